@@ -3,9 +3,12 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <exception>
 #include <stdexcept>
 #include <math.h>
+#include <stdint.h>
+#include <algorithm>
 #include <map>
 #include <vector>
 
@@ -26,6 +29,215 @@ typedef StrMap::const_iterator StrIter;
 typedef std::map<std::string, double> DoubleMap;
 typedef DoubleMap::const_iterator DoubleIter;
 
+// a layer/purpose pair
+struct LayerPurpose {
+    std::string layer;
+    std::string purpose;
+};
+
+typedef std::vector<LayerPurpose> LppList;
+typedef LppList::const_iterator LppIter;
+typedef std::map<std::pair<std::string, std::string>, unsigned int> LppMap;
+
+// an append-only table of interned layer/purpose pairs.  Shapes refer to
+// entries by index, so an id stays valid for the lifetime of the table.
+class LppTable {
+public:
+    LppTable() {}
+
+    unsigned int get_id(const std::string & layer, const std::string & purpose);
+
+    const LayerPurpose & operator[](unsigned int id) const {
+        return lpp_list[id];
+    }
+
+    unsigned int size() const {
+        return (unsigned int) lpp_list.size();
+    }
+
+    LppIter begin() const {
+        return lpp_list.begin();
+    }
+
+    LppIter end() const {
+        return lpp_list.end();
+    }
+
+private:
+    LppList lpp_list;
+    LppMap lpp_map;
+};
+
+// an append-only table of interned names.
+class NameTable {
+public:
+    NameTable() {}
+
+    unsigned int get_id(const std::string & name);
+
+    // look up a name without adding it.  Returns false if it is not in the table.
+    bool find(const std::string & name, unsigned int & id) const;
+
+    const std::string & operator[](unsigned int id) const {
+        return names[id];
+    }
+
+    unsigned int size() const {
+        return (unsigned int) names.size();
+    }
+
+private:
+    std::vector<std::string> names;
+    std::map<std::string, unsigned int> name_map;
+};
+
+// a set of instance parameters
+struct ParamSet {
+    IntMap int_params;
+    StrMap str_params;
+    DoubleMap double_params;
+
+    bool operator==(const ParamSet & other) const {
+        return int_params == other.int_params && str_params == other.str_params
+                && double_params == other.double_params;
+    }
+};
+
+typedef std::vector<ParamSet> ParamSetList;
+
+// a content hash of a parameter set.
+uint64_t hash_params(const ParamSet & params);
+
+// an append-only table of interned parameter sets.  Instances with equal
+// parameters share one entry, so storage scales with the number of distinct
+// parameter sets.
+class ParamTable {
+public:
+    ParamTable() {}
+
+    unsigned int get_id(const ParamSet & params);
+
+    const ParamSet & operator[](unsigned int id) const {
+        return sets[id];
+    }
+
+    unsigned int size() const {
+        return (unsigned int) sets.size();
+    }
+
+private:
+    ParamSetList sets;
+    std::multimap<uint64_t, unsigned int> hash_map;
+};
+
+// the database unit and manufacturing grid coordinates are snapped to.  A
+// dbu_per_uu of 0 means no grid is set.
+struct Grid {
+    Grid() :
+            dbu_per_uu(0), mfg_grid_res(1) {
+    }
+    Grid(unsigned int dbu_per_uu, unsigned int mfg_grid_res) :
+            dbu_per_uu(dbu_per_uu), mfg_grid_res(mfg_grid_res) {
+    }
+
+    bool is_set() const {
+        return dbu_per_uu > 0;
+    }
+
+    bool operator==(const Grid & other) const {
+        return dbu_per_uu == other.dbu_per_uu && mfg_grid_res == other.mfg_grid_res;
+    }
+
+    bool operator!=(const Grid & other) const {
+        return !(*this == other);
+    }
+
+    unsigned int dbu_per_uu;
+    unsigned int mfg_grid_res;
+};
+
+// snap n user-unit coordinates to the given grid and write them as database
+// units.  Returns the number of inputs that were not on the grid.  Throws
+// std::invalid_argument if an input is NaN or its result does not fit in
+// 32 bits; outputs before it may have been written.
+std::size_t quantize(const double * src, int32_t * dst, std::size_t n, const Grid & grid);
+
+// drop repeated points and interior points of straight runs from num_pts
+// interleaved (x, y) database unit coordinates, in place.  Points where a
+// path turns back are kept.  Returns the number of points left.
+std::size_t merge_collinear(int32_t * xy, std::size_t num_pts);
+
+// a list of coordinates.  Coordinates are kept as user-unit doubles, or as
+// snapped database units once a grid is set.
+class CoordArray {
+public:
+    CoordArray() {}
+
+    void set_grid(const Grid & new_grid);
+
+    const Grid & get_grid() const {
+        return grid;
+    }
+
+    bool is_dbu() const {
+        return grid.is_set();
+    }
+
+    std::size_t size() const {
+        return is_dbu() ? ivals.size() : fvals.size();
+    }
+
+    // get a coordinate in user units.
+    double operator[](std::size_t idx) const {
+        return is_dbu() ? ((double) ivals[idx]) / grid.dbu_per_uu : fvals[idx];
+    }
+
+    void reserve(std::size_t n);
+
+    void clear();
+
+    // drop all but the first n coordinates.
+    void truncate(std::size_t n);
+
+    // append n user-unit coordinates.  Returns the number of off-grid inputs.
+    // Appends nothing if quantize() rejects a coordinate.
+    std::size_t append(const double * vals, std::size_t n);
+
+    // append n coordinates already in database units of this array's grid.
+    void append_dbu(const int32_t * vals, std::size_t n);
+
+    // append all coordinates of another array on the same grid.
+    void append(const CoordArray & other);
+
+    // write n coordinates starting at start as database units of the given
+    // grid.  Returns the number of coordinates that were off-grid.
+    std::size_t to_dbu(std::size_t start, std::size_t n, const Grid & target, int32_t * out) const;
+
+    // add dx to even and dy to odd entries of an interleaved (x, y) array.
+    // Returns the number of off-grid offsets.
+    std::size_t shift_xy(double dx, double dy);
+
+    // raw storage, only one of which is in use.
+    const double * fdata() const {
+        return fvals.data();
+    }
+
+    const int32_t * idata() const {
+        return ivals.data();
+    }
+
+private:
+    Grid grid;
+    std::vector<double> fvals;
+    std::vector<int32_t> ivals;
+};
+
+// a range of points in the point arena of a layout
+struct PointRange {
+    std::size_t offset;
+    std::size_t num_pts;
+};
+
 // a layout instance
 struct Inst {
     std::string lib_name;
@@ -36,9 +248,7 @@ struct Inst {
     unsigned char orient;
     int num_rows, num_cols;
     double sp_rows, sp_cols;
-    IntMap int_params;
-    StrMap str_params;
-    DoubleMap double_params;
+    unsigned int params; // id in the parameter table of the layout
 };
 
 typedef std::vector<Inst> InstList;
@@ -46,20 +256,30 @@ typedef InstList::const_iterator InstIter;
 
 // a polygon object
 struct Polygon {
-    std::string layer;
-    std::string purpose;
-    std::vector<double> xcoord;
-    std::vector<double> ycoord;
+    unsigned int lpp;
+    PointRange points;
 };
 
 typedef std::vector<Polygon> PolygonList;
 typedef PolygonList::const_iterator PolygonIter;
+
+// a path through several points.  Interior points use the join style.
+struct Path {
+    unsigned int lpp;
+    PointRange points;
+    double width;
+    unsigned char begin_style;
+    unsigned char end_style;
+    unsigned char join_style;
+};
+
+typedef std::vector<Path> PathList;
+typedef PathList::const_iterator PathIter;
     
 // a boundary object
 struct Boundary {
     std::string type;
-    std::vector<double> xcoord;
-    std::vector<double> ycoord;
+    PointRange points;
 };
 
 typedef std::vector<Boundary> BoundaryList;
@@ -69,8 +289,7 @@ typedef BoundaryList::const_iterator BoundaryIter;
 struct Blockage {
     std::string layer;
     std::string type;
-    std::vector<double> xcoord;
-    std::vector<double> ycoord;
+    PointRange points;
 };
 
 typedef std::vector<Blockage> BlockageList;
@@ -78,8 +297,7 @@ typedef BlockageList::const_iterator BlockageIter;
 
 // a layout rectangle
 struct Rect {
-    std::string layer;
-    std::string purpose;
+    unsigned int lpp;
     double bbox[4];
     int nx, ny;
     double spx, spy;
@@ -88,10 +306,44 @@ struct Rect {
 typedef std::vector<Rect> RectList;
 typedef RectList::const_iterator RectIter;
 
+// rectangles, stored as one dense column per field.
+class RectTable {
+public:
+    RectTable() {}
+
+    std::size_t size() const {
+        return lpp.size();
+    }
+
+    bool empty() const {
+        return lpp.empty();
+    }
+
+    void set_grid(const Grid & grid);
+
+    void reserve(std::size_t n);
+
+    void clear();
+
+    // append n rectangles on one layer.  Returns the number of off-grid coordinates.
+    std::size_t append(unsigned int lpp_id, std::size_t n, const double * box, const int * nx,
+                       const int * ny, const double * sp);
+
+    // append all rectangles of another table on the same grid, with their
+    // layer/purpose ids as is.
+    void append(const RectTable & other);
+
+    Rect operator[](std::size_t idx) const;
+
+    std::vector<unsigned int> lpp;
+    CoordArray bbox;        // (xl, yb, xr, yt) per rectangle
+    std::vector<int> arr_n; // (nx, ny) per rectangle
+    CoordArray arr_sp;      // (spx, spy) per rectangle
+};
+
 // a layout path segment
 struct PathSeg {
-    std::string layer;
-    std::string purpose;
+    unsigned int lpp;
     double x0, y0, x1, y1;
     double width;
     std::string begin_style;
@@ -101,6 +353,41 @@ struct PathSeg {
 typedef std::vector<PathSeg> PathSegList;
 typedef PathSegList::const_iterator PathSegIter;
 
+// path segments, stored as one dense column per field.
+class PathSegTable {
+public:
+    PathSegTable() {}
+
+    std::size_t size() const {
+        return lpp.size();
+    }
+
+    bool empty() const {
+        return lpp.empty();
+    }
+
+    void set_grid(const Grid & grid);
+
+    void reserve(std::size_t n);
+
+    void clear();
+
+    // append a path segment.  Returns the number of off-grid coordinates.
+    std::size_t push_back(unsigned int lpp_id, const double pts[4], double w,
+                          unsigned char begin_style, unsigned char end_style);
+
+    // append all segments of another table on the same grid, with their
+    // layer/purpose ids as is.
+    void append(const PathSegTable & other);
+
+    PathSeg operator[](std::size_t idx) const;
+
+    std::vector<unsigned int> lpp;
+    CoordArray pts;                 // (x0, y0, x1, y1) per segment
+    CoordArray width;
+    std::vector<unsigned char> style; // (begin, end) end style codes per segment
+};
+
 // a layout via
 struct Via {
     std::string via_id;
@@ -120,10 +407,55 @@ struct Via {
 typedef std::vector<Via> ViaList;
 typedef ViaList::const_iterator ViaIter;
 
+// vias, stored as one dense column per field.  Via names are interned, and
+// enclosures are kept as the (xl, yb, xr, yt) boxes they were given as.
+class ViaTable {
+public:
+    ViaTable() {}
+
+    std::size_t size() const {
+        return via_id.size();
+    }
+
+    bool empty() const {
+        return via_id.empty();
+    }
+
+    void set_grid(const Grid & grid);
+
+    void reserve(std::size_t n);
+
+    // remove all vias but keep interned via names.
+    void clear();
+
+    // append a via.  Returns the number of off-grid coordinates.
+    std::size_t push_back(unsigned int id, unsigned char orient_code, const double xy[2],
+                          int num_rows, int num_cols, const double sp[2], const double e1[4],
+                          const double e2[4], const double cut[2], int nx, int ny,
+                          const double asp[2]);
+
+    // append all vias of another table on the same grid.  Via names of other
+    // are interned here.
+    void append(const ViaTable & other);
+
+    Via operator[](std::size_t idx) const;
+
+    NameTable names;
+    std::vector<unsigned int> via_id;
+    std::vector<unsigned char> orient;
+    CoordArray loc;          // (x, y) per via
+    std::vector<int> cut_n;  // (num_rows, num_cols) per via
+    CoordArray cut_sp;       // (x, y) cut spacing per via
+    CoordArray enc1;         // (xl, yb, xr, yt) per via
+    CoordArray enc2;         // (xl, yb, xr, yt) per via
+    CoordArray cut_size;     // (width, height) per via, negative for the default
+    std::vector<int> arr_n;  // (nx, ny) per via
+    CoordArray arr_sp;       // (spx, spy) per via
+};
+
 // a layout pin
 struct Pin {
-    std::string layer;
-    std::string purpose;
+    unsigned int lpp;
     double bbox[4];
     std::string term_name;
     std::string pin_name;
@@ -135,24 +467,79 @@ typedef std::vector<Pin> PinList;
 typedef PinList::const_iterator PinIter;
 
 // a class containing layout information of a cell.
+//
+// By default coordinates are stored in user units and snapped when the
+// layout is written.  If a grid is given, coordinates are snapped as they
+// are added and stored as integer database units instead.  Rectangles,
+// vias and path segments are stored column-wise, and points of all paths,
+// polygons, boundaries and blockages live in one interleaved (x, y) arena.
+// Moving a layout moves its storage without copying shapes.
 class Layout {
 public:
-    Layout() {}
-    ~Layout() {}
+    Layout() :
+            num_off_grid(0) {
+    }
+    Layout(unsigned int dbu_per_uu, unsigned int mfg_grid_res) :
+            num_off_grid(0) {
+        set_grid(dbu_per_uu, mfg_grid_res);
+    }
+
+    void set_grid(unsigned int dbu_per_uu, unsigned int mfg_grid_res);
+
+    const Grid & get_grid() const {
+        return grid;
+    }
+
+    // number of coordinates that were snapped to the grid as they were added.
+    std::size_t get_num_off_grid() const {
+        return num_off_grid;
+    }
 
     void add_inst(const std::string & lib_name, const std::string & cell_name,
                   const std::string & view_name, const std::string & inst_name, double xc, double yc,
                   const std::string & orient, const IntMap & int_params, const StrMap & str_params,
                   const DoubleMap & double_params, int num_rows = 1, int num_cols = 1,
                   double sp_rows = 0.0, double sp_cols = 0.0);
-    
+
+    // add an instance with an interned parameter set.
+    void add_inst(const std::string & lib_name, const std::string & cell_name,
+                  const std::string & view_name, const std::string & inst_name, double xc, double yc,
+                  const std::string & orient, unsigned int params, int num_rows = 1,
+                  int num_cols = 1, double sp_rows = 0.0, double sp_cols = 0.0);
+
+    unsigned int get_param_id(const ParamSet & params) {
+        return param_table.get_id(params);
+    }
+
+    unsigned int get_lpp_id(const std::string & lay_name, const std::string & purp_name) {
+        return lpp_table.get_id(lay_name, purp_name);
+    }
+
     void add_rect(const std::string & lay_name, const std::string & purp_name, double xl, double yb,
                   double xr, double yt, unsigned int nx = 1, unsigned int ny = 1, double spx = 0,
                   double spy = 0);
+
+    void add_rect(unsigned int lpp, double xl, double yb, double xr, double yt,
+                  unsigned int nx = 1, unsigned int ny = 1, double spx = 0, double spy = 0);
+
+    // add n rectangles on one layer.  bbox holds n (xl, yb, xr, yt) rows, nx/ny
+    // hold n array counts and sp holds n (spx, spy) rows.  Optional arrays may
+    // be NULL.
+    void add_rects(unsigned int lpp, std::size_t n, const double * bbox, const int * nx = NULL,
+                   const int * ny = NULL, const double * sp = NULL);
     
     void add_path_seg(const std::string & lay_name, const std::string & purp_name,
                       double x0, double y0, double x1, double y1, double width,
                       const std::string & begin_style, const std::string & end_style);
+
+    void add_path_seg(unsigned int lpp, double x0, double y0, double x1, double y1, double width,
+                      const std::string & begin_style, const std::string & end_style);
+
+    // add a path through num_pts interleaved (x, y) coordinates.  With the
+    // extend join style the path is written as one shape.
+    void add_path(unsigned int lpp, std::size_t num_pts, const double * xy, double width,
+                  const std::string & begin_style, const std::string & end_style,
+                  const std::string & join_style);
     
     void add_via(const std::string & via_name, double xc, double yc, const std::string & orient,
                  unsigned int num_rows, unsigned int num_cols, double sp_rows, double sp_cols,
@@ -160,35 +547,247 @@ public:
                  double enc2_yb, double enc2_xr, double enc2_yt, double cut_width = -1,
                  double cut_height = -1, unsigned int nx = 1, unsigned int ny = 1, double spx = 0,
                  double spy = 0);
+
+    // add n vias of the same type and orientation.  loc and sp hold n (x, y)
+    // rows, enc1/enc2 hold n (xl, yb, xr, yt) rows, and cut_size/arr_sp hold n
+    // (x, y) rows.  Optional arrays may be NULL.
+    void add_vias(const std::string & via_name, const std::string & orient, std::size_t n,
+                  const double * loc, const int * num_rows, const int * num_cols,
+                  const double * sp, const double * enc1, const double * enc2,
+                  const double * cut_size = NULL, const int * nx = NULL, const int * ny = NULL,
+                  const double * arr_sp = NULL);
     
     void add_pin(const std::string & net_name, const std::string & pin_name,
                  const std::string & label, const std::string & lay_name,
                  const std::string & purp_name, double xl, double yb,
                  double xr, double yt, bool make_pin_obj = true);
+
+    void add_pin(const std::string & net_name, const std::string & pin_name,
+                 const std::string & label, unsigned int lpp, double xl, double yb,
+                 double xr, double yt, bool make_pin_obj = true);
+
+    // add n pins on one layer.  bbox holds n (xl, yb, xr, yt) rows.
+    void add_pins(unsigned int lpp, std::size_t n, const double * bbox,
+                  const std::vector<std::string> & net_names,
+                  const std::vector<std::string> & pin_names,
+                  const std::vector<std::string> & labels, bool make_pin_obj = true);
     
     void add_polygon(const std::string & lay_name, const std::string & purp_name,
                      const std::vector<double> & xcoord, const std::vector<double> & ycoord);
+
+    void add_polygon(unsigned int lpp, const std::vector<double> & xcoord,
+                     const std::vector<double> & ycoord);
+
+    // add a polygon from num_pts interleaved (x, y) coordinates.
+    void add_polygon(unsigned int lpp, std::size_t num_pts, const double * xy);
     
     void add_blockage(const std::string & type, const std::string & layer,
                       const std::vector<double> & xcoord, const std::vector<double> & ycoord);
     
+    void add_blockage(const std::string & type, const std::string & layer,
+                      std::size_t num_pts, const double * xy);
+
     void add_boundary(const std::string & type, const std::vector<double> & xcoord,
                       const std::vector<double> & ycoord);
 
+    void add_boundary(const std::string & type, std::size_t num_pts, const double * xy);
+
+    // remove all shapes but keep allocated storage, interned layer/purpose
+    // pairs and parameter sets, and the grid, so the layout can be reused for
+    // another cell.
+    void clear();
+
+    // capacity hints for bulk generators.
+    void reserve_rects(std::size_t n) {
+        rect_list.reserve(n);
+    }
 
+    void reserve_vias(std::size_t n) {
+        via_list.reserve(n);
+    }
+
+    void reserve_path_segs(std::size_t n) {
+        path_seg_list.reserve(n);
+    }
+
+    void reserve_pins(std::size_t n) {
+        pin_list.reserve(n);
+    }
+
+    void reserve_points(std::size_t n) {
+        point_arena.reserve(2 * n);
+    }
+
+    // get the bounding box of all drawn geometry, including arrays.  Vias
+    // and instances contribute their (arrayed) origins only.  Returns false
+    // if the layout has no geometry.
+    bool get_bbox(double bbox[4]) const;
+
+    // translate all shapes and instances by (dx, dy).
+    void move_by(double dx, double dy);
+
+    // move all shapes and instances of other to the end of this layout, and
+    // clear other.  Both layouts must have the same grid.  Storage is
+    // appended one column at a time, and layer/purpose, parameter set and via
+    // ids of other are only rewritten if its tables differ from these.
+    void splice(Layout & other);
+
+
+    LppTable lpp_table;
+    ParamTable param_table;
+    CoordArray point_arena;
     InstList inst_list;
-    RectList rect_list;
-    ViaList via_list;
+    RectTable rect_list;
+    ViaTable via_list;
     PinList pin_list;
-    PathSegList path_seg_list;
+    PathSegTable path_seg_list;
+    PathList path_list;
     PolygonList polygon_list;
     BlockageList block_list;
     BoundaryList boundary_list;
-    
+
+private:
+    void check_lpp(unsigned int lpp) const;
+    void push_via(unsigned int via_id, unsigned char orient, double xc, double yc,
+                  unsigned int num_rows, unsigned int num_cols, double sp_rows, double sp_cols,
+                  double enc1_xl, double enc1_yb, double enc1_xr, double enc1_yt,
+                  double enc2_xl, double enc2_yb, double enc2_xr, double enc2_yt,
+                  double cut_width, double cut_height, unsigned int nx, unsigned int ny,
+                  double spx, double spy);
+    void add_points(PointRange & points, const std::vector<double> & xcoord,
+                    const std::vector<double> & ycoord);
+    void add_points(PointRange & points, std::size_t num_pts, const double * xy);
+
+    Grid grid;
+    std::size_t num_off_grid;
+    std::vector<double> xy_buf;
 };
 
 unsigned char get_orient_code(const std::string & orient_str);
 
+// path end styles
+const unsigned char truncate_style = 0;
+const unsigned char extend_style = 1;
+const unsigned char round_style = 2;
+
+// unrecognized end style names map to truncate.
+unsigned char get_end_style_code(const std::string & style);
+
+std::string get_end_style_name(unsigned char code);
+
+// a content hash of a layout as written on the given grid.  Coordinates are
+// hashed after snapping and layers by name, and the order of shapes within
+// each shape list does not matter.  The hash is stable across processes.
+uint64_t hash_layout(const Layout & layout, const Grid & grid);
+
+// true if two layouts are the same as written on the given grid, comparing
+// everything hash_layout() hashes.  Used to confirm a hash match.
+bool same_layout(const Layout & first, const Layout & second, const Grid & grid);
+
+// a layout output format.  Implementations write a layout as the given cell/view.
+class LayoutWriter {
+public:
+    virtual ~LayoutWriter() {
+    }
+
+    virtual void create_layout(const std::string & cell, const std::string & view,
+            const Layout & layout) = 0;
+};
+
+// receives the contents of a layout one object at a time, as it is read.
+// Layer/purpose pairs and parameter sets are interned by the sink, and later
+// calls refer to them by the returned id.  Arguments are as in Layout.
+class LayoutSink {
+public:
+    virtual ~LayoutSink() {
+    }
+
+    virtual unsigned int get_lpp_id(const std::string & lay_name,
+                                    const std::string & purp_name) = 0;
+
+    virtual unsigned int get_param_id(const ParamSet & params) = 0;
+
+    virtual void add_inst(const std::string & lib_name, const std::string & cell_name,
+                          const std::string & view_name, const std::string & inst_name,
+                          double xc, double yc, const std::string & orient, unsigned int params,
+                          int num_rows, int num_cols, double sp_rows, double sp_cols) = 0;
+
+    virtual void add_rect(unsigned int lpp, double xl, double yb, double xr, double yt) = 0;
+
+    virtual void add_path_seg(unsigned int lpp, double x0, double y0, double x1, double y1,
+                              double width, const std::string & begin_style,
+                              const std::string & end_style) = 0;
+
+    virtual void add_path(unsigned int lpp, std::size_t num_pts, const double * xy, double width,
+                          const std::string & begin_style, const std::string & end_style,
+                          const std::string & join_style) = 0;
+
+    virtual void add_via(const std::string & via_name, double xc, double yc,
+                         const std::string & orient, unsigned int num_rows, unsigned int num_cols,
+                         double sp_rows, double sp_cols, double enc1_xl, double enc1_yb,
+                         double enc1_xr, double enc1_yt, double enc2_xl, double enc2_yb,
+                         double enc2_xr, double enc2_yt, double cut_width,
+                         double cut_height) = 0;
+
+    virtual void add_pin(const std::string & net_name, const std::string & pin_name,
+                         const std::string & label, unsigned int lpp, double xl, double yb,
+                         double xr, double yt, bool make_pin_obj) = 0;
+
+    virtual void add_polygon(unsigned int lpp, std::size_t num_pts, const double * xy) = 0;
+
+    virtual void add_blockage(const std::string & type, const std::string & layer,
+                              std::size_t num_pts, const double * xy) = 0;
+
+    virtual void add_boundary(const std::string & type, std::size_t num_pts,
+                              const double * xy) = 0;
+};
+
+// a sink that adds everything to a layout.
+class LayoutBuilder: public LayoutSink {
+public:
+    explicit LayoutBuilder(Layout & layout) :
+            layout(layout) {
+    }
+
+    unsigned int get_lpp_id(const std::string & lay_name, const std::string & purp_name);
+
+    unsigned int get_param_id(const ParamSet & params);
+
+    void add_inst(const std::string & lib_name, const std::string & cell_name,
+                  const std::string & view_name, const std::string & inst_name, double xc,
+                  double yc, const std::string & orient, unsigned int params, int num_rows,
+                  int num_cols, double sp_rows, double sp_cols);
+
+    void add_rect(unsigned int lpp, double xl, double yb, double xr, double yt);
+
+    void add_path_seg(unsigned int lpp, double x0, double y0, double x1, double y1, double width,
+                      const std::string & begin_style, const std::string & end_style);
+
+    void add_path(unsigned int lpp, std::size_t num_pts, const double * xy, double width,
+                  const std::string & begin_style, const std::string & end_style,
+                  const std::string & join_style);
+
+    void add_via(const std::string & via_name, double xc, double yc, const std::string & orient,
+                 unsigned int num_rows, unsigned int num_cols, double sp_rows, double sp_cols,
+                 double enc1_xl, double enc1_yb, double enc1_xr, double enc1_yt, double enc2_xl,
+                 double enc2_yb, double enc2_xr, double enc2_yt, double cut_width,
+                 double cut_height);
+
+    void add_pin(const std::string & net_name, const std::string & pin_name,
+                 const std::string & label, unsigned int lpp, double xl, double yb, double xr,
+                 double yt, bool make_pin_obj);
+
+    void add_polygon(unsigned int lpp, std::size_t num_pts, const double * xy);
+
+    void add_blockage(const std::string & type, const std::string & layer, std::size_t num_pts,
+                      const double * xy);
+
+    void add_boundary(const std::string & type, std::size_t num_pts, const double * xy);
+
+private:
+    Layout & layout;
+};
+
 /*
  *  Schematic related classes
  */
@@ -1,7 +1,19 @@
 #ifndef BAGOA_H_
 #define BAGOA_H_
 
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <memory>
+#include <set>
+#include <tuple>
+
 #include <bag.hpp>
+#include <library.hpp>
 
 #include "oaDesignDB.h"
 
@@ -20,6 +32,142 @@ typedef std::map<std::string, std::string> StrMap;
 typedef StrMap::const_iterator StrIter;
 typedef std::map<std::string, double> DoubleMap;
 typedef DoubleMap::const_iterator DoubleIter;
+typedef std::map<std::string, oa::oaStdViaDef *> ViaDefMap;
+typedef ViaDefMap::iterator ViaDefIter;
+
+// technology data shared by all libraries that use the same technology library.
+// Never changed once built; a technology that was reopened gets a new entry,
+// and libraries opened before keep the old one.
+struct TechInfo {
+    oa::oaTech * tech_ptr;
+    oa::oaUInt4 dbu_per_uu;
+    oa::oaUInt4 mfg_grid_res;
+    LayerMap lay_map;
+    PurposeMap purp_map;
+};
+
+typedef std::shared_ptr<const TechInfo> TechInfoPtr;
+typedef std::map<std::string, TechInfoPtr> TechCache;
+typedef TechCache::iterator TechIter;
+
+// a layout layer/purpose pair resolved against the technology
+struct OALpp {
+    bool valid;
+    oa::oaLayerNum layer;
+    oa::oaPurposeNum purpose;
+};
+
+typedef std::vector<OALpp> OALppList;
+
+// an instance master resolved once per library session.  If the master
+// design was already open when first used, instances bind to it directly.
+struct InstMaster {
+    oa::oaScalarName lib_name;
+    oa::oaScalarName cell_name;
+    oa::oaScalarName view_name;
+    oa::oaDesign * design;
+};
+
+typedef std::tuple<std::string, std::string, std::string> MasterKey;
+typedef std::map<MasterKey, InstMaster> MasterMap;
+typedef MasterMap::iterator MasterIter;
+
+// a layout with layers resolved and all coordinates snapped to the grid.
+// Preparing a layout does not touch the OA database, so several layouts can
+// be prepared in parallel while another thread writes.
+struct PreparedLayout {
+    const bag::Layout * layout;
+    OALppList lpp_oa;
+    std::vector<int32_t> inst_xy;   // (x, y, sp_cols, sp_rows) per instance
+    std::vector<int32_t> rect_box;  // (xl, yb, xr, yt) per rectangle
+    std::vector<int32_t> rect_sp;   // (spx, spy) per rectangle
+    std::vector<int32_t> seg_pts;   // (x0, y0, x1, y1) per path segment
+    std::vector<int32_t> seg_width; // (width, diagonal extension) per path segment
+    std::vector<int32_t> via_par;   // via_par_size values per via, see prepare_layout()
+    std::vector<int32_t> pin_box;   // (xl, yb, xr, yt) per pin
+    std::vector<int32_t> points;    // snapped copy of the layout point arena
+    std::vector<std::string> lpp_errors; // why each unresolved layer/purpose is skipped
+    std::size_t num_off_grid;
+    std::string hash;               // content hash stored on the written design, if skipping
+    double prep_time;               // seconds spent in prepare_layout()
+
+    PreparedLayout() :
+            layout(NULL), num_off_grid(0), prep_time(0) {
+    }
+};
+
+// the phases of a layout write timed by WriteStats.  Each shape phase covers
+// the OA calls that create the shapes of one layout list.
+enum WritePhase {
+    phase_prepare, phase_hash_check, phase_open, phase_inst, phase_rect, phase_path_seg,
+    phase_path, phase_via, phase_pin, phase_polygon, phase_blockage, phase_boundary,
+    phase_save, phase_close, num_write_phases
+};
+
+// classes of OA calls counted by WriteStats.  Lookups are finds of masters,
+// via definitions, nets and terminals; design calls open, save and close
+// designs and set their properties.
+enum OACallClass {
+    call_lookup, call_design, call_inst, call_shape, call_via, call_conn, call_blockage,
+    call_boundary, num_call_classes
+};
+
+const char * get_phase_name(unsigned int phase);
+
+const char * get_call_class_name(unsigned int cls);
+
+typedef std::map<std::string, std::size_t> SkipMap;
+typedef SkipMap::const_iterator SkipIter;
+
+// timers and counters of layout writes.
+struct WriteStats {
+    std::size_t num_layouts;
+    double time[num_write_phases];          // seconds spent in each phase
+    std::size_t count[num_write_phases];    // layout objects handled in each phase
+    std::size_t calls[num_call_classes];    // OA calls by class
+    SkipMap skipped;                        // objects not written, by reason
+
+    WriteStats() {
+        clear();
+    }
+
+    void clear();
+};
+
+typedef std::vector<const bag::Layout *> LayoutPtrList;
+
+// the result of a layout write queued with create_layout_async().
+class WriteTicket {
+public:
+    WriteTicket() {
+    }
+    explicit WriteTicket(const std::shared_future<void> & result) :
+            result(result) {
+    }
+
+    // true once the layout was written or failed.
+    bool is_done() const {
+        return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // wait for the write, rethrowing its error if it failed.
+    void wait() const {
+        result.get();
+    }
+
+private:
+    std::shared_future<void> result;
+};
+
+// a layout waiting in the write queue
+struct WriteJob {
+    std::string cell;
+    std::string view;
+    bag::Layout layout;
+    std::promise<void> result;
+};
+
+typedef std::deque<std::unique_ptr<WriteJob> > WriteQueue;
 
 class LibDefObserver: public oa::oaObserver<oa::oaLibDefList> {
 public:
@@ -31,13 +179,23 @@ public:
             oa::oaLibDefListWarningTypeEnum type);
 };
 
-class OALayoutLibrary {
+// initialize OA once per process, then read the given library definition file
+// unless it was read before.  Returns true if the file was read.
+bool open_lib_defs(const std::string & lib_file);
+
+// get the cached technology of the given library, opening it on first use.
+TechInfoPtr get_tech_info(oa::oaLib * lib_ptr, const std::string & library);
+
+class OALayoutLibrary: public bag::LayoutWriter {
 public:
     OALayoutLibrary() :
-            is_open(false), dbu_per_uu(1000), mfg_grid_res(1), lib_def_obs(1), lib_ptr(NULL), tech_ptr(NULL) {
-    }
-    ~OALayoutLibrary() {
+            is_open(false), dbu_per_uu(1000), mfg_grid_res(1), lib_def_obs(1),
+            lib_ptr(NULL), tech_ptr(NULL), skip_unchanged(false),
+            num_hash_hits(0), num_hash_misses(0), num_master_hits(0), num_master_misses(0),
+            num_via_def_hits(0), num_via_def_misses(0), collect_stats(false), max_queued(2),
+            stop_writer(false) {
     }
+    virtual ~OALayoutLibrary();
 
     void open_library(const std::string & lib_file, const std::string & library,
                       const std::string & lib_path, const std::string & tech_lib);
@@ -51,18 +209,148 @@ public:
     void create_layout(const std::string & cell, const std::string & view,
             const bag::Layout & layout);
 
+    // queue a layout to be written on the writer thread, and return without
+    // waiting for the write.  The layout is moved into the queue.  Blocks
+    // while the queue is full.  A failed write rethrows on the ticket, and
+    // the first failure also on close().
+    //
+    // OA is never used from two threads at once: OA calls of all writers in
+    // the process, including the writer thread, hold one process-wide lock,
+    // and every other call of this library waits for the queue to drain.
+    WriteTicket create_layout_async(const std::string & cell, const std::string & view,
+            bag::Layout && layout);
+
+    // number of layouts the write queue holds before create_layout_async()
+    // blocks.  Bounds the memory of layouts waiting to be written.
+    void set_max_queued(std::size_t val);
+
+    // wait until all queued layouts are written.
+    void flush();
+
+    // write several layouts.  Layouts are prepared on num_threads worker threads
+    // (0 to use all cores), and written in order on the calling thread.
+    void create_layouts(const std::vector<std::string> & cells,
+            const std::vector<std::string> & views, const LayoutPtrList & layouts,
+            unsigned int num_threads = 0);
+
+    // write all cells of an in-memory library bottom-up, as create_layouts().
+    // The in-memory library must be named after this library.
+    void create_library(const bag::LayoutLibrary & cells, unsigned int num_threads = 0);
+
+    // read a design of this library into the sink, one object at a time.
+    // Layers and purposes are named through the technology tables.  Returns
+    // the number of objects skipped because they have no layout equivalent,
+    // such as text, custom vias, or shapes on unknown layers.
+    std::size_t read_layout(const std::string & cell, const std::string & view,
+            bag::LayoutSink & sink);
+
+    // read a design of this library into a layout.
+    std::size_t read_layout(const std::string & cell, const std::string & view,
+            bag::Layout & layout);
+
+    // resolve layers and snap coordinates of the given layout.  Does not use OA,
+    // and is safe to call from several threads at once.
+    void prepare_layout(const bag::Layout & layout, PreparedLayout & prep) const;
+
+    // if set, layouts whose content hash matches the hash stored on the
+    // existing design are not rewritten.  Off by default.  The hash covers the
+    // snapped shapes and the resolved layer numbers only, so a skipped design
+    // keeps any edits made to it by hand (they leave the stored hash as it
+    // was), and changes to via definitions or the technology do not cause a
+    // rewrite.  Turn it off, or delete the design, after such changes.  The
+    // hash is only computed and stored while this is set, so designs written
+    // before it was set are rewritten once.
+    void set_skip_unchanged(bool val) {
+        skip_unchanged = val;
+    }
+
+    // number of layouts skipped because they were unchanged, and written
+    // because they were new or changed, since the library was opened.
+    std::size_t get_num_hash_hits() const {
+        return num_hash_hits;
+    }
+
+    std::size_t get_num_hash_misses() const {
+        return num_hash_misses;
+    }
+
+    // instance masters and via definitions found in the session caches, and
+    // looked up in OA, since the library was opened.
+    std::size_t get_num_master_hits() const {
+        return num_master_hits;
+    }
+
+    std::size_t get_num_master_misses() const {
+        return num_master_misses;
+    }
+
+    std::size_t get_num_via_def_hits() const {
+        return num_via_def_hits;
+    }
+
+    std::size_t get_num_via_def_misses() const {
+        return num_via_def_misses;
+    }
+
+    // if set, time each write phase and count OA calls into the write
+    // statistics.  Skipped objects are always reported, once per reason and
+    // layout, and also counted while set.
+    void set_collect_stats(bool val) {
+        collect_stats = val;
+    }
+
+    // write statistics collected since the library was opened or the
+    // statistics were reset.  Like the counters above, only stable while no
+    // write is queued; call flush() first.
+    const WriteStats & get_stats() const {
+        return stats;
+    }
+
+    void reset_stats() {
+        stats.clear();
+    }
+
 private:
-    oa::oaCoord double_to_oa(double val);
-    void array_figure(oa::oaFig * fig_ptr, unsigned int nx, unsigned int ny, double spx,
-            double spy);
-    void create_inst(oa::oaBlock * blk_ptr, const bag::Inst & inst);
-    void create_rect(oa::oaBlock * blk_ptr, const bag::Rect & inst);
-    void create_path_seg(oa::oaBlock * blk_ptr, const bag::PathSeg & inst);
-    void create_via(oa::oaBlock * blk_ptr, const bag::Via & inst);
-    void create_pin(oa::oaBlock * blk_ptr, const bag::Pin & inst);
-    void create_polygon(oa::oaBlock * blk_ptr, const bag::Polygon & inst);
-    void create_blockage(oa::oaBlock * blk_ptr, const bag::Blockage & inst);
-    void create_boundary(oa::oaBlock * blk_ptr, const bag::Boundary & inst);
+    typedef std::chrono::steady_clock Clock;
+
+    void count_calls(OACallClass cls, std::size_t num = 1) {
+        if (collect_stats) {
+            stats.calls[cls] += num;
+        }
+    }
+
+    void end_phase(WritePhase phase, std::size_t num, Clock::time_point & mark);
+    void run_writer();
+    void stop_writer_thread();
+    void skip(const std::string & reason);
+    void report_skips(const std::string & cell, const PreparedLayout & prep);
+    void write_layout(const std::string & cell, const std::string & view,
+            const PreparedLayout & prep);
+    bool is_unchanged(const oa::oaScalarName & cell_name, const oa::oaScalarName & view_name,
+            const std::string & hash);
+    void resolve_lpp_table(const bag::LppTable & lpp_table, PreparedLayout & prep) const;
+    oa::oaCoord double_to_oa(double val) const;
+    void get_seg_width(const int32_t * seg_ptr, double seg_width, int32_t * out) const;
+    oa::oaStdViaDef * find_via_def(const std::string & via_name);
+    const InstMaster & find_master(const bag::Inst & inst);
+    void make_point_array(const PreparedLayout & prep, const bag::PointRange & points,
+            oa::oaPointArray & pt_arr);
+    void create_inst(oa::oaBlock * blk_ptr, const bag::Inst & inst, const int32_t * xy,
+            const oa::oaParamArray & oa_params);
+    void create_rects(oa::oaBlock * blk_ptr, const PreparedLayout & prep);
+    void create_path_segs(oa::oaBlock * blk_ptr, const PreparedLayout & prep);
+    void create_path_seg(oa::oaBlock * blk_ptr, const OALpp & lpp, const int32_t * seg_ptr,
+            const int32_t * width_ptr, unsigned char begin_style, unsigned char end_style);
+    void create_paths(oa::oaBlock * blk_ptr, const PreparedLayout & prep);
+    void create_vias(oa::oaBlock * blk_ptr, const PreparedLayout & prep);
+    void create_pin(oa::oaBlock * blk_ptr, const OALpp & lpp, const bag::Pin & inst,
+            const int32_t * box_ptr);
+    void create_polygon(oa::oaBlock * blk_ptr, const PreparedLayout & prep,
+            const bag::Polygon & inst);
+    void create_blockage(oa::oaBlock * blk_ptr, const PreparedLayout & prep,
+            const bag::Blockage & inst);
+    void create_boundary(oa::oaBlock * blk_ptr, const PreparedLayout & prep,
+            const bag::Boundary & inst);
 
     bool is_open;
     oa::oaUInt4 dbu_per_uu;
@@ -74,6 +362,27 @@ private:
     oa::oaLib * lib_ptr;
     oa::oaTech * tech_ptr;
     oa::oaScalarName lib_name;
+    bool skip_unchanged;
+    std::size_t num_hash_hits;
+    std::size_t num_hash_misses;
+    MasterMap master_cache;
+    ViaDefMap via_def_cache;
+    std::size_t num_master_hits;
+    std::size_t num_master_misses;
+    std::size_t num_via_def_hits;
+    std::size_t num_via_def_misses;
+    bool collect_stats;
+    WriteStats stats;
+    std::vector<std::size_t> lpp_skips; // skipped shapes per layer/purpose of the current layout
+    SkipMap skips;                      // other skipped objects of the current layout
+
+    WriteQueue write_queue;             // the front job stays queued while it is written
+    std::size_t max_queued;
+    std::thread writer;
+    bool stop_writer;
+    std::exception_ptr write_error;     // first failed queued write, rethrown by close()
+    std::mutex queue_mtx;
+    std::condition_variable queue_cv;
 };
 
 class OASchematicWriter {
@@ -86,12 +395,20 @@ public:
 
     void open_library(const std::string & lib_path, const std::string & library);
 
+    // copy the schematic and symbol of each cell, then apply its pin renames
+    // and instance substitutions to the copies.
     void create_schematics(const std::vector<bag::SchCell> & cell_list,
             const std::string & sch_name, const std::string & sym_name);
 
     void close();
 
 private:
+    void edit_copy(const bag::SchCell & cell, const oa::oaScalarName & view_name,
+            bool replace_insts);
+    void rename_pins(oa::oaBlock * blk_ptr, const bag::SchCell & cell);
+    void replace_inst(oa::oaBlock * blk_ptr, const bag::SchCell & cell,
+            const std::string & inst_name, const std::vector<bag::SchInst> & inst_list);
+
     bool is_open;
     LibDefObserver lib_def_obs;
 
@@ -100,6 +417,18 @@ private:
 };
 
 oa::oaString get_orient_name(unsigned char orient_code);
+
+// the orientation with the given code.  The objects are built once.
+const oa::oaOrient & get_orient(unsigned char orient_code);
+
+// the code of the given orientation, the inverse of get_orient().
+unsigned char get_orient_code(const oa::oaOrient & orient);
+
+void make_param_array(const bag::ParamSet & params, oa::oaParamArray & oa_params);
+
+// the inverse of make_param_array().  Parameter types without an equivalent
+// are dropped.
+void read_param_array(const oa::oaParamArray & oa_params, bag::ParamSet & params);
 }
 
 #endif
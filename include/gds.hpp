@@ -0,0 +1,172 @@
+#ifndef BAG_GDS_H_
+#define BAG_GDS_H_
+
+#include <set>
+#include <time.h>
+
+#include <bag.hpp>
+
+namespace bag {
+
+// a via definition used for stream out.  GDSII has no via objects, so vias
+// are written as flat cut and enclosure rectangles.
+struct GdsViaDef {
+    std::string bot_layer;
+    std::string cut_layer;
+    std::string top_layer;
+    std::string purpose;
+    double cut_width, cut_height;
+};
+
+typedef std::map<std::string, GdsViaDef> GdsViaDefMap;
+typedef GdsViaDefMap::const_iterator GdsViaDefIter;
+typedef std::map<std::string, int> GdsNumMap;
+typedef GdsNumMap::const_iterator GdsNumIter;
+
+// a layout layer/purpose pair resolved to GDSII layer/datatype numbers
+struct GdsLpp {
+    bool valid;
+    int layer;
+    int datatype;
+};
+
+typedef std::vector<GdsLpp> GdsLppList;
+
+// a generated structure holding one rectangle, referenced by AREFs of arrayed rectangles.
+struct GdsRectCell {
+    std::string name;
+    GdsLpp lpp;
+    int32_t width, height;
+};
+
+typedef std::vector<GdsRectCell> GdsRectCellList;
+
+// via shapes in database units and via coordinates.  The cut box is the lower
+// left cut, cuts repeat with pitch (cut_px, cut_py).
+struct GdsViaShapes {
+    int32_t bot[4];
+    int32_t top[4];
+    int32_t cut[4];
+    int cut_nx, cut_ny;
+    int32_t cut_px, cut_py;
+};
+
+// a generated structure holding the shapes of one via, referenced by the
+// SREFs and AREFs of every via with the same shapes.
+struct GdsViaCell {
+    std::string name;
+    GdsLpp lpp[3];
+    GdsViaShapes shapes;
+};
+
+typedef std::vector<GdsViaCell> GdsViaCellList;
+typedef std::map<std::string, std::string> GdsNameMap;
+
+// apply the orientation with the given code to the point (x, y).
+void orient_point(unsigned char orient, int32_t x, int32_t y, int32_t & xo, int32_t & yo);
+
+// apply the orientation with the given code to the box (xl, yb, xr, yt).
+void orient_box(unsigned char orient, const int32_t box[4], int32_t out[4]);
+
+// get the stream transform of an orientation code, i.e. whether to reflect
+// about the x axis and the counterclockwise rotation angle applied after.
+void get_orient_strans(unsigned char orient, bool & reflect, int & angle);
+
+// compute the shapes of the given via on the given grid.
+void get_via_shapes(const ViaTable & vias, std::size_t idx, const Grid & grid,
+        const GdsViaDef & vdef, GdsViaShapes & shapes);
+
+// writes layouts to a GDSII stream file without going through OpenAccess.
+// Arrays of rectangles and vias, and via cut arrays, become AREFs of
+// generated structures named after the cell.
+// Records are collected in a large buffer and written out sequentially.
+// Layout names map to GDSII layers and purposes map to datatypes.
+class GdsWriter: public LayoutWriter {
+public:
+    GdsWriter() :
+            is_open(false), grid(1000, 1), num_off_grid(0) {
+    }
+    virtual ~GdsWriter();
+
+    void open(const std::string & fname, const std::string & lib_name,
+              unsigned int dbu_per_uu = 1000, unsigned int mfg_grid_res = 1);
+
+    void add_layer(const std::string & lay_name, unsigned int lay_num);
+
+    void add_purpose(const std::string & purp_name, unsigned int purp_num);
+
+    void add_via_def(const std::string & via_name, const std::string & bot_layer,
+                     const std::string & cut_layer, const std::string & top_layer,
+                     const std::string & purpose, double cut_width, double cut_height);
+
+    void close();
+
+    // write the layout as a GDSII structure.  The view name is ignored.
+    void create_layout(const std::string & cell, const std::string & view,
+            const Layout & layout);
+
+    std::size_t get_num_off_grid() const {
+        return num_off_grid;
+    }
+
+private:
+    int32_t to_dbu(double val) const;
+    bool resolve_lpp(const std::string & layer, const std::string & purpose, GdsLpp & lpp);
+
+    void write_rects(const std::string & cell, const Layout & layout);
+    void write_path_segs(const Layout & layout);
+    void write_paths(const Layout & layout);
+    void write_vias(const std::string & cell, const Layout & layout);
+    void write_pins(const Layout & layout);
+    void write_inst(const Inst & inst);
+    std::string get_rect_cell(const std::string & cell, const GdsLpp & lpp, int32_t width,
+            int32_t height);
+    void write_via_cell(const std::string & cell, const GdsViaCell & via_cell);
+    void write_polygon(const GdsLpp & lpp, const PointRange & points);
+
+    // element writers, coordinates are in database units.
+    void write_box(const GdsLpp & lpp, int32_t xl, int32_t yb, int32_t xr, int32_t yt);
+    void write_boundary(const GdsLpp & lpp, const int32_t * xy, std::size_t num_pts);
+    void write_path(const GdsLpp & lpp, int32_t width, unsigned char begin_style,
+                    unsigned char end_style, const int32_t * xy, std::size_t num_pts);
+    void write_text(const GdsLpp & lpp, int32_t x, int32_t y, bool vertical,
+                    const std::string & text);
+    void write_ref(const std::string & master, unsigned char orient, int32_t x, int32_t y,
+                   int nx, int ny, int32_t spx, int32_t spy);
+    void write_struct_begin(const std::string & name);
+    void write_struct_end();
+
+    // record writers
+    void begin_record(uint16_t rec_type, std::size_t num_bytes);
+    void put_int16(int16_t val);
+    void put_int32(int32_t val);
+    void put_real8(double val);
+    void put_string(const std::string & val);
+    void write_string_record(uint16_t rec_type, const std::string & val);
+    void write_int16_record(uint16_t rec_type, int16_t val);
+    void write_timestamp(uint16_t rec_type);
+    void flush();
+
+    bool is_open;
+    Grid grid;
+    std::size_t num_off_grid;
+    std::ofstream out;
+    std::vector<char> buf;
+    GdsNumMap lay_map;
+    GdsNumMap purp_map;
+    GdsViaDefMap via_defs;
+    std::set<std::string> helper_cells;
+    GdsRectCellList pending_helpers;
+    GdsViaCellList pending_vias;
+    GdsNameMap via_cells;
+
+    // per-layout scratch space
+    GdsLppList lpp_gds;
+    std::vector<int32_t> box_buf;
+    std::vector<int32_t> sp_buf;
+    std::vector<int32_t> pt_buf;
+};
+
+}
+
+#endif
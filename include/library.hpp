@@ -0,0 +1,95 @@
+#ifndef BAG_LIBRARY_H_
+#define BAG_LIBRARY_H_
+
+#include <deque>
+#include <map>
+
+#include <bag.hpp>
+
+namespace bag {
+
+typedef std::multimap<uint64_t, std::size_t> LayoutHashMap;
+typedef LayoutHashMap::const_iterator LayoutHashIter;
+
+// an in-memory library of generated layout cells that may instantiate each
+// other.
+//
+// An instance refers to a cell of the library if its library name is empty
+// or the name of this library, and its cell name was added before.  Such
+// instances are stored with the library name and view of this library, and
+// with the name of the cell they resolve to.  Cells must therefore be added
+// bottom-up, and an empty library name with an unknown cell is an error.
+//
+// A cell with the same content as a cell added before is not stored again.
+// Cells are matched by content hash, then compared in full, so a hash
+// collision never aliases two different cells.  The name of a duplicate
+// becomes an alias of the earlier cell, and parents that instantiate either
+// name are identical in turn.
+class LayoutLibrary {
+public:
+    LayoutLibrary() :
+            view_name("layout"), grid(1000, 1), num_dups(0) {
+    }
+
+    LayoutLibrary(const std::string & lib_name, const std::string & view_name,
+                  unsigned int dbu_per_uu, unsigned int mfg_grid_res) :
+            lib_name(lib_name), view_name(view_name), grid(dbu_per_uu, mfg_grid_res),
+            num_dups(0) {
+    }
+
+    const std::string & get_lib_name() const {
+        return lib_name;
+    }
+
+    const std::string & get_view_name() const {
+        return view_name;
+    }
+
+    // add a copy of the layout as the given cell.  Returns the name of the
+    // stored cell, which differs from cell if the layout is a duplicate.
+    const std::string & add_cell(const std::string & cell, const Layout & layout);
+
+    bool has_cell(const std::string & cell) const {
+        return cell_map.find(cell) != cell_map.end();
+    }
+
+    // the name of the stored cell the given cell name resolves to.
+    const std::string & resolve(const std::string & cell) const;
+
+    // number of stored cells, in the order they were added.
+    std::size_t size() const {
+        return layouts.size();
+    }
+
+    const std::string & get_cell_name(std::size_t idx) const {
+        return names[idx];
+    }
+
+    const Layout & operator[](std::size_t idx) const {
+        return layouts[idx];
+    }
+
+    // number of added cells that were duplicates of stored cells.
+    std::size_t get_num_duplicates() const {
+        return num_dups;
+    }
+
+    // write all stored cells bottom-up.
+    void write(LayoutWriter & writer) const;
+
+    void clear();
+
+private:
+    std::string lib_name;
+    std::string view_name;
+    Grid grid;
+    std::deque<Layout> layouts;     // stable addresses as cells are added
+    std::vector<std::string> names;
+    std::map<std::string, std::size_t> cell_map;   // added name to stored cell
+    LayoutHashMap hash_map;                        // content hash to stored cells
+    std::size_t num_dups;
+};
+
+}
+
+#endif
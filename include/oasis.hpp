@@ -0,0 +1,118 @@
+#ifndef BAG_OASIS_H_
+#define BAG_OASIS_H_
+
+#include <gds.hpp>
+
+namespace bag {
+
+typedef std::vector<unsigned char> ByteList;
+
+// nx by ny copies of an element, placed along the lattice vectors (ax, ay)
+// and (bx, by), in database units.
+struct OasisRep {
+    int nx, ny;
+    int32_t ax, ay, bx, by;
+};
+
+// modal variables of an OASIS stream, reset at the start of every cell.
+struct OasisModal {
+    bool has_layer, has_datatype, has_text_layer, has_text_type, has_width, has_height;
+    bool has_half_width, has_ext, has_text, has_place_cell;
+    uint64_t layer, datatype, text_layer, text_type, width, height, half_width;
+    int64_t geom_x, geom_y, text_x, text_y, place_x, place_y;
+    int64_t start_ext, end_ext;
+    std::string text, place_cell;
+    ByteList rep;
+};
+
+// writes layouts to an OASIS file without going through OpenAccess.  Arrayed
+// rectangles, vias and instances are written as OASIS repetitions, repeated
+// values are omitted through modal variables, and cell contents are deflate
+// compressed in CBLOCKs when built with zlib.  Layer, purpose and via mapping
+// works as in GdsWriter.
+class OasisWriter: public LayoutWriter {
+public:
+    OasisWriter() :
+            is_open(false), grid(1000, 1), num_off_grid(0), compress(true),
+            use_repetitions(true) {
+    }
+    virtual ~OasisWriter();
+
+    // open the file.  Setting repetitions to false expands every array into
+    // individual elements, and compress is ignored without zlib.
+    void open(const std::string & fname, unsigned int dbu_per_uu = 1000,
+              unsigned int mfg_grid_res = 1, bool compress = true, bool repetitions = true);
+
+    void add_layer(const std::string & lay_name, unsigned int lay_num);
+
+    void add_purpose(const std::string & purp_name, unsigned int purp_num);
+
+    void add_via_def(const std::string & via_name, const std::string & bot_layer,
+                     const std::string & cut_layer, const std::string & top_layer,
+                     const std::string & purpose, double cut_width, double cut_height);
+
+    void close();
+
+    // write the layout as an OASIS cell.  The view name is ignored.
+    void create_layout(const std::string & cell, const std::string & view,
+            const Layout & layout);
+
+    std::size_t get_num_off_grid() const {
+        return num_off_grid;
+    }
+
+private:
+    int32_t to_dbu(double val) const;
+    bool resolve_lpp(const std::string & layer, const std::string & purpose, GdsLpp & lpp);
+    void reset_modal();
+
+    void write_rects(const Layout & layout);
+    void write_path_segs(const Layout & layout);
+    void write_paths(const Layout & layout);
+    void write_vias(const Layout & layout);
+    void write_pins(const Layout & layout);
+    void write_inst(const Inst & inst);
+    void write_points(const GdsLpp & lpp, const PointRange & points);
+
+    // element writers, coordinates are in database units.
+    void write_rect(const GdsLpp & lpp, int32_t x, int32_t y, int32_t w, int32_t h,
+                    const OasisRep & rep);
+    void write_polygon(const GdsLpp & lpp, const int32_t * xy, std::size_t num_pts);
+    void write_path(const GdsLpp & lpp, int32_t width, unsigned char begin_style,
+                    unsigned char end_style, const int32_t * xy, std::size_t num_pts);
+    void write_text(const GdsLpp & lpp, int32_t x, int32_t y, const std::string & text);
+    void write_placement(const std::string & master, unsigned char orient, int32_t x,
+                         int32_t y, const OasisRep & rep);
+    void write_repetition(const OasisRep & rep);
+    void write_point_list(const int32_t * xy, std::size_t num_pts);
+    void end_element();
+
+    // move buffered records to the file buffer, in a CBLOCK if compressing.
+    void flush_records(bool allow_compress);
+    void flush();
+
+    bool is_open;
+    Grid grid;
+    std::size_t num_off_grid;
+    bool compress;
+    bool use_repetitions;
+    std::ofstream out;
+    ByteList out_buf;
+    ByteList rec_buf;
+    ByteList rep_buf;
+    ByteList zip_buf;
+    OasisModal modal;
+    GdsNumMap lay_map;
+    GdsNumMap purp_map;
+    GdsViaDefMap via_defs;
+
+    // per-layout scratch space
+    GdsLppList lpp_oas;
+    std::vector<int32_t> box_buf;
+    std::vector<int32_t> sp_buf;
+    std::vector<int32_t> pt_buf;
+};
+
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef BAG_SERIALIZE_H_
+#define BAG_SERIALIZE_H_
+
+#include <bag.hpp>
+
+namespace bag {
+
+// Binary layout images.
+//
+// An image is a header, a directory of sections and the section data.  Every
+// section is a dense column of fixed size elements aligned to 8 bytes, so a
+// memory mapped image can be read in place.  Strings are interned into one
+// pool and referred to by index.  Coordinate columns hold int32 database
+// units if the layout has a grid and doubles otherwise.  Numbers are stored
+// in native byte order; images from a machine with a different byte order
+// are rejected.
+
+const uint32_t layout_image_version = 3;
+
+// section ids, in directory order.
+enum LayoutSection {
+    sec_str_offsets,    // uint64, one past the end of each string in the pool
+    sec_str_chars,      // char
+    sec_lpp,            // uint32 (layer, purpose) string ids
+    sec_points,         // coordinate, point arena
+    sec_inst_str,       // uint32 (lib, cell, view, name) string ids
+    sec_inst_orient,    // uint8
+    sec_inst_loc,       // double (x, y, sp_rows, sp_cols)
+    sec_inst_arr_n,     // int32 (num_rows, num_cols)
+    sec_inst_params,    // uint32 parameter set id
+    sec_param_counts,   // uint32 (int, string, double) parameter counts per set
+    sec_int_param_key,  // uint32 string id
+    sec_int_param_val,  // int32
+    sec_str_param_key,  // uint32 string id
+    sec_str_param_val,  // uint32 string id
+    sec_dbl_param_key,  // uint32 string id
+    sec_dbl_param_val,  // double
+    sec_rect_lpp,       // uint32
+    sec_rect_bbox,      // coordinate (xl, yb, xr, yt)
+    sec_rect_arr_n,     // int32 (nx, ny)
+    sec_rect_arr_sp,    // coordinate (spx, spy)
+    sec_via_names,      // uint32 string id per interned via name
+    sec_via_id,         // uint32
+    sec_via_orient,     // uint8
+    sec_via_loc,        // coordinate (x, y)
+    sec_via_cut_n,      // int32 (num_rows, num_cols)
+    sec_via_cut_sp,     // coordinate (x, y)
+    sec_via_enc1,       // coordinate (xl, yb, xr, yt)
+    sec_via_enc2,       // coordinate (xl, yb, xr, yt)
+    sec_via_cut_size,   // coordinate (width, height)
+    sec_via_arr_n,      // int32 (nx, ny)
+    sec_via_arr_sp,     // coordinate (spx, spy)
+    sec_pin_lpp,        // uint32
+    sec_pin_bbox,       // double (xl, yb, xr, yt)
+    sec_pin_str,        // uint32 (term, pin, label) string ids
+    sec_pin_obj,        // uint8
+    sec_seg_lpp,        // uint32
+    sec_seg_pts,        // coordinate (x0, y0, x1, y1)
+    sec_seg_width,      // coordinate
+    sec_seg_style,      // uint8 (begin, end)
+    sec_path_lpp,       // uint32
+    sec_path_pts,       // uint64 (offset, num_pts) into the point arena
+    sec_path_width,     // double
+    sec_path_style,     // uint8 (begin, end, join)
+    sec_poly_lpp,       // uint32
+    sec_poly_pts,       // uint64 (offset, num_pts) into the point arena
+    sec_block_str,      // uint32 (layer, type) string ids
+    sec_block_pts,      // uint64 (offset, num_pts)
+    sec_bound_str,      // uint32 type string id
+    sec_bound_pts,      // uint64 (offset, num_pts)
+    num_layout_sections
+};
+
+struct LayoutImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t dbu_per_uu;
+    uint32_t mfg_grid_res;
+    uint32_t num_sections;
+    uint32_t reserved;
+};
+
+struct LayoutSectionEntry {
+    uint64_t offset;
+    uint64_t count;
+    uint32_t elem_size;
+    uint32_t reserved;
+};
+
+// serialize a layout into one contiguous buffer.  The buffer is replaced.
+void serialize_layout(const Layout & layout, std::vector<char> & buf);
+
+// rebuild a layout from a serialized image.  Any previous content of the
+// layout, including its layer/purpose table and grid, is replaced.
+void deserialize_layout(const char * data, std::size_t size, Layout & layout);
+
+// write a layout image to a file.
+void save_layout(const std::string & fname, const Layout & layout);
+
+// read a layout image from a memory mapped file.
+void load_layout(const std::string & fname, Layout & layout);
+
+// a read-only view of a serialized layout.  The view does not own the data,
+// which must be 8 byte aligned and outlive the view.  Columns are returned
+// as pointers into the image.
+class LayoutImage {
+public:
+    LayoutImage() :
+            data(NULL), size(0), dir(NULL) {
+    }
+    LayoutImage(const char * data, std::size_t size) :
+            data(NULL), size(0), dir(NULL) {
+        reset(data, size);
+    }
+
+    // check the header and the section directory, and view the given data.
+    void reset(const char * data, std::size_t size);
+
+    bool empty() const {
+        return data == NULL;
+    }
+
+    const Grid & get_grid() const {
+        return grid;
+    }
+
+    // number of elements in a section.
+    std::size_t count(unsigned int sec) const {
+        return (std::size_t) dir[sec].count;
+    }
+
+    // the elements of a section.  Throws if the element type does not match.
+    template<typename T>
+    const T * column(unsigned int sec) const {
+        if (dir[sec].elem_size != sizeof(T)) {
+            throw std::invalid_argument("Layout image section has a different element size.");
+        }
+        return reinterpret_cast<const T *>(data + dir[sec].offset);
+    }
+
+    std::string get_string(uint32_t id) const;
+
+    // copy the image into a layout.
+    void load(Layout & layout) const;
+
+private:
+    void check_count(unsigned int sec, std::size_t expected) const;
+    void check_ids(unsigned int sec, std::size_t limit) const;
+    void append_coords(unsigned int sec, CoordArray & arr) const;
+
+    const char * data;
+    std::size_t size;
+    const LayoutSectionEntry * dir;
+    Grid grid;
+};
+
+// a layout image file mapped into memory.
+class MappedLayoutFile {
+public:
+    MappedLayoutFile() :
+            addr(NULL), length(0) {
+    }
+    ~MappedLayoutFile() {
+        close();
+    }
+
+    void open(const std::string & fname);
+
+    void close();
+
+    const LayoutImage & image() const {
+        return img;
+    }
+
+private:
+    MappedLayoutFile(const MappedLayoutFile &);
+    MappedLayoutFile & operator=(const MappedLayoutFile &);
+
+    void * addr;
+    std::size_t length;
+    LayoutImage img;
+};
+
+}
+
+#endif
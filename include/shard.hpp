@@ -0,0 +1,54 @@
+#ifndef BAG_SHARD_H_
+#define BAG_SHARD_H_
+
+#include <mutex>
+
+#include <bag.hpp>
+
+namespace bag {
+
+// builds one layout from several threads.  Each thread adds shapes to its
+// own shard, a layout no other thread touches, so no call is locked.  The
+// shards are spliced into one layout at the end.
+//
+// Layer/purpose ids come from one table shared by all shards.  An id from
+// get_lpp_id() is valid in every shard and in the merged layout, so shapes
+// are merged without rewriting their ids.  Via names and parameter sets are
+// interned per shard and remapped by the merge.
+class ShardedLayout {
+public:
+    ShardedLayout(unsigned int num_shards, unsigned int dbu_per_uu = 0,
+                  unsigned int mfg_grid_res = 1);
+
+    unsigned int size() const {
+        return (unsigned int) shards.size();
+    }
+
+    // the shard of one thread.
+    Layout & operator[](unsigned int idx) {
+        return shards[idx];
+    }
+
+    // intern a layer/purpose pair in the shared table, and return its id in
+    // the given shard.  May be called from all threads at once, but only by
+    // the thread that owns the shard.  Shards must get their layer/purpose
+    // ids from here, not from Layout::get_lpp_id().
+    unsigned int get_lpp_id(unsigned int shard, const std::string & lay_name,
+                            const std::string & purp_name);
+
+    // replace layout with the contents of all shards, in shard order, and
+    // leave the shards empty.  The first shard is moved without copying.
+    // Throws if two shards have instances of the same name; the shards are
+    // unchanged then.
+    void merge(Layout & layout);
+
+private:
+    Grid grid;
+    std::vector<Layout> shards;
+    LppTable lpp_table;
+    std::mutex lpp_mtx;
+};
+
+}
+
+#endif
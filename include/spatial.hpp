@@ -0,0 +1,136 @@
+#ifndef BAG_SPATIAL_H_
+#define BAG_SPATIAL_H_
+
+#include <bag.hpp>
+
+namespace bag {
+
+// Spatial index over the shapes of a layout.
+//
+// Rectangles, pins, path segments, paths and polygons are indexed per
+// layer/purpose id.  A layout does not know which layers a via definition
+// uses, so vias are indexed per via name id instead, with the union of both
+// enclosures around the cut array as their extent.  Rectangle and via
+// arrays are one index entry each, and queries check the individual array
+// elements.  Paths and polygons are matched by their bounding box.
+//
+// Each group is a packed R-tree bulk loaded with sort-tile-recursive order.
+// Shapes added later go to a small unsorted list that is scanned linearly,
+// and the tree is repacked once that list grows past a fraction of the tree.
+
+// kinds of indexed shapes, the index refers into the matching layout list.
+enum ShapeKind {
+    kind_rect, kind_via, kind_pin, kind_path_seg, kind_path, kind_polygon
+};
+
+enum SpatialGroup {
+    group_lpp, group_via
+};
+
+struct ShapeRef {
+    unsigned char kind;
+    std::size_t index;
+};
+
+typedef std::vector<ShapeRef> ShapeRefList;
+typedef std::vector<std::pair<ShapeRef, ShapeRef> > ShapePairList;
+
+// an indexed shape: a base box repeated nx by ny times.
+struct SpatialEntry {
+    double box[4];
+    int nx, ny;
+    double spx, spy;
+    ShapeRef ref;
+};
+
+typedef std::vector<SpatialEntry> SpatialEntryList;
+
+// a packed R-tree over the shapes of one group.
+class RTree {
+public:
+    RTree() :
+            num_packed(0) {
+    }
+
+    std::size_t size() const {
+        return entries.size();
+    }
+
+    const SpatialEntry & operator[](std::size_t idx) const {
+        return entries[idx];
+    }
+
+    void clear();
+
+    // add a shape, repacking the tree if too many shapes are unpacked.
+    void add(const SpatialEntry & entry);
+
+    // add a shape without repacking.
+    void push(const SpatialEntry & entry) {
+        entries.push_back(entry);
+    }
+
+    // bulk load all shapes into the tree.
+    void pack();
+
+    // positions of entries that meet the box.  If strict, touching entries
+    // do not count.
+    void query(const double box[4], bool strict, std::vector<std::size_t> & out) const;
+
+    // position of the entry nearest to (x, y).  Returns false if empty.
+    bool nearest(double x, double y, std::size_t & idx, double & dist) const;
+
+private:
+    void query_node(std::size_t level, std::size_t node, const double box[4], bool strict,
+                    std::vector<std::size_t> & out) const;
+
+    SpatialEntryList entries;   // packed entries first, then unpacked ones
+    std::size_t num_packed;
+    std::vector<std::vector<double> > levels;   // node boxes, leaves first
+};
+
+class SpatialIndex {
+public:
+    SpatialIndex() {
+        clear();
+    }
+
+    void clear();
+
+    // index all shapes of the layout.
+    void build(const Layout & layout);
+
+    // index shapes added to the layout since the last build or update.
+    // Call build() instead after shapes were moved or removed.
+    void update(const Layout & layout);
+
+    // shapes of the given layer/purpose or via id that meet the box,
+    // touching included.
+    void query_box(SpatialGroup group, unsigned int id, const double box[4],
+                   ShapeRefList & out) const;
+
+    // the shape nearest to (x, y) and its distance.  Returns false if the
+    // group is empty.
+    bool nearest(SpatialGroup group, unsigned int id, double x, double y, ShapeRef & out,
+                 double & dist) const;
+
+    // pairs of shapes in the group that overlap with positive area.
+    void overlap_pairs(SpatialGroup group, unsigned int id, ShapePairList & out) const;
+
+private:
+    // index shapes not indexed yet.  In bulk mode trees are not repacked.
+    void add_shapes(const Layout & layout, bool bulk);
+    void add_entry(SpatialGroup group, unsigned int id, const SpatialEntry & entry, bool bulk);
+    RTree & get_tree(SpatialGroup group, unsigned int id);
+    const RTree * find_tree(SpatialGroup group, unsigned int id) const;
+
+    std::vector<RTree> lpp_trees;
+    std::vector<RTree> via_trees;
+
+    // number of shapes of each list already indexed
+    std::size_t num_rects, num_vias, num_pins, num_path_segs, num_paths, num_polygons;
+};
+
+}
+
+#endif
@@ -7,15 +7,20 @@ from Cython.Build import cythonize
 setup(
     ext_modules=cythonize(Extension('cybagoa',
                                     sources=['src/cybagoa.pyx', '../src/bag.cpp',
-                                             '../src/bagoa.cpp'],
+                                             '../src/bagoa.cpp', '../src/coord.cpp',
+                                             '../src/table.cpp', '../src/gds.cpp',
+                                             '../src/oasis.cpp', '../src/serialize.cpp',
+                                             '../src/hash.cpp', '../src/spatial.cpp',
+                                             '../src/library.cpp', '../src/shard.cpp'],
                                     language='c++',
                                     include_dirs=[os.environ['OA_INCLUDE_DIR'],
                                                   '../include/'],
+                                    define_macros=[('BAG_HAVE_ZLIB', None)],
                                     libraries=['oaCommon', 'oaBase', 'oaPlugIn',
-                                               'oaDM', 'oaTech', 'oaDesign', 'dl'],
+                                               'oaDM', 'oaTech', 'oaDesign', 'dl', 'z'],
                                     library_dirs=[os.environ['OA_LINK_DIR']],
-                                    extra_compile_args=["-std=c++11"],
-                                    extra_link_args=["-std=c++11"],
+                                    extra_compile_args=["-std=c++11", "-pthread"],
+                                    extra_link_args=["-std=c++11", "-pthread"],
                                     )
                           ),
 )
@@ -3,13 +3,43 @@
 from libcpp.string cimport string
 from libcpp.map cimport map
 from libcpp.vector cimport vector
+from libcpp.utility cimport pair
+from libcpp.utility cimport move
 from libcpp cimport bool
+from libc.stdint cimport uint64_t
+from cpython.buffer cimport PyBuffer_FillInfo
 
 import os
+import pickle
+import threading
+
+
+cdef _check_shape(object name, object arr, size_t nrow, size_t ncol):
+    # make sure a column array matches the batch size
+    if arr is None:
+        return
+    if arr.shape[0] != nrow or (ncol > 0 and arr.shape[1] != ncol):
+        raise ValueError('%s has the wrong shape, expected %d rows.' % (name, nrow))
 
 cdef extern from "bag.hpp" namespace "bag":
+    cdef cppclass NameTable:
+        bool find(const string & name, unsigned int & id)
+
+    cdef cppclass ViaTable:
+        NameTable names
+
+    cdef cppclass ParamSet:
+        ParamSet()
+        map[string, int] int_params
+        map[string, string] str_params
+        map[string, double] double_params
+
     cdef cppclass Layout:
         Layout()
+        Layout(unsigned int dbu_per_uu, unsigned int mfg_grid_res) except +
+
+        size_t get_num_off_grid()
+        const Grid & get_grid()
 
         void add_inst(const string & lib_name, const string & cell_name,
                       const string & view_name, const string & inst_name,
@@ -17,14 +47,25 @@ cdef extern from "bag.hpp" namespace "bag":
                       const map[string, int] int_params, const map[string, string] str_params,
                       const map[string, double] double_params, int num_rows,
                       int num_cols, double sp_rows, double sp_cols) except +
-        
-        void add_rect(const string & lay_name, const string & purp_name,
-                      double xl, double yb, double xr, double yt,
+
+        void add_inst(const string & lib_name, const string & cell_name,
+                      const string & view_name, const string & inst_name,
+                      double xc, double yc, const string & orient,
+                      unsigned int params, int num_rows, int num_cols,
+                      double sp_rows, double sp_cols) except +
+
+        unsigned int get_param_id(const ParamSet & params) except +
+
+        unsigned int get_lpp_id(const string & lay_name, const string & purp_name) except +
+
+        void add_rect(unsigned int lpp, double xl, double yb, double xr, double yt,
                       unsigned int nx, unsigned int ny,
                       double spx, double spy) except +
 
-        void add_path_seg(const string & lay_name, const string & purp_name,
-                          double x0, double y0, double x1, double y1,
+        void add_rects(unsigned int lpp, size_t n, const double * bbox, const int * nx,
+                       const int * ny, const double * sp) except +
+
+        void add_path_seg(unsigned int lpp, double x0, double y0, double x1, double y1,
                           double width, const string & begin_style,
                           const string & end_style) except +
 
@@ -37,19 +78,52 @@ cdef extern from "bag.hpp" namespace "bag":
                      unsigned int nx, unsigned int ny,
                      double spx, double spy) except +
 
+        void add_vias(const string & via_name, const string & orient, size_t n,
+                      const double * loc, const int * num_rows, const int * num_cols,
+                      const double * sp, const double * enc1, const double * enc2,
+                      const double * cut_size, const int * nx, const int * ny,
+                      const double * arr_sp) except +
+
         void add_pin(const string & net_name, const string & pin_name,
-                     const string & label, const string & lay_name,
-                     const string & purp_name, double xl, double yb,
+                     const string & label, unsigned int lpp, double xl, double yb,
                      double xr, double yt, bool make_pin_obj) except +
 
-        void add_polygon(const string & lay_name, const string & purp_name,
-                         const vector[double] & xcoord, const vector[double] & ycoord) except +
-        
-        void add_blockage(const string & btype, const string & layer, const vector[double] & xcoord,
-                          const vector[double] & ycoord) except +
+        void add_pins(unsigned int lpp, size_t n, const double * bbox,
+                      const vector[string] & net_names, const vector[string] & pin_names,
+                      const vector[string] & labels, bool make_pin_obj) except +
+
+        void add_polygon(unsigned int lpp, size_t num_pts, const double * xy) except +
+
+        void add_path(unsigned int lpp, size_t num_pts, const double * xy, double width,
+                      const string & begin_style, const string & end_style,
+                      const string & join_style) except +
+
+        void add_blockage(const string & btype, const string & layer, size_t num_pts,
+                          const double * xy) except +
+
+        void add_boundary(const string & btype, size_t num_pts, const double * xy) except +
+
+        void clear()
+        void reserve_rects(size_t n)
+        void reserve_vias(size_t n)
+        void reserve_path_segs(size_t n)
+        void reserve_pins(size_t n)
+        void reserve_points(size_t n)
+        bool get_bbox(double bbox[4])
+        void move_by(double dx, double dy)
+
+        ViaTable via_list
+
+    cdef cppclass LayoutWriter:
+        pass
+
+    cdef cppclass Grid:
+        Grid()
+        Grid(unsigned int dbu_per_uu, unsigned int mfg_grid_res)
+        unsigned int dbu_per_uu
+        unsigned int mfg_grid_res
 
-        void add_boundary(const string & btype, const vector[double] & xcoord,
-                  const vector[double] & ycoord) except +
+    uint64_t hash_layout(const Layout & layout, const Grid & grid) except +
         
     cdef cppclass SchInst:
         SchInst()
@@ -64,134 +138,478 @@ cdef extern from "bag.hpp" namespace "bag":
         map[string, vector[SchInst]] inst_map
 
 
+cdef extern from "gds.hpp" namespace "bag":
+    cdef cppclass GdsWriter(LayoutWriter):
+        GdsWriter()
+        void open(const string & fname, const string & lib_name, unsigned int dbu_per_uu,
+                  unsigned int mfg_grid_res) except +
+        void add_layer(const string & lay_name, unsigned int lay_num) except +
+        void add_purpose(const string & purp_name, unsigned int purp_num) except +
+        void add_via_def(const string & via_name, const string & bot_layer,
+                         const string & cut_layer, const string & top_layer,
+                         const string & purpose, double cut_width, double cut_height) except +
+        void close() except + nogil
+        void create_layout(const string & cell, const string & view,
+                           const Layout & layout) except + nogil
+        size_t get_num_off_grid()
+
+
+cdef extern from "serialize.hpp" namespace "bag":
+    void serialize_layout(const Layout & layout, vector[char] & buf) except +
+    void deserialize_layout(const char * data, size_t size, Layout & layout) except +
+    void save_layout(const string & fname, const Layout & layout) except + nogil
+    void load_layout(const string & fname, Layout & layout) except + nogil
+
+
+cdef extern from "library.hpp" namespace "bag":
+    cdef cppclass LayoutLibrary:
+        LayoutLibrary()
+        LayoutLibrary(const string & lib_name, const string & view_name,
+                      unsigned int dbu_per_uu, unsigned int mfg_grid_res)
+        const string & add_cell(const string & cell, const Layout & layout) except +
+        bool has_cell(const string & cell)
+        const string & resolve(const string & cell) except +
+        size_t size()
+        size_t get_num_duplicates()
+        void write(LayoutWriter & writer) except + nogil
+        void clear()
+
+
+cdef extern from "spatial.hpp" namespace "bag":
+    cdef enum SpatialGroup:
+        group_lpp, group_via
+
+    cdef cppclass ShapeRef:
+        unsigned char kind
+        size_t index
+
+    cdef cppclass SpatialIndex:
+        SpatialIndex()
+        void build(const Layout & layout) except +
+        void update(const Layout & layout) except +
+        void query_box(SpatialGroup group, unsigned int id, const double box[4],
+                       vector[ShapeRef] & out) except +
+        bool nearest(SpatialGroup group, unsigned int id, double x, double y, ShapeRef & out,
+                     double & dist) except +
+        void overlap_pairs(SpatialGroup group, unsigned int id,
+                           vector[pair[ShapeRef, ShapeRef]] & out) except +
+
+
+# shape kinds reported by the spatial queries, in ShapeKind order
+_shape_kinds = ('rect', 'via', 'pin', 'path_seg', 'path', 'polygon')
+
+
+cdef extern from "oasis.hpp" namespace "bag":
+    cdef cppclass OasisWriter(LayoutWriter):
+        OasisWriter()
+        void open(const string & fname, unsigned int dbu_per_uu, unsigned int mfg_grid_res,
+                  bool compress, bool repetitions) except +
+        void add_layer(const string & lay_name, unsigned int lay_num) except +
+        void add_purpose(const string & purp_name, unsigned int purp_num) except +
+        void add_via_def(const string & via_name, const string & bot_layer,
+                         const string & cut_layer, const string & top_layer,
+                         const string & purpose, double cut_width, double cut_height) except +
+        void close() except + nogil
+        void create_layout(const string & cell, const string & view,
+                           const Layout & layout) except + nogil
+        size_t get_num_off_grid()
+
+
 cdef extern from "bagoa.hpp" namespace "bagoa":
     cdef cppclass LibDefObserver:
         pass
 
+    cdef enum:
+        num_write_phases
+        num_call_classes
+
+    cdef cppclass WriteStats:
+        size_t num_layouts
+        double time[]
+        size_t count[]
+        size_t calls[]
+        map[string, size_t] skipped
+
+    const char * get_phase_name(unsigned int phase) except +
+    const char * get_call_class_name(unsigned int cls) except +
+
+    cdef cppclass WriteTicket:
+        bool is_done()
+        void wait() except + nogil
+
     cdef cppclass OALayoutLibrary:
         OALayoutLibrary()
         void open_library(const string & lib_file, const string & library,
-                          const string & lib_path, const string & tech_lib) except +
-        void add_purpose(const string & purp_name, unsigned int purp_num) except +
-        void add_layer(const string & lay_name, unsigned int lay_num) except +
-        void close() except +
-        void create_layout(const string & cell, const string & view, const Layout & layout) except +
+                          const string & lib_path, const string & tech_lib) except + nogil
+        void add_purpose(const string & purp_name, unsigned int purp_num) except + nogil
+        void add_layer(const string & lay_name, unsigned int lay_num) except + nogil
+        void close() except + nogil
+        void create_layout(const string & cell, const string & view,
+                           const Layout & layout) except + nogil
+        WriteTicket create_layout_async(const string & cell, const string & view,
+                                        Layout layout) except + nogil
+        void set_max_queued(size_t val) except + nogil
+        void flush() except + nogil
+        void create_layouts(const vector[string] & cells, const vector[string] & views,
+                            const vector[const Layout *] & layouts,
+                            unsigned int num_threads) except + nogil
+        void create_library(const LayoutLibrary & cells, unsigned int num_threads) except + nogil
+        size_t read_layout(const string & cell, const string & view,
+                           Layout & layout) except + nogil
+        void set_skip_unchanged(bool val)
+        size_t get_num_hash_hits()
+        size_t get_num_hash_misses()
+        size_t get_num_master_hits()
+        size_t get_num_master_misses()
+        size_t get_num_via_def_hits()
+        size_t get_num_via_def_misses()
+        void set_collect_stats(bool val)
+        const WriteStats & get_stats()
+        void reset_stats()
 
     cdef cppclass OASchematicWriter:
         OASchematicWriter()
-        void open_library(const string & lib_path, const string & library) except +
-        void close() except +
+        void open_library(const string & lib_path, const string & library) except + nogil
+        void close() except + nogil
         void create_schematics(const vector[SchCell] & cell_list, const string & sch_name,
-                               const string & sym_name) except +
+                               const string & sym_name) except + nogil
+
+
+def _layout_from_buffer(unicode encoding, const unsigned char[::1] data):
+    # rebuild a pickled PyLayout
+    cdef PyLayout layout = PyLayout(encoding)
+    if data.shape[0] == 0:
+        raise ValueError('Empty layout image.')
+    deserialize_layout(<const char *> &data[0], data.shape[0], layout.c_layout)
+    return layout
 
 
 cdef class PyLayout:
     cdef Layout c_layout
     cdef unicode encoding
-    def __init__(self, unicode encoding):
+    cdef dict lpp_ids
+    cdef dict param_ids
+    cdef vector[double] xy_buf
+    cdef vector[char] image_buf
+    cdef int num_exports
+    cdef SpatialIndex spatial
+    cdef bool spatial_dirty
+    # threads reading c_layout, or writing it, without the GIL
+    cdef int num_readers
+    cdef bool writing
+    def __init__(self, unicode encoding, unsigned int dbu_per_uu=0,
+                 unsigned int mfg_grid_res=1):
         self.encoding = encoding
+        self.lpp_ids = {}
+        self.param_ids = {}
+        self.spatial_dirty = True
+        if dbu_per_uu > 0:
+            # snap point lists to the grid as they are added
+            self.c_layout = Layout(dbu_per_uu, mfg_grid_res)
+
+    # the GIL is held while these run, so checking and taking the layout
+    # cannot race with another Python thread.
+    cdef _check_idle(self):
+        # for changes made with the GIL held
+        if self.writing or self.num_readers > 0:
+            raise RuntimeError('Layout is in use by another thread.')
+
+    cdef _check_readable(self):
+        # for reads made with the GIL held
+        if self.writing:
+            raise RuntimeError('Layout is in use by another thread.')
+
+    cdef _begin_read(self):
+        self._check_readable()
+        self.num_readers += 1
+
+    cdef _end_read(self):
+        self.num_readers -= 1
+
+    cdef _begin_write(self):
+        self._check_idle()
+        self.writing = True
+
+    cdef _end_write(self):
+        self.writing = False
+
+    @property
+    def num_off_grid(self):
+        self._check_readable()
+        return self.c_layout.get_num_off_grid()
+
+    def clear(self):
+        # keeps allocated storage, layer/purpose and parameter set ids for the next cell
+        self._check_idle()
+        self.c_layout.clear()
+        self.spatial_dirty = True
+
+    def reserve(self, size_t rects=0, size_t vias=0, size_t path_segs=0, size_t pins=0,
+                size_t points=0):
+        # preallocate storage when the final shape counts are known
+        self._check_idle()
+        self.c_layout.reserve_rects(rects)
+        self.c_layout.reserve_vias(vias)
+        self.c_layout.reserve_path_segs(path_segs)
+        self.c_layout.reserve_pins(pins)
+        self.c_layout.reserve_points(points)
+
+    def get_bbox(self):
+        cdef double bbox[4]
+        self._check_readable()
+        if not self.c_layout.get_bbox(bbox):
+            return None
+        return bbox[0], bbox[1], bbox[2], bbox[3]
+
+    def move_by(self, double dx, double dy):
+        self._check_idle()
+        self.c_layout.move_by(dx, dy)
+        self.spatial_dirty = True
+
+    def content_hash(self, unsigned int dbu_per_uu=1000, unsigned int mfg_grid_res=1):
+        # order-independent hash of the layout snapped to the given grid
+        self._check_readable()
+        return hash_layout(self.c_layout, Grid(dbu_per_uu, mfg_grid_res))
+
+    def __getbuffer__(self, Py_buffer * buffer, int flags):
+        # exports a binary image of the layout, taken when the first view is created
+        if self.num_exports == 0:
+            self._check_readable()
+            serialize_layout(self.c_layout, self.image_buf)
+        PyBuffer_FillInfo(buffer, self, self.image_buf.data(), self.image_buf.size(), 1, flags)
+        self.num_exports += 1
+
+    def __releasebuffer__(self, Py_buffer * buffer):
+        self.num_exports -= 1
+        if self.num_exports == 0:
+            vector[char]().swap(self.image_buf)
+
+    def __reduce_ex__(self, protocol):
+        if protocol >= 5:
+            # lets multiprocessing send the image out-of-band
+            return _layout_from_buffer, (self.encoding, pickle.PickleBuffer(self))
+        return _layout_from_buffer, (self.encoding, self.to_bytes())
+
+    def __reduce__(self):
+        return self.__reduce_ex__(2)
+
+    def to_bytes(self):
+        cdef vector[char] buf
+        self._check_readable()
+        serialize_layout(self.c_layout, buf)
+        return buf.data()[:buf.size()]
+
+    def save(self, unicode fname):
+        cdef string c_fname = fname.encode(self.encoding)
+        self._begin_read()
+        try:
+            with nogil:
+                save_layout(c_fname, self.c_layout)
+        finally:
+            self._end_read()
+
+    def load(self, unicode fname):
+        # replaces the layout with a memory mapped image file
+        cdef string c_fname = fname.encode(self.encoding)
+        self._begin_write()
+        try:
+            with nogil:
+                load_layout(c_fname, self.c_layout)
+        finally:
+            self._end_write()
+        self.lpp_ids = {}
+        self.param_ids = {}
+        self.spatial_dirty = True
+
+    cdef unsigned int _lpp_id(self, object layer) except *:
+        cdef string lay
+        cdef string purp
+        if isinstance(layer, int):
+            # already an interned id
+            return layer
+        key = (layer[0], layer[1])
+        lpp = self.lpp_ids.get(key)
+        if lpp is None:
+            lay = layer[0].encode(self.encoding)
+            purp = layer[1].encode(self.encoding)
+            self._check_idle()
+            lpp = self.c_layout.get_lpp_id(lay, purp)
+            self.lpp_ids[key] = lpp
+        return lpp
+
+    def get_lpp_id(self, object layer):
+        return self._lpp_id(layer)
+
+    cdef SpatialGroup _spatial_group(self, object layer, unsigned int * id) except *:
+        # via names select via shapes, anything else is a layer/purpose
+        self._check_readable()
+        if isinstance(layer, unicode):
+            if not self.c_layout.via_list.names.find(layer.encode(self.encoding), id[0]):
+                id[0] = <unsigned int> -1
+            return group_via
+        id[0] = self._lpp_id(layer)
+        return group_lpp
+
+    cdef _update_spatial(self):
+        # the index is rebuilt after shapes moved, and extended with new shapes otherwise
+        if self.spatial_dirty:
+            self.spatial.build(self.c_layout)
+            self.spatial_dirty = False
+        else:
+            self.spatial.update(self.c_layout)
+
+    def query_box(self, object layer, object bbox):
+        # shapes on the layer, or vias of the given name, that touch the box
+        cdef unsigned int id
+        cdef SpatialGroup group = self._spatial_group(layer, &id)
+        cdef double box[4]
+        cdef vector[ShapeRef] hits
+        box[0], box[1], box[2], box[3] = bbox
+        self._update_spatial()
+        self.spatial.query_box(group, id, box, hits)
+        return [(_shape_kinds[ref.kind], ref.index) for ref in hits]
+
+    def nearest(self, object layer, object loc):
+        # (kind, index, distance) of the closest shape, or None
+        cdef unsigned int id
+        cdef SpatialGroup group = self._spatial_group(layer, &id)
+        cdef ShapeRef ref
+        cdef double dist = 0
+        self._update_spatial()
+        if not self.spatial.nearest(group, id, loc[0], loc[1], ref, dist):
+            return None
+        return _shape_kinds[ref.kind], ref.index, dist
+
+    def overlap_pairs(self, object layer):
+        # pairs of shapes that overlap with positive area
+        cdef unsigned int id
+        cdef SpatialGroup group = self._spatial_group(layer, &id)
+        cdef vector[pair[ShapeRef, ShapeRef]] pairs
+        self._update_spatial()
+        self.spatial.overlap_pairs(group, id, pairs)
+        return [((_shape_kinds[p.first.kind], p.first.index),
+                 (_shape_kinds[p.second.kind], p.second.index)) for p in pairs]
+
+    cdef unsigned int _param_id(self, object params) except *:
+        cdef ParamSet param_set
+        cdef string par_key
+        if isinstance(params, int):
+            # already an interned id
+            return params
+        if params is None:
+            params = {}
+        # value types are part of the key so 1 and 1.0 stay distinct
+        key = tuple((k, type(v), v) for k, v in sorted(params.items()))
+        pid = self.param_ids.get(key)
+        if pid is None:
+            for par_name, val in params.items():
+                par_key = par_name.encode(self.encoding)
+                if isinstance(val, bytes):
+                    param_set.str_params[par_key] = val
+                elif isinstance(val, unicode):
+                    param_set.str_params[par_key] = val.encode(self.encoding)
+                elif isinstance(val, int):
+                    param_set.int_params[par_key] = val
+                elif isinstance(val, float):
+                    param_set.double_params[par_key] = val
+            self._check_idle()
+            pid = self.c_layout.get_param_id(param_set)
+            self.param_ids[key] = pid
+        return pid
+
+    def get_param_id(self, object params):
+        return self._param_id(params)
 
     def add_inst(self, unicode lib, unicode cell, unicode view,
                  unicode name, object loc, unicode orient, object params=None,
                  int num_rows=1, int num_cols=1, double sp_rows=0.0,
                  double sp_cols=0.0):
-        cdef map[string, int] int_map
-        cdef map[string, string] str_map
-        cdef map[string, double] double_map
+        cdef unsigned int pid = self._param_id(params)
         cdef string lib_name = lib.encode(self.encoding)
         cdef string cell_name = cell.encode(self.encoding)
         cdef string view_name = view.encode(self.encoding)
         cdef string inst_name = name.encode(self.encoding)
         cdef string c_orient = orient.encode(self.encoding)
-        cdef string par_key
         cdef double xo = loc[0]
         cdef double yo = loc[1]
-        if params is not None:
-            for key, val in params.items():
-                par_key = key.encode(self.encoding)
-                if isinstance(val, bytes):
-                    str_map[par_key] = val
-                elif isinstance(val, unicode):
-                    str_map[par_key] = val.encode(self.encoding)
-                elif isinstance(val, int):
-                    int_map[par_key] = val
-                elif isinstance(val, float):
-                    double_map[par_key] = val
-
+        self._check_idle()
         self.c_layout.add_inst(lib_name, cell_name, view_name,
-                               inst_name, xo, yo,
-                               c_orient, int_map, str_map,
-                               double_map, num_rows, num_cols,
-                               sp_rows, sp_cols)
-        
+                               inst_name, xo, yo, c_orient, pid,
+                               num_rows, num_cols, sp_rows, sp_cols)
+
     def add_rect(self, object layer, object bbox,
                  int arr_nx=1, int arr_ny=1,
                  double arr_spx=0.0, double arr_spy=0.0):
-        cdef string lay = layer[0].encode(self.encoding)
-        cdef string purp = layer[1].encode(self.encoding)
+        cdef unsigned int lpp = self._lpp_id(layer)
         cdef double xl = bbox[0][0]
         cdef double yb = bbox[0][1]
         cdef double xr = bbox[1][0]
         cdef double yt = bbox[1][1]
-        self.c_layout.add_rect(lay, purp, xl, yb, xr, yt, arr_nx, arr_ny,
+        self._check_idle()
+        self.c_layout.add_rect(lpp, xl, yb, xr, yt, arr_nx, arr_ny,
                                arr_spx, arr_spy)
 
-    def add_polygon(self, object layer, list points):
-        cdef string lay = layer[0].encode(self.encoding)
-        cdef string purp = layer[1].encode(self.encoding)
-        cdef vector[double] xcoord
-        cdef vector[double] ycoord
+    # bbox is an N x 4 float64 array of (xl, yb, xr, yt) rows, arr_nx/arr_ny are
+    # int32 arrays and arr_sp is an N x 2 array of (spx, spy) rows.
+    def add_rects(self, object layer, const double[:, ::1] bbox, const int[::1] arr_nx=None,
+                  const int[::1] arr_ny=None, const double[:, ::1] arr_sp=None):
+        cdef unsigned int lpp = self._lpp_id(layer)
+        cdef size_t n = bbox.shape[0]
+        cdef const int * nx_ptr = NULL
+        cdef const int * ny_ptr = NULL
+        cdef const double * sp_ptr = NULL
+        if n == 0:
+            return
+        _check_shape('bbox', bbox, n, 4)
+        _check_shape('arr_nx', arr_nx, n, 0)
+        _check_shape('arr_ny', arr_ny, n, 0)
+        _check_shape('arr_sp', arr_sp, n, 2)
+        if arr_nx is not None:
+            nx_ptr = &arr_nx[0]
+        if arr_ny is not None:
+            ny_ptr = &arr_ny[0]
+        if arr_sp is not None:
+            sp_ptr = &arr_sp[0, 0]
+        self._check_idle()
+        self.c_layout.add_rects(lpp, n, &bbox[0, 0], nx_ptr, ny_ptr, sp_ptr)
+
+    cdef _fill_points(self, list points):
+        # interleave points into the reusable coordinate buffer
+        self.xy_buf.clear()
         for xval, yval in points:
-            xcoord.push_back(xval)
-            ycoord.push_back(yval)
+            self.xy_buf.push_back(xval)
+            self.xy_buf.push_back(yval)
 
-        self.c_layout.add_polygon(lay, purp, xcoord, ycoord)
+    def add_polygon(self, object layer, list points):
+        cdef unsigned int lpp = self._lpp_id(layer)
+        self._fill_points(points)
+        self._check_idle()
+        self.c_layout.add_polygon(lpp, len(points), self.xy_buf.data())
 
     def add_blockage(self, unicode btype, unicode layer, list points):
         cdef string btype_c = btype.encode(self.encoding)
         cdef string layer_c = layer.encode(self.encoding)
-        cdef vector[double] xcoord
-        cdef vector[double] ycoord
-        for xval, yval in points:
-            xcoord.push_back(xval)
-            ycoord.push_back(yval)
-
-        self.c_layout.add_blockage(btype_c, layer_c, xcoord, ycoord)
+        self._fill_points(points)
+        self._check_idle()
+        self.c_layout.add_blockage(btype_c, layer_c, len(points), self.xy_buf.data())
 
     def add_boundary(self, unicode btype, list points):
         cdef string btype_c = btype.encode(self.encoding)
-        cdef vector[double] xcoord
-        cdef vector[double] ycoord
-        for xval, yval in points:
-            xcoord.push_back(xval)
-            ycoord.push_back(yval)
-
-        self.c_layout.add_boundary(btype_c, xcoord, ycoord)
+        self._fill_points(points)
+        self._check_idle()
+        self.c_layout.add_boundary(btype_c, len(points), self.xy_buf.data())
 
     def add_path(self, object layer, double width, list points,
                  unicode end_style, unicode join_style):
-        cdef string lay = layer[0].encode(self.encoding)
-        cdef string purp = layer[1].encode(self.encoding)
+        cdef unsigned int lpp = self._lpp_id(layer)
         cdef string estyle = end_style.encode(self.encoding)
         cdef string jstyle = join_style.encode(self.encoding)
-        cdef string start_s, stop_s
-        cdef double x0 = 0
-        cdef double y0 = 0
-        cdef double x1 = 0
-        cdef double y1 = 0
-        cdef int plen = len(points)
-        cdef int idx
-        for idx, p in enumerate(points):
-            x1, y1 = p[0], p[1]
-            if idx > 0:
-                start_s = stop_s = jstyle
-                if idx == 1:
-                    start_s = estyle
-                if idx == plen - 1:
-                    stop_s = estyle
-                self.c_layout.add_path_seg(lay, purp, x0, y0, x1, y1, width,
-                                           start_s, stop_s)
-            x0, y0 = x1, y1
+        if len(points) < 2:
+            return
+        self._fill_points(points)
+        self._check_idle()
+        self.c_layout.add_path(lpp, len(points), self.xy_buf.data(), width,
+                               estyle, estyle, jstyle)
 
     def add_via(self, unicode id, loc, unicode orient,
                 int num_rows, int num_cols, double sp_rows, double sp_cols,
@@ -210,28 +628,111 @@ cdef class PyLayout:
         cdef double yb2 = enc2[3]
         cdef double xr2 = enc2[1]
         cdef double yt2 = enc2[2]
+        self._check_idle()
         self.c_layout.add_via(via_name, xo, yo, via_orient, 
                               num_rows, num_cols, sp_rows, sp_cols,
                               xl1, yb1, xr1, yt1,
                               xl2, yb2, xr2, yt2,
                               cut_width, cut_height, arr_nx, arr_ny, arr_spx, arr_spy)
 
+    # loc, sp, cut_size and arr_sp are N x 2 float64 arrays of (x, y) rows,
+    # enc1/enc2 are N x 4 arrays in the same order as add_via, and num_rows,
+    # num_cols, arr_nx and arr_ny are int32 arrays.
+    def add_vias(self, unicode id, unicode orient, const double[:, ::1] loc,
+                 const int[::1] num_rows, const int[::1] num_cols, const double[:, ::1] sp,
+                 const double[:, ::1] enc1, const double[:, ::1] enc2,
+                 const double[:, ::1] cut_size=None, const int[::1] arr_nx=None,
+                 const int[::1] arr_ny=None, const double[:, ::1] arr_sp=None):
+        cdef string via_name = id.encode(self.encoding)
+        cdef string via_orient = orient.encode(self.encoding)
+        cdef size_t n = loc.shape[0]
+        cdef vector[double] c_enc1
+        cdef vector[double] c_enc2
+        cdef const double * cut_ptr = NULL
+        cdef const int * nx_ptr = NULL
+        cdef const int * ny_ptr = NULL
+        cdef const double * sp_ptr = NULL
+        cdef size_t idx
+        if n == 0:
+            return
+        _check_shape('loc', loc, n, 2)
+        _check_shape('num_rows', num_rows, n, 0)
+        _check_shape('num_cols', num_cols, n, 0)
+        _check_shape('sp', sp, n, 2)
+        _check_shape('enc1', enc1, n, 4)
+        _check_shape('enc2', enc2, n, 4)
+        _check_shape('cut_size', cut_size, n, 2)
+        _check_shape('arr_nx', arr_nx, n, 0)
+        _check_shape('arr_ny', arr_ny, n, 0)
+        _check_shape('arr_sp', arr_sp, n, 2)
+
+        # reorder enclosures to (xl, yb, xr, yt)
+        c_enc1.resize(4 * n)
+        c_enc2.resize(4 * n)
+        for idx in range(n):
+            c_enc1[4 * idx] = enc1[idx, 0]
+            c_enc1[4 * idx + 1] = enc1[idx, 3]
+            c_enc1[4 * idx + 2] = enc1[idx, 1]
+            c_enc1[4 * idx + 3] = enc1[idx, 2]
+            c_enc2[4 * idx] = enc2[idx, 0]
+            c_enc2[4 * idx + 1] = enc2[idx, 3]
+            c_enc2[4 * idx + 2] = enc2[idx, 1]
+            c_enc2[4 * idx + 3] = enc2[idx, 2]
+
+        if cut_size is not None:
+            cut_ptr = &cut_size[0, 0]
+        if arr_nx is not None:
+            nx_ptr = &arr_nx[0]
+        if arr_ny is not None:
+            ny_ptr = &arr_ny[0]
+        if arr_sp is not None:
+            sp_ptr = &arr_sp[0, 0]
+        self._check_idle()
+        self.c_layout.add_vias(via_name, via_orient, n, &loc[0, 0], &num_rows[0],
+                               &num_cols[0], &sp[0, 0], c_enc1.data(), c_enc2.data(),
+                               cut_ptr, nx_ptr, ny_ptr, sp_ptr)
+
     def add_pin(self, unicode net_name, unicode pin_name, unicode label, object layer,
                 object bbox, bool make_rect=True):
         cdef string c_net = net_name.encode(self.encoding)
         cdef string c_pin = pin_name.encode(self.encoding)
         cdef string c_label = label.encode(self.encoding)
-        cdef string lay = layer[0].encode(self.encoding)
-        cdef string purp = layer[1].encode(self.encoding)
+        cdef unsigned int lpp = self._lpp_id(layer)
         cdef double xl = bbox[0][0]
         cdef double yb = bbox[0][1]
         cdef double xr = bbox[1][0]
         cdef double yt = bbox[1][1]
-        self.c_layout.add_pin(c_net, c_pin, c_label, lay, purp,
+        self._check_idle()
+        self.c_layout.add_pin(c_net, c_pin, c_label, lpp,
                               xl, yb, xr, yt,
                               make_rect)
+
+    # bbox is an N x 4 float64 array of (xl, yb, xr, yt) rows.
+    def add_pins(self, object net_names, object pin_names, object labels, object layer,
+                 const double[:, ::1] bbox, bool make_rect=True):
+        cdef unsigned int lpp = self._lpp_id(layer)
+        cdef size_t n = bbox.shape[0]
+        cdef vector[string] c_nets
+        cdef vector[string] c_pins
+        cdef vector[string] c_labels
+        if n == 0:
+            return
+        _check_shape('bbox', bbox, n, 4)
+        c_nets.reserve(n)
+        c_pins.reserve(n)
+        c_labels.reserve(n)
+        for name in net_names:
+            c_nets.push_back(name.encode(self.encoding))
+        for name in pin_names:
+            c_pins.push_back(name.encode(self.encoding))
+        for name in labels:
+            c_labels.push_back(name.encode(self.encoding))
+        self._check_idle()
+        self.c_layout.add_pins(lpp, n, &bbox[0, 0], c_nets, c_pins, c_labels, make_rect)
         
 cdef class PyOALayoutLibrary:
+    # OA calls run without the GIL.  The C++ writers serialize them on one
+    # process-wide lock, which the background writer thread also holds.
     cdef OALayoutLibrary c_lib
     cdef string lib_file
     cdef string library
@@ -249,7 +750,8 @@ cdef class PyOALayoutLibrary:
         self.encoding = encoding
     
     def __enter__(self):
-        self.c_lib.open_library(self.lib_file, self.library, self.lib_path, self.tech_lib)
+        with nogil:
+            self.c_lib.open_library(self.lib_file, self.library, self.lib_path, self.tech_lib)
         return self
 
     def __exit__(self, *args):
@@ -259,20 +761,372 @@ cdef class PyOALayoutLibrary:
         self.close()
             
     def close(self):
-        self.c_lib.close()
+        with nogil:
+            self.c_lib.close()
         
     def add_purpose(self, unicode purp_name, int purp_num):
         cdef string purp = purp_name.encode(self.encoding)
-        self.c_lib.add_purpose(purp, purp_num)
+        with nogil:
+            self.c_lib.add_purpose(purp, purp_num)
 
     def add_layer(self, unicode lay_name, int lay_num):
         cdef string lay = lay_name.encode(self.encoding)
-        self.c_lib.add_layer(lay, lay_num)
+        with nogil:
+            self.c_lib.add_layer(lay, lay_num)
+
+    def set_skip_unchanged(self, bool val):
+        # if set, layouts whose content hash matches the one stored on the
+        # existing design are not rewritten.  off by default.  hand edits keep
+        # the stored hash, and via definition or technology changes are not
+        # hashed, so turn it off after such changes.  the hash is only computed
+        # and stored while this is set.
+        self.c_lib.set_skip_unchanged(val)
+
+    @property
+    def hash_hits(self):
+        # layouts skipped because the stored content hash matched
+        return self.c_lib.get_num_hash_hits()
+
+    @property
+    def hash_misses(self):
+        # layouts written because they were new or changed
+        return self.c_lib.get_num_hash_misses()
+
+    @property
+    def master_hits(self):
+        # instances whose master was already resolved in this session
+        return self.c_lib.get_num_master_hits()
+
+    @property
+    def master_misses(self):
+        return self.c_lib.get_num_master_misses()
+
+    @property
+    def via_def_hits(self):
+        # vias whose definition was already resolved
+        return self.c_lib.get_num_via_def_hits()
+
+    @property
+    def via_def_misses(self):
+        return self.c_lib.get_num_via_def_misses()
+
+    def set_collect_stats(self, bool val):
+        # time write phases and count OA calls, off by default
+        self.c_lib.set_collect_stats(val)
+
+    def reset_stats(self):
+        self.c_lib.reset_stats()
+
+    def get_stats(self):
+        # phases map to (seconds, objects), calls to OA call counts by class,
+        # and skipped to counts of objects not written by reason
+        cdef const WriteStats * stats = &self.c_lib.get_stats()
+        cdef map[string, size_t] skip_map = stats.skipped
+        cdef unsigned int idx
+        phases = {}
+        for idx in range(num_write_phases):
+            name = get_phase_name(idx).decode(self.encoding)
+            phases[name] = (stats.time[idx], stats.count[idx])
+        calls = {}
+        for idx in range(num_call_classes):
+            calls[get_call_class_name(idx).decode(self.encoding)] = stats.calls[idx]
+        skipped = {}
+        for item in skip_map:
+            skipped[item.first.decode(self.encoding)] = item.second
+        return dict(layouts=stats.num_layouts, phases=phases, calls=calls, skipped=skipped)
 
     def create_layout(self, unicode cell, unicode view, PyLayout layout):
+        # runs without the GIL; other threads cannot change layout until this returns
+        cdef string cname = cell.encode(self.encoding)
+        cdef string vname = view.encode(self.encoding)
+        layout._begin_read()
+        try:
+            with nogil:
+                self.c_lib.create_layout(cname, vname, layout.c_layout)
+        finally:
+            layout._end_read()
+
+    def create_layout_async(self, unicode cell, unicode view, PyLayout layout):
+        # queues layout to be written on the writer thread and returns a
+        # PyWriteTicket.  The shapes move into the queue, leaving layout empty.
+        cdef string cname = cell.encode(self.encoding)
+        cdef string vname = view.encode(self.encoding)
+        cdef Grid grid = layout.c_layout.get_grid()
+        cdef PyWriteTicket ticket = PyWriteTicket()
+        cdef WriteTicket c_ticket
+        # blocks without the GIL while the queue is full
+        layout._begin_write()
+        try:
+            with nogil:
+                c_ticket = self.c_lib.create_layout_async(cname, vname, move(layout.c_layout))
+            layout.c_layout = Layout(grid.dbu_per_uu, grid.mfg_grid_res)
+        finally:
+            layout._end_write()
+        ticket.c_ticket = c_ticket
+        layout.lpp_ids = {}
+        layout.param_ids = {}
+        layout.spatial_dirty = True
+        return ticket
+
+    def set_max_queued(self, size_t val):
+        # queued layouts before create_layout_async blocks, 2 by default
+        self.c_lib.set_max_queued(val)
+
+    def flush(self):
+        # waits for all queued layouts to be written
+        with nogil:
+            self.c_lib.flush()
+
+    def create_layouts(self, object layout_list, unsigned int num_threads=0):
+        # layout_list is a list of (cell, view, PyLayout) tuples.  Layouts are
+        # prepared on num_threads threads (0 for all cores) and written in order.
+        cdef vector[string] cells
+        cdef vector[string] views
+        cdef vector[const Layout *] layouts
+        cdef PyLayout layout
+        # keeps the layouts alive if layout_list changes while the GIL is released
+        cdef list owners = []
+        try:
+            for cell, view, layout in layout_list:
+                cells.push_back(cell.encode(self.encoding))
+                views.push_back(view.encode(self.encoding))
+                layout._begin_read()
+                owners.append(layout)
+                layouts.push_back(&layout.c_layout)
+            with nogil:
+                self.c_lib.create_layouts(cells, views, layouts, num_threads)
+        finally:
+            for layout in owners:
+                layout._end_read()
+
+    def create_library(self, PyLayoutLibrary cells, unsigned int num_threads=0):
+        # writes every stored cell, children before parents
+        cells.num_readers += 1
+        try:
+            with nogil:
+                self.c_lib.create_library(cells.c_lib, num_threads)
+        finally:
+            cells.num_readers -= 1
+
+    def read_layout(self, unicode cell, unicode view, PyLayout layout):
+        # appends the design to layout.  Returns the number of skipped objects.
         cdef string cname = cell.encode(self.encoding)
         cdef string vname = view.encode(self.encoding)
-        self.c_lib.create_layout(cname, vname, layout.c_layout)
+        cdef size_t num_skipped
+        layout._begin_write()
+        try:
+            with nogil:
+                num_skipped = self.c_lib.read_layout(cname, vname, layout.c_layout)
+        finally:
+            layout._end_write()
+        layout.spatial_dirty = True
+        return num_skipped
+
+
+cdef class PyWriteTicket:
+    # a layout queued with PyOALayoutLibrary.create_layout_async
+    cdef WriteTicket c_ticket
+
+    @property
+    def done(self):
+        return self.c_ticket.is_done()
+
+    def wait(self):
+        # raises the write error, if any
+        with nogil:
+            self.c_ticket.wait()
+
+
+cdef class PyLayoutLibrary:
+    # generated cells that instantiate each other, with duplicates merged
+    cdef LayoutLibrary c_lib
+    cdef unicode encoding
+    # threads writing out c_lib without the GIL
+    cdef int num_readers
+    def __init__(self, unicode lib_name, unicode view_name, unicode encoding,
+                 unsigned int dbu_per_uu=1000, unsigned int mfg_grid_res=1):
+        self.encoding = encoding
+        self.c_lib = LayoutLibrary(lib_name.encode(encoding), view_name.encode(encoding),
+                                   dbu_per_uu, mfg_grid_res)
+
+    def __len__(self):
+        return self.c_lib.size()
+
+    def __contains__(self, unicode cell):
+        return self.c_lib.has_cell(cell.encode(self.encoding))
+
+    @property
+    def num_duplicates(self):
+        return self.c_lib.get_num_duplicates()
+
+    def add_cell(self, unicode cell, PyLayout layout):
+        # instances with an empty lib or this library refer to cells added before.
+        # Returns the cell name the layout is stored as.
+        cdef string cname = cell.encode(self.encoding)
+        self._check_idle()
+        layout._check_readable()
+        return self.c_lib.add_cell(cname, layout.c_layout).decode(self.encoding)
+
+    def resolve(self, unicode cell):
+        cdef string cname = cell.encode(self.encoding)
+        return self.c_lib.resolve(cname).decode(self.encoding)
+
+    def clear(self):
+        self._check_idle()
+        self.c_lib.clear()
+
+    cdef _check_idle(self):
+        if self.num_readers > 0:
+            raise RuntimeError('Layout library is in use by another thread.')
+
+
+cdef class PyGdsWriter:
+    # writes run without the GIL; lock keeps other threads out of the writer
+    cdef GdsWriter c_writer
+    cdef object lock
+    cdef string fname
+    cdef string library
+    cdef unsigned int dbu_per_uu
+    cdef unsigned int mfg_grid_res
+    cdef unicode encoding
+    def __init__(self, unicode fname, unicode library, unicode encoding,
+                 unsigned int dbu_per_uu=1000, unsigned int mfg_grid_res=1):
+        self.fname = fname.encode(encoding)
+        self.library = library.encode(encoding)
+        self.dbu_per_uu = dbu_per_uu
+        self.mfg_grid_res = mfg_grid_res
+        self.encoding = encoding
+        self.lock = threading.Lock()
+
+    def __enter__(self):
+        with self.lock:
+            self.c_writer.open(self.fname, self.library, self.dbu_per_uu, self.mfg_grid_res)
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def close(self):
+        with self.lock, nogil:
+            self.c_writer.close()
+
+    @property
+    def num_off_grid(self):
+        return self.c_writer.get_num_off_grid()
+
+    def add_purpose(self, unicode purp_name, int purp_num):
+        cdef string purp = purp_name.encode(self.encoding)
+        with self.lock:
+            self.c_writer.add_purpose(purp, purp_num)
+
+    def add_layer(self, unicode lay_name, int lay_num):
+        cdef string lay = lay_name.encode(self.encoding)
+        with self.lock:
+            self.c_writer.add_layer(lay, lay_num)
+
+    def add_via_def(self, unicode via_name, unicode bot_layer, unicode cut_layer,
+                    unicode top_layer, double cut_width, double cut_height,
+                    unicode purpose='drawing'):
+        # vias are streamed as flat rectangles on these layers
+        with self.lock:
+            self.c_writer.add_via_def(via_name.encode(self.encoding),
+                                      bot_layer.encode(self.encoding),
+                                      cut_layer.encode(self.encoding),
+                                      top_layer.encode(self.encoding),
+                                      purpose.encode(self.encoding), cut_width, cut_height)
+
+    def create_layout(self, unicode cell, PyLayout layout):
+        cdef string cname = cell.encode(self.encoding)
+        cdef string vname = b'layout'
+        layout._begin_read()
+        try:
+            with self.lock, nogil:
+                self.c_writer.create_layout(cname, vname, layout.c_layout)
+        finally:
+            layout._end_read()
+
+    def create_library(self, PyLayoutLibrary cells):
+        cells.num_readers += 1
+        try:
+            with self.lock, nogil:
+                cells.c_lib.write(self.c_writer)
+        finally:
+            cells.num_readers -= 1
+
+
+cdef class PyOasisWriter:
+    cdef OasisWriter c_writer
+    cdef object lock
+    cdef string fname
+    cdef unsigned int dbu_per_uu
+    cdef unsigned int mfg_grid_res
+    cdef bool compress
+    cdef bool repetitions
+    cdef unicode encoding
+    def __init__(self, unicode fname, unicode encoding, unsigned int dbu_per_uu=1000,
+                 unsigned int mfg_grid_res=1, compress=True, repetitions=True):
+        self.fname = fname.encode(encoding)
+        self.dbu_per_uu = dbu_per_uu
+        self.mfg_grid_res = mfg_grid_res
+        self.compress = compress
+        self.repetitions = repetitions
+        self.encoding = encoding
+        self.lock = threading.Lock()
+
+    def __enter__(self):
+        with self.lock:
+            self.c_writer.open(self.fname, self.dbu_per_uu, self.mfg_grid_res, self.compress,
+                               self.repetitions)
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def close(self):
+        with self.lock, nogil:
+            self.c_writer.close()
+
+    @property
+    def num_off_grid(self):
+        return self.c_writer.get_num_off_grid()
+
+    def add_purpose(self, unicode purp_name, int purp_num):
+        cdef string purp = purp_name.encode(self.encoding)
+        with self.lock:
+            self.c_writer.add_purpose(purp, purp_num)
+
+    def add_layer(self, unicode lay_name, int lay_num):
+        cdef string lay = lay_name.encode(self.encoding)
+        with self.lock:
+            self.c_writer.add_layer(lay, lay_num)
+
+    def add_via_def(self, unicode via_name, unicode bot_layer, unicode cut_layer,
+                    unicode top_layer, double cut_width, double cut_height,
+                    unicode purpose='drawing'):
+        with self.lock:
+            self.c_writer.add_via_def(via_name.encode(self.encoding),
+                                      bot_layer.encode(self.encoding),
+                                      cut_layer.encode(self.encoding),
+                                      top_layer.encode(self.encoding),
+                                      purpose.encode(self.encoding), cut_width, cut_height)
+
+    def create_layout(self, unicode cell, PyLayout layout):
+        cdef string cname = cell.encode(self.encoding)
+        cdef string vname = b'layout'
+        layout._begin_read()
+        try:
+            with self.lock, nogil:
+                self.c_writer.create_layout(cname, vname, layout.c_layout)
+        finally:
+            layout._end_read()
+
+    def create_library(self, PyLayoutLibrary cells):
+        cells.num_readers += 1
+        try:
+            with self.lock, nogil:
+                cells.c_lib.write(self.c_writer)
+        finally:
+            cells.num_readers -= 1
 
 
 cdef class PySchCell:
@@ -324,7 +1178,8 @@ cdef class PyOASchematicWriter:
         self.encoding = encoding
     
     def __enter__(self):
-        self.c_writer.open_library(self.lib_path, self.library)
+        with nogil:
+            self.c_writer.open_library(self.lib_path, self.library)
         return self
 
     def __exit__(self, *args):
@@ -334,7 +1189,8 @@ cdef class PyOASchematicWriter:
         self.close()
             
     def close(self):
-        self.c_writer.close()
+        with nogil:
+            self.c_writer.close()
 
     def add_sch_cell(self, PySchCell cell):
         self.c_cell_list.push_back(cell.c_inst)
@@ -342,5 +1198,7 @@ cdef class PyOASchematicWriter:
     def create_schematics(self, unicode sch_name, unicode sym_name):
         cdef string c_sch_name = sch_name.encode(self.encoding)
         cdef string c_sym_name = sym_name.encode(self.encoding)
-        self.c_writer.create_schematics(self.c_cell_list, c_sch_name,
-                                        c_sym_name)
+        # a copy, since another thread may add cells while the GIL is released
+        cdef vector[SchCell] cell_list = self.c_cell_list
+        with nogil:
+            self.c_writer.create_schematics(cell_list, c_sch_name, c_sym_name)
@@ -1,3 +1,5 @@
+#include <iterator>
+
 #include <bag.hpp>
 
 namespace bag {
@@ -30,11 +32,350 @@ unsigned char get_orient_code(const std::string & orient_str) {
     throw std::invalid_argument("Invalid orientation: " + orient_str);
 }
 
+unsigned char get_end_style_code(const std::string & style) {
+    if (style == "extend") {
+        return extend_style;
+    }
+    if (style == "round") {
+        return round_style;
+    }
+    return truncate_style;
+}
+
+std::string get_end_style_name(unsigned char code) {
+    switch (code) {
+    case extend_style:
+        return "extend";
+    case round_style:
+        return "round";
+    default:
+        return "truncate";
+    }
+}
+
+unsigned int LppTable::get_id(const std::string & layer, const std::string & purpose) {
+    std::pair<LppMap::iterator, bool> ans = lpp_map.insert(
+            LppMap::value_type(std::make_pair(layer, purpose), (unsigned int) lpp_list.size()));
+    if (ans.second) {
+        LayerPurpose lpp;
+        lpp.layer = layer;
+        lpp.purpose = purpose;
+        lpp_list.push_back(lpp);
+    }
+    return ans.first->second;
+}
+
+unsigned int NameTable::get_id(const std::string & name) {
+    std::pair<std::map<std::string, unsigned int>::iterator, bool> ans = name_map.insert(
+            std::make_pair(name, (unsigned int) names.size()));
+    if (ans.second) {
+        names.push_back(name);
+    }
+    return ans.first->second;
+}
+
+bool NameTable::find(const std::string & name, unsigned int & id) const {
+    std::map<std::string, unsigned int>::const_iterator it = name_map.find(name);
+    if (it == name_map.end()) {
+        return false;
+    }
+    id = it->second;
+    return true;
+}
+
+unsigned int ParamTable::get_id(const ParamSet & params) {
+    uint64_t key = hash_params(params);
+    typedef std::multimap<uint64_t, unsigned int>::const_iterator HashIter;
+    std::pair<HashIter, HashIter> range = hash_map.equal_range(key);
+    for (HashIter it = range.first; it != range.second; it++) {
+        if (sets[it->second] == params) {
+            return it->second;
+        }
+    }
+    unsigned int id = (unsigned int) sets.size();
+    sets.push_back(params);
+    hash_map.insert(std::make_pair(key, id));
+    return id;
+}
+
+void Layout::set_grid(unsigned int dbu_per_uu, unsigned int mfg_grid_res) {
+    if (mfg_grid_res == 0) {
+        throw std::invalid_argument("Manufacturing grid resolution must be positive.");
+    }
+    if (point_arena.size() > 0 || !rect_list.empty() || !via_list.empty()
+            || !path_seg_list.empty()) {
+        throw std::logic_error("Cannot change the grid of a non-empty layout.");
+    }
+    grid = Grid(dbu_per_uu, mfg_grid_res);
+    point_arena.set_grid(grid);
+    rect_list.set_grid(grid);
+    via_list.set_grid(grid);
+    path_seg_list.set_grid(grid);
+}
+
+void Layout::clear() {
+    inst_list.clear();
+    rect_list.clear();
+    via_list.clear();
+    pin_list.clear();
+    path_seg_list.clear();
+    path_list.clear();
+    polygon_list.clear();
+    block_list.clear();
+    boundary_list.clear();
+    point_arena.clear();
+    num_off_grid = 0;
+}
+
+// grow bbox to include the raw bounds lo/hi scaled to user units.
+void merge_bbox(double bbox[4], const double lo[2], const double hi[2], double scale) {
+    if (lo[0] <= hi[0]) {
+        bbox[0] = std::min(bbox[0], lo[0] * scale);
+        bbox[1] = std::min(bbox[1], lo[1] * scale);
+        bbox[2] = std::max(bbox[2], hi[0] * scale);
+        bbox[3] = std::max(bbox[3], hi[1] * scale);
+    }
+}
+
+// accumulate bounds of n (x, y) points, each extended by ext and arrayed by
+// arr_n/arr_sp if given.  Works on either user-unit or database-unit columns.
+template<typename T>
+void points_bounds(const T * xy, std::size_t n, std::size_t stride, const int * arr_n,
+        const T * arr_sp, double ext, double lo[2], double hi[2]) {
+    for (std::size_t idx = 0; idx < n; idx++) {
+        const T * pt = xy + stride * idx;
+        double dx = 0, dy = 0;
+        if (arr_n != NULL) {
+            dx = (arr_n[2 * idx] - 1) * (double) arr_sp[2 * idx];
+            dy = (arr_n[2 * idx + 1] - 1) * (double) arr_sp[2 * idx + 1];
+        }
+        for (std::size_t j = 0; j < stride; j += 2) {
+            double x = (double) pt[j];
+            double y = (double) pt[j + 1];
+            lo[0] = std::min(lo[0], std::min(x, x + dx) - ext);
+            lo[1] = std::min(lo[1], std::min(y, y + dy) - ext);
+            hi[0] = std::max(hi[0], std::max(x, x + dx) + ext);
+            hi[1] = std::max(hi[1], std::max(y, y + dy) + ext);
+        }
+    }
+}
+
+// accumulate bounds of coordinate columns into bbox.
+void column_bbox(double bbox[4], const CoordArray & xy, std::size_t n, std::size_t stride,
+        const std::vector<int> * arr_n, const CoordArray * arr_sp) {
+    double lo[2] = { HUGE_VAL, HUGE_VAL };
+    double hi[2] = { -HUGE_VAL, -HUGE_VAL };
+    const int * n_ptr = (arr_n == NULL) ? NULL : arr_n->data();
+    if (xy.is_dbu()) {
+        const int32_t * sp_ptr = (arr_sp == NULL) ? NULL : arr_sp->idata();
+        points_bounds(xy.idata(), n, stride, n_ptr, sp_ptr, 0.0, lo, hi);
+        merge_bbox(bbox, lo, hi, 1.0 / xy.get_grid().dbu_per_uu);
+    } else {
+        const double * sp_ptr = (arr_sp == NULL) ? NULL : arr_sp->fdata();
+        points_bounds(xy.fdata(), n, stride, n_ptr, sp_ptr, 0.0, lo, hi);
+        merge_bbox(bbox, lo, hi, 1.0);
+    }
+}
+
+bool Layout::get_bbox(double bbox[4]) const {
+    bbox[0] = bbox[1] = HUGE_VAL;
+    bbox[2] = bbox[3] = -HUGE_VAL;
+
+    column_bbox(bbox, rect_list.bbox, rect_list.size(), 4, &rect_list.arr_n, &rect_list.arr_sp);
+    column_bbox(bbox, via_list.loc, via_list.size(), 2, &via_list.arr_n, &via_list.arr_sp);
+    column_bbox(bbox, point_arena, point_arena.size() / 2, 2, NULL, NULL);
+    for (std::size_t idx = 0; idx < path_seg_list.size(); idx++) {
+        // end points grown by half the width cover every end style.
+        double lo[2] = { HUGE_VAL, HUGE_VAL };
+        double hi[2] = { -HUGE_VAL, -HUGE_VAL };
+        double pts[4];
+        for (unsigned int j = 0; j < 4; j++) {
+            pts[j] = path_seg_list.pts[4 * idx + j];
+        }
+        points_bounds(pts, 1, 4, (const int *) NULL, (const double *) NULL,
+                path_seg_list.width[idx] / 2, lo, hi);
+        merge_bbox(bbox, lo, hi, 1.0);
+    }
+    for (PathIter it = path_list.begin(); it != path_list.end(); it++) {
+        double lo[2] = { HUGE_VAL, HUGE_VAL };
+        double hi[2] = { -HUGE_VAL, -HUGE_VAL };
+        double ext = it->width / 2;
+        for (std::size_t j = 0; j < 2 * it->points.num_pts; j += 2) {
+            double pt[2] = { point_arena[it->points.offset + j],
+                    point_arena[it->points.offset + j + 1] };
+            points_bounds(pt, 1, 2, (const int *) NULL, (const double *) NULL, ext, lo, hi);
+        }
+        merge_bbox(bbox, lo, hi, 1.0);
+    }
+    for (PinIter it = pin_list.begin(); it != pin_list.end(); it++) {
+        double lo[2] = { it->bbox[0], it->bbox[1] };
+        double hi[2] = { it->bbox[2], it->bbox[3] };
+        merge_bbox(bbox, lo, hi, 1.0);
+    }
+    for (InstIter it = inst_list.begin(); it != inst_list.end(); it++) {
+        double lo[2] = { HUGE_VAL, HUGE_VAL };
+        double hi[2] = { -HUGE_VAL, -HUGE_VAL };
+        int arr_n[2] = { it->num_cols, it->num_rows };
+        double arr_sp[2] = { it->sp_cols, it->sp_rows };
+        points_bounds(it->loc, 1, 2, arr_n, arr_sp, 0.0, lo, hi);
+        merge_bbox(bbox, lo, hi, 1.0);
+    }
+
+    return bbox[0] <= bbox[2];
+}
+
+void Layout::move_by(double dx, double dy) {
+    num_off_grid += rect_list.bbox.shift_xy(dx, dy);
+    num_off_grid += via_list.loc.shift_xy(dx, dy);
+    num_off_grid += path_seg_list.pts.shift_xy(dx, dy);
+    num_off_grid += point_arena.shift_xy(dx, dy);
+    for (PinList::iterator it = pin_list.begin(); it != pin_list.end(); it++) {
+        it->bbox[0] += dx;
+        it->bbox[1] += dy;
+        it->bbox[2] += dx;
+        it->bbox[3] += dy;
+    }
+    for (InstList::iterator it = inst_list.begin(); it != inst_list.end(); it++) {
+        it->loc[0] += dx;
+        it->loc[1] += dy;
+    }
+}
+
+void Layout::splice(Layout & other) {
+    if (grid != other.grid) {
+        throw std::invalid_argument("Cannot splice layouts on different grids.");
+    }
+    if (&other == this) {
+        return;
+    }
+
+    // layer/purpose ids of other in this layout.  Layouts whose tables were
+    // filled in the same order map every id to itself.
+    std::vector<unsigned int> lpp_map(other.lpp_table.size());
+    bool same_lpp = true;
+    for (unsigned int idx = 0; idx < other.lpp_table.size(); idx++) {
+        const LayerPurpose & lpp = other.lpp_table[idx];
+        lpp_map[idx] = lpp_table.get_id(lpp.layer, lpp.purpose);
+        same_lpp = same_lpp && lpp_map[idx] == idx;
+    }
+
+    std::vector<unsigned int> param_map(other.param_table.size());
+    for (unsigned int idx = 0; idx < other.param_table.size(); idx++) {
+        param_map[idx] = param_table.get_id(other.param_table[idx]);
+    }
+    std::size_t start = inst_list.size();
+    inst_list.insert(inst_list.end(), std::make_move_iterator(other.inst_list.begin()),
+            std::make_move_iterator(other.inst_list.end()));
+    for (std::size_t idx = start; idx < inst_list.size(); idx++) {
+        inst_list[idx].params = param_map[inst_list[idx].params];
+    }
+
+    start = rect_list.size();
+    rect_list.append(other.rect_list);
+    std::size_t seg_start = path_seg_list.size();
+    path_seg_list.append(other.path_seg_list);
+    std::size_t pin_start = pin_list.size();
+    pin_list.insert(pin_list.end(), std::make_move_iterator(other.pin_list.begin()),
+            std::make_move_iterator(other.pin_list.end()));
+    via_list.append(other.via_list);
+    if (!same_lpp) {
+        for (std::size_t idx = start; idx < rect_list.size(); idx++) {
+            rect_list.lpp[idx] = lpp_map[rect_list.lpp[idx]];
+        }
+        for (std::size_t idx = seg_start; idx < path_seg_list.size(); idx++) {
+            path_seg_list.lpp[idx] = lpp_map[path_seg_list.lpp[idx]];
+        }
+        for (std::size_t idx = pin_start; idx < pin_list.size(); idx++) {
+            pin_list[idx].lpp = lpp_map[pin_list[idx].lpp];
+        }
+    }
+
+    // point ranges move by the size of this arena.
+    std::size_t offset = point_arena.size();
+    point_arena.append(other.point_arena);
+    for (PathList::iterator it = other.path_list.begin(); it != other.path_list.end(); it++) {
+        it->lpp = lpp_map[it->lpp];
+        it->points.offset += offset;
+    }
+    for (PolygonList::iterator it = other.polygon_list.begin(); it != other.polygon_list.end();
+            it++) {
+        it->lpp = lpp_map[it->lpp];
+        it->points.offset += offset;
+    }
+    for (BlockageList::iterator it = other.block_list.begin(); it != other.block_list.end();
+            it++) {
+        it->points.offset += offset;
+    }
+    for (BoundaryList::iterator it = other.boundary_list.begin();
+            it != other.boundary_list.end(); it++) {
+        it->points.offset += offset;
+    }
+    path_list.insert(path_list.end(), other.path_list.begin(), other.path_list.end());
+    polygon_list.insert(polygon_list.end(), other.polygon_list.begin(), other.polygon_list.end());
+    block_list.insert(block_list.end(), std::make_move_iterator(other.block_list.begin()),
+            std::make_move_iterator(other.block_list.end()));
+    boundary_list.insert(boundary_list.end(),
+            std::make_move_iterator(other.boundary_list.begin()),
+            std::make_move_iterator(other.boundary_list.end()));
+
+    num_off_grid += other.num_off_grid;
+    other.clear();
+}
+
+void check_points(const std::vector<double> & xcoord, const std::vector<double> & ycoord) {
+    if (xcoord.size() != ycoord.size()) {
+        throw std::invalid_argument("X and Y coordinate lists have different lengths.");
+    }
+}
+
+void Layout::add_points(PointRange & points, const std::vector<double> & xcoord,
+        const std::vector<double> & ycoord) {
+    // interleave into the scratch buffer so the whole list is snapped in one pass.
+    std::size_t num_pts = xcoord.size();
+    xy_buf.resize(2 * num_pts);
+    for (std::size_t idx = 0; idx < num_pts; idx++) {
+        xy_buf[2 * idx] = xcoord[idx];
+        xy_buf[2 * idx + 1] = ycoord[idx];
+    }
+    add_points(points, num_pts, xy_buf.data());
+}
+
+// appends nothing if a coordinate is rejected, so callers store the shape
+// only after its points were added.
+void Layout::add_points(PointRange & points, std::size_t num_pts, const double * xy) {
+    points.offset = point_arena.size();
+    points.num_pts = num_pts;
+    num_off_grid += point_arena.append(xy, 2 * num_pts);
+}
+
+void Layout::check_lpp(unsigned int lpp) const {
+    if (lpp >= lpp_table.size()) {
+        std::ostringstream os;
+        os << "Invalid layer/purpose id: " << lpp;
+        throw std::out_of_range(os.str());
+    }
+}
+
 void Layout::add_inst(const std::string & lib_name, const std::string & cell_name,
         const std::string & view_name, const std::string & inst_name, double xc, double yc,
         const std::string & orient, const IntMap & int_params, const StrMap & str_params,
         const DoubleMap & double_params, int num_rows, int num_cols, double sp_rows,
         double sp_cols) {
+    ParamSet params;
+    params.int_params = int_params;
+    params.str_params = str_params;
+    params.double_params = double_params;
+    add_inst(lib_name, cell_name, view_name, inst_name, xc, yc, orient,
+            param_table.get_id(params), num_rows, num_cols, sp_rows, sp_cols);
+}
+
+void Layout::add_inst(const std::string & lib_name, const std::string & cell_name,
+        const std::string & view_name, const std::string & inst_name, double xc, double yc,
+        const std::string & orient, unsigned int params, int num_rows, int num_cols,
+        double sp_rows, double sp_cols) {
+    if (params >= param_table.size()) {
+        throw std::invalid_argument("add_inst: invalid parameter set id.");
+    }
     Inst obj;
     obj.lib_name = lib_name;
     obj.cell_name = cell_name;
@@ -47,44 +388,62 @@ void Layout::add_inst(const std::string & lib_name, const std::string & cell_nam
     obj.num_cols = num_cols;
     obj.sp_rows = sp_rows;
     obj.sp_cols = sp_cols;
-    obj.str_params = str_params;
-    obj.int_params = int_params;
-    obj.double_params = double_params;
+    obj.params = params;
 
     inst_list.push_back(obj);
 }
 
 void Layout::add_rect(const std::string & lay_name, const std::string & purp_name, double xl,
         double yb, double xr, double yt, unsigned int nx, unsigned int ny, double spx, double spy) {
-    Rect r;
-    r.layer = lay_name;
-    r.purpose = purp_name;
-    r.bbox[0] = xl;
-    r.bbox[1] = yb;
-    r.bbox[2] = xr;
-    r.bbox[3] = yt;
-    r.nx = nx;
-    r.ny = ny;
-    r.spx = spx;
-    r.spy = spy;
+    add_rect(lpp_table.get_id(lay_name, purp_name), xl, yb, xr, yt, nx, ny, spx, spy);
+}
 
-    rect_list.push_back(r);
+void Layout::add_rect(unsigned int lpp, double xl, double yb, double xr, double yt,
+        unsigned int nx, unsigned int ny, double spx, double spy) {
+    check_lpp(lpp);
+    double box[4] = { xl, yb, xr, yt };
+    int arr_nx = nx;
+    int arr_ny = ny;
+    double sp[2] = { spx, spy };
+    num_off_grid += rect_list.append(lpp, 1, box, &arr_nx, &arr_ny, sp);
+}
+
+void Layout::add_rects(unsigned int lpp, std::size_t n, const double * bbox, const int * nx,
+        const int * ny, const double * sp) {
+    check_lpp(lpp);
+    num_off_grid += rect_list.append(lpp, n, bbox, nx, ny, sp);
 }
 
 void Layout::add_path_seg(const std::string & lay_name, const std::string & purp_name, double x0,
         double y0, double x1, double y1, double width, const std::string & begin_style,
         const std::string & end_style) {
-    PathSeg p;
-    p.layer = lay_name;
-    p.purpose = purp_name;
-    p.x0 = x0;
-    p.y0 = y0;
-    p.x1 = x1;
-    p.y1 = y1;
-    p.width= width;
-    p.begin_style = begin_style;
-    p.end_style = end_style;
-    path_seg_list.push_back(p);
+    add_path_seg(lpp_table.get_id(lay_name, purp_name), x0, y0, x1, y1, width, begin_style,
+            end_style);
+}
+
+void Layout::add_path_seg(unsigned int lpp, double x0, double y0, double x1, double y1,
+        double width, const std::string & begin_style, const std::string & end_style) {
+    check_lpp(lpp);
+    double pts[4] = { x0, y0, x1, y1 };
+    num_off_grid += path_seg_list.push_back(lpp, pts, width, get_end_style_code(begin_style),
+            get_end_style_code(end_style));
+}
+
+void Layout::add_path(unsigned int lpp, std::size_t num_pts, const double * xy, double width,
+        const std::string & begin_style, const std::string & end_style,
+        const std::string & join_style) {
+    check_lpp(lpp);
+    if (num_pts < 2) {
+        throw std::invalid_argument("add_path: a path needs at least two points.");
+    }
+    Path p;
+    p.lpp = lpp;
+    p.width = width;
+    p.begin_style = get_end_style_code(begin_style);
+    p.end_style = get_end_style_code(end_style);
+    p.join_style = get_end_style_code(join_style);
+    add_points(p.points, num_pts, xy);
+    path_list.push_back(p);
 }
 
 void Layout::add_via(const std::string & via_name, double xc, double yc, const std::string & orient,
@@ -92,39 +451,58 @@ void Layout::add_via(const std::string & via_name, double xc, double yc, const s
         double enc1_xl, double enc1_yb, double enc1_xr, double enc1_yt, double enc2_xl,
         double enc2_yb, double enc2_xr, double enc2_yt, double cut_width, double cut_height,
         unsigned int nx, unsigned int ny, double spx, double spy) {
-    Via v;
-    v.via_id = via_name;
-    v.orient = get_orient_code(orient);
-    v.loc[0] = xc;
-    v.loc[1] = yc;
-    v.num_rows = num_rows;
-    v.num_cols = num_cols;
-    v.spacing[0] = sp_cols;
-    v.spacing[1] = sp_rows;
-    v.enc1[0] = (enc1_xr + enc1_xl) / 2.0;
-    v.enc1[1] = (enc1_yt + enc1_yb) / 2.0;
-    v.off1[0] = (enc1_xr - enc1_xl) / 2.0;
-    v.off1[1] = (enc1_yt - enc1_yb) / 2.0;
-    v.enc2[0] = (enc2_xr + enc2_xl) / 2.0;
-    v.enc2[1] = (enc2_yt + enc2_yb) / 2.0;
-    v.off2[0] = (enc2_xr - enc2_xl) / 2.0;
-    v.off2[1] = (enc2_yt - enc2_yb) / 2.0;
-    v.cut_width = cut_width;
-    v.cut_height = cut_height;
-    v.nx = nx;
-    v.ny = ny;
-    v.spx = spx;
-    v.spy = spy;
-
-    via_list.push_back(v);
+    push_via(via_list.names.get_id(via_name), get_orient_code(orient), xc, yc, num_rows,
+            num_cols, sp_rows, sp_cols, enc1_xl, enc1_yb, enc1_xr, enc1_yt, enc2_xl, enc2_yb,
+            enc2_xr, enc2_yt, cut_width, cut_height, nx, ny, spx, spy);
+}
+
+void Layout::push_via(unsigned int via_id, unsigned char orient, double xc, double yc,
+        unsigned int num_rows, unsigned int num_cols, double sp_rows, double sp_cols,
+        double enc1_xl, double enc1_yb, double enc1_xr, double enc1_yt, double enc2_xl,
+        double enc2_yb, double enc2_xr, double enc2_yt, double cut_width, double cut_height,
+        unsigned int nx, unsigned int ny, double spx, double spy) {
+    double xy[2] = { xc, yc };
+    double sp[2] = { sp_cols, sp_rows };
+    double e1[4] = { enc1_xl, enc1_yb, enc1_xr, enc1_yt };
+    double e2[4] = { enc2_xl, enc2_yb, enc2_xr, enc2_yt };
+    double cut[2] = { cut_width, cut_height };
+    double asp[2] = { spx, spy };
+    num_off_grid += via_list.push_back(via_id, orient, xy, num_rows, num_cols, sp, e1, e2, cut,
+            nx, ny, asp);
+}
+
+void Layout::add_vias(const std::string & via_name, const std::string & orient, std::size_t n,
+        const double * loc, const int * num_rows, const int * num_cols, const double * sp,
+        const double * enc1, const double * enc2, const double * cut_size, const int * nx,
+        const int * ny, const double * arr_sp) {
+    unsigned char orient_code = get_orient_code(orient);
+    unsigned int via_id = via_list.names.get_id(via_name);
+    via_list.reserve(via_list.size() + n);
+    for (std::size_t idx = 0; idx < n; idx++) {
+        const double * e1 = enc1 + 4 * idx;
+        const double * e2 = enc2 + 4 * idx;
+        push_via(via_id, orient_code, loc[2 * idx], loc[2 * idx + 1], num_rows[idx],
+                num_cols[idx], sp[2 * idx + 1], sp[2 * idx], e1[0], e1[1], e1[2], e1[3], e2[0],
+                e2[1], e2[2], e2[3], (cut_size == NULL) ? -1 : cut_size[2 * idx],
+                (cut_size == NULL) ? -1 : cut_size[2 * idx + 1], (nx == NULL) ? 1 : nx[idx],
+                (ny == NULL) ? 1 : ny[idx], (arr_sp == NULL) ? 0 : arr_sp[2 * idx],
+                (arr_sp == NULL) ? 0 : arr_sp[2 * idx + 1]);
+    }
 }
 
 void Layout::add_pin(const std::string & net_name, const std::string & pin_name,
         const std::string & label, const std::string & lay_name, const std::string & purp_name,
         double xl, double yb, double xr, double yt, bool make_pin_obj) {
+    add_pin(net_name, pin_name, label, lpp_table.get_id(lay_name, purp_name), xl, yb, xr, yt,
+            make_pin_obj);
+}
+
+void Layout::add_pin(const std::string & net_name, const std::string & pin_name,
+        const std::string & label, unsigned int lpp, double xl, double yb, double xr, double yt,
+        bool make_pin_obj) {
+    check_lpp(lpp);
     Pin p;
-    p.layer = lay_name;
-    p.purpose = purp_name;
+    p.lpp = lpp;
     p.bbox[0] = xl;
     p.bbox[1] = yb;
     p.bbox[2] = xr;
@@ -137,36 +515,147 @@ void Layout::add_pin(const std::string & net_name, const std::string & pin_name,
     pin_list.push_back(p);
 }
 
+void Layout::add_pins(unsigned int lpp, std::size_t n, const double * bbox,
+        const std::vector<std::string> & net_names, const std::vector<std::string> & pin_names,
+        const std::vector<std::string> & labels, bool make_pin_obj) {
+    check_lpp(lpp);
+    if (net_names.size() != n || pin_names.size() != n || labels.size() != n) {
+        throw std::invalid_argument("Pin name lists do not match the number of pins.");
+    }
+    pin_list.reserve(pin_list.size() + n);
+    for (std::size_t idx = 0; idx < n; idx++) {
+        pin_list.push_back(Pin());
+        Pin & p = pin_list.back();
+        const double * box = bbox + 4 * idx;
+        p.lpp = lpp;
+        p.bbox[0] = box[0];
+        p.bbox[1] = box[1];
+        p.bbox[2] = box[2];
+        p.bbox[3] = box[3];
+        p.term_name = net_names[idx];
+        p.pin_name = pin_names[idx];
+        p.label = labels[idx];
+        p.make_pin_obj = make_pin_obj;
+    }
+}
+
 void Layout::add_polygon(const std::string & lay_name, const std::string & purp_name,
                          const std::vector<double> & xcoord, const std::vector<double> & ycoord) {
+    add_polygon(lpp_table.get_id(lay_name, purp_name), xcoord, ycoord);
+}
+
+void Layout::add_polygon(unsigned int lpp, const std::vector<double> & xcoord,
+                         const std::vector<double> & ycoord) {
+    check_lpp(lpp);
+    check_points(xcoord, ycoord);
     Polygon b;
-    b.layer = lay_name;
-    b.purpose = purp_name;
-    b.xcoord = xcoord;
-    b.ycoord = ycoord;
+    b.lpp = lpp;
+    add_points(b.points, xcoord, ycoord);
+    polygon_list.push_back(b);
+}
 
+void Layout::add_polygon(unsigned int lpp, std::size_t num_pts, const double * xy) {
+    check_lpp(lpp);
+    Polygon b;
+    b.lpp = lpp;
+    add_points(b.points, num_pts, xy);
     polygon_list.push_back(b);
 }
     
 void Layout::add_blockage(const std::string & type, const std::string & layer, const std::vector<double> & xcoord,
         const std::vector<double> & ycoord) {
+    check_points(xcoord, ycoord);
     Blockage b;
     b.type = type;
     b.layer = layer;
-    b.xcoord = xcoord;
-    b.ycoord = ycoord;
+    add_points(b.points, xcoord, ycoord);
+    block_list.push_back(b);
+}
 
+void Layout::add_blockage(const std::string & type, const std::string & layer,
+        std::size_t num_pts, const double * xy) {
+    Blockage b;
+    b.type = type;
+    b.layer = layer;
+    add_points(b.points, num_pts, xy);
     block_list.push_back(b);
 }
 
 void Layout::add_boundary(const std::string & type, const std::vector<double> & xcoord,
         const std::vector<double> & ycoord) {
+    check_points(xcoord, ycoord);
     Boundary b;
     b.type = type;
-    b.xcoord = xcoord;
-    b.ycoord = ycoord;
+    add_points(b.points, xcoord, ycoord);
+    boundary_list.push_back(b);
+}
 
+void Layout::add_boundary(const std::string & type, std::size_t num_pts, const double * xy) {
+    Boundary b;
+    b.type = type;
+    add_points(b.points, num_pts, xy);
     boundary_list.push_back(b);
 }
 
+unsigned int LayoutBuilder::get_lpp_id(const std::string & lay_name,
+        const std::string & purp_name) {
+    return layout.get_lpp_id(lay_name, purp_name);
+}
+
+unsigned int LayoutBuilder::get_param_id(const ParamSet & params) {
+    return layout.get_param_id(params);
+}
+
+void LayoutBuilder::add_inst(const std::string & lib_name, const std::string & cell_name,
+        const std::string & view_name, const std::string & inst_name, double xc, double yc,
+        const std::string & orient, unsigned int params, int num_rows, int num_cols,
+        double sp_rows, double sp_cols) {
+    layout.add_inst(lib_name, cell_name, view_name, inst_name, xc, yc, orient, params, num_rows,
+            num_cols, sp_rows, sp_cols);
+}
+
+void LayoutBuilder::add_rect(unsigned int lpp, double xl, double yb, double xr, double yt) {
+    layout.add_rect(lpp, xl, yb, xr, yt);
+}
+
+void LayoutBuilder::add_path_seg(unsigned int lpp, double x0, double y0, double x1, double y1,
+        double width, const std::string & begin_style, const std::string & end_style) {
+    layout.add_path_seg(lpp, x0, y0, x1, y1, width, begin_style, end_style);
+}
+
+void LayoutBuilder::add_path(unsigned int lpp, std::size_t num_pts, const double * xy,
+        double width, const std::string & begin_style, const std::string & end_style,
+        const std::string & join_style) {
+    layout.add_path(lpp, num_pts, xy, width, begin_style, end_style, join_style);
+}
+
+void LayoutBuilder::add_via(const std::string & via_name, double xc, double yc,
+        const std::string & orient, unsigned int num_rows, unsigned int num_cols, double sp_rows,
+        double sp_cols, double enc1_xl, double enc1_yb, double enc1_xr, double enc1_yt,
+        double enc2_xl, double enc2_yb, double enc2_xr, double enc2_yt, double cut_width,
+        double cut_height) {
+    layout.add_via(via_name, xc, yc, orient, num_rows, num_cols, sp_rows, sp_cols, enc1_xl,
+            enc1_yb, enc1_xr, enc1_yt, enc2_xl, enc2_yb, enc2_xr, enc2_yt, cut_width, cut_height);
+}
+
+void LayoutBuilder::add_pin(const std::string & net_name, const std::string & pin_name,
+        const std::string & label, unsigned int lpp, double xl, double yb, double xr, double yt,
+        bool make_pin_obj) {
+    layout.add_pin(net_name, pin_name, label, lpp, xl, yb, xr, yt, make_pin_obj);
+}
+
+void LayoutBuilder::add_polygon(unsigned int lpp, std::size_t num_pts, const double * xy) {
+    layout.add_polygon(lpp, num_pts, xy);
+}
+
+void LayoutBuilder::add_blockage(const std::string & type, const std::string & layer,
+        std::size_t num_pts, const double * xy) {
+    layout.add_blockage(type, layer, num_pts, xy);
+}
+
+void LayoutBuilder::add_boundary(const std::string & type, std::size_t num_pts,
+        const double * xy) {
+    layout.add_boundary(type, num_pts, xy);
+}
+
 }
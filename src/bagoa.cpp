@@ -34,6 +34,62 @@ oa::oaString get_orient_name(unsigned char orient_code) {
     }
 }
 
+// orientations indexed by code, in the order of get_orient_name()
+const oa::oaOrient orient_table[] = { oa::oaOrient(oa::oacR0), oa::oaOrient(oa::oacMX),
+        oa::oaOrient(oa::oacMY), oa::oaOrient(oa::oacR180), oa::oaOrient(oa::oacR90),
+        oa::oaOrient(oa::oacMXR90), oa::oaOrient(oa::oacMYR90), oa::oaOrient(oa::oacR270) };
+
+const oa::oaOrient & get_orient(unsigned char orient_code) {
+    if (orient_code >= sizeof(orient_table) / sizeof(orient_table[0])) {
+        // throws the invalid orientation error
+        get_orient_name(orient_code);
+    }
+    return orient_table[orient_code];
+}
+
+unsigned char get_orient_code(const oa::oaOrient & orient) {
+    oa::oaOrientEnum val = orient;
+    for (unsigned char code = 0; code < sizeof(orient_table) / sizeof(orient_table[0]); code++) {
+        if ((oa::oaOrientEnum) orient_table[code] == val) {
+            return code;
+        }
+    }
+    throw std::invalid_argument("Invalid OA orientation.");
+}
+
+// names of write phases and OA call classes, in enum order
+const char * const phase_names[] = { "prepare", "hash_check", "open", "inst", "rect",
+        "path_seg", "path", "via", "pin", "polygon", "blockage", "boundary", "save", "close" };
+
+const char * const call_class_names[] = { "lookup", "design", "inst", "shape", "via", "conn",
+        "blockage", "boundary" };
+
+const char * get_phase_name(unsigned int phase) {
+    if (phase >= num_write_phases) {
+        throw std::invalid_argument("Invalid write phase.");
+    }
+    return phase_names[phase];
+}
+
+const char * get_call_class_name(unsigned int cls) {
+    if (cls >= num_call_classes) {
+        throw std::invalid_argument("Invalid OA call class.");
+    }
+    return call_class_names[cls];
+}
+
+void WriteStats::clear() {
+    num_layouts = 0;
+    for (unsigned int idx = 0; idx < num_write_phases; idx++) {
+        time[idx] = 0;
+        count[idx] = 0;
+    }
+    for (unsigned int idx = 0; idx < num_call_classes; idx++) {
+        calls[idx] = 0;
+    }
+    skipped.clear();
+}
+
 LibDefObserver::LibDefObserver(oa::oaUInt4 priority) :
         oa::oaObserver<oa::oaLibDefList>(priority, true) {}
 
@@ -44,17 +100,105 @@ oa::oaBoolean LibDefObserver::onLoadWarnings(oa::oaLibDefList *obj, const oa::oa
     return true;
 }
 
-void OALayoutLibrary::open_library(const std::string & lib_file, const std::string & library,
-                                   const std::string & lib_path, const std::string & tech_lib) {
-    try {
-        oaDesignInit
-        ( oacAPIMajorRevNumber, oacAPIMinorRevNumber, oacDataModelRevNumber);
+// OA only needs to be initialized once per process, and each library definition
+// file only needs to be read once.
+std::once_flag oa_init_flag;
+std::mutex oa_state_mutex;
+// OA is not thread-safe.  Every OA call of the writers, from any library and
+// from the write queue threads, is made while holding this lock.
+std::mutex oa_mutex;
+std::set<std::string> lib_def_files;
+TechCache tech_cache;
+
+void init_oa() {
+    oaDesignInit
+    ( oacAPIMajorRevNumber, oacAPIMinorRevNumber, oacDataModelRevNumber);
+}
 
-        // open library definition
+bool open_lib_defs(const std::string & lib_file) {
+    std::call_once(oa_init_flag, init_oa);
+
+    std::lock_guard<std::mutex> lock(oa_state_mutex);
+    if (!lib_def_files.insert(lib_file).second) {
+        return false;
+    }
+    try {
         oa::oaString lib_def_file(lib_file.c_str());
         oa::oaLibDefList::openLibs(lib_def_file);
+    } catch (...) {
+        lib_def_files.erase(lib_file);
+        throw;
+    }
+    return true;
+}
+
+TechInfoPtr get_tech_info(oa::oaLib * lib_ptr, const std::string & library) {
+    // key by the attached technology library if any, otherwise the library owns its tech.
+    std::string tech_lib = library;
+    oa::oaScalarName tech_lib_name;
+    if (oa::oaTech::getAttachment(lib_ptr, tech_lib_name)) {
+        oa::oaString temp;
+        tech_lib_name.get(ns, temp);
+        tech_lib = static_cast<std::string>(temp);
+    }
+
+    std::lock_guard<std::mutex> lock(oa_state_mutex);
+    TechIter tech_iter = tech_cache.find(tech_lib);
+    if (tech_iter != tech_cache.end() && tech_iter->second->tech_ptr->isValid()) {
+        return tech_iter->second;
+    }
+
+    // open technology file
+    oa::oaTech * tech_ptr = oa::oaTech::find(lib_ptr);
+    if (tech_ptr == NULL) {
+        // opened tech not found, attempt to open
+        if (!oa::oaTech::exists(lib_ptr)) {
+            throw std::runtime_error("Cannot find technology for library: " + library);
+        } else {
+            tech_ptr = oa::oaTech::open(lib_ptr, 'r');
+            if (tech_ptr == NULL) {
+                throw std::runtime_error("Cannot open technology for library: " + library);
+            }
+        }
+    }
+
+    // build a new entry, libraries holding the old one keep it.
+    std::shared_ptr<TechInfo> info_ptr(new TechInfo());
+    TechInfo & info = *info_ptr;
+    info.tech_ptr = tech_ptr;
+
+    // get database unit
+    info.dbu_per_uu = tech_ptr->getDBUPerUU(oa::oaViewType::get(oa::oacMaskLayout));
+    info.mfg_grid_res = tech_ptr->getDefaultManufacturingGrid();
+
+    // fill layer/purpose map
+    oa::oaString temp;
+    oa::oaIter<oa::oaLayer> layers(tech_ptr->getLayers());
+    while (oa::oaLayer *layer = layers.getNext()) {
+        layer->getName(temp);
+        std::string name = static_cast<std::string>(temp);
+        oa::oaLayerNum id = layer->getNumber();
+        info.lay_map[name] = id;
+    }
+    oa::oaIter<oa::oaPurpose> purposes(tech_ptr->getPurposes());
+    while (oa::oaPurpose *purp = purposes.getNext()) {
+        purp->getName(temp);
+        std::string name = static_cast<std::string>(temp);
+        oa::oaLayerNum id = purp->getNumber();
+        info.purp_map[name] = id;
+    }
+    tech_cache[tech_lib] = info_ptr;
+    return info_ptr;
+}
 
-        if (!lib_def_obs.err_msg.empty()) {
+void OALayoutLibrary::open_library(const std::string & lib_file, const std::string & library,
+                                   const std::string & lib_path, const std::string & tech_lib) {
+    flush();
+    std::lock_guard<std::mutex> oa_lock(oa_mutex);
+    try {
+        // open library definition
+        lib_def_obs.err_msg.clear();
+        if (open_lib_defs(lib_file) && !lib_def_obs.err_msg.empty()) {
             throw std::runtime_error(lib_def_obs.err_msg);
         }
 
@@ -77,40 +221,20 @@ void OALayoutLibrary::open_library(const std::string & lib_file, const std::stri
             throw std::invalid_argument("Invalid library: " + library);
         }
 
-        // open technology file
-        tech_ptr = oa::oaTech::find(lib_ptr);
-        if (tech_ptr == NULL) {
-            // opened tech not found, attempt to open
-            if (!oa::oaTech::exists(lib_ptr)) {
-                throw std::runtime_error("Cannot find technology for library: " + library);
-            } else {
-                tech_ptr = oa::oaTech::open(lib_ptr, 'r');
-                if (tech_ptr == NULL) {
-                    throw std::runtime_error("Cannot open technology for library: " + library);
-                }
-            }
-        }
-
-        // get database unit
-        dbu_per_uu = tech_ptr->getDBUPerUU(oa::oaViewType::get(oa::oacMaskLayout));
-        mfg_grid_res = tech_ptr->getDefaultManufacturingGrid();
-
-        // fill layer/purpose map
-        oa::oaString temp;
-        oa::oaIter<oa::oaLayer> layers(tech_ptr->getLayers());
-        while (oa::oaLayer *layer = layers.getNext()) {
-            layer->getName(temp);
-            std::string name = static_cast<std::string>(temp);
-            oa::oaLayerNum id = layer->getNumber();
-            lay_map[name] = id;
-        }
-        oa::oaIter<oa::oaPurpose> purposes(tech_ptr->getPurposes());
-        while (oa::oaPurpose *purp = purposes.getNext()) {
-            purp->getName(temp);
-            std::string name = static_cast<std::string>(temp);
-            oa::oaLayerNum id = purp->getNumber();
-            purp_map[name] = id;
-        }
+        // technology data is cached per technology library, copy the layer and
+        // purpose maps so add_layer()/add_purpose() only affect this library.
+        TechInfoPtr tech_info = get_tech_info(lib_ptr, library);
+        tech_ptr = tech_info->tech_ptr;
+        dbu_per_uu = tech_info->dbu_per_uu;
+        mfg_grid_res = tech_info->mfg_grid_res;
+        lay_map = tech_info->lay_map;
+        purp_map = tech_info->purp_map;
+        num_hash_hits = num_hash_misses = 0;
+        master_cache.clear();
+        via_def_cache.clear();
+        num_master_hits = num_master_misses = 0;
+        num_via_def_hits = num_via_def_misses = 0;
+        stats.clear();
 
         is_open = true;
     } catch (oa::oaCompatibilityError &ex) {
@@ -127,22 +251,138 @@ void OALayoutLibrary::open_library(const std::string & lib_file, const std::stri
     }
 }
 
+OALayoutLibrary::~OALayoutLibrary() {
+    stop_writer_thread();
+}
+
 void OALayoutLibrary::add_purpose(const std::string & purp_name, unsigned int purp_num) {
+    flush();
     purp_map[purp_name] = (oa::oaPurposeNum) purp_num;
 }
 
 void OALayoutLibrary::add_layer(const std::string & lay_name, unsigned int lay_num) {
+    flush();
     lay_map[lay_name] = (oa::oaLayerNum) lay_num;
 }
 
 void OALayoutLibrary::close() {
+    stop_writer_thread();
+    std::lock_guard<std::mutex> oa_lock(oa_mutex);
     if (is_open) {
-        tech_ptr->close();
+        // the technology stays open in the process-wide cache.
         lib_ptr->close();
+        master_cache.clear();
+        via_def_cache.clear();
 
         is_open = false;
     }
+    if (write_error) {
+        std::exception_ptr err = write_error;
+        write_error = std::exception_ptr();
+        std::rethrow_exception(err);
+    }
+
+}
+
+// name of the design property holding the content hash of the written layout.
+const char * layout_hash_prop = "bagLayoutHash";
+
+// number of int32 values stored per via in PreparedLayout::via_par:
+// (x, y, spacing x/y, enc1 x/y, off1 x/y, enc2 x/y, off2 x/y, cut w/h, spx, spy).
+const std::size_t via_par_size = 16;
+
+// the OA enclosure (x, y) and offset (x, y) of via enclosure box idx
+// (xl, yb, xr, yt), taken from the unsnapped box and snapped once.  Returns
+// the number of off-grid results.
+std::size_t get_via_enc(const bag::CoordArray & enc, std::size_t idx, const bag::Grid & grid,
+        int32_t * out) {
+    double xl = enc[4 * idx];
+    double yb = enc[4 * idx + 1];
+    double xr = enc[4 * idx + 2];
+    double yt = enc[4 * idx + 3];
+    double vals[4] = { (xr + xl) / 2, (yt + yb) / 2, (xr - xl) / 2, (yt - yb) / 2 };
+    return bag::quantize(vals, out, 4, grid);
+}
+
+// hands prepared layouts from the worker threads to the writer, in order.  At
+// most window layouts are kept in memory ahead of the writer.
+class PrepPipeline {
+public:
+    PrepPipeline(std::size_t num_cells, std::size_t window) :
+            slots(num_cells), ready(num_cells, 0), errors(num_cells), next_job(0),
+            next_write(0), window(window), stopped(false) {
+    }
+
+    // get the next layout to prepare.  Returns false when there is no more work.
+    bool take(std::size_t & idx) {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!stopped && next_job < slots.size() && next_job >= next_write + window) {
+            space_cv.wait(lock);
+        }
+        if (stopped || next_job >= slots.size()) {
+            return false;
+        }
+        idx = next_job++;
+        return true;
+    }
+
+    void finish(std::size_t idx, std::exception_ptr err) {
+        std::lock_guard<std::mutex> lock(mtx);
+        ready[idx] = 1;
+        errors[idx] = err;
+        ready_cv.notify_all();
+    }
+
+    // wait for the given layout, rethrowing any preparation error.
+    PreparedLayout & wait(std::size_t idx) {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!ready[idx]) {
+            ready_cv.wait(lock);
+        }
+        if (errors[idx]) {
+            std::rethrow_exception(errors[idx]);
+        }
+        return slots[idx];
+    }
+
+    // free the given layout once it has been written.
+    void release(std::size_t idx) {
+        PreparedLayout empty;
+        std::lock_guard<std::mutex> lock(mtx);
+        std::swap(slots[idx], empty);
+        next_write = idx + 1;
+        space_cv.notify_all();
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopped = true;
+        space_cv.notify_all();
+    }
 
+    std::vector<PreparedLayout> slots;
+
+private:
+    std::vector<char> ready;
+    std::vector<std::exception_ptr> errors;
+    std::size_t next_job, next_write, window;
+    bool stopped;
+    std::mutex mtx;
+    std::condition_variable space_cv, ready_cv;
+};
+
+void prepare_worker(const OALayoutLibrary * lib, PrepPipeline * pipe,
+        const LayoutPtrList * layouts) {
+    std::size_t idx;
+    while (pipe->take(idx)) {
+        std::exception_ptr err;
+        try {
+            lib->prepare_layout(*(*layouts)[idx], pipe->slots[idx]);
+        } catch (...) {
+            err = std::current_exception();
+        }
+        pipe->finish(idx, err);
+    }
 }
 
 void OALayoutLibrary::create_layout(const std::string & cell, const std::string & view,
@@ -152,44 +392,385 @@ void OALayoutLibrary::create_layout(const std::string & cell, const std::string
         return;
     }
 
+    flush();
+    PreparedLayout prep;
+    prepare_layout(layout, prep);
+    std::lock_guard<std::mutex> oa_lock(oa_mutex);
+    write_layout(cell, view, prep);
+}
+
+WriteTicket OALayoutLibrary::create_layout_async(const std::string & cell,
+        const std::string & view, bag::Layout && layout) {
+    std::unique_ptr<WriteJob> job(new WriteJob());
+    WriteTicket ticket(job->result.get_future().share());
+    // do nothing if no library is opened
+    if (!is_open) {
+        job->result.set_value();
+        return ticket;
+    }
+
+    job->cell = cell;
+    job->view = view;
+    job->layout = std::move(layout);
+    std::unique_lock<std::mutex> lock(queue_mtx);
+    if (!writer.joinable()) {
+        stop_writer = false;
+        writer = std::thread(&OALayoutLibrary::run_writer, this);
+    }
+    while (write_queue.size() >= max_queued) {
+        queue_cv.wait(lock);
+    }
+    write_queue.push_back(std::move(job));
+    queue_cv.notify_all();
+    return ticket;
+}
+
+void OALayoutLibrary::set_max_queued(std::size_t val) {
+    if (val == 0) {
+        throw std::invalid_argument("set_max_queued: the write queue must hold a layout.");
+    }
+    std::lock_guard<std::mutex> lock(queue_mtx);
+    max_queued = val;
+    queue_cv.notify_all();
+}
+
+void OALayoutLibrary::flush() {
+    std::unique_lock<std::mutex> lock(queue_mtx);
+    while (!write_queue.empty()) {
+        queue_cv.wait(lock);
+    }
+}
+
+void OALayoutLibrary::run_writer() {
+    std::unique_lock<std::mutex> lock(queue_mtx);
+    while (true) {
+        while (!stop_writer && write_queue.empty()) {
+            queue_cv.wait(lock);
+        }
+        if (write_queue.empty()) {
+            return;
+        }
+
+        // the job stays queued while it is written, so flush() waits for it.
+        WriteJob & job = *write_queue.front();
+        lock.unlock();
+        std::exception_ptr err;
+        try {
+            PreparedLayout prep;
+            prepare_layout(job.layout, prep);
+            // preparing does not use OA, so only the write holds the OA lock
+            std::lock_guard<std::mutex> oa_lock(oa_mutex);
+            write_layout(job.cell, job.view, prep);
+        } catch (...) {
+            err = std::current_exception();
+        }
+        if (err) {
+            job.result.set_exception(err);
+        } else {
+            job.result.set_value();
+        }
+
+        lock.lock();
+        if (err && !write_error) {
+            write_error = err;
+        }
+        write_queue.pop_front();
+        queue_cv.notify_all();
+    }
+}
+
+void OALayoutLibrary::stop_writer_thread() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mtx);
+        stop_writer = true;
+        queue_cv.notify_all();
+    }
+    // the writer drains the queue before it stops
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+void OALayoutLibrary::create_layouts(const std::vector<std::string> & cells,
+        const std::vector<std::string> & views, const LayoutPtrList & layouts,
+        unsigned int num_threads) {
+    // do nothing if no library is opened
+    if (!is_open) {
+        return;
+    }
+
+    flush();
+    std::size_t num_cells = layouts.size();
+    if (cells.size() != num_cells || views.size() != num_cells) {
+        throw std::invalid_argument("create_layouts: cell, view and layout lists differ in size.");
+    }
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    num_threads = (unsigned int) std::min((std::size_t) num_threads, num_cells);
+
+    // OA is only ever used from this thread, under the OA lock; the workers
+    // only prepare layouts.
+    PrepPipeline pipe(num_cells, 2 * num_threads);
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned int idx = 0; idx < num_threads; idx++) {
+            workers.push_back(std::thread(prepare_worker, this, &pipe, &layouts));
+        }
+        for (std::size_t idx = 0; idx < num_cells; idx++) {
+            const PreparedLayout & prep = pipe.wait(idx);
+            std::lock_guard<std::mutex> oa_lock(oa_mutex);
+            write_layout(cells[idx], views[idx], prep);
+            pipe.release(idx);
+        }
+    } catch (...) {
+        pipe.stop();
+        for (std::size_t idx = 0; idx < workers.size(); idx++) {
+            workers[idx].join();
+        }
+        throw;
+    }
+    for (std::size_t idx = 0; idx < workers.size(); idx++) {
+        workers[idx].join();
+    }
+}
+
+void OALayoutLibrary::create_library(const bag::LayoutLibrary & cells,
+        unsigned int num_threads) {
+    // do nothing if no library is opened
+    if (!is_open) {
+        return;
+    }
+
+    oa::oaString name;
+    lib_name.get(ns, name);
+    if (cells.get_lib_name() != static_cast<std::string>(name)) {
+        throw std::invalid_argument("create_library: cells of library " + cells.get_lib_name()
+                + " cannot be written to library " + static_cast<std::string>(name) + ".");
+    }
+
+    std::size_t num_cells = cells.size();
+    std::vector<std::string> cell_names(num_cells);
+    std::vector<std::string> views(num_cells, cells.get_view_name());
+    LayoutPtrList layouts(num_cells);
+    for (std::size_t idx = 0; idx < num_cells; idx++) {
+        cell_names[idx] = cells.get_cell_name(idx);
+        layouts[idx] = &cells[idx];
+    }
+    create_layouts(cell_names, views, layouts, num_threads);
+}
+
+void OALayoutLibrary::prepare_layout(const bag::Layout & layout, PreparedLayout & prep) const {
+    Clock::time_point start = Clock::now();
+    bag::Grid grid(dbu_per_uu, mfg_grid_res);
+    prep.layout = &layout;
+    prep.num_off_grid = 0;
+    resolve_lpp_table(layout.lpp_table, prep);
+
+    std::size_t num_inst = layout.inst_list.size();
+    prep.inst_xy.resize(4 * num_inst);
+    for (std::size_t idx = 0; idx < num_inst; idx++) {
+        const bag::Inst & inst = layout.inst_list[idx];
+        int32_t * xy = &prep.inst_xy[4 * idx];
+        xy[0] = double_to_oa(inst.loc[0]);
+        xy[1] = double_to_oa(inst.loc[1]);
+        xy[2] = double_to_oa(inst.sp_cols);
+        xy[3] = double_to_oa(inst.sp_rows);
+    }
+
+    // snap rectangles and path segments in one batch per column.
+    const bag::RectTable & rects = layout.rect_list;
+    std::size_t num_rects = rects.size();
+    prep.rect_box.resize(4 * num_rects);
+    prep.rect_sp.resize(2 * num_rects);
+    prep.num_off_grid += rects.bbox.to_dbu(0, 4 * num_rects, grid, prep.rect_box.data());
+    prep.num_off_grid += rects.arr_sp.to_dbu(0, 2 * num_rects, grid, prep.rect_sp.data());
+
+    const bag::PathSegTable & segs = layout.path_seg_list;
+    std::size_t num_segs = segs.size();
+    prep.seg_pts.resize(4 * num_segs);
+    prep.seg_width.resize(2 * num_segs);
+    prep.num_off_grid += segs.pts.to_dbu(0, 4 * num_segs, grid, prep.seg_pts.data());
+    for (std::size_t idx = 0; idx < num_segs; idx++) {
+        get_seg_width(&prep.seg_pts[4 * idx], segs.width[idx], &prep.seg_width[2 * idx]);
+    }
+
+    // snap vias one column at a time.  The OA enclosure and offset of a via
+    // layer are the center and half-width of its enclosure box.
+    const bag::ViaTable & vias = layout.via_list;
+    std::size_t num_vias = vias.size();
+    std::vector<int32_t> via_buf(8 * num_vias);
+    int32_t * via_loc = via_buf.data();
+    int32_t * via_sp = via_loc + 2 * num_vias;
+    int32_t * via_cut = via_sp + 2 * num_vias;
+    int32_t * via_arr_sp = via_cut + 2 * num_vias;
+    prep.num_off_grid += vias.loc.to_dbu(0, 2 * num_vias, grid, via_loc);
+    prep.num_off_grid += vias.cut_sp.to_dbu(0, 2 * num_vias, grid, via_sp);
+    prep.num_off_grid += vias.cut_size.to_dbu(0, 2 * num_vias, grid, via_cut);
+    prep.num_off_grid += vias.arr_sp.to_dbu(0, 2 * num_vias, grid, via_arr_sp);
+    prep.via_par.resize(via_par_size * num_vias);
+    for (std::size_t idx = 0; idx < num_vias; idx++) {
+        int32_t * par = &prep.via_par[via_par_size * idx];
+        par[0] = via_loc[2 * idx];
+        par[1] = via_loc[2 * idx + 1];
+        par[2] = via_sp[2 * idx];
+        par[3] = via_sp[2 * idx + 1];
+        prep.num_off_grid += get_via_enc(vias.enc1, idx, grid, &par[4]);
+        prep.num_off_grid += get_via_enc(vias.enc2, idx, grid, &par[8]);
+        par[12] = via_cut[2 * idx];
+        par[13] = via_cut[2 * idx + 1];
+        par[14] = via_arr_sp[2 * idx];
+        par[15] = via_arr_sp[2 * idx + 1];
+    }
+
+    std::size_t num_pins = layout.pin_list.size();
+    prep.pin_box.resize(4 * num_pins);
+    for (std::size_t idx = 0; idx < num_pins; idx++) {
+        prep.num_off_grid += bag::quantize(layout.pin_list[idx].bbox, &prep.pin_box[4 * idx],
+                4, grid);
+    }
+
+    std::size_t num_coord = layout.point_arena.size();
+    prep.points.resize(num_coord);
+    prep.num_off_grid += layout.point_arena.to_dbu(0, num_coord, grid, prep.points.data());
+
+    // only needed to skip unchanged layouts.  The resolved layer numbers are
+    // part of the output, so hash them too.
+    prep.hash.clear();
+    if (skip_unchanged) {
+        uint64_t hash = bag::hash_layout(layout, grid);
+        for (OALppList::const_iterator it = prep.lpp_oa.begin(); it != prep.lpp_oa.end(); it++) {
+            uint64_t lpp_val = it->valid ? (((uint64_t) it->layer << 32) | it->purpose) : ~0ULL;
+            hash = (hash ^ lpp_val) * 1099511628211ULL;
+        }
+        std::ostringstream os;
+        os << std::hex << std::setw(16) << std::setfill('0') << hash;
+        prep.hash = os.str();
+    }
+    prep.prep_time = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void OALayoutLibrary::end_phase(WritePhase phase, std::size_t num, Clock::time_point & mark) {
+    if (collect_stats) {
+        Clock::time_point now = Clock::now();
+        stats.time[phase] += std::chrono::duration<double>(now - mark).count();
+        stats.count[phase] += num;
+        mark = now;
+    }
+}
+
+void OALayoutLibrary::skip(const std::string & reason) {
+    skips[reason]++;
+}
+
+void OALayoutLibrary::report_skips(const std::string & cell, const PreparedLayout & prep) {
+    for (std::size_t idx = 0; idx < lpp_skips.size(); idx++) {
+        if (lpp_skips[idx] > 0) {
+            skips[prep.lpp_errors[idx]] += lpp_skips[idx];
+        }
+    }
+    for (SkipIter it = skips.begin(); it != skips.end(); it++) {
+        std::cout << "create_layout: " << cell << ": skipped " << it->second << " objects, "
+                << it->first << "." << std::endl;
+        if (collect_stats) {
+            stats.skipped[it->first] += it->second;
+        }
+    }
+}
+
+void OALayoutLibrary::write_layout(const std::string & cell, const std::string & view,
+        const PreparedLayout & prep) {
+    const bag::Layout & layout = *prep.layout;
+    Clock::time_point mark;
+    if (collect_stats) {
+        mark = Clock::now();
+        stats.num_layouts++;
+        stats.time[phase_prepare] += prep.prep_time;
+        stats.count[phase_prepare]++;
+    }
+
     try {
-        // open design and top block
         oa::oaScalarName cell_name(ns, cell.c_str());
         oa::oaScalarName view_name(ns, view.c_str());
+        if (!prep.hash.empty()) {
+            bool unchanged = is_unchanged(cell_name, view_name, prep.hash);
+            end_phase(phase_hash_check, 1, mark);
+            if (unchanged) {
+                num_hash_hits++;
+                return;
+            }
+        }
+        num_hash_misses++;
+
+        // open design and top block
         oa::oaDesign * dsn_ptr = oa::oaDesign::open(lib_name, cell_name, view_name,
                 oa::oaViewType::get(oa::oacMaskLayout), 'w');
         oa::oaBlock * blk_ptr = oa::oaBlock::create(dsn_ptr);
-
-        // create geometries
-        for (bag::InstIter it = layout.inst_list.begin(); it != layout.inst_list.end(); it++) {
-            create_inst(blk_ptr, *it);
-        }
-        for (bag::RectIter it = layout.rect_list.begin(); it != layout.rect_list.end(); it++) {
-            create_rect(blk_ptr, *it);
-        }
-        for (bag::PathSegIter it = layout.path_seg_list.begin(); it != layout.path_seg_list.end();
-                it++) {
-            create_path_seg(blk_ptr, *it);
-        }
-        for (bag::ViaIter it = layout.via_list.begin(); it != layout.via_list.end(); it++) {
-            create_via(blk_ptr, *it);
+        count_calls(call_design, 2);
+        end_phase(phase_open, 1, mark);
+        lpp_skips.assign(prep.lpp_oa.size(), 0);
+        skips.clear();
+
+        // create geometries.  Each distinct parameter set is converted once
+        // and shared by all instances that use it.
+        std::vector<oa::oaParamArray> param_arrs(layout.param_table.size());
+        std::vector<bool> param_built(layout.param_table.size(), false);
+        for (std::size_t idx = 0; idx < layout.inst_list.size(); idx++) {
+            const bag::Inst & inst = layout.inst_list[idx];
+            if (!param_built[inst.params]) {
+                make_param_array(layout.param_table[inst.params], param_arrs[inst.params]);
+                param_built[inst.params] = true;
+            }
+            create_inst(blk_ptr, inst, &prep.inst_xy[4 * idx], param_arrs[inst.params]);
         }
-        for (bag::PinIter it = layout.pin_list.begin(); it != layout.pin_list.end(); it++) {
-            create_pin(blk_ptr, *it);
+        end_phase(phase_inst, layout.inst_list.size(), mark);
+        create_rects(blk_ptr, prep);
+        end_phase(phase_rect, layout.rect_list.size(), mark);
+        create_path_segs(blk_ptr, prep);
+        end_phase(phase_path_seg, layout.path_seg_list.size(), mark);
+        create_paths(blk_ptr, prep);
+        end_phase(phase_path, layout.path_list.size(), mark);
+        create_vias(blk_ptr, prep);
+        end_phase(phase_via, layout.via_list.size(), mark);
+        for (std::size_t idx = 0; idx < layout.pin_list.size(); idx++) {
+            const bag::Pin & pin = layout.pin_list[idx];
+            if (!prep.lpp_oa[pin.lpp].valid) {
+                lpp_skips[pin.lpp]++;
+                continue;
+            }
+            create_pin(blk_ptr, prep.lpp_oa[pin.lpp], pin, &prep.pin_box[4 * idx]);
         }
+        end_phase(phase_pin, layout.pin_list.size(), mark);
         for (bag::PolygonIter it = layout.polygon_list.begin(); it != layout.polygon_list.end(); it++) {
-            create_polygon(blk_ptr, *it);
+            create_polygon(blk_ptr, prep, *it);
         }
+        end_phase(phase_polygon, layout.polygon_list.size(), mark);
         for (bag::BlockageIter it = layout.block_list.begin(); it != layout.block_list.end(); it++) {
-            create_blockage(blk_ptr, *it);
+            create_blockage(blk_ptr, prep, *it);
         }
+        end_phase(phase_blockage, layout.block_list.size(), mark);
         for (bag::BoundaryIter it = layout.boundary_list.begin(); it != layout.boundary_list.end(); it++) {
-            create_boundary(blk_ptr, *it);
+            create_boundary(blk_ptr, prep, *it);
+        }
+        end_phase(phase_boundary, layout.boundary_list.size(), mark);
+
+        if (!prep.hash.empty()) {
+            oa::oaStringProp::create(dsn_ptr, layout_hash_prop, prep.hash.c_str());
         }
 
         // save and close
         dsn_ptr->save();
+        count_calls(call_design, 2);
+        end_phase(phase_save, 1, mark);
         dsn_ptr->close();
+        count_calls(call_design);
+        end_phase(phase_close, 1, mark);
+
+        report_skips(cell, prep);
+        if (prep.num_off_grid > 0) {
+            std::cout << "create_layout: " << prep.num_off_grid
+                    << " off-grid coordinates snapped to the manufacturing grid." << std::endl;
+        }
     } catch (oa::oaCompatibilityError &ex) {
         throw std::runtime_error(
                 "OA Compatibility Error: " + static_cast<std::string>(ex.getMsg()));
@@ -204,53 +785,172 @@ void OALayoutLibrary::create_layout(const std::string & cell, const std::string
     }
 }
 
-oa::oaCoord OALayoutLibrary::double_to_oa(double val) {
-    return (oa::oaCoord) round(val * dbu_per_uu / mfg_grid_res) * mfg_grid_res;
+bool OALayoutLibrary::is_unchanged(const oa::oaScalarName & cell_name,
+        const oa::oaScalarName & view_name, const std::string & hash) {
+    count_calls(call_lookup);
+    if (!oa::oaDesign::exists(lib_name, cell_name, view_name)) {
+        return false;
+    }
+    oa::oaDesign * dsn_ptr = oa::oaDesign::open(lib_name, cell_name, view_name, 'r');
+    oa::oaProp * prop_ptr = oa::oaProp::find(dsn_ptr, layout_hash_prop);
+    oa::oaString stored;
+    if (prop_ptr != NULL) {
+        prop_ptr->getValue(stored);
+    }
+    dsn_ptr->close();
+    count_calls(call_design, 3);
+    return prop_ptr != NULL && hash == static_cast<const char *>(stored);
 }
 
-void OALayoutLibrary::array_figure(oa::oaFig * fig_ptr, unsigned int nx, unsigned int ny,
-        double spx, double spy) {
-    if (nx > 1 || ny > 1) {
-        oa::oaCoord spx_oa = double_to_oa(spx);
-        oa::oaCoord spy_oa = double_to_oa(spy);
-        for (unsigned int j = 1; j < ny; j++) {
-            fig_ptr->copy(oa::oaTransform(0, j * spy_oa));
+void OALayoutLibrary::resolve_lpp_table(const bag::LppTable & lpp_table,
+        PreparedLayout & prep) const {
+    prep.lpp_oa.resize(lpp_table.size());
+    prep.lpp_errors.assign(lpp_table.size(), std::string());
+    for (unsigned int idx = 0; idx < lpp_table.size(); idx++) {
+        const bag::LayerPurpose & lpp = lpp_table[idx];
+        OALpp & entry = prep.lpp_oa[idx];
+        entry.valid = false;
+
+        LayerMap::const_iterator lay_iter = lay_map.find(lpp.layer);
+        if (lay_iter == lay_map.end()) {
+            prep.lpp_errors[idx] = "unknown layer " + lpp.layer;
+            continue;
         }
-        for (unsigned int i = 1; i < nx; i++) {
-            oa::oaCoord offx = i * spx_oa;
-            for (unsigned int j = 0; j < ny; j++) {
-                fig_ptr->copy(oa::oaTransform(offx, j * spy_oa));
-            }
+        PurposeMap::const_iterator purp_iter = purp_map.find(lpp.purpose);
+        if (purp_iter == purp_map.end()) {
+            prep.lpp_errors[idx] = "unknown purpose " + lpp.purpose;
+            continue;
         }
+        entry.valid = true;
+        entry.layer = lay_iter->second;
+        entry.purpose = purp_iter->second;
     }
 }
 
-void OALayoutLibrary::create_inst(oa::oaBlock * blk_ptr, const bag::Inst & inst) {
-    oa::oaScalarName lib_name(ns, oa::oaString(inst.lib_name.c_str()));
-    oa::oaScalarName cell_name(ns, oa::oaString(inst.cell_name.c_str()));
-    oa::oaScalarName view_name(ns, oa::oaString(inst.view_name.c_str()));
-    oa::oaScalarName inst_name(ns, oa::oaString(inst.inst_name.c_str()));
+oa::oaCoord OALayoutLibrary::double_to_oa(double val) const {
+    return (oa::oaCoord) round(val * dbu_per_uu / mfg_grid_res) * mfg_grid_res;
+}
+
+void OALayoutLibrary::get_seg_width(const int32_t * seg_ptr, double seg_width,
+        int32_t * out) const {
+    if (seg_ptr[0] != seg_ptr[2] && seg_ptr[1] != seg_ptr[3]) {
+        // both X and Y coordinate differ, must be diagonal
+        // set width in diagonal unit, round to even
+        out[0] = double_to_oa(seg_width * sqrt(2) / 2) * 2;
+        out[1] = double_to_oa(seg_width / 2);
+    } else {
+        out[0] = double_to_oa(seg_width / 2) * 2;
+        out[1] = double_to_oa(seg_width * sqrt(2) / 2);
+    }
+}
+
+oa::oaStdViaDef * OALayoutLibrary::find_via_def(const std::string & via_name) {
+    // cached per library, so the shared technology data is never written.
+    ViaDefIter via_iter = via_def_cache.find(via_name);
+    if (via_iter != via_def_cache.end()) {
+        num_via_def_hits++;
+        return via_iter->second;
+    }
+    num_via_def_misses++;
+    count_calls(call_lookup);
+    oa::oaString oa_via_id = oa::oaString(via_name.c_str());
+    oa::oaStdViaDef * vdef = static_cast<oa::oaStdViaDef *>(oa::oaViaDef::find(tech_ptr,
+            oa_via_id));
+    via_def_cache[via_name] = vdef;
+    return vdef;
+}
 
-    oa::oaTransform xfm((oa::oaOffset) double_to_oa(inst.loc[0]),
-            (oa::oaOffset) double_to_oa(inst.loc[1]), get_orient_name(inst.orient));
+const InstMaster & OALayoutLibrary::find_master(const bag::Inst & inst) {
+    MasterKey key(inst.lib_name, inst.cell_name, inst.view_name);
+    MasterIter master_iter = master_cache.find(key);
+    if (master_iter != master_cache.end()) {
+        InstMaster & master = master_iter->second;
+        if (master.design == NULL || master.design->isValid()) {
+            num_master_hits++;
+            return master;
+        }
+        // the master was closed since, bind by name from now on.
+        master.design = NULL;
+        num_master_misses++;
+        return master;
+    }
 
-    oa::oaOffset dx = (oa::oaOffset) double_to_oa(inst.sp_cols);
-    oa::oaOffset dy = (oa::oaOffset) double_to_oa(inst.sp_rows);
+    num_master_misses++;
+    count_calls(call_lookup);
+    InstMaster & master = master_cache[key];
+    master.lib_name = oa::oaScalarName(ns, oa::oaString(inst.lib_name.c_str()));
+    master.cell_name = oa::oaScalarName(ns, oa::oaString(inst.cell_name.c_str()));
+    master.view_name = oa::oaScalarName(ns, oa::oaString(inst.view_name.c_str()));
+    master.design = oa::oaDesign::find(master.lib_name, master.cell_name, master.view_name);
+    return master;
+}
 
-    // create oa ParamArray
-    oa::oaParamArray oa_params;
-    for (bag::IntIter it = inst.int_params.begin(); it != inst.int_params.end(); it++) {
+void OALayoutLibrary::make_point_array(const PreparedLayout & prep,
+        const bag::PointRange & points, oa::oaPointArray & pt_arr) {
+    const int32_t * xy = &prep.points[points.offset];
+    oa::oaUInt4 num_pts = (oa::oaUInt4) points.num_pts;
+    pt_arr = oa::oaPointArray(num_pts);
+    for (oa::oaUInt4 idx = 0; idx < num_pts; idx++) {
+        pt_arr.append(oa::oaPoint(xy[2 * idx], xy[2 * idx + 1]));
+    }
+}
+
+void make_param_array(const bag::ParamSet & params, oa::oaParamArray & oa_params) {
+    for (bag::IntIter it = params.int_params.begin(); it != params.int_params.end(); it++) {
         oa::oaString key(it->first.c_str());
         oa_params.append(oa::oaParam(key, it->second));
     }
-    for (bag::DoubleIter it = inst.double_params.begin(); it != inst.double_params.end(); it++) {
+    for (bag::DoubleIter it = params.double_params.begin(); it != params.double_params.end();
+            it++) {
         oa::oaString key(it->first.c_str());
         oa_params.append(oa::oaParam(key, it->second));
     }
-    for (bag::StrIter it = inst.str_params.begin(); it != inst.str_params.end(); it++) {
+    for (bag::StrIter it = params.str_params.begin(); it != params.str_params.end(); it++) {
         oa::oaString key(it->first.c_str());
         oa_params.append(oa::oaParam(key, oa::oaString(it->second.c_str())));
     }
+}
+
+void read_param_array(const oa::oaParamArray & oa_params, bag::ParamSet & params) {
+    // other parameter types have no equivalent and are dropped
+    oa::oaString name;
+    oa::oaString val;
+    for (oa::oaUInt4 idx = 0; idx < oa_params.getNumElements(); idx++) {
+        const oa::oaParam & par = oa_params[idx];
+        par.getName(name);
+        std::string key = static_cast<std::string>(name);
+        switch (par.getType()) {
+        case oa::oacIntParamType:
+            params.int_params[key] = par.getIntVal();
+            break;
+        case oa::oacBooleanParamType:
+            params.int_params[key] = par.getBooleanVal() ? 1 : 0;
+            break;
+        case oa::oacFloatParamType:
+            params.double_params[key] = par.getFloatVal();
+            break;
+        case oa::oacDoubleParamType:
+            params.double_params[key] = par.getDoubleVal();
+            break;
+        case oa::oacStringParamType:
+            par.getStringVal(val);
+            params.str_params[key] = static_cast<std::string>(val);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void OALayoutLibrary::create_inst(oa::oaBlock * blk_ptr, const bag::Inst & inst,
+        const int32_t * xy, const oa::oaParamArray & oa_params) {
+    const InstMaster & master = find_master(inst);
+    oa::oaScalarName inst_name(ns, oa::oaString(inst.inst_name.c_str()));
+
+    oa::oaTransform xfm((oa::oaOffset) xy[0], (oa::oaOffset) xy[1], get_orient(inst.orient));
+
+    oa::oaOffset dx = (oa::oaOffset) xy[2];
+    oa::oaOffset dy = (oa::oaOffset) xy[3];
 
     const oa::oaParamArray * params_ptr = &oa_params;
     if (params_ptr->getNumElements() == 0) {
@@ -258,138 +958,204 @@ void OALayoutLibrary::create_inst(oa::oaBlock * blk_ptr, const bag::Inst & inst)
         params_ptr = NULL;
     }
     if (inst.num_rows > 1 || inst.num_cols > 1) {
-        oa::oaArrayInst::create(blk_ptr, lib_name, cell_name, view_name, inst_name, xfm, dx, dy,
-                inst.num_rows, inst.num_cols, params_ptr);
+        if (master.design != NULL) {
+            oa::oaArrayInst::create(blk_ptr, master.design, inst_name, xfm, dx, dy,
+                    inst.num_rows, inst.num_cols, params_ptr);
+        } else {
+            oa::oaArrayInst::create(blk_ptr, master.lib_name, master.cell_name,
+                    master.view_name, inst_name, xfm, dx, dy, inst.num_rows, inst.num_cols,
+                    params_ptr);
+        }
+    } else if (master.design != NULL) {
+        oa::oaScalarInst::create(blk_ptr, master.design, inst_name, xfm, params_ptr);
     } else {
-        oa::oaScalarInst::create(blk_ptr, lib_name, cell_name, view_name, inst_name, xfm,
-                params_ptr);
+        oa::oaScalarInst::create(blk_ptr, master.lib_name, master.cell_name, master.view_name,
+                inst_name, xfm, params_ptr);
     }
+    count_calls(call_inst);
 }
 
-void OALayoutLibrary::create_via(oa::oaBlock * blk_ptr, const bag::Via & inst) {
-    oa::oaString oa_via_id = oa::oaString(inst.via_id.c_str());
-    oa::oaStdViaDef * vdef = static_cast<oa::oaStdViaDef *>(oa::oaViaDef::find(tech_ptr, oa_via_id));
-    if (vdef == NULL) {
-        std::cout << "create_via: unknown via " << inst.via_id << ", skipping." << std::endl;
-        return;
-    }
+void OALayoutLibrary::create_vias(oa::oaBlock * blk_ptr, const PreparedLayout & prep) {
+    const bag::ViaTable & vias = prep.layout->via_list;
+    // via definitions resolved by via id, so each name is looked up once.
+    std::vector<oa::oaStdViaDef *> vdefs(vias.names.size(), NULL);
+    std::vector<bool> vdef_found(vias.names.size(), false);
+    for (std::size_t idx = 0; idx < vias.size(); idx++) {
+        unsigned int via_id = vias.via_id[idx];
+        const std::string & via_name = vias.names[via_id];
+        if (vdef_found[via_id]) {
+            num_via_def_hits++;
+        } else {
+            vdefs[via_id] = find_via_def(via_name);
+            vdef_found[via_id] = true;
+        }
+        oa::oaStdViaDef * vdef = vdefs[via_id];
+        if (vdef == NULL) {
+            skip("unknown via " + via_name);
+            continue;
+        }
 
-    oa::oaTransform xfm((oa::oaOffset) double_to_oa(inst.loc[0]),
-            (oa::oaOffset) double_to_oa(inst.loc[1]), get_orient_name(inst.orient));
-
-    oa::oaViaParam params;
-    params.setCutRows(inst.num_rows);
-    params.setCutColumns(inst.num_cols);
-    params.setCutSpacing(
-            oa::oaVector((oa::oaOffset) double_to_oa(inst.spacing[0]),
-                    (oa::oaOffset) double_to_oa(inst.spacing[1])));
-    params.setLayer1Enc(
-            oa::oaVector((oa::oaOffset) double_to_oa(inst.enc1[0]),
-                    (oa::oaOffset) double_to_oa(inst.enc1[1])));
-    params.setLayer1Offset(
-            oa::oaVector((oa::oaOffset) double_to_oa(inst.off1[0]),
-                    (oa::oaOffset) double_to_oa(inst.off1[1])));
-    params.setLayer2Enc(
-            oa::oaVector((oa::oaOffset) double_to_oa(inst.enc2[0]),
-                    (oa::oaOffset) double_to_oa(inst.enc2[1])));
-    params.setLayer2Offset(
-            oa::oaVector((oa::oaOffset) double_to_oa(inst.off2[0]),
-                    (oa::oaOffset) double_to_oa(inst.off2[1])));
-    if (inst.cut_width > 0) {
-        params.setCutWidth((oa::oaDist) double_to_oa(inst.cut_width));
-    }
-    if (inst.cut_height > 0) {
-        params.setCutHeight((oa::oaDist) double_to_oa(inst.cut_height));
-    }
-
-    oa::oaFig * fig = static_cast<oa::oaFig *>(oa::oaStdVia::create(blk_ptr, vdef, xfm, &params));
-    array_figure(fig, inst.nx, inst.ny, inst.spx, inst.spy);
-}
-
-void OALayoutLibrary::create_rect(oa::oaBlock * blk_ptr, const bag::Rect & inst) {
-    LayerIter lay_iter = lay_map.find(inst.layer);
-    if (lay_iter == lay_map.end()) {
-        std::cout << "create_rect: unknown layer " << inst.layer << ", skipping." << std::endl;
-        return;
-    }
-    oa::oaLayerNum layer = lay_iter->second;
+        const int32_t * par = &prep.via_par[via_par_size * idx];
+        const oa::oaOrient & orient = get_orient(vias.orient[idx]);
+
+        oa::oaViaParam params;
+        params.setCutRows(vias.cut_n[2 * idx]);
+        params.setCutColumns(vias.cut_n[2 * idx + 1]);
+        params.setCutSpacing(oa::oaVector((oa::oaOffset) par[2], (oa::oaOffset) par[3]));
+        params.setLayer1Enc(oa::oaVector((oa::oaOffset) par[4], (oa::oaOffset) par[5]));
+        params.setLayer1Offset(oa::oaVector((oa::oaOffset) par[6], (oa::oaOffset) par[7]));
+        params.setLayer2Enc(oa::oaVector((oa::oaOffset) par[8], (oa::oaOffset) par[9]));
+        params.setLayer2Offset(oa::oaVector((oa::oaOffset) par[10], (oa::oaOffset) par[11]));
+        if (par[12] > 0) {
+            params.setCutWidth((oa::oaDist) par[12]);
+        }
+        if (par[13] > 0) {
+            params.setCutHeight((oa::oaDist) par[13]);
+        }
 
-    PurposeIter purp_iter = purp_map.find(inst.purpose);
-    if (purp_iter == purp_map.end()) {
-        std::cout << "create_rect: unknown purpose " << inst.purpose << ", skipping." << std::endl;
-        return;
+        // OA has no via array, create every copy directly with the shared
+        // parameters instead of cloning the first via.
+        int nx = std::max(vias.arr_n[2 * idx], 1);
+        int ny = std::max(vias.arr_n[2 * idx + 1], 1);
+        for (int i = 0; i < nx; i++) {
+            oa::oaOffset x = (oa::oaOffset) (par[0] + i * par[14]);
+            for (int j = 0; j < ny; j++) {
+                oa::oaOffset y = (oa::oaOffset) (par[1] + j * par[15]);
+                oa::oaStdVia::create(blk_ptr, vdef, oa::oaTransform(x, y, orient), &params);
+            }
+        }
+        count_calls(call_via, nx * ny);
     }
-    oa::oaPurposeNum purpose = purp_iter->second;
-
-    oa::oaBox box(double_to_oa(inst.bbox[0]), double_to_oa(inst.bbox[1]),
-            double_to_oa(inst.bbox[2]), double_to_oa(inst.bbox[3]));
-    oa::oaRect * r = oa::oaRect::create(blk_ptr, layer, purpose, box);
-    array_figure(static_cast<oa::oaFig *>(r), inst.nx, inst.ny, inst.spx, inst.spy);
 }
 
-void OALayoutLibrary::create_path_seg(oa::oaBlock * blk_ptr, const bag::PathSeg & inst) {
-    LayerIter lay_iter = lay_map.find(inst.layer);
-    if (lay_iter == lay_map.end()) {
-        std::cout << "create_path_seg: unknown layer " << inst.layer << ", skipping." << std::endl;
-        return;
+void OALayoutLibrary::create_rects(oa::oaBlock * blk_ptr, const PreparedLayout & prep) {
+    const bag::RectTable & rects = prep.layout->rect_list;
+    for (std::size_t idx = 0; idx < rects.size(); idx++) {
+        const OALpp & lpp = prep.lpp_oa[rects.lpp[idx]];
+        if (!lpp.valid) {
+            lpp_skips[rects.lpp[idx]]++;
+            continue;
+        }
+        // OA has no rectangle array, create every copy from its box
+        // instead of cloning the first rectangle.
+        const int32_t * box_ptr = &prep.rect_box[4 * idx];
+        const int32_t * sp_ptr = &prep.rect_sp[2 * idx];
+        int nx = std::max(rects.arr_n[2 * idx], 1);
+        int ny = std::max(rects.arr_n[2 * idx + 1], 1);
+        for (int i = 0; i < nx; i++) {
+            oa::oaCoord dx = i * sp_ptr[0];
+            for (int j = 0; j < ny; j++) {
+                oa::oaCoord dy = j * sp_ptr[1];
+                oa::oaRect::create(blk_ptr, lpp.layer, lpp.purpose,
+                        oa::oaBox(box_ptr[0] + dx, box_ptr[1] + dy, box_ptr[2] + dx,
+                                box_ptr[3] + dy));
+            }
+        }
+        count_calls(call_shape, nx * ny);
     }
-    oa::oaLayerNum layer = lay_iter->second;
+}
 
-    PurposeIter purp_iter = purp_map.find(inst.purpose);
-    if (purp_iter == purp_map.end()) {
-        std::cout << "create_path_seg: unknown purpose " << inst.purpose << ", skipping."
-                << std::endl;
-        return;
+void OALayoutLibrary::create_path_segs(oa::oaBlock * blk_ptr, const PreparedLayout & prep) {
+    const bag::PathSegTable & segs = prep.layout->path_seg_list;
+    for (std::size_t idx = 0; idx < segs.size(); idx++) {
+        if (!prep.lpp_oa[segs.lpp[idx]].valid) {
+            lpp_skips[segs.lpp[idx]]++;
+            continue;
+        }
+        create_path_seg(blk_ptr, prep.lpp_oa[segs.lpp[idx]], &prep.seg_pts[4 * idx],
+                &prep.seg_width[2 * idx], segs.style[2 * idx], segs.style[2 * idx + 1]);
     }
-    oa::oaPurposeNum purpose = purp_iter->second;
-
-    oa::oaPoint start = oa::oaPoint(double_to_oa(inst.x0), double_to_oa(inst.y0));
-    oa::oaPoint stop = oa::oaPoint(double_to_oa(inst.x1), double_to_oa(inst.y1));
+}
 
-    oa::oaDist width, diagExt;
-    if (start.x() != stop.x() and start.y() != stop.y()) {
-        // both X and Y coordinate differ, must be diagonal
-        // set width in diagonal unit, round to even
-        width = double_to_oa(inst.width * sqrt(2) / 2) * 2;
-        diagExt = double_to_oa(inst.width / 2);
-    } else {
-        width = double_to_oa(inst.width / 2) * 2;
-        diagExt = double_to_oa(inst.width * sqrt(2) / 2);
+void OALayoutLibrary::create_path_seg(oa::oaBlock * blk_ptr, const OALpp & lpp,
+        const int32_t * seg_ptr, const int32_t * width_ptr, unsigned char begin_style,
+        unsigned char end_style) {
+    if (!lpp.valid) {
+        return;
     }
+    oa::oaPoint start = oa::oaPoint(seg_ptr[0], seg_ptr[1]);
+    oa::oaPoint stop = oa::oaPoint(seg_ptr[2], seg_ptr[3]);
+    oa::oaDist width = (oa::oaDist) width_ptr[0];
+    oa::oaDist diagExt = (oa::oaDist) width_ptr[1];
 
     oa::oaSegStyle style(width, oa::oacTruncateEndStyle, oa::oacTruncateEndStyle);
-    if (inst.begin_style == "extend") {
+    if (begin_style == bag::extend_style) {
         style.setBeginStyle(oa::oacExtendEndStyle);
-    } else if (inst.begin_style == "round") {
+    } else if (begin_style == bag::round_style) {
         style.setBeginStyle(oa::oacCustomEndStyle, width / 2, diagExt, diagExt, width / 2);
     }
-    if (inst.end_style == "extend") {
+    if (end_style == bag::extend_style) {
         style.setEndStyle(oa::oacExtendEndStyle);
-    } else if (inst.end_style == "round") {
+    } else if (end_style == bag::round_style) {
         style.setEndStyle(oa::oacCustomEndStyle, width / 2, diagExt, diagExt, width / 2);
     }
 
-    oa::oaPathSeg::create(blk_ptr, layer, purpose, start, stop, style);
+    oa::oaPathSeg::create(blk_ptr, lpp.layer, lpp.purpose, start, stop, style);
+    count_calls(call_shape);
 }
 
-void OALayoutLibrary::create_pin(oa::oaBlock * blk_ptr, const bag::Pin & inst) {
-    // draw pin rectangle
-    LayerIter lay_iter = lay_map.find(inst.layer);
-    if (lay_iter == lay_map.end()) {
-        std::cout << "create_pin: unknown layer " << inst.layer << ", skipping." << std::endl;
-        return;
+void OALayoutLibrary::create_paths(oa::oaBlock * blk_ptr, const PreparedLayout & prep) {
+    const bag::Layout & layout = *prep.layout;
+    std::vector<int32_t> xy;
+    for (bag::PathIter it = layout.path_list.begin(); it != layout.path_list.end(); it++) {
+        const OALpp & lpp = prep.lpp_oa[it->lpp];
+        if (!lpp.valid) {
+            lpp_skips[it->lpp]++;
+            continue;
+        }
+        const int32_t * pts = &prep.points[it->points.offset];
+        xy.assign(pts, pts + 2 * it->points.num_pts);
+        std::size_t num_pts = bag::merge_collinear(xy.data(), it->points.num_pts);
+
+        // a single oaPath covers extend joins with square or flush ends on
+        // Manhattan paths.  Anything else is drawn one segment at a time.
+        bool single = (it->join_style == bag::extend_style && it->begin_style != bag::round_style
+                && it->end_style != bag::round_style);
+        for (std::size_t idx = 0; single && idx + 1 < num_pts; idx++) {
+            single = (xy[2 * idx] == xy[2 * idx + 2] || xy[2 * idx + 1] == xy[2 * idx + 3]);
+        }
+        if (!single) {
+            for (std::size_t idx = 0; idx + 1 < num_pts; idx++) {
+                int32_t width[2];
+                get_seg_width(&xy[2 * idx], it->width, width);
+                create_path_seg(blk_ptr, lpp, &xy[2 * idx], width,
+                        (idx == 0) ? it->begin_style : it->join_style,
+                        (idx + 2 == num_pts) ? it->end_style : it->join_style);
+            }
+            continue;
+        }
+        if (num_pts < 2) {
+            continue;
+        }
+
+        oa::oaPointArray pt_arr((oa::oaUInt4) num_pts);
+        for (std::size_t idx = 0; idx < num_pts; idx++) {
+            pt_arr.append(oa::oaPoint(xy[2 * idx], xy[2 * idx + 1]));
+        }
+        oa::oaDist width = (oa::oaDist) double_to_oa(it->width / 2) * 2;
+        oa::oaDist begin_ext = (it->begin_style == bag::extend_style) ? width / 2 : 0;
+        oa::oaDist end_ext = (it->end_style == bag::extend_style) ? width / 2 : 0;
+        oa::oaPathStyle style(oa::oacVariablePathStyle);
+        if (it->begin_style == it->end_style) {
+            style = (begin_ext > 0) ? oa::oacExtendPathStyle : oa::oacTruncatePathStyle;
+            begin_ext = end_ext = 0;
+        }
+        oa::oaPath::create(blk_ptr, lpp.layer, lpp.purpose, width, pt_arr, style, begin_ext,
+                end_ext);
+        count_calls(call_shape);
     }
-    oa::oaLayerNum layer = lay_iter->second;
+}
 
-    PurposeIter purp_iter = purp_map.find(inst.purpose);
-    if (purp_iter == purp_map.end()) {
-        std::cout << "create_pin: unknown purpose " << inst.purpose << ", skipping." << std::endl;
+void OALayoutLibrary::create_pin(oa::oaBlock * blk_ptr, const OALpp & lpp, const bag::Pin & inst,
+        const int32_t * box_ptr) {
+    // draw pin rectangle
+    if (!lpp.valid) {
         return;
     }
-    oa::oaPurposeNum purpose = purp_iter->second;
+    oa::oaLayerNum layer = lpp.layer;
+    oa::oaPurposeNum purpose = lpp.purpose;
 
-    oa::oaBox box(double_to_oa(inst.bbox[0]), double_to_oa(inst.bbox[1]),
-            double_to_oa(inst.bbox[2]), double_to_oa(inst.bbox[3]));
+    oa::oaBox box(box_ptr[0], box_ptr[1], box_ptr[2], box_ptr[3]);
 
     // get label location and orientation
     oa::oaPoint op;
@@ -405,72 +1171,67 @@ void OALayoutLibrary::create_pin(oa::oaBlock * blk_ptr, const bag::Pin & inst) {
     oa::oaString oa_label = oa::oaString(inst.label.c_str());
     oa::oaText::create(blk_ptr, layer, purpose, oa_label, op, oa::oacCenterCenterTextAlign, lorient,
             oa::oacRomanFont, lheight);
+    count_calls(call_shape);
 
     if (inst.make_pin_obj) {
         // make pin object
         oa::oaRect * r = oa::oaRect::create(blk_ptr, layer, purpose, box);
+        count_calls(call_shape);
 
         // get terminal
         oa::oaName term_name(ns_cdba, oa::oaString(inst.term_name.c_str()));
         oa::oaTerm * term = oa::oaTerm::find(blk_ptr, term_name);
+        count_calls(call_lookup);
         if (term == NULL) {
             // get net
             oa::oaNet * net = oa::oaNet::find(blk_ptr, term_name);
+            count_calls(call_lookup);
             if (net == NULL) {
                 // create net
                 net = oa::oaNet::create(blk_ptr, term_name);
+                count_calls(call_conn);
             }
             // create terminal
             term = oa::oaTerm::create(net, term_name);
+            count_calls(call_conn);
         }
 
         // create pin and add rectangle to pin.
         oa::oaString oa_pin_name = oa::oaString(inst.pin_name.c_str());
         oa::oaPin * pin = oa::oaPin::create(term, oa_pin_name, pin_dir);
         r->addToPin(pin);
+        count_calls(call_conn, 2);
     }
 }
 
-void OALayoutLibrary::create_polygon(oa::oaBlock * blk_ptr, const bag::Polygon & inst) {
-    // make oaPointArray
-    oa::oaPointArray pt_arr;
-    for (unsigned int idx = 0; idx < inst.xcoord.size(); idx++) {
-        oa::oaCoord x_unit = double_to_oa(inst.xcoord[idx]);
-        oa::oaCoord y_unit = double_to_oa(inst.ycoord[idx]);
-        pt_arr.append(oa::oaPoint(x_unit, y_unit));
-    }
-    LayerIter lay_iter = lay_map.find(inst.layer);
-    if (lay_iter == lay_map.end()) {
-        std::cout << "create_polygon: unknown layer " << inst.layer << ", skipping." << std::endl;
+void OALayoutLibrary::create_polygon(oa::oaBlock * blk_ptr, const PreparedLayout & prep,
+        const bag::Polygon & inst) {
+    const OALpp & lpp = prep.lpp_oa[inst.lpp];
+    if (!lpp.valid) {
+        lpp_skips[inst.lpp]++;
         return;
     }
-    oa::oaLayerNum layer = lay_iter->second;
 
-    PurposeIter purp_iter = purp_map.find(inst.purpose);
-    if (purp_iter == purp_map.end()) {
-        std::cout << "create_polygon: unknown purpose " << inst.purpose << ", skipping." << std::endl;
-        return;
-    }
-    oa::oaPurposeNum purpose = purp_iter->second;
+    // make oaPointArray
+    oa::oaPointArray pt_arr;
+    make_point_array(prep, inst.points, pt_arr);
 
-    oa::oaPolygon::create(blk_ptr, layer, purpose, pt_arr);
+    oa::oaPolygon::create(blk_ptr, lpp.layer, lpp.purpose, pt_arr);
+    count_calls(call_shape);
 }
 
-void OALayoutLibrary::create_blockage(oa::oaBlock * blk_ptr, const bag::Blockage & inst) {
+void OALayoutLibrary::create_blockage(oa::oaBlock * blk_ptr, const PreparedLayout & prep,
+        const bag::Blockage & inst) {
     // make oaPointArray
     oa::oaPointArray pt_arr;
-    for (unsigned int idx = 0; idx < inst.xcoord.size(); idx++) {
-        oa::oaCoord x_unit = double_to_oa(inst.xcoord[idx]);
-        oa::oaCoord y_unit = double_to_oa(inst.ycoord[idx]);
-        pt_arr.append(oa::oaPoint(x_unit, y_unit));
-    }
+    make_point_array(prep, inst.points, pt_arr);
     if (inst.type == "placement") {
         // area blockage
         oa::oaAreaBlockage::create(blk_ptr, pt_arr);
     } else {
         LayerIter lay_iter = lay_map.find(inst.layer);
         if (lay_iter == lay_map.end()) {
-            std::cout << "create_blockage: unknown layer " << inst.layer << ", skipping." << std::endl;
+            skip("unknown blockage layer " + inst.layer);
             return;
         }
         oa::oaLayerNum layer = lay_iter->second;
@@ -478,16 +1239,14 @@ void OALayoutLibrary::create_blockage(oa::oaBlock * blk_ptr, const bag::Blockage
 
         oa::oaLayerBlockage::create(blk_ptr, block_type, layer, pt_arr);
     }
+    count_calls(call_blockage);
 }
 
-void OALayoutLibrary::create_boundary(oa::oaBlock * blk_ptr, const bag::Boundary & inst) {
+void OALayoutLibrary::create_boundary(oa::oaBlock * blk_ptr, const PreparedLayout & prep,
+        const bag::Boundary & inst) {
     // make oaPointArray
     oa::oaPointArray pt_arr;
-    for (unsigned int idx = 0; idx < inst.xcoord.size(); idx++) {
-        oa::oaCoord x_unit = double_to_oa(inst.xcoord[idx]);
-        oa::oaCoord y_unit = double_to_oa(inst.ycoord[idx]);
-        pt_arr.append(oa::oaPoint(x_unit, y_unit));
-    }
+    make_point_array(prep, inst.points, pt_arr);
     if (inst.type == "PR") {
         // PR boundary
         oa::oaPRBoundary::create(blk_ptr, pt_arr);
@@ -496,18 +1255,363 @@ void OALayoutLibrary::create_boundary(oa::oaBlock * blk_ptr, const bag::Boundary
     } else if (inst.type == "area") {
         oa::oaAreaBoundary::create(blk_ptr, pt_arr);
     } else {
-        std::cout << "create_boundary: unknown boundary type" << inst.type << ", skipping." << std::endl;
+        skip("unknown boundary type " + inst.type);
+        return;
     }
+    count_calls(call_boundary);
 }
 
-void OASchematicWriter::open_library(const std::string & lib_path, const std::string & library) {
+// streams the objects of one OA block into a layout sink.  Only the current
+// object and small per-read caches are kept in memory.
+class LayoutReader {
+public:
+    LayoutReader(const LayerMap & lay_map, const PurposeMap & purp_map, oa::oaUInt4 dbu_per_uu,
+            bag::LayoutSink & sink) :
+            dbu_per_uu(dbu_per_uu), sink(sink), num_skipped(0) {
+        for (LayerMap::const_iterator it = lay_map.begin(); it != lay_map.end(); it++) {
+            lay_names[it->second] = it->first;
+        }
+        for (PurposeMap::const_iterator it = purp_map.begin(); it != purp_map.end(); it++) {
+            purp_names[it->second] = it->first;
+        }
+    }
+
+    std::size_t read(oa::oaBlock * blk_ptr) {
+        read_insts(blk_ptr);
+        read_shapes(blk_ptr);
+        read_vias(blk_ptr);
+        read_blockages(blk_ptr);
+        read_boundaries(blk_ptr);
+        return num_skipped;
+    }
+
+private:
+    typedef std::pair<oa::oaLayerNum, oa::oaPurposeNum> OALppKey;
+    typedef std::map<OALppKey, int> LppIdMap;
+
+    double to_double(oa::oaCoord val) const {
+        return ((double) val) / dbu_per_uu;
+    }
+
+    // sink id of the shape's layer/purpose, or -1 if the tech does not name it.
+    int find_lpp(const oa::oaShape * shape) {
+        OALppKey key(shape->getLayerNum(), shape->getPurposeNum());
+        LppIdMap::iterator it = lpp_ids.find(key);
+        if (it != lpp_ids.end()) {
+            return it->second;
+        }
+        int id = -1;
+        std::map<oa::oaLayerNum, std::string>::const_iterator lay = lay_names.find(key.first);
+        std::map<oa::oaPurposeNum, std::string>::const_iterator purp = purp_names.find(
+                key.second);
+        if (lay != lay_names.end() && purp != purp_names.end()) {
+            id = (int) sink.get_lpp_id(lay->second, purp->second);
+        }
+        lpp_ids[key] = id;
+        return id;
+    }
+
+    // copy a point array into xy_buf in user units.
+    void get_points(const oa::oaPointArray & pt_arr) {
+        oa::oaUInt4 num_pts = pt_arr.getNumElements();
+        xy_buf.resize(2 * num_pts);
+        for (oa::oaUInt4 idx = 0; idx < num_pts; idx++) {
+            xy_buf[2 * idx] = to_double(pt_arr[idx].x());
+            xy_buf[2 * idx + 1] = to_double(pt_arr[idx].y());
+        }
+    }
+
+    void read_insts(oa::oaBlock * blk_ptr) {
+        oa::oaIter<oa::oaInst> inst_iter(blk_ptr->getInsts());
+        oa::oaInst * inst;
+        oa::oaString lib, cell, view, name;
+        while ((inst = inst_iter.getNext()) != NULL) {
+            inst->getLibName(ns, lib);
+            inst->getCellName(ns, cell);
+            inst->getViewName(ns, view);
+            inst->getName(ns, name);
+            oa::oaTransform xfm;
+            inst->getTransform(xfm);
+
+            oa::oaParamArray oa_params;
+            inst->getParams(oa_params);
+            bag::ParamSet params;
+            read_param_array(oa_params, params);
+
+            int num_rows = 1, num_cols = 1;
+            double sp_rows = 0, sp_cols = 0;
+            if (inst->getType() == oa::oacArrayInstType) {
+                oa::oaArrayInst * arr = static_cast<oa::oaArrayInst *>(inst);
+                num_rows = (int) arr->getNumRows();
+                num_cols = (int) arr->getNumCols();
+                sp_rows = to_double(arr->getDY());
+                sp_cols = to_double(arr->getDX());
+            }
+            sink.add_inst(static_cast<std::string>(lib), static_cast<std::string>(cell),
+                    static_cast<std::string>(view), static_cast<std::string>(name),
+                    to_double(xfm.xOffset()), to_double(xfm.yOffset()),
+                    static_cast<std::string>(get_orient_name(get_orient_code(xfm.orient()))),
+                    sink.get_param_id(params), num_rows, num_cols, sp_rows, sp_cols);
+        }
+    }
+
+    void read_shapes(oa::oaBlock * blk_ptr) {
+        oa::oaIter<oa::oaShape> shape_iter(blk_ptr->getShapes());
+        oa::oaShape * shape;
+        oa::oaBox box;
+        oa::oaPointArray pt_arr;
+        oa::oaString term_name, pin_name;
+        while ((shape = shape_iter.getNext()) != NULL) {
+            oa::oaTypeEnum type = shape->getType();
+            if (type != oa::oacRectType && type != oa::oacPolygonType && type != oa::oacPathType
+                    && type != oa::oacPathSegType) {
+                // text, including pin labels, and other shapes
+                num_skipped++;
+                continue;
+            }
+            int lpp = find_lpp(shape);
+            if (lpp < 0) {
+                num_skipped++;
+                continue;
+            }
+
+            switch (type) {
+            case oa::oacRectType: {
+                static_cast<oa::oaRect *>(shape)->getBBox(box);
+                double xl = to_double(box.left());
+                double yb = to_double(box.bottom());
+                double xr = to_double(box.right());
+                double yt = to_double(box.top());
+                oa::oaPin * pin = shape->getPin();
+                if (pin == NULL) {
+                    sink.add_rect((unsigned int) lpp, xl, yb, xr, yt);
+                } else {
+                    // the written label is the terminal name unless set otherwise
+                    pin->getTerm()->getName(ns_cdba, term_name);
+                    pin->getName(pin_name);
+                    std::string term = static_cast<std::string>(term_name);
+                    sink.add_pin(term, static_cast<std::string>(pin_name), term,
+                            (unsigned int) lpp, xl, yb, xr, yt, true);
+                }
+                break;
+            }
+            case oa::oacPolygonType:
+                static_cast<oa::oaPolygon *>(shape)->getPoints(pt_arr);
+                get_points(pt_arr);
+                sink.add_polygon((unsigned int) lpp, pt_arr.getNumElements(), xy_buf.data());
+                break;
+            case oa::oacPathType: {
+                oa::oaPath * path = static_cast<oa::oaPath *>(shape);
+                path->getPoints(pt_arr);
+                if (pt_arr.getNumElements() < 2) {
+                    num_skipped++;
+                    break;
+                }
+                get_points(pt_arr);
+                std::string begin_style, end_style;
+                switch (path->getStyle()) {
+                case oa::oacExtendPathStyle:
+                    begin_style = end_style = "extend";
+                    break;
+                case oa::oacRoundPathStyle:
+                    begin_style = end_style = "round";
+                    break;
+                case oa::oacVariablePathStyle:
+                    begin_style = (path->getBeginExt() > 0) ? "extend" : "truncate";
+                    end_style = (path->getEndExt() > 0) ? "extend" : "truncate";
+                    break;
+                default:
+                    begin_style = end_style = "truncate";
+                }
+                sink.add_path((unsigned int) lpp, pt_arr.getNumElements(), xy_buf.data(),
+                        to_double(path->getWidth()), begin_style, end_style, "extend");
+                break;
+            }
+            default: {
+                oa::oaPathSeg * seg = static_cast<oa::oaPathSeg *>(shape);
+                oa::oaPoint start, stop;
+                oa::oaSegStyle style;
+                seg->getPoints(start, stop);
+                seg->getStyle(style);
+                sink.add_path_seg((unsigned int) lpp, to_double(start.x()), to_double(start.y()),
+                        to_double(stop.x()), to_double(stop.y()), to_double(style.getWidth()),
+                        get_seg_end_style(style.getBeginStyle()),
+                        get_seg_end_style(style.getEndStyle()));
+            }
+            }
+        }
+    }
+
+    // round ends are written as custom end styles.
+    static std::string get_seg_end_style(const oa::oaEndStyle & style) {
+        switch (style) {
+        case oa::oacExtendEndStyle:
+            return "extend";
+        case oa::oacCustomEndStyle:
+            return "round";
+        default:
+            return "truncate";
+        }
+    }
+
+    void read_vias(oa::oaBlock * blk_ptr) {
+        oa::oaIter<oa::oaVia> via_iter(blk_ptr->getVias());
+        oa::oaVia * via;
+        oa::oaString def_name;
+        oa::oaViaParam params;
+        while ((via = via_iter.getNext()) != NULL) {
+            if (via->getType() != oa::oacStdViaType) {
+                num_skipped++;
+                continue;
+            }
+            oa::oaStdVia * std_via = static_cast<oa::oaStdVia *>(via);
+            std_via->getViaDef()->getName(def_name);
+            std_via->getParams(params);
+            oa::oaTransform xfm;
+            via->getTransform(xfm);
+
+            // enclosures are stored as (enclosure, offset) pairs, see prepare_layout()
+            oa::oaVector enc1 = params.getLayer1Enc();
+            oa::oaVector off1 = params.getLayer1Offset();
+            oa::oaVector enc2 = params.getLayer2Enc();
+            oa::oaVector off2 = params.getLayer2Offset();
+            oa::oaVector cut_sp = params.getCutSpacing();
+            sink.add_via(static_cast<std::string>(def_name), to_double(xfm.xOffset()),
+                    to_double(xfm.yOffset()),
+                    static_cast<std::string>(get_orient_name(get_orient_code(xfm.orient()))),
+                    params.getCutRows(), params.getCutColumns(), to_double(cut_sp.y()),
+                    to_double(cut_sp.x()), to_double(enc1.x() - off1.x()),
+                    to_double(enc1.y() - off1.y()), to_double(enc1.x() + off1.x()),
+                    to_double(enc1.y() + off1.y()), to_double(enc2.x() - off2.x()),
+                    to_double(enc2.y() - off2.y()), to_double(enc2.x() + off2.x()),
+                    to_double(enc2.y() + off2.y()), to_double(params.getCutWidth()),
+                    to_double(params.getCutHeight()));
+        }
+    }
+
+    void read_blockages(oa::oaBlock * blk_ptr) {
+        oa::oaIter<oa::oaBlockage> block_iter(blk_ptr->getBlockages());
+        oa::oaBlockage * block;
+        oa::oaPointArray pt_arr;
+        while ((block = block_iter.getNext()) != NULL) {
+            block->getPoints(pt_arr);
+            get_points(pt_arr);
+            if (block->getType() == oa::oacAreaBlockageType) {
+                sink.add_blockage("placement", "", pt_arr.getNumElements(), xy_buf.data());
+            } else if (block->getType() == oa::oacLayerBlockageType) {
+                oa::oaLayerNum layer = static_cast<oa::oaLayerBlockage *>(block)->getLayerNum();
+                std::map<oa::oaLayerNum, std::string>::const_iterator lay = lay_names.find(layer);
+                if (lay == lay_names.end()) {
+                    num_skipped++;
+                    continue;
+                }
+                sink.add_blockage(static_cast<std::string>(block->getBlockageType().getName()),
+                        lay->second, pt_arr.getNumElements(), xy_buf.data());
+            } else {
+                num_skipped++;
+            }
+        }
+    }
+
+    void read_boundaries(oa::oaBlock * blk_ptr) {
+        oa::oaIter<oa::oaBoundary> bound_iter(blk_ptr->getBoundaries());
+        oa::oaBoundary * bound;
+        oa::oaPointArray pt_arr;
+        while ((bound = bound_iter.getNext()) != NULL) {
+            const char * type;
+            switch (bound->getType()) {
+            case oa::oacPRBoundaryType:
+                type = "PR";
+                break;
+            case oa::oacSnapBoundaryType:
+                type = "snap";
+                break;
+            case oa::oacAreaBoundaryType:
+                type = "area";
+                break;
+            default:
+                num_skipped++;
+                continue;
+            }
+            bound->getPoints(pt_arr);
+            get_points(pt_arr);
+            sink.add_boundary(type, pt_arr.getNumElements(), xy_buf.data());
+        }
+    }
+
+    oa::oaUInt4 dbu_per_uu;
+    bag::LayoutSink & sink;
+    std::size_t num_skipped;
+    std::map<oa::oaLayerNum, std::string> lay_names;
+    std::map<oa::oaPurposeNum, std::string> purp_names;
+    LppIdMap lpp_ids;
+    std::vector<double> xy_buf;
+};
+
+std::size_t OALayoutLibrary::read_layout(const std::string & cell, const std::string & view,
+        bag::LayoutSink & sink) {
+    if (!is_open) {
+        throw std::logic_error("read_layout: no library is opened.");
+    }
+    flush();
+    std::lock_guard<std::mutex> oa_lock(oa_mutex);
+
     try {
-        oaDesignInit
-        ( oacAPIMajorRevNumber, oacAPIMinorRevNumber, oacDataModelRevNumber);
+        oa::oaScalarName cell_name(ns, cell.c_str());
+        oa::oaScalarName view_name(ns, view.c_str());
+        // designs that are already open, for example masters of written
+        // layouts, are read in place and left open.
+        oa::oaDesign * dsn_ptr = oa::oaDesign::find(lib_name, cell_name, view_name);
+        bool opened = (dsn_ptr == NULL);
+        if (opened) {
+            if (!oa::oaDesign::exists(lib_name, cell_name, view_name)) {
+                throw std::invalid_argument("read_layout: cannot find " + cell + " " + view + ".");
+            }
+            dsn_ptr = oa::oaDesign::open(lib_name, cell_name, view_name, 'r');
+        }
+
+        std::size_t num_skipped = 0;
+        oa::oaBlock * blk_ptr = dsn_ptr->getTopBlock();
+        if (blk_ptr != NULL) {
+            LayoutReader reader(lay_map, purp_map, dbu_per_uu, sink);
+            try {
+                num_skipped = reader.read(blk_ptr);
+            } catch (...) {
+                if (opened) {
+                    dsn_ptr->close();
+                }
+                throw;
+            }
+        }
+        if (opened) {
+            dsn_ptr->close();
+        }
+        return num_skipped;
+    } catch (oa::oaCompatibilityError &ex) {
+        throw std::runtime_error(
+                "OA Compatibility Error: " + static_cast<std::string>(ex.getMsg()));
+    } catch (oa::oaDMError &ex) {
+        throw std::runtime_error("OA DM Error: " + static_cast<std::string>(ex.getMsg()));
+    } catch (oa::oaError &ex) {
+        throw std::runtime_error("OA Error: " + static_cast<std::string>(ex.getMsg()));
+    } catch (oa::oaDesignError &ex) {
+        throw std::runtime_error("OA Design Error: " + static_cast<std::string>(ex.getMsg()));
+    } catch (oa::oaTechError &ex) {
+        throw std::runtime_error("OA Tech Error: " + static_cast<std::string>(ex.getMsg()));
+    }
+}
+
+std::size_t OALayoutLibrary::read_layout(const std::string & cell, const std::string & view,
+        bag::Layout & layout) {
+    bag::LayoutBuilder builder(layout);
+    return read_layout(cell, view, builder);
+}
 
+void OASchematicWriter::open_library(const std::string & lib_path, const std::string & library) {
+    std::lock_guard<std::mutex> oa_lock(oa_mutex);
+    try {
         // open library definition
-        oa::oaString lib_def_path(lib_path.c_str());
-        oa::oaLibDefList::openLibs(lib_def_path);
+        open_lib_defs(lib_path);
 
         // open library
         lib_name = oa::oaScalarName(ns, library.c_str());
@@ -533,6 +1637,95 @@ void OASchematicWriter::open_library(const std::string & lib_path, const std::st
     }
 }
 
+// a source schematic and symbol, opened once for all cells copied from them.
+struct SchSource {
+    oa::oaDesign * sch_ptr;
+    oa::oaDesign * sym_ptr;
+    oa::oaStringProp * part_prop;
+    std::size_t last_use;           // index of the last cell copied from this source
+
+    SchSource() :
+            sch_ptr(NULL), sym_ptr(NULL), part_prop(NULL), last_use(0) {
+    }
+};
+
+typedef std::pair<std::string, std::string> SchSourceKey;
+typedef std::map<SchSourceKey, SchSource> SchSourceMap;
+typedef SchSourceMap::iterator SchSourceIter;
+
+// the sources of a create_schematics() call.  Each source is opened on its
+// first copy and closed after its last one, so only sources still needed are
+// kept open.  Sources left open by an error are closed on destruction.
+class SchSourceCache {
+public:
+    SchSourceCache(const std::vector<bag::SchCell> & cell_list, const oa::oaScalarName & sch_view,
+            const oa::oaScalarName & sym_view) :
+            cell_list(cell_list), sch_view(sch_view), sym_view(sym_view) {
+        for (std::size_t idx = 0; idx < cell_list.size(); idx++) {
+            const bag::SchCell & cell = cell_list[idx];
+            sources[SchSourceKey(cell.lib_name, cell.cell_name)].last_use = idx;
+        }
+    }
+
+    ~SchSourceCache() {
+        for (SchSourceIter it = sources.begin(); it != sources.end(); it++) {
+            try {
+                close_source(it->second);
+            } catch (...) {
+            }
+        }
+    }
+
+    // the source of the given cell, opened on first use.
+    SchSource & get(std::size_t idx) {
+        const bag::SchCell & cell = cell_list[idx];
+        SchSource & src = sources[SchSourceKey(cell.lib_name, cell.cell_name)];
+        if (src.sch_ptr == NULL) {
+            oa::oaScalarName sch_lib(ns, cell.lib_name.c_str());
+            oa::oaScalarName cell_name(ns, cell.cell_name.c_str());
+            src.sch_ptr = oa::oaDesign::open(sch_lib, cell_name, sch_view,
+                    oa::oaViewType::get(oa::oacSchematic), 'r');
+            src.sym_ptr = oa::oaDesign::open(sch_lib, cell_name, sym_view,
+                    oa::oaViewType::get(oa::oacSchematicSymbol), 'r');
+            src.part_prop = static_cast<oa::oaStringProp *>(oa::oaProp::find(src.sym_ptr,
+                    oa::oaString("partName")));
+            if (src.part_prop == NULL) {
+                std::cout << "create_schematic : cannot find partName property of "
+                        << cell.cell_name << ", not modifying." << std::endl;
+            }
+        }
+        return src;
+    }
+
+    // close the source of the given cell if no later cell is copied from it.
+    void release(std::size_t idx) {
+        const bag::SchCell & cell = cell_list[idx];
+        SchSourceIter it = sources.find(SchSourceKey(cell.lib_name, cell.cell_name));
+        if (it->second.last_use == idx) {
+            close_source(it->second);
+            sources.erase(it);
+        }
+    }
+
+private:
+    void close_source(SchSource & src) {
+        if (src.sch_ptr != NULL) {
+            oa::oaDesign * sch_ptr = src.sch_ptr;
+            oa::oaDesign * sym_ptr = src.sym_ptr;
+            src.sch_ptr = src.sym_ptr = NULL;
+            sch_ptr->close();
+            if (sym_ptr != NULL) {
+                sym_ptr->close();
+            }
+        }
+    }
+
+    const std::vector<bag::SchCell> & cell_list;
+    oa::oaScalarName sch_view;
+    oa::oaScalarName sym_view;
+    SchSourceMap sources;
+};
+
 void OASchematicWriter::create_schematics(const std::vector<bag::SchCell> & cell_list,
         const std::string & sch_name, const std::string & sym_name) {
     // do nothing if no library is opened
@@ -540,44 +1733,36 @@ void OASchematicWriter::create_schematics(const std::vector<bag::SchCell> & cell
         return;
     }
 
+    std::lock_guard<std::mutex> oa_lock(oa_mutex);
     try {
         oa::oaScalarName sch_view(ns, sch_name.c_str());
         oa::oaScalarName sym_view(ns, sym_name.c_str());
-        oa::oaString part_name_prop("partName");
-        std::vector<bag::SchCell>::const_iterator it;
-        for (std::vector<bag::SchCell>::const_iterator it = cell_list.begin();
-                it != cell_list.end(); it++) {
-            oa::oaScalarName sch_lib(ns, it->lib_name.c_str());
-            oa::oaScalarName cell_name(ns, it->cell_name.c_str());
-            oa::oaScalarName new_cell_name(ns, it->new_cell_name.c_str());
-            oa::oaBoolean rename_module = (it->cell_name != it->new_cell_name);
-
-            // oa::oaString debug_lib;
-            // lib_name.get(debug_lib);
-            // std::cout << "copying " << it->lib_name << ", " << it->cell_name << " to " << debug_lib
-            //      << ", " << it->new_cell_name << " , rename = " << rename_module << std::endl;
+
+        // copies of the same template share one open source
+        SchSourceCache sources(cell_list, sch_view, sym_view);
+        for (std::size_t idx = 0; idx < cell_list.size(); idx++) {
+            const bag::SchCell & cell = cell_list[idx];
+            oa::oaScalarName new_cell_name(ns, cell.new_cell_name.c_str());
+            oa::oaBoolean rename_module = (cell.cell_name != cell.new_cell_name);
+            SchSource & src = sources.get(idx);
 
             // copy schematic
-            oa::oaDesign * dsn_ptr = oa::oaDesign::open(sch_lib, cell_name, sch_view,
-                    oa::oaViewType::get(oa::oacSchematic), 'r');
-            dsn_ptr->saveAs(lib_name, new_cell_name, sch_view, rename_module);
-            dsn_ptr->close();
+            src.sch_ptr->saveAs(lib_name, new_cell_name, sch_view, rename_module);
 
-            // open symbol
-            dsn_ptr = oa::oaDesign::open(sch_lib, cell_name, sym_view,
-                    oa::oaViewType::get(oa::oacSchematicSymbol), 'r');
-            // modify partName property
-            oa::oaStringProp * prop_ptr = static_cast<oa::oaStringProp *>(oa::oaProp::find(dsn_ptr,
-                    part_name_prop));
-            if (prop_ptr != NULL) {
-                prop_ptr->setValue(oa::oaString(it->new_cell_name.c_str()));
-            } else {
-                std::cout << "create_schematic : cannot find partName property, not modifying."
-                        << std::endl;
+            // modify partName property and copy symbol
+            if (src.part_prop != NULL) {
+                src.part_prop->setValue(oa::oaString(cell.new_cell_name.c_str()));
+            }
+            src.sym_ptr->saveAs(lib_name, new_cell_name, sym_view, rename_module);
+            sources.release(idx);
+
+            // the source is shared by other copies, so edits go to the copies
+            if (!cell.pin_map.empty() || !cell.inst_map.empty()) {
+                edit_copy(cell, sch_view, true);
+            }
+            if (!cell.pin_map.empty()) {
+                edit_copy(cell, sym_view, false);
             }
-            // copy symbol
-            dsn_ptr->saveAs(lib_name, new_cell_name, sym_view, rename_module);
-            dsn_ptr->close();
         }
 
     } catch (oa::oaCompatibilityError &ex) {
@@ -594,7 +1779,205 @@ void OASchematicWriter::create_schematics(const std::vector<bag::SchCell> & cell
     }
 }
 
+void OASchematicWriter::edit_copy(const bag::SchCell & cell, const oa::oaScalarName & view_name,
+        bool replace_insts) {
+    oa::oaScalarName new_cell_name(ns, cell.new_cell_name.c_str());
+    oa::oaDesign * dsn_ptr = oa::oaDesign::open(lib_name, new_cell_name, view_name, 'a');
+    oa::oaBlock * blk_ptr = dsn_ptr->getTopBlock();
+    try {
+        rename_pins(blk_ptr, cell);
+        if (replace_insts) {
+            for (std::map<std::string, std::vector<bag::SchInst> >::const_iterator it =
+                    cell.inst_map.begin(); it != cell.inst_map.end(); it++) {
+                replace_inst(blk_ptr, cell, it->first, it->second);
+            }
+        }
+    } catch (...) {
+        dsn_ptr->close();
+        throw;
+    }
+    dsn_ptr->save();
+    dsn_ptr->close();
+}
+
+// the net of the given name, created if it does not exist.
+oa::oaNet * get_net(oa::oaBlock * blk_ptr, const std::string & net_name) {
+    oa::oaName name(ns_cdba, oa::oaString(net_name.c_str()));
+    oa::oaNet * net = oa::oaNet::find(blk_ptr, name);
+    if (net == NULL) {
+        net = oa::oaNet::create(blk_ptr, name);
+    }
+    return net;
+}
+
+// move all terms, instance terms and shapes of a net to another net, then
+// remove it.
+void join_net(oa::oaNet * src, oa::oaNet * dst) {
+    std::vector<oa::oaTerm *> terms;
+    std::vector<oa::oaInstTerm *> inst_terms;
+    std::vector<oa::oaShape *> shapes;
+    oa::oaIter<oa::oaTerm> term_iter(src->getTerms());
+    while (oa::oaTerm * term = term_iter.getNext()) {
+        terms.push_back(term);
+    }
+    oa::oaIter<oa::oaInstTerm> inst_term_iter(src->getInstTerms());
+    while (oa::oaInstTerm * inst_term = inst_term_iter.getNext()) {
+        inst_terms.push_back(inst_term);
+    }
+    oa::oaIter<oa::oaShape> shape_iter(src->getShapes());
+    while (oa::oaShape * shape = shape_iter.getNext()) {
+        shapes.push_back(shape);
+    }
+
+    for (std::size_t idx = 0; idx < terms.size(); idx++) {
+        terms[idx]->moveToNet(dst);
+    }
+    for (std::size_t idx = 0; idx < inst_terms.size(); idx++) {
+        inst_terms[idx]->addToNet(dst);
+    }
+    for (std::size_t idx = 0; idx < shapes.size(); idx++) {
+        shapes[idx]->addToNet(dst);
+    }
+    src->destroy();
+}
+
+void OASchematicWriter::rename_pins(oa::oaBlock * blk_ptr, const bag::SchCell & cell) {
+    for (bag::StrIter it = cell.pin_map.begin(); it != cell.pin_map.end(); it++) {
+        oa::oaName old_name(ns_cdba, oa::oaString(it->first.c_str()));
+        oa::oaName new_name(ns_cdba, oa::oaString(it->second.c_str()));
+        oa::oaTerm * term = oa::oaTerm::find(blk_ptr, old_name);
+        if (term == NULL) {
+            throw std::invalid_argument("create_schematics: cannot find pin " + it->first
+                    + " of cell " + cell.cell_name + ".");
+        }
+        term->setName(new_name);
+        // the net of a pin is named after it.  If the new name is taken by
+        // another net, the two nets are the same net, so join them.
+        oa::oaNet * old_net = term->getNet();
+        oa::oaNet * new_net = oa::oaNet::find(blk_ptr, new_name);
+        if (new_net == NULL) {
+            old_net->setName(new_name);
+        } else if (new_net != old_net) {
+            join_net(old_net, new_net);
+        }
+    }
+}
+
+// an instance name of a schematic, either scalar or a vector such as XINV<3:0>.
+struct SchInstName {
+    oa::oaScalarName base;
+    bool is_vector;
+    oa::oaUInt4 start;
+    oa::oaUInt4 stop;
+
+    SchInstName() :
+            is_vector(false), start(0), stop(0) {
+    }
+};
+
+SchInstName parse_inst_name(const std::string & name) {
+    SchInstName ans;
+    oa::oaName oa_name(ns_cdba, oa::oaString(name.c_str()));
+    switch (oa_name.getType()) {
+    case oa::oacScalarNameType:
+        ans.base = *oa_name.getScalar();
+        break;
+    case oa::oacVectorNameType: {
+        oa::oaVectorName * vec_name = oa_name.getVector();
+        if (vec_name->getStep() != 1) {
+            throw std::invalid_argument("create_schematics: instance name " + name
+                    + " has a step.");
+        }
+        vec_name->getBaseName(ans.base);
+        ans.is_vector = true;
+        ans.start = vec_name->getStart();
+        ans.stop = vec_name->getStop();
+        break;
+    }
+    default:
+        throw std::invalid_argument("create_schematics: instance name " + name
+                + " is not a scalar or vector name.");
+    }
+    return ans;
+}
+
+void OASchematicWriter::replace_inst(oa::oaBlock * blk_ptr, const bag::SchCell & cell,
+        const std::string & inst_name, const std::vector<bag::SchInst> & inst_list) {
+    SchInstName old_name = parse_inst_name(inst_name);
+    oa::oaInst * inst_ptr;
+    if (old_name.is_vector) {
+        inst_ptr = oa::oaVectorInst::find(blk_ptr, old_name.base, old_name.start,
+                old_name.stop);
+    } else {
+        inst_ptr = oa::oaInst::find(blk_ptr, old_name.base);
+    }
+    if (inst_ptr == NULL) {
+        throw std::invalid_argument("create_schematics: cannot find instance " + inst_name
+                + " of cell " + cell.cell_name + ".");
+    }
+
+    // keep the placement and connections of the instance, then remove it so
+    // a replacement may reuse its name.
+    oa::oaTransform xfm;
+    inst_ptr->getTransform(xfm);
+    oa::oaString view_str;
+    inst_ptr->getViewName(ns, view_str);
+    oa::oaScalarName view_name(ns, view_str);
+    std::map<std::string, oa::oaNet *> conns;
+    oa::oaIter<oa::oaInstTerm> term_iter(inst_ptr->getInstTerms());
+    while (oa::oaInstTerm * inst_term = term_iter.getNext()) {
+        oa::oaName term_name;
+        oa::oaString term_str;
+        inst_term->getTermName(term_name);
+        term_name.get(ns_cdba, term_str);
+        conns[static_cast<std::string>(term_str)] = inst_term->getNet();
+    }
+    inst_ptr->destroy();
+
+    // replacements are placed side by side from the origin of the replaced
+    // instance, each as wide as its own master, with each term connected to
+    // the net given by its term map or else to the net of the replaced instance.
+    oa::oaOffset x_off = xfm.xOffset();
+    for (std::size_t idx = 0; idx < inst_list.size(); idx++) {
+        const bag::SchInst & inst = inst_list[idx];
+        oa::oaParamArray params;
+        for (bag::StrIter it = inst.params.begin(); it != inst.params.end(); it++) {
+            params.append(oa::oaParam(oa::oaString(it->first.c_str()),
+                    oa::oaString(it->second.c_str())));
+        }
+        const oa::oaParamArray * params_ptr = (params.getNumElements() > 0) ? &params : NULL;
+        oa::oaScalarName lib_name(ns, oa::oaString(inst.lib_name.c_str()));
+        oa::oaScalarName cell_name(ns, oa::oaString(inst.cell_name.c_str()));
+        oa::oaTransform new_xfm(x_off, xfm.yOffset(), xfm.orient());
+        SchInstName new_name = parse_inst_name(inst.inst_name);
+        oa::oaInst * new_ptr;
+        if (new_name.is_vector) {
+            new_ptr = oa::oaVectorInst::create(blk_ptr, lib_name, cell_name, view_name,
+                    new_name.base, new_name.start, new_name.stop, new_xfm, params_ptr);
+        } else {
+            new_ptr = oa::oaScalarInst::create(blk_ptr, lib_name, cell_name, view_name,
+                    new_name.base, new_xfm, params_ptr);
+        }
+        oa::oaBox box;
+        new_ptr->getBBox(box);
+        x_off += (oa::oaOffset) box.getWidth();
+
+        std::map<std::string, oa::oaNet *> inst_conns(conns);
+        for (bag::StrIter it = inst.term_map.begin(); it != inst.term_map.end(); it++) {
+            inst_conns[it->first] = get_net(blk_ptr, it->second);
+        }
+        for (std::map<std::string, oa::oaNet *>::const_iterator it = inst_conns.begin();
+                it != inst_conns.end(); it++) {
+            if (it->second != NULL) {
+                oa::oaInstTerm::create(it->second, new_ptr,
+                        oa::oaName(ns_cdba, oa::oaString(it->first.c_str())));
+            }
+        }
+    }
+}
+
 void OASchematicWriter::close() {
+    std::lock_guard<std::mutex> oa_lock(oa_mutex);
     if (is_open) {
         lib_ptr->close();
 
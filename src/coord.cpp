@@ -0,0 +1,230 @@
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <bag.hpp>
+
+namespace bag {
+
+// tolerance (in grid steps) below which a coordinate is considered on-grid.
+const double grid_tol = 1e-6;
+
+// number of coordinates converted per block when changing grids.
+const std::size_t regrid_block = 256;
+
+void throw_out_of_grid(const double * src, std::size_t n, const Grid & grid) {
+    // the first input in src that quantize() rejects
+    const double lim = (double) (INT32_MAX / grid.mfg_grid_res);
+    const double scale = ((double) grid.dbu_per_uu) / grid.mfg_grid_res;
+    for (std::size_t idx = 0; idx < n; idx++) {
+        if (!(fabs(src[idx] * scale) <= lim)) {
+            std::ostringstream os;
+            os << "Coordinate " << src[idx] << " is out of range of a " << grid.dbu_per_uu
+                    << " database unit grid.";
+            throw std::invalid_argument(os.str());
+        }
+    }
+}
+
+std::size_t quantize(const double * src, int32_t * dst, std::size_t n, const Grid & grid) {
+    // round half away from zero to match round() in the scalar writer, i.e.
+    // truncate (q + copysign(0.5, q)).  The SIMD and scalar paths use the
+    // same arithmetic so the result does not depend on alignment.  Inputs
+    // more than lim grid steps from zero, or NaN, do not fit and are rejected.
+    const double scale = ((double) grid.dbu_per_uu) / grid.mfg_grid_res;
+    const double res = (double) grid.mfg_grid_res;
+    const double lim = (double) (INT32_MAX / grid.mfg_grid_res);
+    std::size_t num_off = 0;
+    std::size_t idx = 0;
+
+#if defined(__AVX__)
+    const __m256d scale_v = _mm256_set1_pd(scale);
+    const __m256d res_v = _mm256_set1_pd(res);
+    const __m256d half_v = _mm256_set1_pd(0.5);
+    const __m256d tol_v = _mm256_set1_pd(grid_tol);
+    const __m256d sign_v = _mm256_set1_pd(-0.0);
+    const __m256d lim_v = _mm256_set1_pd(lim);
+    for (; idx + 4 <= n; idx += 4) {
+        __m256d q = _mm256_mul_pd(_mm256_loadu_pd(src + idx), scale_v);
+        if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(sign_v, q), lim_v, _CMP_NLE_UQ))) {
+            throw_out_of_grid(src + idx, 4, grid);
+        }
+        __m256d h = _mm256_or_pd(half_v, _mm256_and_pd(q, sign_v));
+        __m128i r = _mm256_cvttpd_epi32(_mm256_add_pd(q, h));
+        __m256d rd = _mm256_cvtepi32_pd(r);
+        __m256d err = _mm256_andnot_pd(sign_v, _mm256_sub_pd(q, rd));
+        num_off += __builtin_popcount(_mm256_movemask_pd(_mm256_cmp_pd(err, tol_v, _CMP_GT_OQ)));
+        _mm_storeu_si128((__m128i *) (dst + idx), _mm256_cvttpd_epi32(_mm256_mul_pd(rd, res_v)));
+    }
+#elif defined(__SSE2__)
+    const __m128d scale_v = _mm_set1_pd(scale);
+    const __m128d res_v = _mm_set1_pd(res);
+    const __m128d half_v = _mm_set1_pd(0.5);
+    const __m128d tol_v = _mm_set1_pd(grid_tol);
+    const __m128d sign_v = _mm_set1_pd(-0.0);
+    const __m128d lim_v = _mm_set1_pd(lim);
+    for (; idx + 2 <= n; idx += 2) {
+        __m128d q = _mm_mul_pd(_mm_loadu_pd(src + idx), scale_v);
+        if (_mm_movemask_pd(_mm_cmpnle_pd(_mm_andnot_pd(sign_v, q), lim_v))) {
+            throw_out_of_grid(src + idx, 2, grid);
+        }
+        __m128d h = _mm_or_pd(half_v, _mm_and_pd(q, sign_v));
+        __m128i r = _mm_cvttpd_epi32(_mm_add_pd(q, h));
+        __m128d rd = _mm_cvtepi32_pd(r);
+        __m128d err = _mm_andnot_pd(sign_v, _mm_sub_pd(q, rd));
+        num_off += __builtin_popcount(_mm_movemask_pd(_mm_cmpgt_pd(err, tol_v)));
+        _mm_storel_epi64((__m128i *) (dst + idx), _mm_cvttpd_epi32(_mm_mul_pd(rd, res_v)));
+    }
+#endif
+
+    for (; idx < n; idx++) {
+        double q = src[idx] * scale;
+        if (!(fabs(q) <= lim)) {
+            throw_out_of_grid(src + idx, 1, grid);
+        }
+        int32_t r = (int32_t) (q + copysign(0.5, q));
+        if (fabs(q - r) > grid_tol) {
+            num_off++;
+        }
+        dst[idx] = (int32_t) (r * res);
+    }
+
+    return num_off;
+}
+
+std::size_t merge_collinear(int32_t * xy, std::size_t num_pts) {
+    std::size_t n = 0;
+    for (std::size_t idx = 0; idx < num_pts; idx++) {
+        int64_t x = xy[2 * idx];
+        int64_t y = xy[2 * idx + 1];
+        if (n > 0 && x == xy[2 * n - 2] && y == xy[2 * n - 1]) {
+            continue;
+        }
+        if (n > 1) {
+            // drop the last kept point if it lies inside the run to (x, y)
+            int64_t dx0 = xy[2 * n - 2] - (int64_t) xy[2 * n - 4];
+            int64_t dy0 = xy[2 * n - 1] - (int64_t) xy[2 * n - 3];
+            int64_t dx1 = x - xy[2 * n - 2];
+            int64_t dy1 = y - xy[2 * n - 1];
+            if (dx0 * dy1 == dy0 * dx1 && dx0 * dx1 + dy0 * dy1 > 0) {
+                n--;
+            }
+        }
+        xy[2 * n] = (int32_t) x;
+        xy[2 * n + 1] = (int32_t) y;
+        n++;
+    }
+    return n;
+}
+
+void CoordArray::set_grid(const Grid & new_grid) {
+    if (size() > 0) {
+        throw std::logic_error("Cannot change the grid of a non-empty coordinate array.");
+    }
+    grid = new_grid;
+}
+
+void CoordArray::reserve(std::size_t n) {
+    if (is_dbu()) {
+        ivals.reserve(n);
+    } else {
+        fvals.reserve(n);
+    }
+}
+
+void CoordArray::clear() {
+    fvals.clear();
+    ivals.clear();
+}
+
+void CoordArray::truncate(std::size_t n) {
+    if (n < size()) {
+        fvals.resize(is_dbu() ? 0 : n);
+        ivals.resize(is_dbu() ? n : 0);
+    }
+}
+
+std::size_t CoordArray::append(const double * vals, std::size_t n) {
+    if (n == 0) {
+        return 0;
+    }
+    if (!is_dbu()) {
+        fvals.insert(fvals.end(), vals, vals + n);
+        return 0;
+    }
+
+    std::size_t start = ivals.size();
+    ivals.resize(start + n);
+    try {
+        return quantize(vals, &ivals[start], n, grid);
+    } catch (...) {
+        ivals.resize(start);
+        throw;
+    }
+}
+
+void CoordArray::append_dbu(const int32_t * vals, std::size_t n) {
+    if (!is_dbu()) {
+        throw std::logic_error("Cannot append database units to a coordinate array without grid.");
+    }
+    ivals.insert(ivals.end(), vals, vals + n);
+}
+
+void CoordArray::append(const CoordArray & other) {
+    if (grid != other.grid) {
+        throw std::invalid_argument("Cannot append coordinates on a different grid.");
+    }
+    fvals.insert(fvals.end(), other.fvals.begin(), other.fvals.end());
+    ivals.insert(ivals.end(), other.ivals.begin(), other.ivals.end());
+}
+
+std::size_t CoordArray::to_dbu(std::size_t start, std::size_t n, const Grid & target,
+        int32_t * out) const {
+    if (n == 0) {
+        return 0;
+    }
+    if (!is_dbu()) {
+        return quantize(&fvals[start], out, n, target);
+    }
+    if (grid == target) {
+        memcpy(out, &ivals[start], n * sizeof(int32_t));
+        return 0;
+    }
+
+    // different grid, go through user units one block at a time.
+    double buf[regrid_block];
+    std::size_t num_off = 0;
+    for (std::size_t offset = 0; offset < n; offset += regrid_block) {
+        std::size_t cnt = std::min(regrid_block, n - offset);
+        for (std::size_t idx = 0; idx < cnt; idx++) {
+            buf[idx] = ((double) ivals[start + offset + idx]) / grid.dbu_per_uu;
+        }
+        num_off += quantize(buf, out + offset, cnt, target);
+    }
+    return num_off;
+}
+
+std::size_t CoordArray::shift_xy(double dx, double dy) {
+    if (!is_dbu()) {
+        for (std::size_t idx = 0; idx + 1 < fvals.size(); idx += 2) {
+            fvals[idx] += dx;
+            fvals[idx + 1] += dy;
+        }
+        return 0;
+    }
+
+    double offset[2] = { dx, dy };
+    int32_t ioffset[2];
+    std::size_t num_off = quantize(offset, ioffset, 2, grid);
+    for (std::size_t idx = 0; idx + 1 < ivals.size(); idx += 2) {
+        ivals[idx] += ioffset[0];
+        ivals[idx + 1] += ioffset[1];
+    }
+    return num_off;
+}
+
+}
@@ -0,0 +1,713 @@
+#include <gds.hpp>
+
+namespace bag {
+
+// GDSII record types, including the data type in the low byte.
+const uint16_t gds_header = 0x0002;
+const uint16_t gds_bgnlib = 0x0102;
+const uint16_t gds_libname = 0x0206;
+const uint16_t gds_units = 0x0305;
+const uint16_t gds_endlib = 0x0400;
+const uint16_t gds_bgnstr = 0x0502;
+const uint16_t gds_strname = 0x0606;
+const uint16_t gds_endstr = 0x0700;
+const uint16_t gds_boundary = 0x0800;
+const uint16_t gds_path = 0x0900;
+const uint16_t gds_sref = 0x0A00;
+const uint16_t gds_aref = 0x0B00;
+const uint16_t gds_text = 0x0C00;
+const uint16_t gds_layer = 0x0D02;
+const uint16_t gds_datatype = 0x0E02;
+const uint16_t gds_width = 0x0F03;
+const uint16_t gds_xy = 0x1003;
+const uint16_t gds_endel = 0x1100;
+const uint16_t gds_sname = 0x1206;
+const uint16_t gds_colrow = 0x1302;
+const uint16_t gds_texttype = 0x1602;
+const uint16_t gds_presentation = 0x1701;
+const uint16_t gds_string = 0x1906;
+const uint16_t gds_strans = 0x1A01;
+const uint16_t gds_angle = 0x1C05;
+const uint16_t gds_pathtype = 0x2102;
+const uint16_t gds_bgnextn = 0x3003;
+const uint16_t gds_endextn = 0x3103;
+
+// the largest number of points that fit in one XY record.
+const std::size_t gds_max_points = 8191;
+
+// the largest row/column count of an AREF.
+const int gds_max_colrow = 32767;
+
+// buffered bytes before writing to the file.
+const std::size_t gds_buf_size = 1 << 20;
+
+void orient_point(unsigned char orient, int32_t x, int32_t y, int32_t & xo, int32_t & yo) {
+    switch (orient) {
+    case 1: // MX
+        xo = x;
+        yo = -y;
+        break;
+    case 2: // MY
+        xo = -x;
+        yo = y;
+        break;
+    case 3: // R180
+        xo = -x;
+        yo = -y;
+        break;
+    case 4: // R90
+        xo = -y;
+        yo = x;
+        break;
+    case 5: // MXR90
+        xo = y;
+        yo = x;
+        break;
+    case 6: // MYR90
+        xo = -y;
+        yo = -x;
+        break;
+    case 7: // R270
+        xo = y;
+        yo = -x;
+        break;
+    default:
+        xo = x;
+        yo = y;
+    }
+}
+
+void orient_box(unsigned char orient, const int32_t box[4], int32_t out[4]) {
+    int32_t ax, ay, bx, by;
+    orient_point(orient, box[0], box[1], ax, ay);
+    orient_point(orient, box[2], box[3], bx, by);
+    out[0] = std::min(ax, bx);
+    out[1] = std::min(ay, by);
+    out[2] = std::max(ax, bx);
+    out[3] = std::max(ay, by);
+}
+
+void get_orient_strans(unsigned char orient, bool & reflect, int & angle) {
+    // reflect about the x axis first, then rotate counterclockwise.
+    static const bool reflect_table[8] = { false, true, true, false, false, true, true, false };
+    static const int angle_table[8] = { 0, 0, 180, 180, 90, 90, 270, 270 };
+    if (orient >= 8) {
+        orient = 0;
+    }
+    reflect = reflect_table[orient];
+    angle = angle_table[orient];
+}
+
+void get_via_shapes(const ViaTable & vias, std::size_t idx, const Grid & grid,
+        const GdsViaDef & vdef, GdsViaShapes & shapes) {
+    int32_t vals[12];
+    double cut_w = vias.cut_size[2 * idx];
+    double cut_h = vias.cut_size[2 * idx + 1];
+    double in_vals[12] = { cut_w > 0 ? cut_w : vdef.cut_width,
+            cut_h > 0 ? cut_h : vdef.cut_height, vias.cut_sp[2 * idx], vias.cut_sp[2 * idx + 1],
+            vias.enc1[4 * idx], vias.enc1[4 * idx + 1], vias.enc1[4 * idx + 2],
+            vias.enc1[4 * idx + 3], vias.enc2[4 * idx], vias.enc2[4 * idx + 1],
+            vias.enc2[4 * idx + 2], vias.enc2[4 * idx + 3] };
+    quantize(in_vals, vals, 12, grid);
+
+    // the cut array is centered at the origin.
+    int32_t cw = vals[0];
+    int32_t ch = vals[1];
+    shapes.cut_ny = vias.cut_n[2 * idx];
+    shapes.cut_nx = vias.cut_n[2 * idx + 1];
+    shapes.cut_px = cw + vals[2];
+    shapes.cut_py = ch + vals[3];
+    int32_t arr_w = shapes.cut_nx * cw + (shapes.cut_nx - 1) * vals[2];
+    int32_t arr_h = shapes.cut_ny * ch + (shapes.cut_ny - 1) * vals[3];
+    int32_t xl = -arr_w / 2;
+    int32_t yb = -arr_h / 2;
+
+    shapes.cut[0] = xl;
+    shapes.cut[1] = yb;
+    shapes.cut[2] = xl + cw;
+    shapes.cut[3] = yb + ch;
+    int32_t * encs[2] = { shapes.bot, shapes.top };
+    for (unsigned int k = 0; k < 2; k++) {
+        const int32_t * enc = vals + 4 + 4 * k;
+        encs[k][0] = xl - enc[0];
+        encs[k][1] = yb - enc[1];
+        encs[k][2] = xl + arr_w + enc[2];
+        encs[k][3] = yb + arr_h + enc[3];
+    }
+}
+
+GdsWriter::~GdsWriter() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void GdsWriter::open(const std::string & fname, const std::string & lib_name,
+        unsigned int dbu_per_uu, unsigned int mfg_grid_res) {
+    close();
+    if (dbu_per_uu == 0 || mfg_grid_res == 0) {
+        throw std::invalid_argument("GDS database unit and grid resolution must be positive.");
+    }
+
+    out.open(fname.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot open GDS file: " + fname);
+    }
+    buf.clear();
+    buf.reserve(gds_buf_size + 1024);
+    grid = Grid(dbu_per_uu, mfg_grid_res);
+    num_off_grid = 0;
+    helper_cells.clear();
+    is_open = true;
+
+    write_int16_record(gds_header, 600);
+    write_timestamp(gds_bgnlib);
+    write_string_record(gds_libname, lib_name);
+    // user units per database unit, then meters per database unit (user unit is 1 um).
+    begin_record(gds_units, 16);
+    put_real8(1.0 / dbu_per_uu);
+    put_real8(1e-6 / dbu_per_uu);
+}
+
+void GdsWriter::add_layer(const std::string & lay_name, unsigned int lay_num) {
+    lay_map[lay_name] = (int) lay_num;
+}
+
+void GdsWriter::add_purpose(const std::string & purp_name, unsigned int purp_num) {
+    purp_map[purp_name] = (int) purp_num;
+}
+
+void GdsWriter::add_via_def(const std::string & via_name, const std::string & bot_layer,
+        const std::string & cut_layer, const std::string & top_layer,
+        const std::string & purpose, double cut_width, double cut_height) {
+    GdsViaDef & vdef = via_defs[via_name];
+    vdef.bot_layer = bot_layer;
+    vdef.cut_layer = cut_layer;
+    vdef.top_layer = top_layer;
+    vdef.purpose = purpose;
+    vdef.cut_width = cut_width;
+    vdef.cut_height = cut_height;
+}
+
+void GdsWriter::close() {
+    if (is_open) {
+        begin_record(gds_endlib, 0);
+        flush();
+        out.close();
+        is_open = false;
+    }
+}
+
+void GdsWriter::create_layout(const std::string & cell, const std::string & view,
+        const Layout & layout) {
+    // do nothing if no file is opened
+    if (!is_open) {
+        return;
+    }
+
+    // resolve all layer/purpose pairs once
+    lpp_gds.resize(layout.lpp_table.size());
+    for (unsigned int idx = 0; idx < layout.lpp_table.size(); idx++) {
+        const LayerPurpose & lpp = layout.lpp_table[idx];
+        if (!resolve_lpp(lpp.layer, lpp.purpose, lpp_gds[idx])) {
+            std::cout << "create_layout: unknown layer/purpose (" << lpp.layer << ", "
+                    << lpp.purpose << "), skipping." << std::endl;
+        }
+    }
+
+    // snap the point arena in one batch
+    std::size_t start_off_grid = num_off_grid;
+    std::size_t num_coord = layout.point_arena.size();
+    pt_buf.resize(num_coord);
+    num_off_grid += layout.point_arena.to_dbu(0, num_coord, grid, pt_buf.data());
+
+    write_struct_begin(cell);
+    for (InstIter it = layout.inst_list.begin(); it != layout.inst_list.end(); it++) {
+        write_inst(*it);
+    }
+    write_rects(cell, layout);
+    write_path_segs(layout);
+    write_paths(layout);
+    write_vias(cell, layout);
+    write_pins(layout);
+    for (PolygonIter it = layout.polygon_list.begin(); it != layout.polygon_list.end(); it++) {
+        write_polygon(lpp_gds[it->lpp], it->points);
+    }
+    for (BlockageIter it = layout.block_list.begin(); it != layout.block_list.end(); it++) {
+        // layer blockages go on the blockage purpose, placement blockages are not streamed.
+        GdsLpp lpp;
+        if (it->type != "placement" && resolve_lpp(it->layer, "blockage", lpp)) {
+            write_polygon(lpp, it->points);
+        }
+    }
+    for (BoundaryIter it = layout.boundary_list.begin(); it != layout.boundary_list.end(); it++) {
+        GdsLpp lpp;
+        if (it->type == "PR" && resolve_lpp("prBoundary", "boundary", lpp)) {
+            write_polygon(lpp, it->points);
+        }
+    }
+    write_struct_end();
+
+    // structures referenced by vias, then by rectangle and cut arrays
+    for (GdsViaCellList::const_iterator it = pending_vias.begin(); it != pending_vias.end();
+            it++) {
+        write_via_cell(cell, *it);
+    }
+    pending_vias.clear();
+    via_cells.clear();
+    for (GdsRectCellList::const_iterator it = pending_helpers.begin();
+            it != pending_helpers.end(); it++) {
+        write_struct_begin(it->name);
+        write_box(it->lpp, 0, 0, it->width, it->height);
+        write_struct_end();
+    }
+    pending_helpers.clear();
+
+    std::size_t cell_off_grid = num_off_grid - start_off_grid;
+    if (cell_off_grid > 0) {
+        std::cout << "create_layout: " << cell_off_grid
+                << " off-grid coordinates snapped to the manufacturing grid." << std::endl;
+    }
+}
+
+int32_t GdsWriter::to_dbu(double val) const {
+    int32_t ans;
+    quantize(&val, &ans, 1, grid);
+    return ans;
+}
+
+bool GdsWriter::resolve_lpp(const std::string & layer, const std::string & purpose,
+        GdsLpp & lpp) {
+    lpp.valid = false;
+    GdsNumIter lay_iter = lay_map.find(layer);
+    GdsNumIter purp_iter = purp_map.find(purpose);
+    if (lay_iter == lay_map.end() || purp_iter == purp_map.end()) {
+        return false;
+    }
+    lpp.valid = true;
+    lpp.layer = lay_iter->second;
+    lpp.datatype = purp_iter->second;
+    return true;
+}
+
+void GdsWriter::write_rects(const std::string & cell, const Layout & layout) {
+    // snap all boxes and array spacings in one batch each.
+    const RectTable & rects = layout.rect_list;
+    std::size_t num_rects = rects.size();
+    box_buf.resize(4 * num_rects);
+    sp_buf.resize(2 * num_rects);
+    num_off_grid += rects.bbox.to_dbu(0, 4 * num_rects, grid, box_buf.data());
+    num_off_grid += rects.arr_sp.to_dbu(0, 2 * num_rects, grid, sp_buf.data());
+
+    for (std::size_t idx = 0; idx < num_rects; idx++) {
+        const GdsLpp & lpp = lpp_gds[rects.lpp[idx]];
+        if (!lpp.valid) {
+            continue;
+        }
+        const int32_t * box = &box_buf[4 * idx];
+        int nx = rects.arr_n[2 * idx];
+        int ny = rects.arr_n[2 * idx + 1];
+        if (nx <= 1 && ny <= 1) {
+            write_box(lpp, box[0], box[1], box[2], box[3]);
+            continue;
+        }
+
+        // arrays reference a generated structure with the rectangle at the origin.
+        std::string name = get_rect_cell(cell, lpp, box[2] - box[0], box[3] - box[1]);
+        write_ref(name, 0, box[0], box[1], std::max(nx, 1), std::max(ny, 1), sp_buf[2 * idx],
+                sp_buf[2 * idx + 1]);
+    }
+}
+
+std::string GdsWriter::get_rect_cell(const std::string & cell, const GdsLpp & lpp,
+        int32_t width, int32_t height) {
+    std::ostringstream os;
+    os << cell << "$rect_" << lpp.layer << "_" << lpp.datatype << "_" << width << "x" << height;
+    std::string name = os.str();
+    if (helper_cells.insert(name).second) {
+        GdsRectCell helper;
+        helper.name = name;
+        helper.lpp = lpp;
+        helper.width = width;
+        helper.height = height;
+        pending_helpers.push_back(helper);
+    }
+    return name;
+}
+
+void GdsWriter::write_path_segs(const Layout & layout) {
+    const PathSegTable & segs = layout.path_seg_list;
+    std::size_t num_segs = segs.size();
+    box_buf.resize(4 * num_segs);
+    num_off_grid += segs.pts.to_dbu(0, 4 * num_segs, grid, box_buf.data());
+
+    for (std::size_t idx = 0; idx < num_segs; idx++) {
+        const GdsLpp & lpp = lpp_gds[segs.lpp[idx]];
+        if (!lpp.valid) {
+            continue;
+        }
+        // round width to even so the path edges stay on grid.
+        int32_t width = to_dbu(segs.width[idx] / 2) * 2;
+        write_path(lpp, width, segs.style[2 * idx], segs.style[2 * idx + 1], &box_buf[4 * idx], 2);
+    }
+}
+
+void GdsWriter::write_paths(const Layout & layout) {
+    for (PathIter it = layout.path_list.begin(); it != layout.path_list.end(); it++) {
+        const GdsLpp & lpp = lpp_gds[it->lpp];
+        if (!lpp.valid) {
+            continue;
+        }
+        const int32_t * xy = &pt_buf[it->points.offset];
+        box_buf.assign(xy, xy + 2 * it->points.num_pts);
+        std::size_t num_pts = merge_collinear(box_buf.data(), it->points.num_pts);
+        int32_t width = to_dbu(it->width / 2) * 2;
+        if (it->join_style != extend_style) {
+            // other joins need separate segments.
+            for (std::size_t idx = 0; idx + 1 < num_pts; idx++) {
+                write_path(lpp, width, (idx == 0) ? it->begin_style : it->join_style,
+                        (idx + 2 == num_pts) ? it->end_style : it->join_style,
+                        &box_buf[2 * idx], 2);
+            }
+            continue;
+        }
+        // split paths longer than one XY record, the pieces overlap by an
+        // extended end.
+        for (std::size_t start = 0; start + 1 < num_pts; start += gds_max_points - 1) {
+            std::size_t cnt = std::min(gds_max_points, num_pts - start);
+            write_path(lpp, width, (start == 0) ? it->begin_style : extend_style,
+                    (start + cnt == num_pts) ? it->end_style : extend_style, &box_buf[2 * start],
+                    cnt);
+        }
+    }
+}
+
+void GdsWriter::write_vias(const std::string & cell, const Layout & layout) {
+    const ViaTable & vias = layout.via_list;
+    for (std::size_t idx = 0; idx < vias.size(); idx++) {
+        const std::string & via_name = vias.names[vias.via_id[idx]];
+        GdsViaDefIter vdef_iter = via_defs.find(via_name);
+        if (vdef_iter == via_defs.end()) {
+            std::cout << "create_via: unknown via " << via_name << ", skipping." << std::endl;
+            continue;
+        }
+        const GdsViaDef & vdef = vdef_iter->second;
+        GdsViaCell via_cell;
+        resolve_lpp(vdef.bot_layer, vdef.purpose, via_cell.lpp[0]);
+        resolve_lpp(vdef.cut_layer, vdef.purpose, via_cell.lpp[1]);
+        resolve_lpp(vdef.top_layer, vdef.purpose, via_cell.lpp[2]);
+        if (!via_cell.lpp[0].valid && !via_cell.lpp[1].valid && !via_cell.lpp[2].valid) {
+            continue;
+        }
+        const GdsViaShapes & shapes = via_cell.shapes;
+        get_via_shapes(vias, idx, grid, vdef, via_cell.shapes);
+
+        // vias with the same shapes share one structure.
+        std::ostringstream key;
+        key << via_name;
+        for (unsigned int j = 0; j < 4; j++) {
+            key << " " << shapes.bot[j] << " " << shapes.top[j] << " " << shapes.cut[j];
+        }
+        key << " " << shapes.cut_nx << " " << shapes.cut_ny << " " << shapes.cut_px << " "
+                << shapes.cut_py;
+        std::string & name = via_cells[key.str()];
+        if (name.empty()) {
+            std::ostringstream os;
+            os << cell << "$via_" << via_name << "_" << via_cells.size();
+            name = os.str();
+            via_cell.name = name;
+            pending_vias.push_back(via_cell);
+        }
+
+        // the via orientation goes on the reference, arrays stay along x and y.
+        int nx = vias.arr_n[2 * idx];
+        int ny = vias.arr_n[2 * idx + 1];
+        write_ref(name, vias.orient[idx], to_dbu(vias.loc[2 * idx]),
+                to_dbu(vias.loc[2 * idx + 1]), std::max(nx, 1), std::max(ny, 1),
+                to_dbu(vias.arr_sp[2 * idx]), to_dbu(vias.arr_sp[2 * idx + 1]));
+    }
+}
+
+void GdsWriter::write_via_cell(const std::string & cell, const GdsViaCell & via_cell) {
+    const GdsViaShapes & shapes = via_cell.shapes;
+    write_struct_begin(via_cell.name);
+    if (via_cell.lpp[0].valid) {
+        write_box(via_cell.lpp[0], shapes.bot[0], shapes.bot[1], shapes.bot[2], shapes.bot[3]);
+    }
+    if (via_cell.lpp[2].valid) {
+        write_box(via_cell.lpp[2], shapes.top[0], shapes.top[1], shapes.top[2], shapes.top[3]);
+    }
+    const GdsLpp & cut_lpp = via_cell.lpp[1];
+    if (cut_lpp.valid) {
+        if (shapes.cut_nx > 1 || shapes.cut_ny > 1) {
+            std::string name = get_rect_cell(cell, cut_lpp, shapes.cut[2] - shapes.cut[0],
+                    shapes.cut[3] - shapes.cut[1]);
+            write_ref(name, 0, shapes.cut[0], shapes.cut[1], shapes.cut_nx, shapes.cut_ny,
+                    shapes.cut_px, shapes.cut_py);
+        } else {
+            write_box(cut_lpp, shapes.cut[0], shapes.cut[1], shapes.cut[2], shapes.cut[3]);
+        }
+    }
+    write_struct_end();
+}
+
+void GdsWriter::write_pins(const Layout & layout) {
+    for (PinIter it = layout.pin_list.begin(); it != layout.pin_list.end(); it++) {
+        const GdsLpp & lpp = lpp_gds[it->lpp];
+        if (!lpp.valid) {
+            continue;
+        }
+        int32_t xl = to_dbu(it->bbox[0]);
+        int32_t yb = to_dbu(it->bbox[1]);
+        int32_t xr = to_dbu(it->bbox[2]);
+        int32_t yt = to_dbu(it->bbox[3]);
+
+        // label at the center, rotated along tall pins like the OA writer.
+        write_text(lpp, (xl + xr) / 2, (yb + yt) / 2, (yt - yb) > (xr - xl), it->label);
+        if (it->make_pin_obj) {
+            write_box(lpp, xl, yb, xr, yt);
+        }
+    }
+}
+
+void GdsWriter::write_inst(const Inst & inst) {
+    write_ref(inst.cell_name, inst.orient, to_dbu(inst.loc[0]), to_dbu(inst.loc[1]),
+            inst.num_cols, inst.num_rows, to_dbu(inst.sp_cols), to_dbu(inst.sp_rows));
+}
+
+void GdsWriter::write_polygon(const GdsLpp & lpp, const PointRange & points) {
+    if (lpp.valid) {
+        write_boundary(lpp, &pt_buf[points.offset], points.num_pts);
+    }
+}
+
+void GdsWriter::write_box(const GdsLpp & lpp, int32_t xl, int32_t yb, int32_t xr, int32_t yt) {
+    int32_t xy[8] = { xl, yb, xr, yb, xr, yt, xl, yt };
+    write_boundary(lpp, xy, 4);
+}
+
+void GdsWriter::write_boundary(const GdsLpp & lpp, const int32_t * xy, std::size_t num_pts) {
+    if (num_pts + 1 > gds_max_points) {
+        std::ostringstream os;
+        os << "GDS polygon with " << num_pts << " points exceeds the limit of "
+                << gds_max_points - 1;
+        throw std::invalid_argument(os.str());
+    }
+    begin_record(gds_boundary, 0);
+    write_int16_record(gds_layer, (int16_t) lpp.layer);
+    write_int16_record(gds_datatype, (int16_t) lpp.datatype);
+    // GDSII boundaries repeat the first point at the end.
+    begin_record(gds_xy, 8 * (num_pts + 1));
+    for (std::size_t idx = 0; idx < 2 * num_pts; idx++) {
+        put_int32(xy[idx]);
+    }
+    put_int32(xy[0]);
+    put_int32(xy[1]);
+    begin_record(gds_endel, 0);
+}
+
+void GdsWriter::write_path(const GdsLpp & lpp, int32_t width, unsigned char begin_style,
+        unsigned char end_style, const int32_t * xy, std::size_t num_pts) {
+    // pick the closest GDSII path type.  Mixed end styles use explicit extensions,
+    // with round ends extended like square ends.
+    int16_t path_type = 4;
+    if (begin_style == end_style) {
+        if (begin_style == truncate_style) {
+            path_type = 0;
+        } else if (begin_style == round_style) {
+            path_type = 1;
+        } else {
+            path_type = 2;
+        }
+    }
+
+    begin_record(gds_path, 0);
+    write_int16_record(gds_layer, (int16_t) lpp.layer);
+    write_int16_record(gds_datatype, (int16_t) lpp.datatype);
+    write_int16_record(gds_pathtype, path_type);
+    begin_record(gds_width, 4);
+    put_int32(width);
+    if (path_type == 4) {
+        begin_record(gds_bgnextn, 4);
+        put_int32(begin_style == truncate_style ? 0 : width / 2);
+        begin_record(gds_endextn, 4);
+        put_int32(end_style == truncate_style ? 0 : width / 2);
+    }
+    begin_record(gds_xy, 8 * num_pts);
+    for (std::size_t idx = 0; idx < 2 * num_pts; idx++) {
+        put_int32(xy[idx]);
+    }
+    begin_record(gds_endel, 0);
+}
+
+void GdsWriter::write_text(const GdsLpp & lpp, int32_t x, int32_t y, bool vertical,
+        const std::string & text) {
+    begin_record(gds_text, 0);
+    write_int16_record(gds_layer, (int16_t) lpp.layer);
+    write_int16_record(gds_texttype, (int16_t) lpp.datatype);
+    // center/center justification
+    write_int16_record(gds_presentation, 0x0005);
+    if (vertical) {
+        write_int16_record(gds_strans, 0);
+        begin_record(gds_angle, 8);
+        put_real8(90.0);
+    }
+    begin_record(gds_xy, 8);
+    put_int32(x);
+    put_int32(y);
+    write_string_record(gds_string, text);
+    begin_record(gds_endel, 0);
+}
+
+void GdsWriter::write_ref(const std::string & master, unsigned char orient, int32_t x, int32_t y,
+        int nx, int ny, int32_t spx, int32_t spy) {
+    if (nx > gds_max_colrow || ny > gds_max_colrow) {
+        std::ostringstream os;
+        os << "GDS array of " << master << " too large: " << nx << " x " << ny;
+        throw std::invalid_argument(os.str());
+    }
+    bool is_array = (nx > 1 || ny > 1);
+    begin_record(is_array ? gds_aref : gds_sref, 0);
+    write_string_record(gds_sname, master);
+
+    bool reflect;
+    int angle;
+    get_orient_strans(orient, reflect, angle);
+    if (reflect || angle != 0) {
+        write_int16_record(gds_strans, reflect ? (int16_t) 0x8000 : 0);
+        if (angle != 0) {
+            begin_record(gds_angle, 8);
+            put_real8((double) angle);
+        }
+    }
+
+    if (is_array) {
+        begin_record(gds_colrow, 4);
+        put_int16((int16_t) nx);
+        put_int16((int16_t) ny);
+        begin_record(gds_xy, 24);
+        put_int32(x);
+        put_int32(y);
+        put_int32(x + nx * spx);
+        put_int32(y);
+        put_int32(x);
+        put_int32(y + ny * spy);
+    } else {
+        begin_record(gds_xy, 8);
+        put_int32(x);
+        put_int32(y);
+    }
+    begin_record(gds_endel, 0);
+}
+
+void GdsWriter::write_struct_begin(const std::string & name) {
+    write_timestamp(gds_bgnstr);
+    write_string_record(gds_strname, name);
+}
+
+void GdsWriter::write_struct_end() {
+    begin_record(gds_endstr, 0);
+    if (buf.size() >= gds_buf_size) {
+        flush();
+    }
+}
+
+void GdsWriter::begin_record(uint16_t rec_type, std::size_t num_bytes) {
+    if (buf.size() >= gds_buf_size) {
+        flush();
+    }
+    uint16_t rec_len = (uint16_t) (num_bytes + 4);
+    buf.push_back((char) (rec_len >> 8));
+    buf.push_back((char) (rec_len & 0xFF));
+    buf.push_back((char) (rec_type >> 8));
+    buf.push_back((char) (rec_type & 0xFF));
+}
+
+void GdsWriter::put_int16(int16_t val) {
+    uint16_t uval = (uint16_t) val;
+    buf.push_back((char) (uval >> 8));
+    buf.push_back((char) (uval & 0xFF));
+}
+
+void GdsWriter::put_int32(int32_t val) {
+    uint32_t uval = (uint32_t) val;
+    buf.push_back((char) (uval >> 24));
+    buf.push_back((char) ((uval >> 16) & 0xFF));
+    buf.push_back((char) ((uval >> 8) & 0xFF));
+    buf.push_back((char) (uval & 0xFF));
+}
+
+void GdsWriter::put_real8(double val) {
+    // excess-64 base-16 floating point, 56 bit mantissa.
+    uint64_t bits = 0;
+    if (val != 0) {
+        uint64_t sign = 0;
+        if (val < 0) {
+            sign = 1;
+            val = -val;
+        }
+        int exponent = 64;
+        while (val >= 1) {
+            val /= 16;
+            exponent++;
+        }
+        while (val < 1.0 / 16) {
+            val *= 16;
+            exponent--;
+        }
+        uint64_t mantissa = (uint64_t) (val * 72057594037927936.0 + 0.5);
+        if (mantissa >= ((uint64_t) 1 << 56)) {
+            mantissa >>= 4;
+            exponent++;
+        }
+        bits = (sign << 63) | (((uint64_t) exponent) << 56) | mantissa;
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        buf.push_back((char) ((bits >> shift) & 0xFF));
+    }
+}
+
+void GdsWriter::put_string(const std::string & val) {
+    buf.insert(buf.end(), val.begin(), val.end());
+    if (val.size() % 2 != 0) {
+        buf.push_back('\0');
+    }
+}
+
+void GdsWriter::write_string_record(uint16_t rec_type, const std::string & val) {
+    begin_record(rec_type, val.size() + val.size() % 2);
+    put_string(val);
+}
+
+void GdsWriter::write_int16_record(uint16_t rec_type, int16_t val) {
+    begin_record(rec_type, 2);
+    put_int16(val);
+}
+
+void GdsWriter::write_timestamp(uint16_t rec_type) {
+    // modification and access time
+    time_t now = time(NULL);
+    struct tm * t = localtime(&now);
+    int16_t vals[6] = { (int16_t) (t->tm_year + 1900), (int16_t) (t->tm_mon + 1),
+            (int16_t) t->tm_mday, (int16_t) t->tm_hour, (int16_t) t->tm_min,
+            (int16_t) t->tm_sec };
+    begin_record(rec_type, 24);
+    for (unsigned int k = 0; k < 2; k++) {
+        for (unsigned int j = 0; j < 6; j++) {
+            put_int16(vals[j]);
+        }
+    }
+}
+
+void GdsWriter::flush() {
+    if (!buf.empty()) {
+        out.write(buf.data(), buf.size());
+        buf.clear();
+        if (!out) {
+            throw std::runtime_error("Error writing GDS file.");
+        }
+    }
+}
+
+}
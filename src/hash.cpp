@@ -0,0 +1,371 @@
+#include <cstring>
+#include <algorithm>
+
+#include <bag.hpp>
+
+namespace bag {
+
+// changes whenever the hashed content changes, so old hashes never match.
+const uint64_t layout_hash_version = 3;
+
+const uint64_t fnv_offset = 14695981039346656037ULL;
+const uint64_t fnv_prime = 1099511628211ULL;
+
+// splitmix64 finalizer, spreads element hashes before they are summed.
+uint64_t mix_hash(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// FNV-1a over the fields of one element.
+class Hasher {
+public:
+    Hasher() :
+            val(fnv_offset) {
+    }
+
+    void add_bytes(const void * data, std::size_t n) {
+        const unsigned char * ptr = static_cast<const unsigned char *>(data);
+        for (std::size_t idx = 0; idx < n; idx++) {
+            val = (val ^ ptr[idx]) * fnv_prime;
+        }
+    }
+
+    void add(int64_t x) {
+        // fixed little-endian layout regardless of platform
+        unsigned char bytes[8];
+        uint64_t ux = (uint64_t) x;
+        for (unsigned int idx = 0; idx < 8; idx++) {
+            bytes[idx] = (unsigned char) (ux >> (8 * idx));
+        }
+        add_bytes(bytes, 8);
+    }
+
+    void add(double x) {
+        int64_t bits;
+        x = (x == 0) ? 0.0 : x;
+        std::memcpy(&bits, &x, sizeof(bits));
+        add(bits);
+    }
+
+    void add(const std::string & str) {
+        add((int64_t) str.size());
+        add_bytes(str.data(), str.size());
+    }
+
+    void add(const int32_t * vals, std::size_t n) {
+        for (std::size_t idx = 0; idx < n; idx++) {
+            add((int64_t) vals[idx]);
+        }
+    }
+
+    void add(const Hasher & other) {
+        add((int64_t) other.get());
+    }
+
+    uint64_t get() const {
+        return val;
+    }
+
+private:
+    uint64_t val;
+};
+
+// an order-independent hash of a list of elements.
+class ListHash {
+public:
+    ListHash() :
+            sum(0), count(0) {
+    }
+
+    void add(const Hasher & elem) {
+        sum += mix_hash(elem.get());
+        count++;
+    }
+
+    void merge_into(Hasher & top) const {
+        top.add((int64_t) count);
+        top.add((int64_t) sum);
+    }
+
+private:
+    uint64_t sum;
+    uint64_t count;
+};
+
+// the fields of one element written out in full, for exact comparison.
+// Same interface as Hasher.
+class Recorder {
+public:
+    void add_bytes(const void * data, std::size_t n) {
+        bytes.append(static_cast<const char *>(data), n);
+    }
+
+    void add(int64_t x) {
+        add_bytes(&x, sizeof(x));
+    }
+
+    void add(double x) {
+        x = (x == 0) ? 0.0 : x;
+        add_bytes(&x, sizeof(x));
+    }
+
+    void add(const std::string & str) {
+        add((int64_t) str.size());
+        add_bytes(str.data(), str.size());
+    }
+
+    void add(const int32_t * vals, std::size_t n) {
+        for (std::size_t idx = 0; idx < n; idx++) {
+            add((int64_t) vals[idx]);
+        }
+    }
+
+    void add(const Recorder & other) {
+        add(other.bytes);
+    }
+
+    std::string bytes;
+};
+
+// the elements of a list in sorted order.  Same interface as ListHash.
+class ListRecord {
+public:
+    void add(const Recorder & elem) {
+        elems.push_back(elem.bytes);
+    }
+
+    void merge_into(Recorder & top) const {
+        std::vector<std::string> sorted(elems);
+        std::sort(sorted.begin(), sorted.end());
+        top.add((int64_t) sorted.size());
+        for (std::size_t idx = 0; idx < sorted.size(); idx++) {
+            top.add(sorted[idx]);
+        }
+    }
+
+private:
+    std::vector<std::string> elems;
+};
+
+int32_t snap_coord(double val, const Grid & grid) {
+    int32_t ans;
+    quantize(&val, &ans, 1, grid);
+    return ans;
+}
+
+template<class Elem>
+Elem describe_params(const ParamSet & params) {
+    // parameter maps are sorted by name
+    Elem h;
+    h.add((int64_t) params.int_params.size());
+    for (IntIter p = params.int_params.begin(); p != params.int_params.end(); p++) {
+        h.add(p->first);
+        h.add((int64_t) p->second);
+    }
+    h.add((int64_t) params.str_params.size());
+    for (StrIter p = params.str_params.begin(); p != params.str_params.end(); p++) {
+        h.add(p->first);
+        h.add(p->second);
+    }
+    h.add((int64_t) params.double_params.size());
+    for (DoubleIter p = params.double_params.begin(); p != params.double_params.end(); p++) {
+        h.add(p->first);
+        h.add(p->second);
+    }
+    return h;
+}
+
+uint64_t hash_params(const ParamSet & params) {
+    return describe_params<Hasher>(params).get();
+}
+
+// write the content of a layout to top: each element of each list is written
+// to an Elem and the lists are merged in.  Coordinates are snapped to the
+// grid and layers are written by name.
+template<class Elem, class List>
+void describe_layout(const Layout & layout, const Grid & grid, Elem & top) {
+    if (!grid.is_set()) {
+        throw std::invalid_argument("hash_layout: the grid must be set.");
+    }
+
+    // layers by name so the interned ids do not matter.
+    std::vector<Elem> lpp_desc(layout.lpp_table.size());
+    for (unsigned int idx = 0; idx < layout.lpp_table.size(); idx++) {
+        lpp_desc[idx].add(layout.lpp_table[idx].layer);
+        lpp_desc[idx].add(layout.lpp_table[idx].purpose);
+    }
+
+    // each distinct parameter set is described once
+    std::vector<Elem> param_desc(layout.param_table.size());
+    for (unsigned int idx = 0; idx < layout.param_table.size(); idx++) {
+        param_desc[idx] = describe_params<Elem>(layout.param_table[idx]);
+    }
+
+    std::vector<int32_t> pts(layout.point_arena.size());
+    layout.point_arena.to_dbu(0, pts.size(), grid, pts.data());
+
+    List insts;
+    for (InstIter it = layout.inst_list.begin(); it != layout.inst_list.end(); it++) {
+        Elem h;
+        h.add(it->lib_name);
+        h.add(it->cell_name);
+        h.add(it->view_name);
+        h.add(it->inst_name);
+        h.add((int64_t) it->orient);
+        h.add((int64_t) snap_coord(it->loc[0], grid));
+        h.add((int64_t) snap_coord(it->loc[1], grid));
+        h.add((int64_t) it->num_rows);
+        h.add((int64_t) it->num_cols);
+        h.add((int64_t) snap_coord(it->sp_rows, grid));
+        h.add((int64_t) snap_coord(it->sp_cols, grid));
+        h.add(param_desc[it->params]);
+        insts.add(h);
+    }
+
+    List rects;
+    const RectTable & rect_tab = layout.rect_list;
+    std::vector<int32_t> box(4 * rect_tab.size());
+    std::vector<int32_t> sp(2 * rect_tab.size());
+    rect_tab.bbox.to_dbu(0, box.size(), grid, box.data());
+    rect_tab.arr_sp.to_dbu(0, sp.size(), grid, sp.data());
+    for (std::size_t idx = 0; idx < rect_tab.size(); idx++) {
+        Elem h;
+        h.add(lpp_desc[rect_tab.lpp[idx]]);
+        h.add(&box[4 * idx], 4);
+        h.add((int64_t) rect_tab.arr_n[2 * idx]);
+        h.add((int64_t) rect_tab.arr_n[2 * idx + 1]);
+        h.add(&sp[2 * idx], 2);
+        rects.add(h);
+    }
+
+    List segs;
+    const PathSegTable & seg_tab = layout.path_seg_list;
+    box.resize(4 * seg_tab.size());
+    sp.resize(seg_tab.size());
+    seg_tab.pts.to_dbu(0, box.size(), grid, box.data());
+    seg_tab.width.to_dbu(0, sp.size(), grid, sp.data());
+    for (std::size_t idx = 0; idx < seg_tab.size(); idx++) {
+        Elem h;
+        h.add(lpp_desc[seg_tab.lpp[idx]]);
+        h.add(&box[4 * idx], 4);
+        h.add((int64_t) sp[idx]);
+        h.add((int64_t) seg_tab.style[2 * idx]);
+        h.add((int64_t) seg_tab.style[2 * idx + 1]);
+        segs.add(h);
+    }
+
+    List vias;
+    const ViaTable & via_tab = layout.via_list;
+    std::size_t num_vias = via_tab.size();
+    const CoordArray * via_cols[] = { &via_tab.loc, &via_tab.cut_sp, &via_tab.enc1,
+            &via_tab.enc2, &via_tab.cut_size, &via_tab.arr_sp };
+    const unsigned int via_widths[] = { 2, 2, 4, 4, 2, 2 };
+    const unsigned int num_via_cols = sizeof(via_widths) / sizeof(via_widths[0]);
+    std::vector<int32_t> via_vals[num_via_cols];
+    for (unsigned int col = 0; col < num_via_cols; col++) {
+        via_vals[col].resize(via_widths[col] * num_vias);
+        via_cols[col]->to_dbu(0, via_vals[col].size(), grid, via_vals[col].data());
+    }
+    for (std::size_t idx = 0; idx < num_vias; idx++) {
+        Elem h;
+        h.add(via_tab.names[via_tab.via_id[idx]]);
+        h.add((int64_t) via_tab.orient[idx]);
+        h.add((int64_t) via_tab.cut_n[2 * idx]);
+        h.add((int64_t) via_tab.cut_n[2 * idx + 1]);
+        h.add((int64_t) via_tab.arr_n[2 * idx]);
+        h.add((int64_t) via_tab.arr_n[2 * idx + 1]);
+        for (unsigned int col = 0; col < num_via_cols; col++) {
+            h.add(&via_vals[col][via_widths[col] * idx], via_widths[col]);
+        }
+        vias.add(h);
+    }
+
+    List pins;
+    for (PinIter it = layout.pin_list.begin(); it != layout.pin_list.end(); it++) {
+        Elem h;
+        h.add(lpp_desc[it->lpp]);
+        for (unsigned int j = 0; j < 4; j++) {
+            h.add((int64_t) snap_coord(it->bbox[j], grid));
+        }
+        h.add(it->term_name);
+        h.add(it->pin_name);
+        h.add(it->label);
+        h.add((int64_t) it->make_pin_obj);
+        pins.add(h);
+    }
+
+    // point lists keep their order within a shape
+    List paths;
+    for (PathIter it = layout.path_list.begin(); it != layout.path_list.end(); it++) {
+        Elem h;
+        h.add(lpp_desc[it->lpp]);
+        h.add((int64_t) snap_coord(it->width, grid));
+        h.add((int64_t) it->begin_style);
+        h.add((int64_t) it->end_style);
+        h.add((int64_t) it->join_style);
+        h.add((int64_t) it->points.num_pts);
+        h.add(&pts[it->points.offset], 2 * it->points.num_pts);
+        paths.add(h);
+    }
+
+    List polys;
+    for (PolygonIter it = layout.polygon_list.begin(); it != layout.polygon_list.end(); it++) {
+        Elem h;
+        h.add(lpp_desc[it->lpp]);
+        h.add((int64_t) it->points.num_pts);
+        h.add(&pts[it->points.offset], 2 * it->points.num_pts);
+        polys.add(h);
+    }
+
+    List blocks;
+    for (BlockageIter it = layout.block_list.begin(); it != layout.block_list.end(); it++) {
+        Elem h;
+        h.add(it->layer);
+        h.add(it->type);
+        h.add((int64_t) it->points.num_pts);
+        h.add(&pts[it->points.offset], 2 * it->points.num_pts);
+        blocks.add(h);
+    }
+
+    List bounds;
+    for (BoundaryIter it = layout.boundary_list.begin(); it != layout.boundary_list.end(); it++) {
+        Elem h;
+        h.add(it->type);
+        h.add((int64_t) it->points.num_pts);
+        h.add(&pts[it->points.offset], 2 * it->points.num_pts);
+        bounds.add(h);
+    }
+
+    top.add((int64_t) layout_hash_version);
+    top.add((int64_t) grid.dbu_per_uu);
+    top.add((int64_t) grid.mfg_grid_res);
+    insts.merge_into(top);
+    rects.merge_into(top);
+    segs.merge_into(top);
+    vias.merge_into(top);
+    pins.merge_into(top);
+    paths.merge_into(top);
+    polys.merge_into(top);
+    blocks.merge_into(top);
+    bounds.merge_into(top);
+}
+
+uint64_t hash_layout(const Layout & layout, const Grid & grid) {
+    Hasher top;
+    describe_layout<Hasher, ListHash>(layout, grid, top);
+    return top.get();
+}
+
+bool same_layout(const Layout & first, const Layout & second, const Grid & grid) {
+    Recorder first_desc, second_desc;
+    describe_layout<Recorder, ListRecord>(first, grid, first_desc);
+    describe_layout<Recorder, ListRecord>(second, grid, second_desc);
+    return first_desc.bytes == second_desc.bytes;
+}
+
+}
@@ -0,0 +1,86 @@
+#include <library.hpp>
+
+namespace bag {
+
+const std::string & LayoutLibrary::add_cell(const std::string & cell, const Layout & layout) {
+    if (has_cell(cell)) {
+        throw std::invalid_argument("LayoutLibrary: cell " + cell + " was already added.");
+    }
+
+    // point instances of library cells at the stored cells, so duplicates
+    // hash the same no matter which alias their children were added as.
+    layouts.push_back(layout);
+    Layout & stored = layouts.back();
+    for (InstList::iterator it = stored.inst_list.begin(); it != stored.inst_list.end(); it++) {
+        if (!it->lib_name.empty() && it->lib_name != lib_name) {
+            continue;
+        }
+        std::map<std::string, std::size_t>::const_iterator child = cell_map.find(it->cell_name);
+        if (child != cell_map.end()) {
+            it->lib_name = lib_name;
+            it->view_name = view_name;
+            it->cell_name = names[child->second];
+        } else if (it->lib_name.empty()) {
+            std::string msg = "LayoutLibrary: cell " + cell + " instantiates unknown cell "
+                    + it->cell_name + ".";
+            layouts.pop_back();
+            throw std::invalid_argument(msg);
+        }
+    }
+
+    uint64_t hash;
+    try {
+        hash = hash_layout(stored, grid);
+    } catch (...) {
+        layouts.pop_back();
+        throw;
+    }
+    // a matching hash is confirmed by comparing the layouts.
+    std::pair<LayoutHashIter, LayoutHashIter> range = hash_map.equal_range(hash);
+    for (LayoutHashIter dup = range.first; dup != range.second; dup++) {
+        bool same;
+        try {
+            same = same_layout(stored, layouts[dup->second], grid);
+        } catch (...) {
+            layouts.pop_back();
+            throw;
+        }
+        if (same) {
+            layouts.pop_back();
+            cell_map[cell] = dup->second;
+            num_dups++;
+            return names[dup->second];
+        }
+    }
+
+    std::size_t idx = names.size();
+    names.push_back(cell);
+    cell_map[cell] = idx;
+    hash_map.insert(std::make_pair(hash, idx));
+    return names[idx];
+}
+
+const std::string & LayoutLibrary::resolve(const std::string & cell) const {
+    std::map<std::string, std::size_t>::const_iterator it = cell_map.find(cell);
+    if (it == cell_map.end()) {
+        throw std::invalid_argument("LayoutLibrary: unknown cell " + cell + ".");
+    }
+    return names[it->second];
+}
+
+void LayoutLibrary::write(LayoutWriter & writer) const {
+    // children are always added before their parents
+    for (std::size_t idx = 0; idx < layouts.size(); idx++) {
+        writer.create_layout(names[idx], view_name, layouts[idx]);
+    }
+}
+
+void LayoutLibrary::clear() {
+    layouts.clear();
+    names.clear();
+    cell_map.clear();
+    hash_map.clear();
+    num_dups = 0;
+}
+
+}
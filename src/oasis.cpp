@@ -0,0 +1,825 @@
+#include <cstring>
+
+#ifdef BAG_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <oasis.hpp>
+
+namespace bag {
+
+// OASIS record types
+const unsigned char oas_start = 1;
+const unsigned char oas_end = 2;
+const unsigned char oas_cell = 14;
+const unsigned char oas_placement = 17;
+const unsigned char oas_text = 19;
+const unsigned char oas_rectangle = 20;
+const unsigned char oas_polygon = 21;
+const unsigned char oas_path = 22;
+const unsigned char oas_cblock = 34;
+
+const char oas_magic[] = "%SEMI-OASIS\r\n";
+
+// the END record is padded to this many bytes.
+const std::size_t oas_end_size = 256;
+
+// uncompressed bytes per CBLOCK, and buffered bytes before writing to the file.
+const std::size_t oas_block_size = 1 << 20;
+
+static void put_uint(ByteList & buf, uint64_t val) {
+    while (val >= 0x80) {
+        buf.push_back((unsigned char) (val & 0x7F) | 0x80);
+        val >>= 7;
+    }
+    buf.push_back((unsigned char) val);
+}
+
+static void put_sint(ByteList & buf, int64_t val) {
+    if (val < 0) {
+        put_uint(buf, (((uint64_t) -val) << 1) | 1);
+    } else {
+        put_uint(buf, ((uint64_t) val) << 1);
+    }
+}
+
+static void put_string(ByteList & buf, const std::string & val) {
+    put_uint(buf, val.size());
+    buf.insert(buf.end(), val.begin(), val.end());
+}
+
+static void put_gdelta(ByteList & buf, int64_t dx, int64_t dy) {
+    // octangular deltas take one integer, anything else two.
+    uint64_t ax = (uint64_t) (dx < 0 ? -dx : dx);
+    uint64_t ay = (uint64_t) (dy < 0 ? -dy : dy);
+    int dir = -1;
+    uint64_t mag = 0;
+    if (dy == 0) {
+        dir = dx >= 0 ? 0 : 2;
+        mag = ax;
+    } else if (dx == 0) {
+        dir = dy > 0 ? 1 : 3;
+        mag = ay;
+    } else if (ax == ay) {
+        dir = dx > 0 ? (dy > 0 ? 4 : 7) : (dy > 0 ? 5 : 6);
+        mag = ax;
+    }
+    if (dir >= 0) {
+        put_uint(buf, (mag << 4) | (dir << 1));
+    } else {
+        put_uint(buf, (ax << 2) | (dx < 0 ? 2 : 0) | 1);
+        put_sint(buf, dy);
+    }
+}
+
+OasisWriter::~OasisWriter() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void OasisWriter::open(const std::string & fname, unsigned int dbu_per_uu,
+        unsigned int mfg_grid_res, bool compress, bool repetitions) {
+    close();
+    if (dbu_per_uu == 0 || mfg_grid_res == 0) {
+        throw std::invalid_argument("OASIS database unit and grid resolution must be positive.");
+    }
+
+    out.open(fname.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot open OASIS file: " + fname);
+    }
+    out_buf.clear();
+    out_buf.reserve(oas_block_size + 1024);
+    rec_buf.clear();
+    rec_buf.reserve(oas_block_size + 1024);
+    grid = Grid(dbu_per_uu, mfg_grid_res);
+    num_off_grid = 0;
+#ifdef BAG_HAVE_ZLIB
+    this->compress = compress;
+#else
+    this->compress = false;
+#endif
+    use_repetitions = repetitions;
+    is_open = true;
+
+    out_buf.insert(out_buf.end(), oas_magic, oas_magic + sizeof(oas_magic) - 1);
+    out_buf.push_back(oas_start);
+    put_string(out_buf, "1.0");
+    // grid steps per micron as an unsigned integer real
+    put_uint(out_buf, 0);
+    put_uint(out_buf, dbu_per_uu);
+    // table offsets are stored here, all tables are absent.
+    put_uint(out_buf, 0);
+    for (unsigned int idx = 0; idx < 12; idx++) {
+        put_uint(out_buf, 0);
+    }
+}
+
+void OasisWriter::add_layer(const std::string & lay_name, unsigned int lay_num) {
+    lay_map[lay_name] = (int) lay_num;
+}
+
+void OasisWriter::add_purpose(const std::string & purp_name, unsigned int purp_num) {
+    purp_map[purp_name] = (int) purp_num;
+}
+
+void OasisWriter::add_via_def(const std::string & via_name, const std::string & bot_layer,
+        const std::string & cut_layer, const std::string & top_layer,
+        const std::string & purpose, double cut_width, double cut_height) {
+    GdsViaDef & vdef = via_defs[via_name];
+    vdef.bot_layer = bot_layer;
+    vdef.cut_layer = cut_layer;
+    vdef.top_layer = top_layer;
+    vdef.purpose = purpose;
+    vdef.cut_width = cut_width;
+    vdef.cut_height = cut_height;
+}
+
+void OasisWriter::close() {
+    if (is_open) {
+        flush_records(true);
+        // record type, empty padding string and validation scheme, padded to the fixed size.
+        std::size_t pad = oas_end_size - 3;
+        if (pad >= 0x80) {
+            pad--;
+        }
+        out_buf.push_back(oas_end);
+        put_uint(out_buf, pad);
+        out_buf.insert(out_buf.end(), pad, 0);
+        put_uint(out_buf, 0);
+        flush();
+        out.close();
+        is_open = false;
+    }
+}
+
+void OasisWriter::create_layout(const std::string & cell, const std::string & view,
+        const Layout & layout) {
+    // do nothing if no file is opened
+    if (!is_open) {
+        return;
+    }
+
+    // resolve all layer/purpose pairs once
+    lpp_oas.resize(layout.lpp_table.size());
+    for (unsigned int idx = 0; idx < layout.lpp_table.size(); idx++) {
+        const LayerPurpose & lpp = layout.lpp_table[idx];
+        if (!resolve_lpp(lpp.layer, lpp.purpose, lpp_oas[idx])) {
+            std::cout << "create_layout: unknown layer/purpose (" << lpp.layer << ", "
+                    << lpp.purpose << "), skipping." << std::endl;
+        }
+    }
+
+    // snap the point arena in one batch
+    std::size_t start_off_grid = num_off_grid;
+    std::size_t num_coord = layout.point_arena.size();
+    pt_buf.resize(num_coord);
+    num_off_grid += layout.point_arena.to_dbu(0, num_coord, grid, pt_buf.data());
+
+    rec_buf.push_back(oas_cell);
+    put_string(rec_buf, cell);
+    reset_modal();
+
+    for (InstIter it = layout.inst_list.begin(); it != layout.inst_list.end(); it++) {
+        write_inst(*it);
+    }
+    write_rects(layout);
+    write_path_segs(layout);
+    write_paths(layout);
+    write_vias(layout);
+    write_pins(layout);
+    for (PolygonIter it = layout.polygon_list.begin(); it != layout.polygon_list.end(); it++) {
+        write_points(lpp_oas[it->lpp], it->points);
+    }
+    for (BlockageIter it = layout.block_list.begin(); it != layout.block_list.end(); it++) {
+        // layer blockages go on the blockage purpose, placement blockages are not streamed.
+        GdsLpp lpp;
+        if (it->type != "placement" && resolve_lpp(it->layer, "blockage", lpp)) {
+            write_points(lpp, it->points);
+        }
+    }
+    for (BoundaryIter it = layout.boundary_list.begin(); it != layout.boundary_list.end(); it++) {
+        GdsLpp lpp;
+        if (it->type == "PR" && resolve_lpp("prBoundary", "boundary", lpp)) {
+            write_points(lpp, it->points);
+        }
+    }
+
+    std::size_t cell_off_grid = num_off_grid - start_off_grid;
+    if (cell_off_grid > 0) {
+        std::cout << "create_layout: " << cell_off_grid
+                << " off-grid coordinates snapped to the manufacturing grid." << std::endl;
+    }
+}
+
+int32_t OasisWriter::to_dbu(double val) const {
+    int32_t ans;
+    quantize(&val, &ans, 1, grid);
+    return ans;
+}
+
+bool OasisWriter::resolve_lpp(const std::string & layer, const std::string & purpose,
+        GdsLpp & lpp) {
+    lpp.valid = false;
+    GdsNumIter lay_iter = lay_map.find(layer);
+    GdsNumIter purp_iter = purp_map.find(purpose);
+    if (lay_iter == lay_map.end() || purp_iter == purp_map.end()) {
+        return false;
+    }
+    lpp.valid = true;
+    lpp.layer = lay_iter->second;
+    lpp.datatype = purp_iter->second;
+    return true;
+}
+
+void OasisWriter::reset_modal() {
+    // positions restart at the origin, everything else becomes undefined.
+    modal.has_layer = modal.has_datatype = modal.has_text_layer = modal.has_text_type = false;
+    modal.has_width = modal.has_height = modal.has_half_width = modal.has_ext = false;
+    modal.has_text = modal.has_place_cell = false;
+    modal.geom_x = modal.geom_y = modal.text_x = modal.text_y = 0;
+    modal.place_x = modal.place_y = 0;
+    modal.rep.clear();
+}
+
+void OasisWriter::write_rects(const Layout & layout) {
+    // snap all boxes and array spacings in one batch each.
+    const RectTable & rects = layout.rect_list;
+    std::size_t num_rects = rects.size();
+    box_buf.resize(4 * num_rects);
+    sp_buf.resize(2 * num_rects);
+    num_off_grid += rects.bbox.to_dbu(0, 4 * num_rects, grid, box_buf.data());
+    num_off_grid += rects.arr_sp.to_dbu(0, 2 * num_rects, grid, sp_buf.data());
+
+    for (std::size_t idx = 0; idx < num_rects; idx++) {
+        const GdsLpp & lpp = lpp_oas[rects.lpp[idx]];
+        if (!lpp.valid) {
+            continue;
+        }
+        const int32_t * box = &box_buf[4 * idx];
+        OasisRep rep = { std::max((int) rects.arr_n[2 * idx], 1),
+                std::max((int) rects.arr_n[2 * idx + 1], 1), sp_buf[2 * idx], 0, 0,
+                sp_buf[2 * idx + 1] };
+        write_rect(lpp, box[0], box[1], box[2] - box[0], box[3] - box[1], rep);
+    }
+}
+
+void OasisWriter::write_path_segs(const Layout & layout) {
+    const PathSegTable & segs = layout.path_seg_list;
+    std::size_t num_segs = segs.size();
+    box_buf.resize(4 * num_segs);
+    num_off_grid += segs.pts.to_dbu(0, 4 * num_segs, grid, box_buf.data());
+
+    for (std::size_t idx = 0; idx < num_segs; idx++) {
+        const GdsLpp & lpp = lpp_oas[segs.lpp[idx]];
+        if (!lpp.valid) {
+            continue;
+        }
+        // round width to even so the path edges stay on grid.
+        int32_t width = to_dbu(segs.width[idx] / 2) * 2;
+        write_path(lpp, width, segs.style[2 * idx], segs.style[2 * idx + 1], &box_buf[4 * idx], 2);
+    }
+}
+
+void OasisWriter::write_paths(const Layout & layout) {
+    for (PathIter it = layout.path_list.begin(); it != layout.path_list.end(); it++) {
+        const GdsLpp & lpp = lpp_oas[it->lpp];
+        if (!lpp.valid) {
+            continue;
+        }
+        const int32_t * xy = &pt_buf[it->points.offset];
+        box_buf.assign(xy, xy + 2 * it->points.num_pts);
+        std::size_t num_pts = merge_collinear(box_buf.data(), it->points.num_pts);
+        int32_t width = to_dbu(it->width / 2) * 2;
+        if (it->join_style == extend_style) {
+            if (num_pts > 1) {
+                write_path(lpp, width, it->begin_style, it->end_style, box_buf.data(), num_pts);
+            }
+            continue;
+        }
+        // other joins need separate segments.
+        for (std::size_t idx = 0; idx + 1 < num_pts; idx++) {
+            write_path(lpp, width, (idx == 0) ? it->begin_style : it->join_style,
+                    (idx + 2 == num_pts) ? it->end_style : it->join_style, &box_buf[2 * idx], 2);
+        }
+    }
+}
+
+void OasisWriter::write_vias(const Layout & layout) {
+    const ViaTable & vias = layout.via_list;
+    for (std::size_t idx = 0; idx < vias.size(); idx++) {
+        const std::string & via_name = vias.names[vias.via_id[idx]];
+        GdsViaDefIter vdef_iter = via_defs.find(via_name);
+        if (vdef_iter == via_defs.end()) {
+            std::cout << "create_via: unknown via " << via_name << ", skipping." << std::endl;
+            continue;
+        }
+        const GdsViaDef & vdef = vdef_iter->second;
+        GdsLpp lpp[3];
+        resolve_lpp(vdef.bot_layer, vdef.purpose, lpp[0]);
+        resolve_lpp(vdef.cut_layer, vdef.purpose, lpp[1]);
+        resolve_lpp(vdef.top_layer, vdef.purpose, lpp[2]);
+
+        GdsViaShapes shapes;
+        get_via_shapes(vias, idx, grid, vdef, shapes);
+
+        unsigned char orient = vias.orient[idx];
+        int32_t x0 = to_dbu(vias.loc[2 * idx]);
+        int32_t y0 = to_dbu(vias.loc[2 * idx + 1]);
+        OasisRep arr_rep = { std::max((int) vias.arr_n[2 * idx], 1),
+                std::max((int) vias.arr_n[2 * idx + 1], 1), to_dbu(vias.arr_sp[2 * idx]), 0, 0,
+                to_dbu(vias.arr_sp[2 * idx + 1]) };
+
+        // enclosures repeat with the via array.
+        int32_t box[4];
+        const int32_t * encs[2] = { shapes.bot, shapes.top };
+        for (unsigned int k = 0; k < 2; k++) {
+            if (lpp[2 * k].valid) {
+                orient_box(orient, encs[k], box);
+                write_rect(lpp[2 * k], box[0] + x0, box[1] + y0, box[2] - box[0], box[3] - box[1],
+                        arr_rep);
+            }
+        }
+        if (!lpp[1].valid) {
+            continue;
+        }
+
+        // cuts repeat along the oriented cut pitch vectors, once per via in the array.
+        orient_box(orient, shapes.cut, box);
+        OasisRep cut_rep = { shapes.cut_nx, shapes.cut_ny, 0, 0, 0, 0 };
+        orient_point(orient, shapes.cut_px, 0, cut_rep.ax, cut_rep.ay);
+        orient_point(orient, 0, shapes.cut_py, cut_rep.bx, cut_rep.by);
+        int32_t cw = box[2] - box[0];
+        int32_t ch = box[3] - box[1];
+        // one of the two lattices has to be expanded, pick the smaller one.
+        if (cut_rep.nx * cut_rep.ny <= arr_rep.nx * arr_rep.ny) {
+            for (int iy = 0; iy < cut_rep.ny; iy++) {
+                for (int ix = 0; ix < cut_rep.nx; ix++) {
+                    write_rect(lpp[1], box[0] + x0 + ix * cut_rep.ax + iy * cut_rep.bx,
+                            box[1] + y0 + ix * cut_rep.ay + iy * cut_rep.by, cw, ch, arr_rep);
+                }
+            }
+            continue;
+        }
+        for (int iy = 0; iy < arr_rep.ny; iy++) {
+            for (int ix = 0; ix < arr_rep.nx; ix++) {
+                write_rect(lpp[1], box[0] + x0 + ix * arr_rep.ax, box[1] + y0 + iy * arr_rep.by,
+                        cw, ch, cut_rep);
+            }
+        }
+    }
+}
+
+void OasisWriter::write_pins(const Layout & layout) {
+    OasisRep single = { 1, 1, 0, 0, 0, 0 };
+    for (PinIter it = layout.pin_list.begin(); it != layout.pin_list.end(); it++) {
+        const GdsLpp & lpp = lpp_oas[it->lpp];
+        if (!lpp.valid) {
+            continue;
+        }
+        int32_t xl = to_dbu(it->bbox[0]);
+        int32_t yb = to_dbu(it->bbox[1]);
+        int32_t xr = to_dbu(it->bbox[2]);
+        int32_t yt = to_dbu(it->bbox[3]);
+
+        // OASIS text has no orientation, so the label just sits at the center.
+        write_text(lpp, (xl + xr) / 2, (yb + yt) / 2, it->label);
+        if (it->make_pin_obj) {
+            write_rect(lpp, xl, yb, xr - xl, yt - yb, single);
+        }
+    }
+}
+
+void OasisWriter::write_inst(const Inst & inst) {
+    OasisRep rep = { std::max((int) inst.num_cols, 1), std::max((int) inst.num_rows, 1),
+            to_dbu(inst.sp_cols), 0, 0, to_dbu(inst.sp_rows) };
+    write_placement(inst.cell_name, inst.orient, to_dbu(inst.loc[0]), to_dbu(inst.loc[1]), rep);
+}
+
+void OasisWriter::write_points(const GdsLpp & lpp, const PointRange & points) {
+    if (lpp.valid) {
+        write_polygon(lpp, &pt_buf[points.offset], points.num_pts);
+    }
+}
+
+void OasisWriter::write_rect(const GdsLpp & lpp, int32_t x, int32_t y, int32_t w, int32_t h,
+        const OasisRep & rep) {
+    // boxes are not normalized when added, and width/height are unsigned.
+    if (w < 0) {
+        x += w;
+        w = -w;
+    }
+    if (h < 0) {
+        y += h;
+        h = -h;
+    }
+    if (!use_repetitions && rep.nx * rep.ny > 1) {
+        OasisRep single = { 1, 1, 0, 0, 0, 0 };
+        for (int iy = 0; iy < rep.ny; iy++) {
+            for (int ix = 0; ix < rep.nx; ix++) {
+                write_rect(lpp, x + ix * rep.ax + iy * rep.bx, y + ix * rep.ay + iy * rep.by, w,
+                        h, single);
+            }
+        }
+        return;
+    }
+
+    // info byte SWHXYRDL
+    bool square = (w == h);
+    unsigned char info = square ? 0x80 : 0;
+    if (!modal.has_width || modal.width != (uint64_t) w) {
+        info |= 0x40;
+    }
+    if (!square && (!modal.has_height || modal.height != (uint64_t) h)) {
+        info |= 0x20;
+    }
+    if (modal.geom_x != x) {
+        info |= 0x10;
+    }
+    if (modal.geom_y != y) {
+        info |= 0x08;
+    }
+    if (rep.nx * rep.ny > 1) {
+        info |= 0x04;
+    }
+    if (!modal.has_datatype || modal.datatype != (uint64_t) lpp.datatype) {
+        info |= 0x02;
+    }
+    if (!modal.has_layer || modal.layer != (uint64_t) lpp.layer) {
+        info |= 0x01;
+    }
+
+    rec_buf.push_back(oas_rectangle);
+    rec_buf.push_back(info);
+    if (info & 0x01) {
+        put_uint(rec_buf, lpp.layer);
+    }
+    if (info & 0x02) {
+        put_uint(rec_buf, lpp.datatype);
+    }
+    if (info & 0x40) {
+        put_uint(rec_buf, w);
+    }
+    if (info & 0x20) {
+        put_uint(rec_buf, h);
+    }
+    if (info & 0x10) {
+        put_sint(rec_buf, x);
+    }
+    if (info & 0x08) {
+        put_sint(rec_buf, y);
+    }
+    if (info & 0x04) {
+        write_repetition(rep);
+    }
+
+    modal.has_layer = modal.has_datatype = modal.has_width = modal.has_height = true;
+    modal.layer = lpp.layer;
+    modal.datatype = lpp.datatype;
+    modal.width = w;
+    modal.height = h;
+    modal.geom_x = x;
+    modal.geom_y = y;
+    end_element();
+}
+
+void OasisWriter::write_polygon(const GdsLpp & lpp, const int32_t * xy, std::size_t num_pts) {
+    // the closing point is implicit.
+    if (num_pts > 3 && xy[0] == xy[2 * num_pts - 2] && xy[1] == xy[2 * num_pts - 1]) {
+        num_pts--;
+    }
+    if (num_pts < 3) {
+        return;
+    }
+
+    // info byte 00PXYRDL
+    unsigned char info = 0x20;
+    if (modal.geom_x != xy[0]) {
+        info |= 0x10;
+    }
+    if (modal.geom_y != xy[1]) {
+        info |= 0x08;
+    }
+    if (!modal.has_datatype || modal.datatype != (uint64_t) lpp.datatype) {
+        info |= 0x02;
+    }
+    if (!modal.has_layer || modal.layer != (uint64_t) lpp.layer) {
+        info |= 0x01;
+    }
+
+    rec_buf.push_back(oas_polygon);
+    rec_buf.push_back(info);
+    if (info & 0x01) {
+        put_uint(rec_buf, lpp.layer);
+    }
+    if (info & 0x02) {
+        put_uint(rec_buf, lpp.datatype);
+    }
+    write_point_list(xy, num_pts);
+    if (info & 0x10) {
+        put_sint(rec_buf, xy[0]);
+    }
+    if (info & 0x08) {
+        put_sint(rec_buf, xy[1]);
+    }
+
+    modal.has_layer = modal.has_datatype = true;
+    modal.layer = lpp.layer;
+    modal.datatype = lpp.datatype;
+    modal.geom_x = xy[0];
+    modal.geom_y = xy[1];
+    end_element();
+}
+
+void OasisWriter::write_path(const GdsLpp & lpp, int32_t width, unsigned char begin_style,
+        unsigned char end_style, const int32_t * xy, std::size_t num_pts) {
+    // round ends are extended like square ends.
+    uint64_t half_width = width / 2;
+    int64_t start_ext = (begin_style == truncate_style) ? 0 : (int64_t) half_width;
+    int64_t end_ext = (end_style == truncate_style) ? 0 : (int64_t) half_width;
+
+    // info byte EWPXYRDL
+    unsigned char info = 0x20;
+    bool new_ext = (!modal.has_ext || modal.start_ext != start_ext || modal.end_ext != end_ext);
+    if (new_ext) {
+        info |= 0x80;
+    }
+    if (!modal.has_half_width || modal.half_width != half_width) {
+        info |= 0x40;
+    }
+    if (modal.geom_x != xy[0]) {
+        info |= 0x10;
+    }
+    if (modal.geom_y != xy[1]) {
+        info |= 0x08;
+    }
+    if (!modal.has_datatype || modal.datatype != (uint64_t) lpp.datatype) {
+        info |= 0x02;
+    }
+    if (!modal.has_layer || modal.layer != (uint64_t) lpp.layer) {
+        info |= 0x01;
+    }
+
+    rec_buf.push_back(oas_path);
+    rec_buf.push_back(info);
+    if (info & 0x01) {
+        put_uint(rec_buf, lpp.layer);
+    }
+    if (info & 0x02) {
+        put_uint(rec_buf, lpp.datatype);
+    }
+    if (info & 0x40) {
+        put_uint(rec_buf, half_width);
+    }
+    if (new_ext) {
+        // extension scheme 0000SSEE: 1 is flush, 2 is half width, 3 is explicit.
+        int64_t exts[2] = { start_ext, end_ext };
+        unsigned char codes[2];
+        for (unsigned int k = 0; k < 2; k++) {
+            codes[k] = (exts[k] == 0) ? 1 : ((exts[k] == (int64_t) half_width) ? 2 : 3);
+        }
+        rec_buf.push_back((unsigned char) ((codes[0] << 2) | codes[1]));
+        for (unsigned int k = 0; k < 2; k++) {
+            if (codes[k] == 3) {
+                put_sint(rec_buf, exts[k]);
+            }
+        }
+    }
+    write_point_list(xy, num_pts);
+    if (info & 0x10) {
+        put_sint(rec_buf, xy[0]);
+    }
+    if (info & 0x08) {
+        put_sint(rec_buf, xy[1]);
+    }
+
+    modal.has_layer = modal.has_datatype = modal.has_half_width = modal.has_ext = true;
+    modal.layer = lpp.layer;
+    modal.datatype = lpp.datatype;
+    modal.half_width = half_width;
+    modal.start_ext = start_ext;
+    modal.end_ext = end_ext;
+    modal.geom_x = xy[0];
+    modal.geom_y = xy[1];
+    end_element();
+}
+
+void OasisWriter::write_text(const GdsLpp & lpp, int32_t x, int32_t y, const std::string & text) {
+    // info byte 0CNXYRTL
+    unsigned char info = 0;
+    if (!modal.has_text || modal.text != text) {
+        info |= 0x40;
+    }
+    if (modal.text_x != x) {
+        info |= 0x10;
+    }
+    if (modal.text_y != y) {
+        info |= 0x08;
+    }
+    if (!modal.has_text_type || modal.text_type != (uint64_t) lpp.datatype) {
+        info |= 0x02;
+    }
+    if (!modal.has_text_layer || modal.text_layer != (uint64_t) lpp.layer) {
+        info |= 0x01;
+    }
+
+    rec_buf.push_back(oas_text);
+    rec_buf.push_back(info);
+    if (info & 0x40) {
+        put_string(rec_buf, text);
+    }
+    if (info & 0x01) {
+        put_uint(rec_buf, lpp.layer);
+    }
+    if (info & 0x02) {
+        put_uint(rec_buf, lpp.datatype);
+    }
+    if (info & 0x10) {
+        put_sint(rec_buf, x);
+    }
+    if (info & 0x08) {
+        put_sint(rec_buf, y);
+    }
+
+    modal.has_text = modal.has_text_layer = modal.has_text_type = true;
+    modal.text = text;
+    modal.text_layer = lpp.layer;
+    modal.text_type = lpp.datatype;
+    modal.text_x = x;
+    modal.text_y = y;
+    end_element();
+}
+
+void OasisWriter::write_placement(const std::string & master, unsigned char orient, int32_t x,
+        int32_t y, const OasisRep & rep) {
+    if (!use_repetitions && rep.nx * rep.ny > 1) {
+        OasisRep single = { 1, 1, 0, 0, 0, 0 };
+        for (int iy = 0; iy < rep.ny; iy++) {
+            for (int ix = 0; ix < rep.nx; ix++) {
+                write_placement(master, orient, x + ix * rep.ax + iy * rep.bx,
+                        y + ix * rep.ay + iy * rep.by, single);
+            }
+        }
+        return;
+    }
+
+    bool reflect;
+    int angle;
+    get_orient_strans(orient, reflect, angle);
+
+    // info byte CNXYRAAF
+    unsigned char info = (unsigned char) (((angle / 90) << 1) | (reflect ? 1 : 0));
+    if (!modal.has_place_cell || modal.place_cell != master) {
+        info |= 0x80;
+    }
+    if (modal.place_x != x) {
+        info |= 0x20;
+    }
+    if (modal.place_y != y) {
+        info |= 0x10;
+    }
+    if (rep.nx * rep.ny > 1) {
+        info |= 0x08;
+    }
+
+    rec_buf.push_back(oas_placement);
+    rec_buf.push_back(info);
+    if (info & 0x80) {
+        put_string(rec_buf, master);
+    }
+    if (info & 0x20) {
+        put_sint(rec_buf, x);
+    }
+    if (info & 0x10) {
+        put_sint(rec_buf, y);
+    }
+    if (info & 0x08) {
+        write_repetition(rep);
+    }
+
+    modal.has_place_cell = true;
+    modal.place_cell = master;
+    modal.place_x = x;
+    modal.place_y = y;
+    end_element();
+}
+
+void OasisWriter::write_repetition(const OasisRep & rep) {
+    // use the axis aligned forms when possible, arbitrary lattice vectors otherwise.
+    rep_buf.clear();
+    bool row_axis = (rep.ay == 0 && rep.ax >= 0);
+    bool col_axis = (rep.bx == 0 && rep.by >= 0);
+    if (rep.nx > 1 && rep.ny > 1) {
+        if (row_axis && col_axis) {
+            put_uint(rep_buf, 1);
+            put_uint(rep_buf, rep.nx - 2);
+            put_uint(rep_buf, rep.ny - 2);
+            put_uint(rep_buf, rep.ax);
+            put_uint(rep_buf, rep.by);
+        } else {
+            put_uint(rep_buf, 8);
+            put_uint(rep_buf, rep.nx - 2);
+            put_uint(rep_buf, rep.ny - 2);
+            put_gdelta(rep_buf, rep.ax, rep.ay);
+            put_gdelta(rep_buf, rep.bx, rep.by);
+        }
+    } else if (rep.nx > 1) {
+        if (row_axis) {
+            put_uint(rep_buf, 2);
+            put_uint(rep_buf, rep.nx - 2);
+            put_uint(rep_buf, rep.ax);
+        } else {
+            put_uint(rep_buf, 9);
+            put_uint(rep_buf, rep.nx - 2);
+            put_gdelta(rep_buf, rep.ax, rep.ay);
+        }
+    } else {
+        if (col_axis) {
+            put_uint(rep_buf, 3);
+            put_uint(rep_buf, rep.ny - 2);
+            put_uint(rep_buf, rep.by);
+        } else {
+            put_uint(rep_buf, 9);
+            put_uint(rep_buf, rep.ny - 2);
+            put_gdelta(rep_buf, rep.bx, rep.by);
+        }
+    }
+
+    // repeat the previous repetition with a single byte.
+    if (rep_buf == modal.rep) {
+        put_uint(rec_buf, 0);
+    } else {
+        rec_buf.insert(rec_buf.end(), rep_buf.begin(), rep_buf.end());
+        modal.rep.swap(rep_buf);
+    }
+}
+
+void OasisWriter::write_point_list(const int32_t * xy, std::size_t num_pts) {
+    // list type 4, general deltas from the first point.
+    put_uint(rec_buf, 4);
+    put_uint(rec_buf, num_pts - 1);
+    for (std::size_t idx = 1; idx < num_pts; idx++) {
+        put_gdelta(rec_buf, (int64_t) xy[2 * idx] - xy[2 * idx - 2],
+                (int64_t) xy[2 * idx + 1] - xy[2 * idx - 1]);
+    }
+}
+
+void OasisWriter::end_element() {
+    if (rec_buf.size() >= oas_block_size) {
+        flush_records(true);
+    }
+}
+
+void OasisWriter::flush_records(bool allow_compress) {
+    if (rec_buf.empty()) {
+        return;
+    }
+#ifdef BAG_HAVE_ZLIB
+    if (compress && allow_compress) {
+        // raw deflate stream, no zlib header.
+        z_stream strm;
+        std::memset(&strm, 0, sizeof(strm));
+        if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("Cannot initialize OASIS compression.");
+        }
+        zip_buf.resize(deflateBound(&strm, rec_buf.size()));
+        strm.next_in = rec_buf.data();
+        strm.avail_in = (uInt) rec_buf.size();
+        strm.next_out = zip_buf.data();
+        strm.avail_out = (uInt) zip_buf.size();
+        int status = deflate(&strm, Z_FINISH);
+        std::size_t num_zip = strm.total_out;
+        deflateEnd(&strm);
+        if (status != Z_STREAM_END) {
+            throw std::runtime_error("Error compressing OASIS cell data.");
+        }
+
+        out_buf.push_back(oas_cblock);
+        put_uint(out_buf, 0);
+        put_uint(out_buf, rec_buf.size());
+        put_uint(out_buf, num_zip);
+        out_buf.insert(out_buf.end(), zip_buf.begin(), zip_buf.begin() + num_zip);
+        rec_buf.clear();
+        flush();
+        return;
+    }
+#endif
+    out_buf.insert(out_buf.end(), rec_buf.begin(), rec_buf.end());
+    rec_buf.clear();
+    flush();
+}
+
+void OasisWriter::flush() {
+    if (!out_buf.empty()) {
+        out.write((const char *) out_buf.data(), out_buf.size());
+        out_buf.clear();
+        if (!out) {
+            throw std::runtime_error("Error writing OASIS file.");
+        }
+    }
+}
+
+}
@@ -0,0 +1,667 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <serialize.hpp>
+
+namespace bag {
+
+const char image_magic[8] = { 'B', 'A', 'G', 'L', 'A', 'Y', 'O', '\0' };
+const uint32_t image_byte_order = 0x01020304;
+
+std::size_t align8(std::size_t n) {
+    return (n + 7) & ~((std::size_t) 7);
+}
+
+// strings interned while writing an image.
+class ImageStrings {
+public:
+    uint32_t get_id(const std::string & val) {
+        std::map<std::string, uint32_t>::const_iterator it = ids.find(val);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        uint32_t id = (uint32_t) offsets.size();
+        chars.insert(chars.end(), val.begin(), val.end());
+        offsets.push_back(chars.size());
+        ids[val] = id;
+        return id;
+    }
+
+    std::vector<uint64_t> offsets;
+    std::vector<char> chars;
+
+private:
+    std::map<std::string, uint32_t> ids;
+};
+
+// a column to be copied into an image.
+struct ImageColumn {
+    ImageColumn() :
+            data(NULL), count(0), elem_size(1) {
+    }
+
+    template<typename T>
+    void set(const std::vector<T> & vec) {
+        data = vec.data();
+        count = vec.size();
+        elem_size = sizeof(T);
+    }
+
+    void set(const CoordArray & arr) {
+        count = arr.size();
+        if (arr.is_dbu()) {
+            data = arr.idata();
+            elem_size = sizeof(int32_t);
+        } else {
+            data = arr.fdata();
+            elem_size = sizeof(double);
+        }
+    }
+
+    const void * data;
+    std::size_t count;
+    uint32_t elem_size;
+};
+
+void push_range(std::vector<uint64_t> & vec, const PointRange & points) {
+    vec.push_back(points.offset);
+    vec.push_back(points.num_pts);
+}
+
+void serialize_layout(const Layout & layout, std::vector<char> & buf) {
+    ImageStrings strs;
+    ImageColumn cols[num_layout_sections];
+
+    std::vector<uint32_t> lpp_str;
+    lpp_str.reserve(2 * layout.lpp_table.size());
+    for (LppIter it = layout.lpp_table.begin(); it != layout.lpp_table.end(); it++) {
+        lpp_str.push_back(strs.get_id(it->layer));
+        lpp_str.push_back(strs.get_id(it->purpose));
+    }
+
+    std::vector<uint32_t> param_counts, int_key, str_key, str_val, dbl_key;
+    std::vector<double> dbl_val;
+    std::vector<int32_t> int_val;
+    for (unsigned int idx = 0; idx < layout.param_table.size(); idx++) {
+        const ParamSet & params = layout.param_table[idx];
+        param_counts.push_back((uint32_t) params.int_params.size());
+        param_counts.push_back((uint32_t) params.str_params.size());
+        param_counts.push_back((uint32_t) params.double_params.size());
+        for (IntIter p = params.int_params.begin(); p != params.int_params.end(); p++) {
+            int_key.push_back(strs.get_id(p->first));
+            int_val.push_back(p->second);
+        }
+        for (StrIter p = params.str_params.begin(); p != params.str_params.end(); p++) {
+            str_key.push_back(strs.get_id(p->first));
+            str_val.push_back(strs.get_id(p->second));
+        }
+        for (DoubleIter p = params.double_params.begin(); p != params.double_params.end(); p++) {
+            dbl_key.push_back(strs.get_id(p->first));
+            dbl_val.push_back(p->second);
+        }
+    }
+
+    std::vector<uint32_t> inst_str, inst_params;
+    std::vector<unsigned char> inst_orient;
+    std::vector<double> inst_loc;
+    std::vector<int32_t> inst_arr_n;
+    for (InstIter it = layout.inst_list.begin(); it != layout.inst_list.end(); it++) {
+        inst_str.push_back(strs.get_id(it->lib_name));
+        inst_str.push_back(strs.get_id(it->cell_name));
+        inst_str.push_back(strs.get_id(it->view_name));
+        inst_str.push_back(strs.get_id(it->inst_name));
+        inst_orient.push_back(it->orient);
+        inst_loc.push_back(it->loc[0]);
+        inst_loc.push_back(it->loc[1]);
+        inst_loc.push_back(it->sp_rows);
+        inst_loc.push_back(it->sp_cols);
+        inst_arr_n.push_back(it->num_rows);
+        inst_arr_n.push_back(it->num_cols);
+        inst_params.push_back(it->params);
+    }
+
+    const ViaTable & vias = layout.via_list;
+    std::vector<uint32_t> via_names;
+    for (unsigned int idx = 0; idx < vias.names.size(); idx++) {
+        via_names.push_back(strs.get_id(vias.names[idx]));
+    }
+
+    std::vector<uint32_t> pin_lpp, pin_str;
+    std::vector<double> pin_bbox;
+    std::vector<unsigned char> pin_obj;
+    for (PinIter it = layout.pin_list.begin(); it != layout.pin_list.end(); it++) {
+        pin_lpp.push_back(it->lpp);
+        pin_bbox.insert(pin_bbox.end(), it->bbox, it->bbox + 4);
+        pin_str.push_back(strs.get_id(it->term_name));
+        pin_str.push_back(strs.get_id(it->pin_name));
+        pin_str.push_back(strs.get_id(it->label));
+        pin_obj.push_back(it->make_pin_obj ? 1 : 0);
+    }
+
+    std::vector<uint32_t> path_lpp;
+    std::vector<uint64_t> path_pts;
+    std::vector<double> path_width;
+    std::vector<unsigned char> path_style;
+    for (PathIter it = layout.path_list.begin(); it != layout.path_list.end(); it++) {
+        path_lpp.push_back(it->lpp);
+        push_range(path_pts, it->points);
+        path_width.push_back(it->width);
+        path_style.push_back(it->begin_style);
+        path_style.push_back(it->end_style);
+        path_style.push_back(it->join_style);
+    }
+
+    std::vector<uint32_t> poly_lpp, block_str, bound_str;
+    std::vector<uint64_t> poly_pts, block_pts, bound_pts;
+    for (PolygonIter it = layout.polygon_list.begin(); it != layout.polygon_list.end(); it++) {
+        poly_lpp.push_back(it->lpp);
+        push_range(poly_pts, it->points);
+    }
+    for (BlockageIter it = layout.block_list.begin(); it != layout.block_list.end(); it++) {
+        block_str.push_back(strs.get_id(it->layer));
+        block_str.push_back(strs.get_id(it->type));
+        push_range(block_pts, it->points);
+    }
+    for (BoundaryIter it = layout.boundary_list.begin(); it != layout.boundary_list.end(); it++) {
+        bound_str.push_back(strs.get_id(it->type));
+        push_range(bound_pts, it->points);
+    }
+
+    cols[sec_str_offsets].set(strs.offsets);
+    cols[sec_str_chars].set(strs.chars);
+    cols[sec_lpp].set(lpp_str);
+    cols[sec_points].set(layout.point_arena);
+    cols[sec_inst_str].set(inst_str);
+    cols[sec_inst_orient].set(inst_orient);
+    cols[sec_inst_loc].set(inst_loc);
+    cols[sec_inst_arr_n].set(inst_arr_n);
+    cols[sec_inst_params].set(inst_params);
+    cols[sec_param_counts].set(param_counts);
+    cols[sec_int_param_key].set(int_key);
+    cols[sec_int_param_val].set(int_val);
+    cols[sec_str_param_key].set(str_key);
+    cols[sec_str_param_val].set(str_val);
+    cols[sec_dbl_param_key].set(dbl_key);
+    cols[sec_dbl_param_val].set(dbl_val);
+    cols[sec_rect_lpp].set(layout.rect_list.lpp);
+    cols[sec_rect_bbox].set(layout.rect_list.bbox);
+    cols[sec_rect_arr_n].set(layout.rect_list.arr_n);
+    cols[sec_rect_arr_sp].set(layout.rect_list.arr_sp);
+    cols[sec_via_names].set(via_names);
+    cols[sec_via_id].set(vias.via_id);
+    cols[sec_via_orient].set(vias.orient);
+    cols[sec_via_loc].set(vias.loc);
+    cols[sec_via_cut_n].set(vias.cut_n);
+    cols[sec_via_cut_sp].set(vias.cut_sp);
+    cols[sec_via_enc1].set(vias.enc1);
+    cols[sec_via_enc2].set(vias.enc2);
+    cols[sec_via_cut_size].set(vias.cut_size);
+    cols[sec_via_arr_n].set(vias.arr_n);
+    cols[sec_via_arr_sp].set(vias.arr_sp);
+    cols[sec_pin_lpp].set(pin_lpp);
+    cols[sec_pin_bbox].set(pin_bbox);
+    cols[sec_pin_str].set(pin_str);
+    cols[sec_pin_obj].set(pin_obj);
+    cols[sec_seg_lpp].set(layout.path_seg_list.lpp);
+    cols[sec_seg_pts].set(layout.path_seg_list.pts);
+    cols[sec_seg_width].set(layout.path_seg_list.width);
+    cols[sec_seg_style].set(layout.path_seg_list.style);
+    cols[sec_path_lpp].set(path_lpp);
+    cols[sec_path_pts].set(path_pts);
+    cols[sec_path_width].set(path_width);
+    cols[sec_path_style].set(path_style);
+    cols[sec_poly_lpp].set(poly_lpp);
+    cols[sec_poly_pts].set(poly_pts);
+    cols[sec_block_str].set(block_str);
+    cols[sec_block_pts].set(block_pts);
+    cols[sec_bound_str].set(bound_str);
+    cols[sec_bound_pts].set(bound_pts);
+
+    // lay out the sections, then copy everything in one pass.
+    std::size_t offset = sizeof(LayoutImageHeader)
+            + num_layout_sections * sizeof(LayoutSectionEntry);
+    LayoutSectionEntry dir[num_layout_sections];
+    for (unsigned int sec = 0; sec < num_layout_sections; sec++) {
+        dir[sec].offset = offset;
+        dir[sec].count = cols[sec].count;
+        dir[sec].elem_size = cols[sec].elem_size;
+        dir[sec].reserved = 0;
+        offset += align8(cols[sec].count * cols[sec].elem_size);
+    }
+
+    buf.assign(offset, 0);
+    LayoutImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, image_magic, sizeof(image_magic));
+    header.version = layout_image_version;
+    header.byte_order = image_byte_order;
+    header.dbu_per_uu = layout.get_grid().dbu_per_uu;
+    header.mfg_grid_res = layout.get_grid().mfg_grid_res;
+    header.num_sections = num_layout_sections;
+    std::memcpy(&buf[0], &header, sizeof(header));
+    std::memcpy(&buf[sizeof(header)], dir, sizeof(dir));
+    for (unsigned int sec = 0; sec < num_layout_sections; sec++) {
+        if (cols[sec].count > 0) {
+            std::memcpy(&buf[dir[sec].offset], cols[sec].data,
+                    cols[sec].count * cols[sec].elem_size);
+        }
+    }
+}
+
+void deserialize_layout(const char * data, std::size_t size, Layout & layout) {
+    if (reinterpret_cast<uintptr_t>(data) % 8 == 0) {
+        LayoutImage(data, size).load(layout);
+        return;
+    }
+    // columns are read in place, so copy unaligned data first.
+    std::vector<uint64_t> aligned((size + 7) / 8);
+    std::memcpy(aligned.data(), data, size);
+    LayoutImage(reinterpret_cast<const char *>(aligned.data()), size).load(layout);
+}
+
+void save_layout(const std::string & fname, const Layout & layout) {
+    std::vector<char> buf;
+    serialize_layout(layout, buf);
+    std::ofstream out(fname.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot open layout file: " + fname);
+    }
+    out.write(buf.data(), buf.size());
+    if (!out) {
+        throw std::runtime_error("Error writing layout file: " + fname);
+    }
+}
+
+void load_layout(const std::string & fname, Layout & layout) {
+    MappedLayoutFile file;
+    file.open(fname);
+    file.image().load(layout);
+}
+
+void LayoutImage::reset(const char * new_data, std::size_t new_size) {
+    data = NULL;
+    size = 0;
+    dir = NULL;
+
+    if (reinterpret_cast<uintptr_t>(new_data) % 8 != 0) {
+        throw std::invalid_argument("Layout image must be 8 byte aligned.");
+    }
+    std::size_t dir_end = sizeof(LayoutImageHeader)
+            + num_layout_sections * sizeof(LayoutSectionEntry);
+    if (new_size < sizeof(LayoutImageHeader)) {
+        throw std::invalid_argument("Layout image is truncated.");
+    }
+    const LayoutImageHeader * header = reinterpret_cast<const LayoutImageHeader *>(new_data);
+    if (std::memcmp(header->magic, image_magic, sizeof(image_magic)) != 0) {
+        throw std::invalid_argument("Not a layout image.");
+    }
+    if (header->byte_order != image_byte_order) {
+        throw std::invalid_argument("Layout image has a different byte order.");
+    }
+    if (header->version != layout_image_version || header->num_sections != num_layout_sections) {
+        std::ostringstream os;
+        os << "Unsupported layout image version: " << header->version;
+        throw std::invalid_argument(os.str());
+    }
+    if (new_size < dir_end || header->mfg_grid_res == 0) {
+        throw std::invalid_argument("Corrupt layout image header.");
+    }
+
+    const LayoutSectionEntry * entries = reinterpret_cast<const LayoutSectionEntry *>(
+            new_data + sizeof(LayoutImageHeader));
+    for (unsigned int sec = 0; sec < num_layout_sections; sec++) {
+        const LayoutSectionEntry & entry = entries[sec];
+        if (entry.offset % 8 != 0 || entry.offset < dir_end || entry.offset > new_size
+                || entry.elem_size == 0
+                || entry.count > (new_size - entry.offset) / entry.elem_size) {
+            std::ostringstream os;
+            os << "Corrupt layout image: section " << sec << " is out of bounds.";
+            throw std::invalid_argument(os.str());
+        }
+    }
+
+    data = new_data;
+    size = new_size;
+    dir = entries;
+    grid = Grid(header->dbu_per_uu, header->mfg_grid_res);
+}
+
+std::string LayoutImage::get_string(uint32_t id) const {
+    const uint64_t * offsets = column<uint64_t>(sec_str_offsets);
+    uint64_t start = (id == 0) ? 0 : offsets[id - 1];
+    uint64_t stop = offsets[id];
+    if (stop < start || stop > count(sec_str_chars)) {
+        throw std::invalid_argument("Corrupt layout image: bad string table.");
+    }
+    const char * chars = column<char>(sec_str_chars);
+    return std::string(chars + start, chars + stop);
+}
+
+void LayoutImage::check_count(unsigned int sec, std::size_t expected) const {
+    if (count(sec) != expected) {
+        std::ostringstream os;
+        os << "Corrupt layout image: section " << sec << " has " << count(sec)
+                << " elements, expected " << expected << ".";
+        throw std::invalid_argument(os.str());
+    }
+}
+
+void LayoutImage::check_ids(unsigned int sec, std::size_t limit) const {
+    const uint32_t * ids = column<uint32_t>(sec);
+    for (std::size_t idx = 0; idx < count(sec); idx++) {
+        if (ids[idx] >= limit) {
+            std::ostringstream os;
+            os << "Corrupt layout image: section " << sec << " refers to id " << ids[idx]
+                    << " of " << limit << ".";
+            throw std::invalid_argument(os.str());
+        }
+    }
+}
+
+void LayoutImage::append_coords(unsigned int sec, CoordArray & arr) const {
+    if (grid.is_set()) {
+        arr.append_dbu(column<int32_t>(sec), count(sec));
+    } else {
+        arr.append(column<double>(sec), count(sec));
+    }
+}
+
+void LayoutImage::load(Layout & layout) const {
+    if (empty()) {
+        throw std::invalid_argument("No layout image to load.");
+    }
+
+    // validate everything before touching the layout.
+    std::size_t num_str = count(sec_str_offsets);
+    std::size_t num_lpp = count(sec_lpp) / 2;
+    std::size_t num_inst = count(sec_inst_orient);
+    std::size_t num_sets = count(sec_param_counts) / 3;
+    std::size_t num_rect = count(sec_rect_lpp);
+    std::size_t num_via = count(sec_via_id);
+    std::size_t num_pin = count(sec_pin_lpp);
+    std::size_t num_seg = count(sec_seg_lpp);
+    std::size_t num_path = count(sec_path_lpp);
+    std::size_t num_poly = count(sec_poly_lpp);
+    std::size_t num_block = count(sec_block_str) / 2;
+    std::size_t num_bound = count(sec_bound_str);
+    std::size_t coord_size = grid.is_set() ? sizeof(int32_t) : sizeof(double);
+    const unsigned int coord_secs[] = { sec_points, sec_rect_bbox, sec_rect_arr_sp, sec_via_loc,
+            sec_via_cut_sp, sec_via_enc1, sec_via_enc2, sec_via_cut_size, sec_via_arr_sp,
+            sec_seg_pts, sec_seg_width };
+    for (unsigned int idx = 0; idx < sizeof(coord_secs) / sizeof(coord_secs[0]); idx++) {
+        if (dir[coord_secs[idx]].elem_size != coord_size) {
+            throw std::invalid_argument("Corrupt layout image: coordinate type does not match grid.");
+        }
+    }
+
+    check_count(sec_lpp, 2 * num_lpp);
+    check_count(sec_points, 2 * (count(sec_points) / 2));
+    check_count(sec_inst_str, 4 * num_inst);
+    check_count(sec_inst_loc, 4 * num_inst);
+    check_count(sec_inst_arr_n, 2 * num_inst);
+    check_count(sec_inst_params, num_inst);
+    check_count(sec_param_counts, 3 * num_sets);
+    std::size_t num_params[3] = { 0, 0, 0 };
+    const uint32_t * param_counts = column<uint32_t>(sec_param_counts);
+    for (std::size_t idx = 0; idx < 3 * num_sets; idx++) {
+        num_params[idx % 3] += param_counts[idx];
+    }
+    check_count(sec_int_param_key, num_params[0]);
+    check_count(sec_int_param_val, num_params[0]);
+    check_count(sec_str_param_key, num_params[1]);
+    check_count(sec_str_param_val, num_params[1]);
+    check_count(sec_dbl_param_key, num_params[2]);
+    check_count(sec_dbl_param_val, num_params[2]);
+    check_count(sec_rect_bbox, 4 * num_rect);
+    check_count(sec_rect_arr_n, 2 * num_rect);
+    check_count(sec_rect_arr_sp, 2 * num_rect);
+    check_count(sec_via_orient, num_via);
+    check_count(sec_via_loc, 2 * num_via);
+    check_count(sec_via_cut_n, 2 * num_via);
+    check_count(sec_via_cut_sp, 2 * num_via);
+    check_count(sec_via_enc1, 4 * num_via);
+    check_count(sec_via_enc2, 4 * num_via);
+    check_count(sec_via_cut_size, 2 * num_via);
+    check_count(sec_via_arr_n, 2 * num_via);
+    check_count(sec_via_arr_sp, 2 * num_via);
+    check_count(sec_pin_bbox, 4 * num_pin);
+    check_count(sec_pin_str, 3 * num_pin);
+    check_count(sec_pin_obj, num_pin);
+    check_count(sec_seg_pts, 4 * num_seg);
+    check_count(sec_seg_width, num_seg);
+    check_count(sec_seg_style, 2 * num_seg);
+    check_count(sec_path_pts, 2 * num_path);
+    check_count(sec_path_width, num_path);
+    check_count(sec_path_style, 3 * num_path);
+    check_count(sec_poly_pts, 2 * num_poly);
+    check_count(sec_block_str, 2 * num_block);
+    check_count(sec_block_pts, 2 * num_block);
+    check_count(sec_bound_pts, 2 * num_bound);
+
+    const unsigned int str_secs[] = { sec_lpp, sec_inst_str, sec_int_param_key,
+            sec_str_param_key, sec_str_param_val, sec_dbl_param_key, sec_via_names, sec_pin_str,
+            sec_block_str, sec_bound_str };
+    for (unsigned int idx = 0; idx < sizeof(str_secs) / sizeof(str_secs[0]); idx++) {
+        check_ids(str_secs[idx], num_str);
+    }
+    check_ids(sec_rect_lpp, num_lpp);
+    check_ids(sec_pin_lpp, num_lpp);
+    check_ids(sec_seg_lpp, num_lpp);
+    check_ids(sec_path_lpp, num_lpp);
+    check_ids(sec_poly_lpp, num_lpp);
+    check_ids(sec_via_id, count(sec_via_names));
+    check_ids(sec_inst_params, num_sets);
+
+    // point ranges are offsets into the interleaved arena.
+    std::size_t num_coord = count(sec_points);
+    const unsigned int range_secs[] = { sec_path_pts, sec_poly_pts, sec_block_pts,
+            sec_bound_pts };
+    for (unsigned int idx = 0; idx < sizeof(range_secs) / sizeof(range_secs[0]); idx++) {
+        const uint64_t * ranges = column<uint64_t>(range_secs[idx]);
+        for (std::size_t j = 0; j < count(range_secs[idx]); j += 2) {
+            if (ranges[j + 1] > num_coord / 2 || ranges[j] > num_coord - 2 * ranges[j + 1]) {
+                throw std::invalid_argument("Corrupt layout image: point range out of bounds.");
+            }
+        }
+    }
+
+    // the string table is read on demand, cache it once.
+    std::vector<std::string> strs(num_str);
+    for (std::size_t idx = 0; idx < num_str; idx++) {
+        strs[idx] = get_string((uint32_t) idx);
+    }
+
+    layout = Layout(grid.dbu_per_uu, grid.mfg_grid_res);
+
+    const uint32_t * lpp_str = column<uint32_t>(sec_lpp);
+    for (std::size_t idx = 0; idx < num_lpp; idx++) {
+        layout.get_lpp_id(strs[lpp_str[2 * idx]], strs[lpp_str[2 * idx + 1]]);
+    }
+    if (layout.lpp_table.size() != num_lpp) {
+        throw std::invalid_argument("Corrupt layout image: duplicate layer/purpose pairs.");
+    }
+    append_coords(sec_points, layout.point_arena);
+
+    const uint32_t * int_key = column<uint32_t>(sec_int_param_key);
+    const int32_t * int_val = column<int32_t>(sec_int_param_val);
+    const uint32_t * str_key = column<uint32_t>(sec_str_param_key);
+    const uint32_t * str_val = column<uint32_t>(sec_str_param_val);
+    const uint32_t * dbl_key = column<uint32_t>(sec_dbl_param_key);
+    const double * dbl_val = column<double>(sec_dbl_param_val);
+    for (std::size_t idx = 0; idx < num_sets; idx++) {
+        ParamSet params;
+        for (uint32_t j = 0; j < param_counts[3 * idx]; j++, int_key++, int_val++) {
+            params.int_params[strs[*int_key]] = *int_val;
+        }
+        for (uint32_t j = 0; j < param_counts[3 * idx + 1]; j++, str_key++, str_val++) {
+            params.str_params[strs[*str_key]] = strs[*str_val];
+        }
+        for (uint32_t j = 0; j < param_counts[3 * idx + 2]; j++, dbl_key++, dbl_val++) {
+            params.double_params[strs[*dbl_key]] = *dbl_val;
+        }
+        layout.get_param_id(params);
+    }
+    if (layout.param_table.size() != num_sets) {
+        throw std::invalid_argument("Corrupt layout image: duplicate parameter sets.");
+    }
+
+    const uint32_t * inst_str = column<uint32_t>(sec_inst_str);
+    const unsigned char * inst_orient = column<unsigned char>(sec_inst_orient);
+    const double * inst_loc = column<double>(sec_inst_loc);
+    const int32_t * inst_arr_n = column<int32_t>(sec_inst_arr_n);
+    const uint32_t * inst_params = column<uint32_t>(sec_inst_params);
+    layout.inst_list.resize(num_inst);
+    for (std::size_t idx = 0; idx < num_inst; idx++) {
+        Inst & inst = layout.inst_list[idx];
+        inst.lib_name = strs[inst_str[4 * idx]];
+        inst.cell_name = strs[inst_str[4 * idx + 1]];
+        inst.view_name = strs[inst_str[4 * idx + 2]];
+        inst.inst_name = strs[inst_str[4 * idx + 3]];
+        inst.orient = inst_orient[idx];
+        inst.loc[0] = inst_loc[4 * idx];
+        inst.loc[1] = inst_loc[4 * idx + 1];
+        inst.sp_rows = inst_loc[4 * idx + 2];
+        inst.sp_cols = inst_loc[4 * idx + 3];
+        inst.num_rows = inst_arr_n[2 * idx];
+        inst.num_cols = inst_arr_n[2 * idx + 1];
+        inst.params = inst_params[idx];
+    }
+
+    RectTable & rects = layout.rect_list;
+    const uint32_t * rect_lpp = column<uint32_t>(sec_rect_lpp);
+    const int32_t * rect_arr_n = column<int32_t>(sec_rect_arr_n);
+    rects.lpp.assign(rect_lpp, rect_lpp + num_rect);
+    append_coords(sec_rect_bbox, rects.bbox);
+    rects.arr_n.assign(rect_arr_n, rect_arr_n + 2 * num_rect);
+    append_coords(sec_rect_arr_sp, rects.arr_sp);
+
+    ViaTable & vias = layout.via_list;
+    const uint32_t * via_names = column<uint32_t>(sec_via_names);
+    for (std::size_t idx = 0; idx < count(sec_via_names); idx++) {
+        vias.names.get_id(strs[via_names[idx]]);
+    }
+    if (vias.names.size() != count(sec_via_names)) {
+        throw std::invalid_argument("Corrupt layout image: duplicate via names.");
+    }
+    const uint32_t * via_id = column<uint32_t>(sec_via_id);
+    const unsigned char * via_orient = column<unsigned char>(sec_via_orient);
+    const int32_t * via_cut_n = column<int32_t>(sec_via_cut_n);
+    const int32_t * via_arr_n = column<int32_t>(sec_via_arr_n);
+    vias.via_id.assign(via_id, via_id + num_via);
+    vias.orient.assign(via_orient, via_orient + num_via);
+    append_coords(sec_via_loc, vias.loc);
+    vias.cut_n.assign(via_cut_n, via_cut_n + 2 * num_via);
+    append_coords(sec_via_cut_sp, vias.cut_sp);
+    append_coords(sec_via_enc1, vias.enc1);
+    append_coords(sec_via_enc2, vias.enc2);
+    append_coords(sec_via_cut_size, vias.cut_size);
+    vias.arr_n.assign(via_arr_n, via_arr_n + 2 * num_via);
+    append_coords(sec_via_arr_sp, vias.arr_sp);
+
+    const uint32_t * pin_lpp = column<uint32_t>(sec_pin_lpp);
+    const double * pin_bbox = column<double>(sec_pin_bbox);
+    const uint32_t * pin_str = column<uint32_t>(sec_pin_str);
+    const unsigned char * pin_obj = column<unsigned char>(sec_pin_obj);
+    layout.pin_list.resize(num_pin);
+    for (std::size_t idx = 0; idx < num_pin; idx++) {
+        Pin & pin = layout.pin_list[idx];
+        pin.lpp = pin_lpp[idx];
+        std::copy(pin_bbox + 4 * idx, pin_bbox + 4 * idx + 4, pin.bbox);
+        pin.term_name = strs[pin_str[3 * idx]];
+        pin.pin_name = strs[pin_str[3 * idx + 1]];
+        pin.label = strs[pin_str[3 * idx + 2]];
+        pin.make_pin_obj = (pin_obj[idx] != 0);
+    }
+
+    PathSegTable & segs = layout.path_seg_list;
+    const uint32_t * seg_lpp = column<uint32_t>(sec_seg_lpp);
+    const unsigned char * seg_style = column<unsigned char>(sec_seg_style);
+    segs.lpp.assign(seg_lpp, seg_lpp + num_seg);
+    append_coords(sec_seg_pts, segs.pts);
+    append_coords(sec_seg_width, segs.width);
+    segs.style.assign(seg_style, seg_style + 2 * num_seg);
+
+    const uint32_t * path_lpp = column<uint32_t>(sec_path_lpp);
+    const uint64_t * path_pts = column<uint64_t>(sec_path_pts);
+    const double * path_width = column<double>(sec_path_width);
+    const unsigned char * path_style = column<unsigned char>(sec_path_style);
+    layout.path_list.resize(num_path);
+    for (std::size_t idx = 0; idx < num_path; idx++) {
+        Path & p = layout.path_list[idx];
+        p.lpp = path_lpp[idx];
+        p.points.offset = path_pts[2 * idx];
+        p.points.num_pts = path_pts[2 * idx + 1];
+        p.width = path_width[idx];
+        p.begin_style = path_style[3 * idx];
+        p.end_style = path_style[3 * idx + 1];
+        p.join_style = path_style[3 * idx + 2];
+    }
+
+    const uint32_t * poly_lpp = column<uint32_t>(sec_poly_lpp);
+    const uint64_t * poly_pts = column<uint64_t>(sec_poly_pts);
+    layout.polygon_list.resize(num_poly);
+    for (std::size_t idx = 0; idx < num_poly; idx++) {
+        layout.polygon_list[idx].lpp = poly_lpp[idx];
+        layout.polygon_list[idx].points.offset = poly_pts[2 * idx];
+        layout.polygon_list[idx].points.num_pts = poly_pts[2 * idx + 1];
+    }
+
+    const uint32_t * block_str = column<uint32_t>(sec_block_str);
+    const uint64_t * block_pts = column<uint64_t>(sec_block_pts);
+    layout.block_list.resize(num_block);
+    for (std::size_t idx = 0; idx < num_block; idx++) {
+        layout.block_list[idx].layer = strs[block_str[2 * idx]];
+        layout.block_list[idx].type = strs[block_str[2 * idx + 1]];
+        layout.block_list[idx].points.offset = block_pts[2 * idx];
+        layout.block_list[idx].points.num_pts = block_pts[2 * idx + 1];
+    }
+
+    const uint32_t * bound_str = column<uint32_t>(sec_bound_str);
+    const uint64_t * bound_pts = column<uint64_t>(sec_bound_pts);
+    layout.boundary_list.resize(num_bound);
+    for (std::size_t idx = 0; idx < num_bound; idx++) {
+        layout.boundary_list[idx].type = strs[bound_str[idx]];
+        layout.boundary_list[idx].points.offset = bound_pts[2 * idx];
+        layout.boundary_list[idx].points.num_pts = bound_pts[2 * idx + 1];
+    }
+}
+
+void MappedLayoutFile::open(const std::string & fname) {
+    close();
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open layout file: " + fname);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot read layout file: " + fname);
+    }
+    void * ptr = mmap(NULL, (std::size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        throw std::runtime_error("Cannot map layout file: " + fname);
+    }
+    addr = ptr;
+    length = (std::size_t) st.st_size;
+    try {
+        img.reset(static_cast<const char *>(addr), length);
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+void MappedLayoutFile::close() {
+    if (addr != NULL) {
+        munmap(addr, length);
+        addr = NULL;
+        length = 0;
+        img = LayoutImage();
+    }
+}
+
+}
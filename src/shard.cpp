@@ -0,0 +1,71 @@
+#include <shard.hpp>
+
+namespace bag {
+
+ShardedLayout::ShardedLayout(unsigned int num_shards, unsigned int dbu_per_uu,
+        unsigned int mfg_grid_res) :
+        grid(dbu_per_uu, mfg_grid_res), shards(num_shards, Layout(dbu_per_uu, mfg_grid_res)) {
+    if (num_shards == 0) {
+        throw std::invalid_argument("ShardedLayout: need at least one shard.");
+    }
+}
+
+unsigned int ShardedLayout::get_lpp_id(unsigned int shard, const std::string & lay_name,
+        const std::string & purp_name) {
+    Layout & layout = shards.at(shard);
+    std::lock_guard<std::mutex> lock(lpp_mtx);
+    unsigned int id = lpp_table.get_id(lay_name, purp_name);
+    // bring the shard table up to date in table order, so its ids match.
+    bool valid = layout.lpp_table.size() <= lpp_table.size();
+    for (unsigned int idx = layout.lpp_table.size(); valid && idx < lpp_table.size(); idx++) {
+        const LayerPurpose & lpp = lpp_table[idx];
+        valid = layout.lpp_table.get_id(lpp.layer, lpp.purpose) == idx;
+    }
+    if (!valid || layout.lpp_table[id].layer != lay_name
+            || layout.lpp_table[id].purpose != purp_name) {
+        throw std::logic_error("ShardedLayout: a shard interned layer/purpose ids "
+                "outside the shared table.");
+    }
+    return id;
+}
+
+void ShardedLayout::merge(Layout & layout) {
+    // check instance names first, so a collision leaves the shards intact.
+    std::map<std::string, unsigned int> inst_shard;
+    for (unsigned int idx = 0; idx < shards.size(); idx++) {
+        const InstList & insts = shards[idx].inst_list;
+        for (InstIter it = insts.begin(); it != insts.end(); it++) {
+            std::pair<std::map<std::string, unsigned int>::iterator, bool> ans = inst_shard.insert(
+                    std::make_pair(it->inst_name, idx));
+            if (!ans.second && ans.first->second != idx) {
+                std::ostringstream os;
+                os << "ShardedLayout: instance " << it->inst_name << " is in shards "
+                        << ans.first->second << " and " << idx << ".";
+                throw std::invalid_argument(os.str());
+            }
+        }
+    }
+
+    layout = std::move(shards[0]);
+    shards[0] = Layout(grid.dbu_per_uu, grid.mfg_grid_res);
+    std::size_t num_rects = layout.rect_list.size(), num_vias = layout.via_list.size();
+    std::size_t num_segs = layout.path_seg_list.size(), num_pins = layout.pin_list.size();
+    std::size_t num_pts = layout.point_arena.size() / 2;
+    for (unsigned int idx = 1; idx < shards.size(); idx++) {
+        num_rects += shards[idx].rect_list.size();
+        num_vias += shards[idx].via_list.size();
+        num_segs += shards[idx].path_seg_list.size();
+        num_pins += shards[idx].pin_list.size();
+        num_pts += shards[idx].point_arena.size() / 2;
+    }
+    layout.reserve_rects(num_rects);
+    layout.reserve_vias(num_vias);
+    layout.reserve_path_segs(num_segs);
+    layout.reserve_pins(num_pins);
+    layout.reserve_points(num_pts);
+    for (unsigned int idx = 1; idx < shards.size(); idx++) {
+        layout.splice(shards[idx]);
+    }
+}
+
+}
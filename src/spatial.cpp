@@ -0,0 +1,524 @@
+#include <queue>
+
+#include <spatial.hpp>
+
+namespace bag {
+
+// children per R-tree node.
+const std::size_t rtree_fanout = 16;
+
+// unpacked entries allowed before the tree is repacked, as a fraction of
+// the tree size.
+const std::size_t rtree_min_pending = 256;
+const std::size_t rtree_pending_div = 8;
+
+// 1-D interval test, closed unless strict.
+bool meets(double lo, double hi, double qlo, double qhi, bool strict) {
+    return strict ? (lo < qhi && qlo < hi) : (lo <= qhi && qlo <= hi);
+}
+
+// whether one of n copies of [lo, hi], spaced sp apart, meets [qlo, qhi].
+bool axis_meets(double lo, double hi, int n, double sp, double qlo, double qhi, bool strict) {
+    if (n <= 1 || sp == 0) {
+        return meets(lo, hi, qlo, qhi, strict);
+    }
+    if (sp < 0) {
+        return axis_meets(-hi, -lo, n, -sp, -qhi, -qlo, strict);
+    }
+    // start just before the first copy that can reach qlo
+    double t = (qlo - hi) / sp;
+    int start = (t <= 0) ? 0 : (int) std::min(ceil(t) - 1, (double) n);
+    for (int idx = start; idx < n && lo + idx * sp <= qhi; idx++) {
+        if (meets(lo + idx * sp, hi + idx * sp, qlo, qhi, strict)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// whether a copy of one array meets a copy of another along one axis.
+bool axis_arrays_meet(double lo1, double hi1, int n1, double sp1, double lo2, double hi2,
+        int n2, double sp2, bool strict) {
+    if (n1 > n2) {
+        return axis_arrays_meet(lo2, hi2, n2, sp2, lo1, hi1, n1, sp1, strict);
+    }
+    for (int idx = 0; idx < std::max(n1, 1); idx++) {
+        double off = idx * sp1;
+        if (axis_meets(lo2, hi2, n2, sp2, lo1 + off, hi1 + off, strict)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// distance from p to the nearest of n copies of [lo, hi] spaced sp apart.
+double axis_dist(double lo, double hi, int n, double sp, double p) {
+    int center = 0;
+    if (n > 1 && sp != 0) {
+        double t = floor((p - (lo + hi) / 2) / sp + 0.5);
+        center = (int) std::max(0.0, std::min(t, (double) (n - 1)));
+    }
+    double ans = HUGE_VAL;
+    for (int idx = std::max(center - 1, 0); idx <= std::min(center + 1, std::max(n, 1) - 1);
+            idx++) {
+        double elo = lo + idx * sp;
+        double ehi = hi + idx * sp;
+        ans = std::min(ans, (p < elo) ? elo - p : ((p > ehi) ? p - ehi : 0.0));
+    }
+    return ans;
+}
+
+// bounding box of all copies of an entry.
+void entry_extent(const SpatialEntry & entry, double out[4]) {
+    double dx = (std::max(entry.nx, 1) - 1) * entry.spx;
+    double dy = (std::max(entry.ny, 1) - 1) * entry.spy;
+    out[0] = entry.box[0] + std::min(dx, 0.0);
+    out[1] = entry.box[1] + std::min(dy, 0.0);
+    out[2] = entry.box[2] + std::max(dx, 0.0);
+    out[3] = entry.box[3] + std::max(dy, 0.0);
+}
+
+bool entry_meets(const SpatialEntry & entry, const double box[4], bool strict) {
+    return axis_meets(entry.box[0], entry.box[2], entry.nx, entry.spx, box[0], box[2], strict)
+            && axis_meets(entry.box[1], entry.box[3], entry.ny, entry.spy, box[1], box[3],
+                    strict);
+}
+
+bool entries_overlap(const SpatialEntry & a, const SpatialEntry & b) {
+    // rows and columns of an array are independent, so check each axis.
+    return axis_arrays_meet(a.box[0], a.box[2], a.nx, a.spx, b.box[0], b.box[2], b.nx, b.spx,
+            true)
+            && axis_arrays_meet(a.box[1], a.box[3], a.ny, a.spy, b.box[1], b.box[3], b.ny,
+                    b.spy, true);
+}
+
+double entry_dist(const SpatialEntry & entry, double x, double y) {
+    double dx = axis_dist(entry.box[0], entry.box[2], entry.nx, entry.spx, x);
+    double dy = axis_dist(entry.box[1], entry.box[3], entry.ny, entry.spy, y);
+    return sqrt(dx * dx + dy * dy);
+}
+
+double box_dist(const double * box, double x, double y) {
+    double dx = (x < box[0]) ? box[0] - x : ((x > box[2]) ? x - box[2] : 0.0);
+    double dy = (y < box[1]) ? box[1] - y : ((y > box[3]) ? y - box[3] : 0.0);
+    return sqrt(dx * dx + dy * dy);
+}
+
+void grow_box(double * box, const double * other) {
+    box[0] = std::min(box[0], other[0]);
+    box[1] = std::min(box[1], other[1]);
+    box[2] = std::max(box[2], other[2]);
+    box[3] = std::max(box[3], other[3]);
+}
+
+// an entry position sorted by the center of its extent.
+struct CenterKey {
+    double x, y;
+    std::size_t idx;
+};
+
+bool x_less(const CenterKey & a, const CenterKey & b) {
+    return a.x < b.x;
+}
+
+bool y_less(const CenterKey & a, const CenterKey & b) {
+    return a.y < b.y;
+}
+
+void RTree::clear() {
+    entries.clear();
+    num_packed = 0;
+    levels.clear();
+}
+
+void RTree::add(const SpatialEntry & entry) {
+    push(entry);
+    if (entries.size() - num_packed > std::max(rtree_min_pending, num_packed / rtree_pending_div)) {
+        pack();
+    }
+}
+
+void RTree::pack() {
+    // sort-tile-recursive: sort by x, cut into vertical slices of whole
+    // leaves, and sort each slice by y.
+    std::size_t n = entries.size();
+    levels.clear();
+    num_packed = n;
+    if (n == 0) {
+        // an empty tree has no root node.
+        return;
+    }
+    std::size_t num_leaves = (n + rtree_fanout - 1) / rtree_fanout;
+    std::size_t num_slices = (std::size_t) ceil(sqrt((double) num_leaves));
+    std::size_t slice_size = std::max(num_slices, (std::size_t) 1) * rtree_fanout;
+    std::vector<CenterKey> keys(n);
+    for (std::size_t idx = 0; idx < n; idx++) {
+        double ext[4];
+        entry_extent(entries[idx], ext);
+        keys[idx].x = ext[0] + ext[2];
+        keys[idx].y = ext[1] + ext[3];
+        keys[idx].idx = idx;
+    }
+    std::sort(keys.begin(), keys.end(), x_less);
+    for (std::size_t start = 0; start < n; start += slice_size) {
+        std::sort(keys.begin() + start, keys.begin() + std::min(start + slice_size, n), y_less);
+    }
+    SpatialEntryList sorted(n);
+    for (std::size_t idx = 0; idx < n; idx++) {
+        sorted[idx] = entries[keys[idx].idx];
+    }
+    entries.swap(sorted);
+
+    std::size_t num_nodes = num_leaves;
+    levels.push_back(std::vector<double>(4 * num_nodes));
+    for (std::size_t idx = 0; idx < n; idx++) {
+        double ext[4];
+        entry_extent(entries[idx], ext);
+        double * node = &levels[0][4 * (idx / rtree_fanout)];
+        if (idx % rtree_fanout == 0) {
+            std::copy(ext, ext + 4, node);
+        } else {
+            grow_box(node, ext);
+        }
+    }
+    while (num_nodes > 1) {
+        std::size_t num_parents = (num_nodes + rtree_fanout - 1) / rtree_fanout;
+        levels.push_back(std::vector<double>(4 * num_parents));
+        const std::vector<double> & children = levels[levels.size() - 2];
+        std::vector<double> & parents = levels.back();
+        for (std::size_t idx = 0; idx < num_nodes; idx++) {
+            double * node = &parents[4 * (idx / rtree_fanout)];
+            if (idx % rtree_fanout == 0) {
+                std::copy(&children[4 * idx], &children[4 * idx] + 4, node);
+            } else {
+                grow_box(node, &children[4 * idx]);
+            }
+        }
+        num_nodes = num_parents;
+    }
+}
+
+void RTree::query_node(std::size_t level, std::size_t node, const double box[4], bool strict,
+        std::vector<std::size_t> & out) const {
+    std::size_t start = node * rtree_fanout;
+    if (level == 0) {
+        std::size_t stop = std::min(start + rtree_fanout, num_packed);
+        for (std::size_t idx = start; idx < stop; idx++) {
+            if (entry_meets(entries[idx], box, strict)) {
+                out.push_back(idx);
+            }
+        }
+        return;
+    }
+    const std::vector<double> & children = levels[level - 1];
+    std::size_t stop = std::min(start + rtree_fanout, children.size() / 4);
+    for (std::size_t idx = start; idx < stop; idx++) {
+        const double * child = &children[4 * idx];
+        if (meets(child[0], child[2], box[0], box[2], false)
+                && meets(child[1], child[3], box[1], box[3], false)) {
+            query_node(level - 1, idx, box, strict, out);
+        }
+    }
+}
+
+void RTree::query(const double box[4], bool strict, std::vector<std::size_t> & out) const {
+    if (!levels.empty()) {
+        const double * root = &levels.back()[0];
+        if (meets(root[0], root[2], box[0], box[2], false)
+                && meets(root[1], root[3], box[1], box[3], false)) {
+            query_node(levels.size() - 1, 0, box, strict, out);
+        }
+    }
+    for (std::size_t idx = num_packed; idx < entries.size(); idx++) {
+        if (entry_meets(entries[idx], box, strict)) {
+            out.push_back(idx);
+        }
+    }
+}
+
+// a node or entry to visit in the nearest neighbor search.  level 0 is an
+// entry, level k > 0 is a node in levels[k - 1].
+struct NearestItem {
+    double dist;
+    std::size_t level;
+    std::size_t idx;
+
+    bool operator<(const NearestItem & other) const {
+        // std::priority_queue keeps the largest item on top
+        return dist > other.dist;
+    }
+};
+
+bool RTree::nearest(double x, double y, std::size_t & idx, double & dist) const {
+    dist = HUGE_VAL;
+    for (std::size_t j = num_packed; j < entries.size(); j++) {
+        double d = entry_dist(entries[j], x, y);
+        if (d < dist) {
+            dist = d;
+            idx = j;
+        }
+    }
+
+    // best-first search, stops once no node can hold a closer shape.
+    std::priority_queue<NearestItem> todo;
+    if (!levels.empty()) {
+        NearestItem root = { box_dist(&levels.back()[0], x, y), levels.size(), 0 };
+        todo.push(root);
+    }
+    while (!todo.empty() && todo.top().dist < dist) {
+        NearestItem item = todo.top();
+        todo.pop();
+        if (item.level == 0) {
+            dist = item.dist;
+            idx = item.idx;
+            break;
+        }
+        std::size_t start = item.idx * rtree_fanout;
+        if (item.level == 1) {
+            std::size_t stop = std::min(start + rtree_fanout, num_packed);
+            for (std::size_t j = start; j < stop; j++) {
+                NearestItem child = { entry_dist(entries[j], x, y), 0, j };
+                todo.push(child);
+            }
+        } else {
+            const std::vector<double> & children = levels[item.level - 2];
+            std::size_t stop = std::min(start + rtree_fanout, children.size() / 4);
+            for (std::size_t j = start; j < stop; j++) {
+                NearestItem child = { box_dist(&children[4 * j], x, y), item.level - 1, j };
+                todo.push(child);
+            }
+        }
+    }
+    return dist < HUGE_VAL;
+}
+
+void SpatialIndex::clear() {
+    lpp_trees.clear();
+    via_trees.clear();
+    num_rects = num_vias = num_pins = num_path_segs = num_paths = num_polygons = 0;
+}
+
+void SpatialIndex::build(const Layout & layout) {
+    clear();
+    add_shapes(layout, true);
+    for (std::size_t idx = 0; idx < lpp_trees.size(); idx++) {
+        lpp_trees[idx].pack();
+    }
+    for (std::size_t idx = 0; idx < via_trees.size(); idx++) {
+        via_trees[idx].pack();
+    }
+}
+
+RTree & SpatialIndex::get_tree(SpatialGroup group, unsigned int id) {
+    std::vector<RTree> & trees = (group == group_via) ? via_trees : lpp_trees;
+    if (id >= trees.size()) {
+        trees.resize(id + 1);
+    }
+    return trees[id];
+}
+
+const RTree * SpatialIndex::find_tree(SpatialGroup group, unsigned int id) const {
+    const std::vector<RTree> & trees = (group == group_via) ? via_trees : lpp_trees;
+    return (id < trees.size()) ? &trees[id] : NULL;
+}
+
+// bounding box of num_pts points of the arena, grown by ext.
+void arena_bbox(const CoordArray & arena, const PointRange & points, double ext,
+        double box[4]) {
+    box[0] = box[1] = HUGE_VAL;
+    box[2] = box[3] = -HUGE_VAL;
+    for (std::size_t idx = 0; idx < points.num_pts; idx++) {
+        double x = arena[points.offset + 2 * idx];
+        double y = arena[points.offset + 2 * idx + 1];
+        box[0] = std::min(box[0], x - ext);
+        box[1] = std::min(box[1], y - ext);
+        box[2] = std::max(box[2], x + ext);
+        box[3] = std::max(box[3], y + ext);
+    }
+}
+
+void SpatialIndex::update(const Layout & layout) {
+    if (layout.rect_list.size() < num_rects || layout.via_list.size() < num_vias
+            || layout.pin_list.size() < num_pins || layout.path_seg_list.size() < num_path_segs
+            || layout.path_list.size() < num_paths
+            || layout.polygon_list.size() < num_polygons) {
+        // shapes were removed
+        build(layout);
+    } else {
+        add_shapes(layout, false);
+    }
+}
+
+void SpatialIndex::add_entry(SpatialGroup group, unsigned int id, const SpatialEntry & entry,
+        bool bulk) {
+    RTree & tree = get_tree(group, id);
+    if (bulk) {
+        tree.push(entry);
+    } else {
+        tree.add(entry);
+    }
+}
+
+void SpatialIndex::add_shapes(const Layout & layout, bool bulk) {
+
+    SpatialEntry entry;
+    entry.nx = entry.ny = 1;
+    entry.spx = entry.spy = 0;
+
+    const RectTable & rects = layout.rect_list;
+    entry.ref.kind = kind_rect;
+    for (; num_rects < rects.size(); num_rects++) {
+        std::size_t idx = num_rects;
+        for (unsigned int j = 0; j < 4; j++) {
+            entry.box[j] = rects.bbox[4 * idx + j];
+        }
+        entry.nx = rects.arr_n[2 * idx];
+        entry.ny = rects.arr_n[2 * idx + 1];
+        entry.spx = rects.arr_sp[2 * idx];
+        entry.spy = rects.arr_sp[2 * idx + 1];
+        entry.ref.index = idx;
+        add_entry(group_lpp, rects.lpp[idx], entry, bulk);
+    }
+
+    const ViaTable & vias = layout.via_list;
+    entry.ref.kind = kind_via;
+    for (; num_vias < vias.size(); num_vias++) {
+        // the cut array is centered at the via location; unknown cut sizes
+        // count as zero.
+        std::size_t idx = num_vias;
+        int cut_ny = vias.cut_n[2 * idx];
+        int cut_nx = vias.cut_n[2 * idx + 1];
+        double cut_w = std::max(vias.cut_size[2 * idx], 0.0);
+        double cut_h = std::max(vias.cut_size[2 * idx + 1], 0.0);
+        double arr_w = cut_nx * cut_w + (cut_nx - 1) * vias.cut_sp[2 * idx];
+        double arr_h = cut_ny * cut_h + (cut_ny - 1) * vias.cut_sp[2 * idx + 1];
+        double ext[4];
+        ext[0] = arr_w / 2 + std::max(vias.enc1[4 * idx], vias.enc2[4 * idx]);
+        ext[1] = arr_h / 2 + std::max(vias.enc1[4 * idx + 1], vias.enc2[4 * idx + 1]);
+        ext[2] = arr_w / 2 + std::max(vias.enc1[4 * idx + 2], vias.enc2[4 * idx + 2]);
+        ext[3] = arr_h / 2 + std::max(vias.enc1[4 * idx + 3], vias.enc2[4 * idx + 3]);
+
+        // rotate the corners and keep the bounds
+        const double corners[4][2] = { { -ext[0], -ext[1] }, { ext[2], ext[3] },
+                { -ext[0], ext[3] }, { ext[2], -ext[1] } };
+        double x = vias.loc[2 * idx];
+        double y = vias.loc[2 * idx + 1];
+        entry.box[0] = entry.box[1] = HUGE_VAL;
+        entry.box[2] = entry.box[3] = -HUGE_VAL;
+        for (unsigned int j = 0; j < 4; j++) {
+            double cx = corners[j][0];
+            double cy = corners[j][1];
+            double ox, oy;
+            switch (vias.orient[idx]) {
+            case 1: ox = cx; oy = -cy; break;   // MX
+            case 2: ox = -cx; oy = cy; break;   // MY
+            case 3: ox = -cx; oy = -cy; break;  // R180
+            case 4: ox = -cy; oy = cx; break;   // R90
+            case 5: ox = cy; oy = cx; break;    // MXR90
+            case 6: ox = -cy; oy = -cx; break;  // MYR90
+            case 7: ox = cy; oy = -cx; break;   // R270
+            default: ox = cx; oy = cy;
+            }
+            entry.box[0] = std::min(entry.box[0], x + ox);
+            entry.box[1] = std::min(entry.box[1], y + oy);
+            entry.box[2] = std::max(entry.box[2], x + ox);
+            entry.box[3] = std::max(entry.box[3], y + oy);
+        }
+        entry.nx = vias.arr_n[2 * idx];
+        entry.ny = vias.arr_n[2 * idx + 1];
+        entry.spx = vias.arr_sp[2 * idx];
+        entry.spy = vias.arr_sp[2 * idx + 1];
+        entry.ref.index = idx;
+        add_entry(group_via, vias.via_id[idx], entry, bulk);
+    }
+
+    // the remaining shapes are not arrayed
+    entry.nx = entry.ny = 1;
+    entry.spx = entry.spy = 0;
+
+    entry.ref.kind = kind_pin;
+    for (; num_pins < layout.pin_list.size(); num_pins++) {
+        const Pin & pin = layout.pin_list[num_pins];
+        std::copy(pin.bbox, pin.bbox + 4, entry.box);
+        entry.ref.index = num_pins;
+        add_entry(group_lpp, pin.lpp, entry, bulk);
+    }
+
+    const PathSegTable & segs = layout.path_seg_list;
+    entry.ref.kind = kind_path_seg;
+    for (; num_path_segs < segs.size(); num_path_segs++) {
+        // half the width covers every end style
+        std::size_t idx = num_path_segs;
+        double ext = segs.width[idx] / 2;
+        entry.box[0] = std::min(segs.pts[4 * idx], segs.pts[4 * idx + 2]) - ext;
+        entry.box[1] = std::min(segs.pts[4 * idx + 1], segs.pts[4 * idx + 3]) - ext;
+        entry.box[2] = std::max(segs.pts[4 * idx], segs.pts[4 * idx + 2]) + ext;
+        entry.box[3] = std::max(segs.pts[4 * idx + 1], segs.pts[4 * idx + 3]) + ext;
+        entry.ref.index = idx;
+        add_entry(group_lpp, segs.lpp[idx], entry, bulk);
+    }
+
+    entry.ref.kind = kind_path;
+    for (; num_paths < layout.path_list.size(); num_paths++) {
+        const Path & path = layout.path_list[num_paths];
+        arena_bbox(layout.point_arena, path.points, path.width / 2, entry.box);
+        entry.ref.index = num_paths;
+        add_entry(group_lpp, path.lpp, entry, bulk);
+    }
+
+    entry.ref.kind = kind_polygon;
+    for (; num_polygons < layout.polygon_list.size(); num_polygons++) {
+        const Polygon & poly = layout.polygon_list[num_polygons];
+        arena_bbox(layout.point_arena, poly.points, 0.0, entry.box);
+        entry.ref.index = num_polygons;
+        add_entry(group_lpp, poly.lpp, entry, bulk);
+    }
+}
+
+void SpatialIndex::query_box(SpatialGroup group, unsigned int id, const double box[4],
+        ShapeRefList & out) const {
+    const RTree * tree = find_tree(group, id);
+    if (tree == NULL) {
+        return;
+    }
+    std::vector<std::size_t> hits;
+    tree->query(box, false, hits);
+    for (std::size_t idx = 0; idx < hits.size(); idx++) {
+        out.push_back((*tree)[hits[idx]].ref);
+    }
+}
+
+bool SpatialIndex::nearest(SpatialGroup group, unsigned int id, double x, double y,
+        ShapeRef & out, double & dist) const {
+    const RTree * tree = find_tree(group, id);
+    std::size_t idx;
+    if (tree == NULL || !tree->nearest(x, y, idx, dist)) {
+        return false;
+    }
+    out = (*tree)[idx].ref;
+    return true;
+}
+
+void SpatialIndex::overlap_pairs(SpatialGroup group, unsigned int id,
+        ShapePairList & out) const {
+    const RTree * tree = find_tree(group, id);
+    if (tree == NULL) {
+        return;
+    }
+    std::vector<std::size_t> hits;
+    for (std::size_t idx = 0; idx < tree->size(); idx++) {
+        const SpatialEntry & entry = (*tree)[idx];
+        double ext[4];
+        entry_extent(entry, ext);
+        hits.clear();
+        tree->query(ext, true, hits);
+        for (std::size_t j = 0; j < hits.size(); j++) {
+            // report each pair once
+            if (hits[j] > idx && entries_overlap(entry, (*tree)[hits[j]])) {
+                out.push_back(std::make_pair(entry.ref, (*tree)[hits[j]].ref));
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,252 @@
+#include <bag.hpp>
+
+namespace bag {
+
+void RectTable::set_grid(const Grid & grid) {
+    bbox.set_grid(grid);
+    arr_sp.set_grid(grid);
+}
+
+void RectTable::reserve(std::size_t n) {
+    lpp.reserve(n);
+    bbox.reserve(4 * n);
+    arr_n.reserve(2 * n);
+    arr_sp.reserve(2 * n);
+}
+
+void RectTable::clear() {
+    lpp.clear();
+    bbox.clear();
+    arr_n.clear();
+    arr_sp.clear();
+}
+
+std::size_t RectTable::append(unsigned int lpp_id, std::size_t n, const double * box,
+        const int * nx, const int * ny, const double * sp) {
+    // coordinates first, so a rejected one leaves the columns as they were.
+    std::size_t num_rows = lpp.size();
+    std::size_t num_off = bbox.append(box, 4 * n);
+    try {
+        if (sp == NULL) {
+            std::vector<double> zeros(2 * n, 0.0);
+            num_off += arr_sp.append(zeros.data(), 2 * n);
+        } else {
+            num_off += arr_sp.append(sp, 2 * n);
+        }
+    } catch (...) {
+        bbox.truncate(4 * num_rows);
+        throw;
+    }
+    lpp.insert(lpp.end(), n, lpp_id);
+
+    std::size_t start = arr_n.size();
+    arr_n.resize(start + 2 * n);
+    for (std::size_t idx = 0; idx < n; idx++) {
+        arr_n[start + 2 * idx] = (nx == NULL) ? 1 : nx[idx];
+        arr_n[start + 2 * idx + 1] = (ny == NULL) ? 1 : ny[idx];
+    }
+    return num_off;
+}
+
+void RectTable::append(const RectTable & other) {
+    lpp.insert(lpp.end(), other.lpp.begin(), other.lpp.end());
+    bbox.append(other.bbox);
+    arr_n.insert(arr_n.end(), other.arr_n.begin(), other.arr_n.end());
+    arr_sp.append(other.arr_sp);
+}
+
+Rect RectTable::operator[](std::size_t idx) const {
+    Rect r;
+    r.lpp = lpp[idx];
+    for (unsigned int j = 0; j < 4; j++) {
+        r.bbox[j] = bbox[4 * idx + j];
+    }
+    r.nx = arr_n[2 * idx];
+    r.ny = arr_n[2 * idx + 1];
+    r.spx = arr_sp[2 * idx];
+    r.spy = arr_sp[2 * idx + 1];
+    return r;
+}
+
+void PathSegTable::set_grid(const Grid & grid) {
+    pts.set_grid(grid);
+    width.set_grid(grid);
+}
+
+void PathSegTable::reserve(std::size_t n) {
+    lpp.reserve(n);
+    pts.reserve(4 * n);
+    width.reserve(n);
+    style.reserve(2 * n);
+}
+
+void PathSegTable::clear() {
+    lpp.clear();
+    pts.clear();
+    width.clear();
+    style.clear();
+}
+
+std::size_t PathSegTable::push_back(unsigned int lpp_id, const double seg_pts[4], double w,
+        unsigned char begin_style, unsigned char end_style) {
+    std::size_t num_off = pts.append(seg_pts, 4);
+    try {
+        num_off += width.append(&w, 1);
+    } catch (...) {
+        pts.truncate(4 * lpp.size());
+        throw;
+    }
+    lpp.push_back(lpp_id);
+    style.push_back(begin_style);
+    style.push_back(end_style);
+    return num_off;
+}
+
+void PathSegTable::append(const PathSegTable & other) {
+    lpp.insert(lpp.end(), other.lpp.begin(), other.lpp.end());
+    pts.append(other.pts);
+    width.append(other.width);
+    style.insert(style.end(), other.style.begin(), other.style.end());
+}
+
+PathSeg PathSegTable::operator[](std::size_t idx) const {
+    PathSeg p;
+    p.lpp = lpp[idx];
+    p.x0 = pts[4 * idx];
+    p.y0 = pts[4 * idx + 1];
+    p.x1 = pts[4 * idx + 2];
+    p.y1 = pts[4 * idx + 3];
+    p.width = width[idx];
+    p.begin_style = get_end_style_name(style[2 * idx]);
+    p.end_style = get_end_style_name(style[2 * idx + 1]);
+    return p;
+}
+
+void ViaTable::set_grid(const Grid & grid) {
+    loc.set_grid(grid);
+    cut_sp.set_grid(grid);
+    enc1.set_grid(grid);
+    enc2.set_grid(grid);
+    cut_size.set_grid(grid);
+    arr_sp.set_grid(grid);
+}
+
+void ViaTable::reserve(std::size_t n) {
+    via_id.reserve(n);
+    orient.reserve(n);
+    loc.reserve(2 * n);
+    cut_n.reserve(2 * n);
+    cut_sp.reserve(2 * n);
+    enc1.reserve(4 * n);
+    enc2.reserve(4 * n);
+    cut_size.reserve(2 * n);
+    arr_n.reserve(2 * n);
+    arr_sp.reserve(2 * n);
+}
+
+void ViaTable::clear() {
+    via_id.clear();
+    orient.clear();
+    loc.clear();
+    cut_n.clear();
+    cut_sp.clear();
+    enc1.clear();
+    enc2.clear();
+    cut_size.clear();
+    arr_n.clear();
+    arr_sp.clear();
+}
+
+std::size_t ViaTable::push_back(unsigned int id, unsigned char orient_code, const double xy[2],
+        int num_rows, int num_cols, const double sp[2], const double e1[4], const double e2[4],
+        const double cut[2], int nx, int ny, const double asp[2]) {
+    std::size_t num_off = 0;
+    std::size_t n = via_id.size();
+    try {
+        num_off += loc.append(xy, 2);
+        num_off += cut_sp.append(sp, 2);
+        num_off += enc1.append(e1, 4);
+        num_off += enc2.append(e2, 4);
+        num_off += arr_sp.append(asp, 2);
+        // a negative cut size selects the technology default and is not a coordinate.
+        cut_size.append(cut, 2);
+    } catch (...) {
+        // leave the columns as they were
+        loc.truncate(2 * n);
+        cut_sp.truncate(2 * n);
+        enc1.truncate(4 * n);
+        enc2.truncate(4 * n);
+        arr_sp.truncate(2 * n);
+        cut_size.truncate(2 * n);
+        throw;
+    }
+    via_id.push_back(id);
+    orient.push_back(orient_code);
+    cut_n.push_back(num_rows);
+    cut_n.push_back(num_cols);
+    arr_n.push_back(nx);
+    arr_n.push_back(ny);
+    return num_off;
+}
+
+void ViaTable::append(const ViaTable & other) {
+    std::size_t start = via_id.size();
+    via_id.insert(via_id.end(), other.via_id.begin(), other.via_id.end());
+    // rewrite the new ids only if other interned its names differently.
+    std::vector<unsigned int> id_map(other.names.size());
+    bool same = true;
+    for (unsigned int idx = 0; idx < other.names.size(); idx++) {
+        id_map[idx] = names.get_id(other.names[idx]);
+        same = same && id_map[idx] == idx;
+    }
+    if (!same) {
+        for (std::size_t idx = start; idx < via_id.size(); idx++) {
+            via_id[idx] = id_map[via_id[idx]];
+        }
+    }
+
+    orient.insert(orient.end(), other.orient.begin(), other.orient.end());
+    loc.append(other.loc);
+    cut_n.insert(cut_n.end(), other.cut_n.begin(), other.cut_n.end());
+    cut_sp.append(other.cut_sp);
+    enc1.append(other.enc1);
+    enc2.append(other.enc2);
+    cut_size.append(other.cut_size);
+    arr_n.insert(arr_n.end(), other.arr_n.begin(), other.arr_n.end());
+    arr_sp.append(other.arr_sp);
+}
+
+Via ViaTable::operator[](std::size_t idx) const {
+    Via v;
+    v.via_id = names[via_id[idx]];
+    v.orient = orient[idx];
+    v.loc[0] = loc[2 * idx];
+    v.loc[1] = loc[2 * idx + 1];
+    v.num_rows = cut_n[2 * idx];
+    v.num_cols = cut_n[2 * idx + 1];
+    v.spacing[0] = cut_sp[2 * idx];
+    v.spacing[1] = cut_sp[2 * idx + 1];
+
+    double e1[4], e2[4];
+    for (unsigned int j = 0; j < 4; j++) {
+        e1[j] = enc1[4 * idx + j];
+        e2[j] = enc2[4 * idx + j];
+    }
+    v.enc1[0] = (e1[2] + e1[0]) / 2.0;
+    v.enc1[1] = (e1[3] + e1[1]) / 2.0;
+    v.off1[0] = (e1[2] - e1[0]) / 2.0;
+    v.off1[1] = (e1[3] - e1[1]) / 2.0;
+    v.enc2[0] = (e2[2] + e2[0]) / 2.0;
+    v.enc2[1] = (e2[3] + e2[1]) / 2.0;
+    v.off2[0] = (e2[2] - e2[0]) / 2.0;
+    v.off2[1] = (e2[3] - e2[1]) / 2.0;
+    v.cut_width = cut_size[2 * idx];
+    v.cut_height = cut_size[2 * idx + 1];
+    v.nx = arr_n[2 * idx];
+    v.ny = arr_n[2 * idx + 1];
+    v.spx = arr_sp[2 * idx];
+    v.spy = arr_sp[2 * idx + 1];
+    return v;
+}
+
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <chrono>
+
+#include "bagoa.hpp"
+
+// writes rectangle and via arrays of increasing size to OA, both as one
+// array record and as separate shapes, and reports the write time.
+//
+// usage: bench_arrays <lib_file> <library> <lib_path> <tech_lib> <layer> <via>
+
+typedef std::chrono::steady_clock Clock;
+
+const unsigned int array_sizes[] = { 1, 16, 256 };
+const double pitch = 0.2;
+
+double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void add_rect_array(bag::Layout & layout, const std::string & layer, unsigned int n,
+        bool expand) {
+    if (!expand) {
+        layout.add_rect(layer, "drawing", 0.0, 0.0, 0.1, 0.1, n, n, pitch, pitch);
+        return;
+    }
+    for (unsigned int i = 0; i < n; i++) {
+        for (unsigned int j = 0; j < n; j++) {
+            double x = i * pitch;
+            double y = j * pitch;
+            layout.add_rect(layer, "drawing", x, y, x + 0.1, y + 0.1);
+        }
+    }
+}
+
+void add_via_array(bag::Layout & layout, const std::string & via, unsigned int n, bool expand) {
+    unsigned int nx = expand ? 1 : n;
+    unsigned int num = expand ? n : 1;
+    for (unsigned int i = 0; i < num; i++) {
+        for (unsigned int j = 0; j < num; j++) {
+            layout.add_via(via, i * pitch, j * pitch, "R0", 1, 1, 0.0, 0.0, 0.01, 0.01, 0.01,
+                    0.01, 0.01, 0.01, 0.01, 0.01, -1, -1, nx, nx, pitch, pitch);
+        }
+    }
+}
+
+void run(bagoa::OALayoutLibrary & lib, const std::string & kind, unsigned int n, bool expand,
+        const bag::Layout & layout) {
+    std::ostringstream cell;
+    cell << "bench_" << kind << "_" << n << "x" << n << (expand ? "_flat" : "");
+    Clock::time_point start = Clock::now();
+    lib.create_layout(cell.str(), "layout", layout);
+    double ms = elapsed_ms(start);
+    std::cout << std::left << std::setw(28) << cell.str() << std::right << std::setw(10)
+            << n * n << " shapes" << std::setw(12) << std::fixed << std::setprecision(2) << ms
+            << " ms" << std::endl;
+}
+
+int main(int argc, char * argv[]) {
+    if (argc < 7) {
+        std::cerr << "usage: " << argv[0]
+                << " <lib_file> <library> <lib_path> <tech_lib> <layer> <via>" << std::endl;
+        return 1;
+    }
+    std::string layer = argv[5];
+    std::string via = argv[6];
+
+    try {
+        bagoa::OALayoutLibrary lib;
+        lib.open_library(argv[1], argv[2], argv[3], argv[4]);
+        lib.set_skip_unchanged(false);
+        for (unsigned int idx = 0; idx < sizeof(array_sizes) / sizeof(array_sizes[0]); idx++) {
+            unsigned int n = array_sizes[idx];
+            for (unsigned int expand = 0; expand < 2; expand++) {
+                bag::Layout rects;
+                add_rect_array(rects, layer, n, expand != 0);
+                run(lib, "rect", n, expand != 0, rects);
+
+                bag::Layout vias;
+                add_via_array(vias, via, n, expand != 0);
+                run(lib, "via", n, expand != 0, vias);
+            }
+        }
+        lib.close();
+    } catch (std::exception & ex) {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
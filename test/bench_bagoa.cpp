@@ -0,0 +1,254 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <malloc.h>
+#include <sys/resource.h>
+
+#include "bagoa.hpp"
+
+// builds synthetic layouts of increasing size and writes them through
+// OALayoutLibrary.  Built against the recording OA stub in test/oastub, so
+// no OA install is needed and the write time is the cost of bagoa itself.
+// Reports shapes/sec of Layout::add_* and create_layout, heap allocations,
+// peak heap and peak RSS.
+//
+// usage: bench_bagoa [max_shapes]
+
+typedef std::chrono::steady_clock Clock;
+
+// heap counters, updated by the global allocation functions below.  delete
+// is kept out of line so the compiler does not match the free() inside it
+// against callers' new expressions.
+std::atomic<std::size_t> num_allocs(0);
+std::atomic<std::size_t> heap_bytes(0);
+std::atomic<std::size_t> heap_peak(0);
+
+void * operator new(std::size_t size) {
+    void * ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == NULL) {
+        throw std::bad_alloc();
+    }
+    num_allocs++;
+    std::size_t cur = heap_bytes += malloc_usable_size(ptr);
+    std::size_t peak = heap_peak.load();
+    while (cur > peak && !heap_peak.compare_exchange_weak(peak, cur)) {
+    }
+    return ptr;
+}
+
+__attribute__((noinline)) void operator delete(void * ptr) noexcept {
+    if (ptr != NULL) {
+        heap_bytes -= malloc_usable_size(ptr);
+        free(ptr);
+    }
+}
+
+void operator delete(void * ptr, std::size_t) noexcept {
+    operator delete(ptr);
+}
+
+void * operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void * ptr) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete[](void * ptr, std::size_t) noexcept {
+    operator delete(ptr);
+}
+
+double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double peak_rss_mb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// number of OA figures and nets created since the last reset, not counting
+// design opens, saves and properties.
+std::size_t num_oa_shapes() {
+    std::size_t total = 0;
+    for (unsigned int idx = 0; idx < oa::stub::num_calls; idx++) {
+        if (idx != oa::stub::call_design_open && idx != oa::stub::call_design_save
+                && idx != oa::stub::call_prop) {
+            total += oa::stub::counts()[idx];
+        }
+    }
+    return total;
+}
+
+const double pitch = 0.2;
+const unsigned int row_len = 1000;
+
+// 4x4 rectangle arrays on a grid.
+void add_rect_arrays(bag::Layout & layout, std::size_t num_shapes) {
+    unsigned int lpp = layout.get_lpp_id("M1", "drawing");
+    for (std::size_t idx = 0; idx < num_shapes / 16; idx++) {
+        double x = (idx % row_len) * 4 * pitch;
+        double y = (idx / row_len) * 4 * pitch;
+        layout.add_rect(lpp, x, y, x + 0.1, y + 0.1, 4, 4, pitch, pitch);
+    }
+}
+
+// 2x2 via arrays of 2x2 cut vias on a grid.
+void add_via_arrays(bag::Layout & layout, std::size_t num_shapes) {
+    for (std::size_t idx = 0; idx < num_shapes / 4; idx++) {
+        double x = (idx % row_len) * 2 * pitch;
+        double y = (idx / row_len) * 2 * pitch;
+        layout.add_via("M1_M2", x, y, "R0", 2, 2, 0.05, 0.05, 0.01, 0.02, 0.01, 0.02, 0.02,
+                0.01, 0.02, 0.01, -1, -1, 2, 2, pitch, pitch);
+    }
+}
+
+// dense routing: L-shaped wires alternating between two layers, with a via
+// at each corner and end.
+void add_routing(bag::Layout & layout, std::size_t num_shapes) {
+    unsigned int lpp[2] = { layout.get_lpp_id("M2", "drawing"), layout.get_lpp_id("M3",
+            "drawing") };
+    double xy[8];
+    for (std::size_t idx = 0; idx < num_shapes / 3; idx++) {
+        double x = (idx % row_len) * 0.1;
+        double y = (idx / row_len) * 0.1;
+        xy[0] = x;
+        xy[1] = y;
+        xy[2] = x + 2.0;
+        xy[3] = y;
+        xy[4] = x + 2.0;
+        xy[5] = y + 1.0;
+        xy[6] = x + 3.0;
+        xy[7] = y + 1.0;
+        layout.add_path(lpp[idx % 2], 4, xy, 0.04, "extend", "extend", "extend");
+        layout.add_via("M2_M3", xy[0], xy[1], "R0", 1, 1, 0.05, 0.05, 0.01, 0.02, 0.01, 0.02,
+                0.02, 0.01, 0.02, 0.01);
+        layout.add_via("M2_M3", xy[6], xy[7], "R90", 1, 1, 0.05, 0.05, 0.01, 0.02, 0.01, 0.02,
+                0.02, 0.01, 0.02, 0.01);
+    }
+}
+
+// rows of parameterized instances drawn from a few masters and parameter sets.
+void add_inst_rows(bag::Layout & layout, std::size_t num_shapes) {
+    const char * cells[] = { "nmos4", "pmos4", "res", "cap" };
+    unsigned int params[8];
+    for (unsigned int idx = 0; idx < 8; idx++) {
+        bag::ParamSet par;
+        par.int_params["nf"] = 2 + idx;
+        par.double_params["l"] = 1e-8 * (idx % 2 + 1);
+        par.str_params["model"] = idx < 4 ? "nch" : "pch";
+        params[idx] = layout.get_param_id(par);
+    }
+    for (std::size_t idx = 0; idx < num_shapes; idx++) {
+        std::ostringstream name;
+        name << "X" << idx;
+        double x = (idx % row_len) * 0.5;
+        double y = (idx / row_len) * 2.0;
+        layout.add_inst("bench_lib", cells[idx % 4], "layout", name.str(), x, y,
+                idx % 2 == 0 ? "R0" : "MY", params[idx % 8]);
+    }
+}
+
+// 1000-point staircase polygons.
+void add_polygons(bag::Layout & layout, std::size_t num_shapes) {
+    const std::size_t num_pts = 1000;
+    unsigned int lpp = layout.get_lpp_id("M4", "drawing");
+    std::vector<double> xy(2 * num_pts);
+    for (std::size_t idx = 0; idx < num_shapes / num_pts; idx++) {
+        double x0 = (idx % row_len) * 60.0;
+        double y0 = (idx / row_len) * 60.0;
+        // a staircase up and to the right, closed below its first step
+        std::size_t num_steps = num_pts - 2;
+        for (std::size_t j = 0; j < num_steps; j++) {
+            xy[2 * j] = x0 + (j + 1) / 2 * 0.1;
+            xy[2 * j + 1] = y0 + j / 2 * 0.1;
+        }
+        xy[2 * num_steps] = xy[2 * num_steps - 2];
+        xy[2 * num_steps + 1] = y0 - 1.0;
+        xy[2 * num_steps + 2] = x0;
+        xy[2 * num_steps + 3] = y0 - 1.0;
+        layout.add_polygon(lpp, num_pts, xy.data());
+    }
+}
+
+typedef void (*Workload)(bag::Layout &, std::size_t);
+
+struct Bench {
+    const char * name;
+    Workload fill;
+};
+
+const Bench benches[] = {
+    { "rect_arrays", add_rect_arrays },
+    { "via_arrays", add_via_arrays },
+    { "routing", add_routing },
+    { "inst_rows", add_inst_rows },
+    { "polygons", add_polygons },
+};
+
+void run(bagoa::OALayoutLibrary & lib, const Bench & bench, std::size_t num_shapes) {
+    std::size_t allocs0 = num_allocs.load();
+    heap_peak.store(heap_bytes.load());
+    std::size_t heap0 = heap_bytes.load();
+
+    Clock::time_point start = Clock::now();
+    bag::Layout layout;
+    bench.fill(layout, num_shapes);
+    double build_ms = elapsed_ms(start);
+
+    std::ostringstream cell;
+    cell << "bench_" << bench.name << "_" << num_shapes;
+    oa::stub::reset();
+    start = Clock::now();
+    lib.create_layout(cell.str(), "layout", layout);
+    double write_ms = elapsed_ms(start);
+
+    // shapes/sec from add_* to the last OA object
+    std::size_t drawn = num_oa_shapes();
+    double rate = drawn / ((build_ms + write_ms) * 1e-3);
+    std::cout << std::left << std::setw(24) << cell.str() << std::right << std::setw(10)
+            << drawn << " OA objs" << std::fixed << std::setprecision(1) << std::setw(10)
+            << build_ms << " ms build" << std::setw(10) << write_ms << " ms write"
+            << std::setw(12) << std::setprecision(0) << rate << " /s" << std::setw(10)
+            << num_allocs.load() - allocs0 << " allocs" << std::setprecision(1) << std::setw(9)
+            << (heap_peak.load() - heap0) / 1048576.0 << " MB heap" << std::setw(9)
+            << peak_rss_mb() << " MB rss" << std::endl;
+}
+
+int main(int argc, char * argv[]) {
+    std::size_t max_shapes = 1000000;
+    if (argc > 1) {
+        max_shapes = strtoul(argv[1], NULL, 10);
+    }
+    std::size_t sizes[] = { max_shapes / 100, max_shapes / 10, max_shapes };
+
+    try {
+        bagoa::OALayoutLibrary lib;
+        lib.open_library("./cds.lib", "bench_lib", "./bench_lib", "bench_tech");
+        lib.set_skip_unchanged(false);
+        const char * layers[] = { "M1", "M2", "M3", "M4" };
+        for (unsigned int idx = 0; idx < 4; idx++) {
+            lib.add_layer(layers[idx], idx + 1);
+        }
+        lib.add_purpose("drawing", 0);
+
+        for (unsigned int idx = 0; idx < sizeof(benches) / sizeof(benches[0]); idx++) {
+            for (unsigned int j = 0; j < 3; j++) {
+                run(lib, benches[idx], sizes[j]);
+            }
+        }
+        lib.close();
+    } catch (std::exception & ex) {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <stdlib.h>
+
+#include "bag.hpp"
+#include "shard.hpp"
+
+// compares one-struct-per-shape storage against the columnar bag::Layout
+// tables, in user units and in database units.  The iteration pass computes
+// the bounding box of all shapes.  Also times building one layout from
+// several threads with ShardedLayout.
+
+typedef std::chrono::steady_clock Clock;
+
+const std::size_t num_shapes = 1000000;
+
+double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template<typename T>
+std::size_t vec_bytes(const std::vector<T> & vec) {
+    return vec.capacity() * sizeof(T);
+}
+
+std::size_t coord_bytes(const bag::CoordArray & arr) {
+    return arr.is_dbu() ? arr.size() * sizeof(int32_t) : arr.size() * sizeof(double);
+}
+
+std::size_t rect_table_bytes(const bag::RectTable & tab) {
+    return vec_bytes(tab.lpp) + coord_bytes(tab.bbox) + vec_bytes(tab.arr_n)
+            + coord_bytes(tab.arr_sp);
+}
+
+std::size_t via_table_bytes(const bag::ViaTable & tab) {
+    return vec_bytes(tab.via_id) + vec_bytes(tab.orient) + coord_bytes(tab.loc)
+            + vec_bytes(tab.cut_n) + coord_bytes(tab.cut_sp) + coord_bytes(tab.enc1)
+            + coord_bytes(tab.enc2) + coord_bytes(tab.cut_size) + vec_bytes(tab.arr_n)
+            + coord_bytes(tab.arr_sp);
+}
+
+// via records also own a heap string per via for names too long for SSO.
+std::size_t via_list_bytes(const bag::ViaList & vias) {
+    std::size_t total = vec_bytes(vias);
+    for (bag::ViaIter it = vias.begin(); it != vias.end(); it++) {
+        if (it->via_id.capacity() > 15) {
+            total += it->via_id.capacity() + 1;
+        }
+    }
+    return total;
+}
+
+void report(const std::string & name, std::size_t bytes, double build_ms, double iter_ms,
+        double checksum) {
+    std::cout << std::left << std::setw(24) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(1) << bytes / 1048576.0 << " MB"
+            << std::setw(10) << build_ms << " ms build"
+            << std::setw(10) << iter_ms << " ms iterate"
+            << "  (checksum " << std::setprecision(3) << checksum << ")" << std::endl;
+}
+
+int main(int argc, char * argv[]) {
+    srand(0);
+    std::vector<double> box(4 * num_shapes);
+    std::vector<double> loc(2 * num_shapes);
+    for (std::size_t idx = 0; idx < num_shapes; idx++) {
+        double x = (rand() % 100000) * 0.005;
+        double y = (rand() % 100000) * 0.005;
+        box[4 * idx] = x;
+        box[4 * idx + 1] = y;
+        box[4 * idx + 2] = x + 0.1;
+        box[4 * idx + 3] = y + 0.05;
+        loc[2 * idx] = x;
+        loc[2 * idx + 1] = y;
+    }
+    const std::string via_name("M1_M2_VIA_DEFAULT_CUT");
+    double sp[2] = { 0.05, 0.05 };
+    double enc[4] = { 0.01, 0.02, 0.01, 0.02 };
+
+    std::cout << "rects: " << num_shapes << std::endl;
+    {
+        Clock::time_point start = Clock::now();
+        bag::RectList rects;
+        for (std::size_t idx = 0; idx < num_shapes; idx++) {
+            bag::Rect r;
+            r.lpp = 0;
+            for (unsigned int j = 0; j < 4; j++) {
+                r.bbox[j] = box[4 * idx + j];
+            }
+            r.nx = r.ny = 1;
+            r.spx = r.spy = 0;
+            rects.push_back(r);
+        }
+        double build_ms = elapsed_ms(start);
+
+        start = Clock::now();
+        double xl = HUGE_VAL, xr = -HUGE_VAL;
+        for (bag::RectIter it = rects.begin(); it != rects.end(); it++) {
+            xl = std::min(xl, it->bbox[0]);
+            xr = std::max(xr, it->bbox[2]);
+        }
+        report("RectList", vec_bytes(rects), build_ms, elapsed_ms(start), xr - xl);
+    }
+    for (unsigned int dbu = 0; dbu <= 1000; dbu += 1000) {
+        Clock::time_point start = Clock::now();
+        bag::Layout layout(dbu, 1);
+        unsigned int lpp = layout.get_lpp_id("M1", "drawing");
+        layout.add_rects(lpp, num_shapes, box.data());
+        double build_ms = elapsed_ms(start);
+
+        start = Clock::now();
+        double bbox[4];
+        layout.get_bbox(bbox);
+        double iter_ms = elapsed_ms(start);
+        report(dbu == 0 ? "RectTable (float)" : "RectTable (dbu)",
+                rect_table_bytes(layout.rect_list), build_ms, iter_ms, bbox[2] - bbox[0]);
+    }
+
+    std::cout << "vias: " << num_shapes << std::endl;
+    {
+        Clock::time_point start = Clock::now();
+        bag::ViaList vias;
+        for (std::size_t idx = 0; idx < num_shapes; idx++) {
+            bag::Via v;
+            v.via_id = via_name;
+            v.orient = 0;
+            v.loc[0] = loc[2 * idx];
+            v.loc[1] = loc[2 * idx + 1];
+            v.num_rows = v.num_cols = 1;
+            v.spacing[0] = v.spacing[1] = sp[0];
+            v.enc1[0] = v.enc1[1] = v.enc2[0] = v.enc2[1] = enc[0];
+            v.off1[0] = v.off1[1] = v.off2[0] = v.off2[1] = 0;
+            v.cut_width = v.cut_height = -1;
+            v.nx = v.ny = 1;
+            v.spx = v.spy = 0;
+            vias.push_back(v);
+        }
+        double build_ms = elapsed_ms(start);
+
+        start = Clock::now();
+        double xl = HUGE_VAL, xr = -HUGE_VAL;
+        for (bag::ViaIter it = vias.begin(); it != vias.end(); it++) {
+            xl = std::min(xl, it->loc[0]);
+            xr = std::max(xr, it->loc[0]);
+        }
+        report("ViaList", via_list_bytes(vias), build_ms, elapsed_ms(start), xr - xl);
+    }
+    for (unsigned int dbu = 0; dbu <= 1000; dbu += 1000) {
+        Clock::time_point start = Clock::now();
+        bag::Layout layout(dbu, 1);
+        layout.reserve_vias(num_shapes);
+        for (std::size_t idx = 0; idx < num_shapes; idx++) {
+            layout.add_via(via_name, loc[2 * idx], loc[2 * idx + 1], "R0", 1, 1, sp[0], sp[1],
+                    enc[0], enc[1], enc[2], enc[3], enc[0], enc[1], enc[2], enc[3]);
+        }
+        double build_ms = elapsed_ms(start);
+
+        start = Clock::now();
+        double bbox[4];
+        layout.get_bbox(bbox);
+        double iter_ms = elapsed_ms(start);
+        report(dbu == 0 ? "ViaTable (float)" : "ViaTable (dbu)",
+                via_table_bytes(layout.via_list), build_ms, iter_ms, bbox[2] - bbox[0]);
+    }
+
+    std::cout << "sharded vias + rects: " << num_shapes << std::endl;
+    unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        Clock::time_point start = Clock::now();
+        bag::ShardedLayout shards(num_threads, 1000, 1);
+        std::vector<std::thread> threads;
+        for (unsigned int tid = 0; tid < num_threads; tid++) {
+            threads.push_back(std::thread([&, tid]() {
+                bag::Layout & layout = shards[tid];
+                unsigned int lpp = shards.get_lpp_id(tid, "M1", "drawing");
+                for (std::size_t idx = tid; idx < num_shapes; idx += num_threads) {
+                    layout.add_via(via_name, loc[2 * idx], loc[2 * idx + 1], "R0", 1, 1, sp[0],
+                            sp[1], enc[0], enc[1], enc[2], enc[3], enc[0], enc[1], enc[2],
+                            enc[3]);
+                    layout.add_rect(lpp, box[4 * idx], box[4 * idx + 1], box[4 * idx + 2],
+                            box[4 * idx + 3]);
+                }
+            }));
+        }
+        for (unsigned int tid = 0; tid < num_threads; tid++) {
+            threads[tid].join();
+        }
+        double build_ms = elapsed_ms(start);
+
+        start = Clock::now();
+        bag::Layout layout;
+        shards.merge(layout);
+        double merge_ms = elapsed_ms(start);
+
+        double bbox[4];
+        layout.get_bbox(bbox);
+        std::ostringstream name;
+        name << num_threads << " threads";
+        std::cout << std::left << std::setw(24) << name.str() << std::right << std::fixed
+                << std::setprecision(1) << std::setw(10) << build_ms << " ms build"
+                << std::setw(10) << merge_ms << " ms merge"
+                << "  (checksum " << std::setprecision(3) << bbox[2] - bbox[0] << ")"
+                << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "oasis.hpp"
+
+// writes a memory-array-like hierarchy to OASIS with repetitions and CBLOCK
+// compression, with repetitions only, and fully expanded, and compares file
+// size and write time.  A GDSII dump is included for reference.  Fails if
+// repetitions and compression do not make the file smaller.
+
+typedef std::chrono::steady_clock Clock;
+
+const unsigned int array_size = 256;
+
+double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::size_t file_bytes(const std::string & fname) {
+    struct stat st;
+    if (stat(fname.c_str(), &st) != 0) {
+        return 0;
+    }
+    return (std::size_t) st.st_size;
+}
+
+// a bit cell with a few shapes, a via with a 2x2 cut array and a pin.
+void make_bitcell(bag::Layout & layout) {
+    layout.add_rect("OD", "drawing", 0.0, 0.1, 0.4, 0.3);
+    layout.add_rect("PO", "drawing", 0.05, 0.0, 0.09, 0.4, 4, 1, 0.1, 0.0);
+    layout.add_rect("M1", "drawing", 0.0, 0.18, 0.4, 0.22);
+    layout.add_path_seg("M2", "drawing", 0.2, 0.0, 0.2, 0.4, 0.04, "truncate", "truncate");
+    layout.add_via("M1_M2", 0.2, 0.2, "R0", 2, 2, 0.02, 0.02, 0.01, 0.005, 0.01, 0.005,
+            0.005, 0.01, 0.005, 0.01, 0.02, 0.02);
+    layout.add_pin("BL", "BL", "BL", "M2", "pin", 0.18, 0.0, 0.22, 0.04);
+}
+
+// a bit cell array with word lines, bit lines, strap vias and fill.
+void make_array(bag::Layout & layout) {
+    bag::IntMap int_params;
+    bag::StrMap str_params;
+    bag::DoubleMap double_params;
+    double pitch = 0.4;
+    double span = array_size * pitch;
+    layout.add_inst("bench", "bitcell", "layout", "XCELL", 0.0, 0.0, "R0", int_params,
+            str_params, double_params, array_size, array_size, pitch, pitch);
+    layout.add_inst("bench", "bitcell", "layout", "XDUMMY", 0.0, -pitch, "MX", int_params,
+            str_params, double_params, 1, array_size, 0.0, pitch);
+
+    // word lines and bit lines
+    layout.add_rect("M3", "drawing", 0.0, 0.18, span, 0.22, 1, array_size, 0.0, pitch);
+    layout.add_rect("M4", "drawing", 0.18, 0.0, 0.22, span, array_size, 1, pitch, 0.0);
+    layout.add_via("M3_M4", 0.2, 0.2, "R90", 1, 2, 0.02, 0.02, 0.01, 0.01, 0.01, 0.01,
+            0.01, 0.01, 0.01, 0.01, 0.02, 0.02, array_size, array_size, pitch, pitch);
+
+    // dummy fill, one array per 16 x 16 tile.
+    for (unsigned int row = 0; row < array_size / 16; row++) {
+        for (unsigned int col = 0; col < array_size / 16; col++) {
+            double x0 = span + 1.0 + col * 1.0;
+            double y0 = row * 1.0;
+            layout.add_rect("M1", "fill", x0, y0, x0 + 0.05, y0 + 0.05, 8, 8, 0.1, 0.1);
+        }
+    }
+    layout.add_boundary("PR", std::vector<double> { 0.0, 0.0, span + 20.0, span + 20.0 },
+            std::vector<double> { 0.0, span, span, 0.0 });
+}
+
+// both stream writers take the same layer, purpose and via mappings.
+template<typename Writer>
+void add_layers(Writer & writer) {
+    const char * layers[] = { "OD", "PO", "M1", "M2", "M3", "M4", "V1", "V3", "prBoundary" };
+    const char * purposes[] = { "drawing", "pin", "fill", "boundary" };
+    for (unsigned int idx = 0; idx < sizeof(layers) / sizeof(layers[0]); idx++) {
+        writer.add_layer(layers[idx], idx + 1);
+    }
+    for (unsigned int idx = 0; idx < sizeof(purposes) / sizeof(purposes[0]); idx++) {
+        writer.add_purpose(purposes[idx], idx);
+    }
+    writer.add_via_def("M1_M2", "M1", "V1", "M2", "drawing", 0.02, 0.02);
+    writer.add_via_def("M3_M4", "M3", "V3", "M4", "drawing", 0.02, 0.02);
+}
+
+void report(const std::string & name, const std::string & fname, double ms) {
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(12)
+            << file_bytes(fname) << " bytes" << std::setw(10) << std::fixed
+            << std::setprecision(1) << ms << " ms" << std::endl;
+}
+
+int main(int argc, char * argv[]) {
+    std::string out_dir = (argc > 1) ? argv[1] : ".";
+
+    bag::Layout bitcell(1000, 1);
+    bag::Layout array(1000, 1);
+    make_bitcell(bitcell);
+    make_array(array);
+
+    std::cout << "bit cell array: " << array_size << " x " << array_size << std::endl;
+    const char * names[] = { "OASIS (rep + cblock)", "OASIS (rep)", "OASIS (expanded)" };
+    const char * files[] = { "/bench_rep_cblock.oas", "/bench_rep.oas", "/bench_flat.oas" };
+    std::size_t sizes[3];
+    for (unsigned int mode = 0; mode < 3; mode++) {
+        std::string fname = out_dir + files[mode];
+        Clock::time_point start = Clock::now();
+        {
+            bag::OasisWriter writer;
+            add_layers(writer);
+            writer.open(fname, 1000, 1, mode == 0, mode < 2);
+            writer.create_layout("bitcell", "layout", bitcell);
+            writer.create_layout("array", "layout", array);
+            writer.close();
+        }
+        report(names[mode], fname, elapsed_ms(start));
+        sizes[mode] = file_bytes(fname);
+    }
+
+    std::string fname = out_dir + "/bench.gds";
+    Clock::time_point start = Clock::now();
+    {
+        bag::GdsWriter writer;
+        add_layers(writer);
+        writer.open(fname, "bench", 1000, 1);
+        writer.create_layout("bitcell", "layout", bitcell);
+        writer.create_layout("array", "layout", array);
+        writer.close();
+    }
+    report("GDS (AREF)", fname, elapsed_ms(start));
+
+    if (sizes[2] == 0 || sizes[1] >= sizes[2] || sizes[0] >= sizes[2]) {
+        std::cerr << "FAILED: repetitions do not shrink the OASIS file" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,1569 @@
+#ifndef OA_STUB_DESIGN_DB_H_
+#define OA_STUB_DESIGN_DB_H_
+
+// a stand-in for the subset of the OpenAccess API used by bagoa.  Nothing is
+// stored; database objects are shared placeholders, and every call that
+// creates or saves something is counted, so the writer can be built and
+// benchmarked without an OA install.  Lookups behave as in an empty library
+// with a technology of 1000 database units per user unit.
+//
+// OA is not thread-safe, so the stub also checks that it is used from one
+// thread at a time: a thread owns OA from its first design open to its last
+// close, and calls from any other thread meanwhile count as overlaps.
+//
+// To check schematic edits, names can be tracked: designs are then kept by
+// name, and the nets, terms, instances and instance terms created in their
+// blocks are stored so they can be found, renamed and listed.  A copy made
+// with saveAs() shares the block of its source.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#define oacAPIMajorRevNumber 1
+#define oacAPIMinorRevNumber 1
+#define oacDataModelRevNumber 1
+
+#define oacTop 1
+#define oacBottom 2
+#define oacLeft 4
+#define oacRight 8
+
+inline void oaDesignInit(int, int, int) {
+}
+
+namespace oa {
+
+namespace stub {
+
+// recorded calls
+enum Call {
+    call_rect, call_polygon, call_path, call_path_seg, call_text, call_via, call_scalar_inst,
+    call_array_inst, call_vector_inst, call_inst_term, call_net, call_term, call_pin, call_blockage, call_boundary,
+    call_prop, call_design_open, call_design_save, num_calls
+};
+
+inline std::atomic<std::size_t> * counts() {
+    static std::atomic<std::size_t> vals[num_calls];
+    return vals;
+}
+
+// calls made while another thread had a design open.
+inline std::atomic<std::size_t> & num_overlaps() {
+    static std::atomic<std::size_t> val(0);
+    return val;
+}
+
+// the thread with open designs, and how many it has open.
+inline std::atomic<std::thread::id> & owner() {
+    static std::atomic<std::thread::id> val;
+    return val;
+}
+
+inline unsigned int & owner_depth() {
+    static unsigned int val = 0;
+    return val;
+}
+
+inline void record(Call call) {
+    counts()[call].fetch_add(1, std::memory_order_relaxed);
+    std::thread::id cur = owner().load();
+    if (cur != std::thread::id() && cur != std::this_thread::get_id()) {
+        num_overlaps()++;
+    }
+}
+
+inline void enter() {
+    std::thread::id cur;
+    if (owner().compare_exchange_strong(cur, std::this_thread::get_id())) {
+        owner_depth() = 1;
+    } else if (cur == std::this_thread::get_id()) {
+        owner_depth()++;
+    } else {
+        num_overlaps()++;
+    }
+}
+
+inline void leave() {
+    if (owner().load() != std::this_thread::get_id()) {
+        num_overlaps()++;
+    } else if (--owner_depth() == 0) {
+        owner().store(std::thread::id());
+    }
+}
+
+inline void reset() {
+    for (unsigned int idx = 0; idx < num_calls; idx++) {
+        counts()[idx] = 0;
+    }
+    num_overlaps() = 0;
+}
+
+inline const char * call_name(unsigned int call) {
+    static const char * names[] = { "rect", "polygon", "path", "path_seg", "text", "via",
+            "scalar_inst", "array_inst", "vector_inst", "inst_term", "net", "term", "pin", "blockage",
+            "boundary", "prop", "design_open", "design_save" };
+    return names[call];
+}
+
+// the placeholder returned for every object of type T.
+template<class T>
+T * object() {
+    static T obj;
+    return &obj;
+}
+
+// true to track names, see above.  Set before opening designs.
+inline bool & track_names() {
+    static bool val = false;
+    return val;
+}
+
+// the live tracked objects of type T.
+template<class T>
+std::vector<T *> & tracked() {
+    static std::vector<T *> val;
+    return val;
+}
+
+template<class T>
+void untrack(T * obj) {
+    std::vector<T *> & vec = tracked<T>();
+    vec.erase(std::remove(vec.begin(), vec.end(), obj), vec.end());
+    delete obj;
+}
+
+// the width of the tracked instances of each cell.
+inline std::map<std::string, int> & cell_widths() {
+    static std::map<std::string, int> val;
+    return val;
+}
+
+}
+
+typedef unsigned int oaUInt4;
+typedef int oaInt4;
+typedef unsigned long long oaUInt8;
+typedef bool oaBoolean;
+typedef unsigned char oaByte;
+typedef double oaDouble;
+typedef float oaFloat;
+typedef int oaCoord;
+typedef int oaOffset;
+typedef unsigned int oaDist;
+typedef unsigned int oaLayerNum;
+typedef unsigned int oaPurposeNum;
+
+class oaString {
+public:
+    oaString() {
+    }
+    oaString(const char * val) :
+            val(val) {
+    }
+    operator const char *() const {
+        return val.c_str();
+    }
+    oaUInt4 getLength() const {
+        return (oaUInt4) val.size();
+    }
+    bool operator==(const oaString & other) const {
+        return val == other.val;
+    }
+
+private:
+    std::string val;
+};
+
+class oaNameSpace {
+};
+
+class oaNativeNS: public oaNameSpace {
+public:
+    oaNativeNS() {
+    }
+};
+
+class oaCdbaNS: public oaNameSpace {
+public:
+    oaCdbaNS() {
+    }
+};
+
+class oaScalarName {
+public:
+    oaScalarName() {
+    }
+    oaScalarName(const oaNameSpace &, const oaString & val) :
+            val(val) {
+    }
+    void get(oaString & out) const {
+        out = val;
+    }
+    void get(const oaNameSpace &, oaString & out) const {
+        out = val;
+    }
+    bool operator==(const oaScalarName & other) const {
+        return val == other.val;
+    }
+
+private:
+    oaString val;
+};
+
+class oaSimpleName: public oaScalarName {
+public:
+    oaSimpleName(const oaNameSpace & ns, const oaString & val) :
+            oaScalarName(ns, val) {
+    }
+};
+
+enum oaNameTypeEnum {
+    oacScalarNameType, oacVectorBitNameType, oacVectorNameType, oacBundleNameType
+};
+
+class oaNameType {
+public:
+    oaNameType(oaNameTypeEnum val = oacScalarNameType) :
+            val(val) {
+    }
+    operator oaNameTypeEnum() const {
+        return val;
+    }
+
+private:
+    oaNameTypeEnum val;
+};
+
+class oaVectorName {
+public:
+    oaVectorName() :
+            start(0), stop(0) {
+    }
+    oaVectorName(const oaScalarName & base, oaUInt4 start, oaUInt4 stop) :
+            base(base), start(start), stop(stop) {
+    }
+    void getBaseName(oaScalarName & out) const {
+        out = base;
+    }
+    oaUInt4 getStart() const {
+        return start;
+    }
+    oaUInt4 getStop() const {
+        return stop;
+    }
+    oaUInt4 getStep() const {
+        return 1;
+    }
+
+private:
+    oaScalarName base;
+    oaUInt4 start, stop;
+};
+
+// a name of the form base<start:stop> is a vector name, and base<bit> a
+// vector bit name.  Anything else is scalar.
+class oaName: public oaScalarName {
+public:
+    oaName() :
+            type(oacScalarNameType) {
+    }
+    oaName(const oaNameSpace & ns, const oaString & val) :
+            oaScalarName(ns, val), type(oacScalarNameType) {
+        std::string str(val);
+        std::size_t open = str.find('<');
+        if (open != std::string::npos && open > 0 && str[str.size() - 1] == '>') {
+            std::string range = str.substr(open + 1, str.size() - open - 2);
+            std::size_t colon = range.find(':');
+            if (colon == std::string::npos) {
+                type = oacVectorBitNameType;
+            } else {
+                type = oacVectorNameType;
+                vec = oaVectorName(oaScalarName(ns, oaString(str.substr(0, open).c_str())),
+                        (oaUInt4) std::stoul(range.substr(0, colon)),
+                        (oaUInt4) std::stoul(range.substr(colon + 1)));
+            }
+        }
+    }
+    oaNameType getType() const {
+        return type;
+    }
+    oaScalarName * getScalar() {
+        return (type == oacScalarNameType) ? this : NULL;
+    }
+    oaVectorName * getVector() {
+        return (type == oacVectorNameType) ? &vec : NULL;
+    }
+
+private:
+    oaNameType type;
+    oaVectorName vec;
+};
+
+class oaException {
+public:
+    oaString getMsg() const {
+        return oaString("stub error");
+    }
+};
+
+class oaCompatibilityError: public oaException {
+};
+
+class oaDMError: public oaException {
+};
+
+class oaError: public oaException {
+};
+
+class oaDesignError: public oaException {
+};
+
+class oaTechError: public oaException {
+};
+
+enum oaViewTypeEnum {
+    oacMaskLayout, oacSchematic, oacSchematicSymbol
+};
+
+class oaViewType {
+public:
+    static oaViewType * get(oaViewTypeEnum) {
+        return stub::object<oaViewType>();
+    }
+};
+
+enum oaOrientEnum {
+    oacR0, oacR90, oacR180, oacR270, oacMY, oacMYR90, oacMX, oacMXR90
+};
+
+class oaOrient {
+public:
+    oaOrient(oaOrientEnum val = oacR0) :
+            val(val) {
+    }
+    oaOrient(const oaString &) :
+            val(oacR0) {
+    }
+    operator oaOrientEnum() const {
+        return val;
+    }
+
+private:
+    oaOrientEnum val;
+};
+
+class oaPoint {
+public:
+    oaPoint() :
+            px(0), py(0) {
+    }
+    oaPoint(oaCoord x, oaCoord y) :
+            px(x), py(y) {
+    }
+    oaCoord x() const {
+        return px;
+    }
+    oaCoord y() const {
+        return py;
+    }
+
+private:
+    oaCoord px, py;
+};
+
+class oaVector {
+public:
+    oaVector() :
+            vx(0), vy(0) {
+    }
+    oaVector(oaOffset x, oaOffset y) :
+            vx(x), vy(y) {
+    }
+    oaOffset x() const {
+        return vx;
+    }
+    oaOffset y() const {
+        return vy;
+    }
+
+private:
+    oaOffset vx, vy;
+};
+
+class oaBox {
+public:
+    oaBox() :
+            xl(0), yb(0), xr(0), yt(0) {
+    }
+    oaBox(oaCoord xl, oaCoord yb, oaCoord xr, oaCoord yt) :
+            xl(xl), yb(yb), xr(xr), yt(yt) {
+    }
+    void getCenter(oaPoint & out) const {
+        out = oaPoint((xl + xr) / 2, (yb + yt) / 2);
+    }
+    oaUInt4 getWidth() const {
+        return (oaUInt4) (xr - xl);
+    }
+    oaUInt4 getHeight() const {
+        return (oaUInt4) (yt - yb);
+    }
+    oaCoord left() const {
+        return xl;
+    }
+    oaCoord bottom() const {
+        return yb;
+    }
+    oaCoord right() const {
+        return xr;
+    }
+    oaCoord top() const {
+        return yt;
+    }
+
+private:
+    oaCoord xl, yb, xr, yt;
+};
+
+class oaTransform {
+public:
+    oaTransform() :
+            dx(0), dy(0) {
+    }
+    oaTransform(oaOffset dx, oaOffset dy, const oaOrient & rot = oaOrient()) :
+            dx(dx), dy(dy), rot(rot) {
+    }
+    oaTransform(const oaPoint & pt, const oaOrient & rot = oaOrient()) :
+            dx(pt.x()), dy(pt.y()), rot(rot) {
+    }
+    oaOffset xOffset() const {
+        return dx;
+    }
+    oaOffset yOffset() const {
+        return dy;
+    }
+    oaOrient orient() const {
+        return rot;
+    }
+
+private:
+    oaOffset dx, dy;
+    oaOrient rot;
+};
+
+// only the number of points is kept.
+class oaPointArray {
+public:
+    oaPointArray() :
+            num(0) {
+    }
+    explicit oaPointArray(oaUInt4) :
+            num(0) {
+    }
+    void append(const oaPoint &) {
+        num++;
+    }
+    oaUInt4 getNumElements() const {
+        return num;
+    }
+    const oaPoint & operator[](oaUInt4) const {
+        return *stub::object<oaPoint>();
+    }
+    void compress() {
+    }
+
+private:
+    oaUInt4 num;
+};
+
+enum oaParamTypeEnum {
+    oacIntParamType, oacFloatParamType, oacStringParamType, oacDoubleParamType,
+    oacBooleanParamType
+};
+
+class oaParamType {
+public:
+    oaParamType(oaParamTypeEnum val = oacIntParamType) :
+            val(val) {
+    }
+    operator oaParamTypeEnum() const {
+        return val;
+    }
+
+private:
+    oaParamTypeEnum val;
+};
+
+class oaParam {
+public:
+    oaParam() {
+    }
+    oaParam(const oaString &, oaInt4) {
+    }
+    oaParam(const oaString &, oaDouble) {
+    }
+    oaParam(const oaString &, const oaString &) {
+    }
+    oaParamType getType() const {
+        return oaParamType();
+    }
+    void getName(oaString &) const {
+    }
+    oaInt4 getIntVal() const {
+        return 0;
+    }
+    oaFloat getFloatVal() const {
+        return 0;
+    }
+    oaDouble getDoubleVal() const {
+        return 0;
+    }
+    oaBoolean getBooleanVal() const {
+        return false;
+    }
+    void getStringVal(oaString &) const {
+    }
+};
+
+// only the number of parameters is kept.
+class oaParamArray {
+public:
+    oaParamArray() :
+            num(0) {
+    }
+    void append(const oaParam &) {
+        num++;
+    }
+    oaUInt4 getNumElements() const {
+        return num;
+    }
+    const oaParam & operator[](oaUInt4) const {
+        return *stub::object<oaParam>();
+    }
+
+private:
+    oaUInt4 num;
+};
+
+class oaViaParam {
+public:
+    oaViaParam() :
+            rows(1), cols(1), cut_w(0), cut_h(0) {
+    }
+    void setCutRows(oaUInt4 val) {
+        rows = val;
+    }
+    void setCutColumns(oaUInt4 val) {
+        cols = val;
+    }
+    void setCutSpacing(const oaVector & val) {
+        cut_sp = val;
+    }
+    void setLayer1Enc(const oaVector & val) {
+        enc1 = val;
+    }
+    void setLayer1Offset(const oaVector & val) {
+        off1 = val;
+    }
+    void setLayer2Enc(const oaVector & val) {
+        enc2 = val;
+    }
+    void setLayer2Offset(const oaVector & val) {
+        off2 = val;
+    }
+    void setCutWidth(oaDist val) {
+        cut_w = val;
+    }
+    void setCutHeight(oaDist val) {
+        cut_h = val;
+    }
+    oaUInt4 getCutRows() const {
+        return rows;
+    }
+    oaUInt4 getCutColumns() const {
+        return cols;
+    }
+    oaVector getCutSpacing() const {
+        return cut_sp;
+    }
+    oaVector getLayer1Enc() const {
+        return enc1;
+    }
+    oaVector getLayer1Offset() const {
+        return off1;
+    }
+    oaVector getLayer2Enc() const {
+        return enc2;
+    }
+    oaVector getLayer2Offset() const {
+        return off2;
+    }
+    oaDist getCutWidth() const {
+        return cut_w;
+    }
+    oaDist getCutHeight() const {
+        return cut_h;
+    }
+
+private:
+    oaUInt4 rows, cols;
+    oaVector cut_sp, enc1, off1, enc2, off2;
+    oaDist cut_w, cut_h;
+};
+
+enum oaEndStyleEnum {
+    oacTruncateEndStyle, oacExtendEndStyle, oacVariableEndStyle, oacCustomEndStyle,
+    oacChamferEndStyle
+};
+
+class oaEndStyle {
+public:
+    oaEndStyle(oaEndStyleEnum val = oacTruncateEndStyle) :
+            val(val) {
+    }
+    operator oaEndStyleEnum() const {
+        return val;
+    }
+
+private:
+    oaEndStyleEnum val;
+};
+
+class oaSegStyle {
+public:
+    oaSegStyle() :
+            width(0) {
+    }
+    oaSegStyle(oaDist width, const oaEndStyle & begin, const oaEndStyle & end) :
+            width(width), begin(begin), end(end) {
+    }
+    void setBeginStyle(const oaEndStyle & val, oaDist = 0, oaDist = 0, oaDist = 0, oaDist = 0) {
+        begin = val;
+    }
+    void setEndStyle(const oaEndStyle & val, oaDist = 0, oaDist = 0, oaDist = 0, oaDist = 0) {
+        end = val;
+    }
+    oaDist getWidth() const {
+        return width;
+    }
+    oaEndStyle getBeginStyle() const {
+        return begin;
+    }
+    oaEndStyle getEndStyle() const {
+        return end;
+    }
+
+private:
+    oaDist width;
+    oaEndStyle begin, end;
+};
+
+enum oaPathStyleEnum {
+    oacTruncatePathStyle, oacExtendPathStyle, oacRoundPathStyle, oacVariablePathStyle
+};
+
+class oaPathStyle {
+public:
+    oaPathStyle(oaPathStyleEnum val = oacTruncatePathStyle) :
+            val(val) {
+    }
+    operator oaPathStyleEnum() const {
+        return val;
+    }
+
+private:
+    oaPathStyleEnum val;
+};
+
+enum oaTextAlignEnum {
+    oacCenterCenterTextAlign
+};
+
+enum oaFontEnum {
+    oacRomanFont
+};
+
+class oaTextAlign {
+public:
+    oaTextAlign(oaTextAlignEnum = oacCenterCenterTextAlign) {
+    }
+};
+
+class oaFont {
+public:
+    oaFont(oaFontEnum = oacRomanFont) {
+    }
+};
+
+class oaBlockageType {
+public:
+    oaBlockageType() {
+    }
+    oaBlockageType(const oaString & name) :
+            name(name) {
+    }
+    oaString getName() const {
+        return name;
+    }
+
+private:
+    oaString name;
+};
+
+enum oaLibDefListWarningTypeEnum {
+    oacNoLibDefListWarning
+};
+
+template<class T>
+class oaObserver {
+public:
+    oaObserver(oaUInt4, oaBoolean = true) {
+    }
+    virtual ~oaObserver() {
+    }
+};
+
+class oaLibDefList {
+public:
+    static void openLibs() {
+    }
+    static void openLibs(const oaString &) {
+    }
+};
+
+// collections are empty, except those of tracked objects.
+template<class T>
+class oaCollection {
+public:
+    oaCollection() {
+    }
+    explicit oaCollection(const std::vector<T *> & items) :
+            items(items) {
+    }
+    oaBoolean isEmpty() const {
+        return items.empty();
+    }
+
+    std::vector<T *> items;
+};
+
+template<class T>
+class oaIter {
+public:
+    oaIter(const oaCollection<T> & coll) :
+            items(coll.items), idx(0) {
+    }
+    T * getNext() {
+        return (idx < items.size()) ? items[idx++] : NULL;
+    }
+
+private:
+    std::vector<T *> items;
+    std::size_t idx;
+};
+
+enum oaTypeEnum {
+    oacRectType, oacPolygonType, oacPathType, oacPathSegType, oacTextType, oacScalarInstType,
+    oacArrayInstType, oacStdViaType, oacCustomViaType, oacAreaBlockageType,
+    oacLayerBlockageType, oacPRBoundaryType, oacSnapBoundaryType, oacAreaBoundaryType
+};
+
+class oaType {
+public:
+    oaType(oaTypeEnum val = oacRectType) :
+            val(val) {
+    }
+    operator oaTypeEnum() const {
+        return val;
+    }
+
+private:
+    oaTypeEnum val;
+};
+
+class oaObject {
+public:
+    oaBoolean isValid() const {
+        return true;
+    }
+    oaType getType() const {
+        return oaType();
+    }
+};
+
+class oaProp;
+class oaDesign;
+class oaBlock;
+class oaTech;
+class oaLib;
+class oaNet;
+class oaTerm;
+class oaPin;
+
+class oaLayer: public oaObject {
+public:
+    void getName(oaString &) const {
+    }
+    oaLayerNum getNumber() const {
+        return 0;
+    }
+};
+
+class oaPurpose: public oaObject {
+public:
+    void getName(oaString &) const {
+    }
+    oaPurposeNum getNumber() const {
+        return 0;
+    }
+};
+
+// every via name resolves to the same definition.
+class oaViaDef: public oaObject {
+public:
+    static oaViaDef * find(const oaTech *, const oaString &);
+    void getName(oaString &) const {
+    }
+};
+
+class oaStdViaDef: public oaViaDef {
+};
+
+inline oaViaDef * oaViaDef::find(const oaTech *, const oaString &) {
+    return stub::object<oaStdViaDef>();
+}
+
+class oaTech: public oaObject {
+public:
+    static oaTech * find(const oaLib *) {
+        return stub::object<oaTech>();
+    }
+    static oaBoolean exists(const oaLib *) {
+        return true;
+    }
+    static oaTech * open(const oaLib *, char = 'r') {
+        return stub::object<oaTech>();
+    }
+    static void attach(oaLib *, const oaScalarName &) {
+    }
+    static oaBoolean getAttachment(const oaLib *, oaScalarName &) {
+        return false;
+    }
+    oaUInt4 getDBUPerUU(const oaViewType *) const {
+        return 1000;
+    }
+    oaUInt4 getDefaultManufacturingGrid() const {
+        return 1;
+    }
+    oaCollection<oaLayer> getLayers() const {
+        return oaCollection<oaLayer>();
+    }
+    oaCollection<oaPurpose> getPurposes() const {
+        return oaCollection<oaPurpose>();
+    }
+    void close() {
+    }
+};
+
+class oaLib: public oaObject {
+public:
+    static oaLib * find(const oaScalarName &) {
+        return stub::object<oaLib>();
+    }
+    static oaLib * create(const oaScalarName &, const oaString &) {
+        return stub::object<oaLib>();
+    }
+    void close() {
+    }
+};
+
+class oaFig: public oaObject {
+public:
+    void getBBox(oaBox & out) const {
+        out = oaBox();
+    }
+    void destroy() {
+    }
+};
+
+class oaShape: public oaFig {
+public:
+    oaLayerNum getLayerNum() const {
+        return 0;
+    }
+    oaPurposeNum getPurposeNum() const {
+        return 0;
+    }
+    void addToPin(oaPin *) {
+    }
+    oaPin * getPin() const {
+        return NULL;
+    }
+    void addToNet(oaNet *) {
+    }
+};
+
+class oaRect: public oaShape {
+public:
+    static oaRect * create(oaBlock *, oaLayerNum, oaPurposeNum, const oaBox &) {
+        stub::record(stub::call_rect);
+        return stub::object<oaRect>();
+    }
+    void getBBox(oaBox &) const {
+    }
+};
+
+class oaPolygon: public oaShape {
+public:
+    static oaPolygon * create(oaBlock *, oaLayerNum, oaPurposeNum, const oaPointArray &) {
+        stub::record(stub::call_polygon);
+        return stub::object<oaPolygon>();
+    }
+    void getPoints(oaPointArray &) const {
+    }
+};
+
+class oaPathSeg: public oaShape {
+public:
+    static oaPathSeg * create(oaBlock *, oaLayerNum, oaPurposeNum, const oaPoint &,
+            const oaPoint &, const oaSegStyle &) {
+        stub::record(stub::call_path_seg);
+        return stub::object<oaPathSeg>();
+    }
+    void getPoints(oaPoint &, oaPoint &) const {
+    }
+    void getStyle(oaSegStyle &) const {
+    }
+};
+
+class oaPath: public oaShape {
+public:
+    static oaPath * create(oaBlock *, oaLayerNum, oaPurposeNum, oaDist, const oaPointArray &,
+            const oaPathStyle & = oaPathStyle(), oaDist = 0, oaDist = 0) {
+        stub::record(stub::call_path);
+        return stub::object<oaPath>();
+    }
+    void getPoints(oaPointArray &) const {
+    }
+    oaDist getWidth() const {
+        return 0;
+    }
+    oaPathStyle getStyle() const {
+        return oaPathStyle();
+    }
+    oaDist getBeginExt() const {
+        return 0;
+    }
+    oaDist getEndExt() const {
+        return 0;
+    }
+};
+
+class oaText: public oaShape {
+public:
+    static oaText * create(oaBlock *, oaLayerNum, oaPurposeNum, const oaString &,
+            const oaPoint &, const oaTextAlign &, const oaOrient &, const oaFont &, oaDist) {
+        stub::record(stub::call_text);
+        return stub::object<oaText>();
+    }
+};
+
+class oaVia: public oaFig {
+public:
+    void getTransform(oaTransform &) const {
+    }
+};
+
+class oaStdVia: public oaVia {
+public:
+    static oaStdVia * create(oaBlock *, oaStdViaDef *, const oaTransform &,
+            const oaViaParam * = NULL) {
+        stub::record(stub::call_via);
+        return stub::object<oaStdVia>();
+    }
+    oaStdViaDef * getViaDef() const {
+        return stub::object<oaStdViaDef>();
+    }
+    void getParams(oaViaParam &) const {
+    }
+};
+
+class oaInstTerm;
+
+class oaInst: public oaFig {
+public:
+    oaInst() :
+            blk(NULL) {
+    }
+    virtual ~oaInst() {
+    }
+    static oaInst * find(const oaBlock * blk, const oaScalarName & name);
+    oaCollection<oaInstTerm> getInstTerms() const;
+    void getParams(oaParamArray &) const {
+    }
+    void getLibName(const oaNameSpace &, oaString & out) const {
+        out = lib.c_str();
+    }
+    void getCellName(const oaNameSpace &, oaString & out) const {
+        out = cell.c_str();
+    }
+    void getViewName(const oaNameSpace &, oaString & out) const {
+        out = view.c_str();
+    }
+    void getName(const oaNameSpace &, oaString & out) const {
+        out = name.c_str();
+    }
+    void getTransform(oaTransform & out) const {
+        out = xfm;
+    }
+    oaBlock * getBlock() const {
+        return blk;
+    }
+    // a tracked instance spans the width of its cell to the right of its origin.
+    void getBBox(oaBox & out) const {
+        std::map<std::string, int>::const_iterator it = stub::cell_widths().find(cell);
+        int width = (it == stub::cell_widths().end()) ? 0 : it->second;
+        out = oaBox(xfm.xOffset(), xfm.yOffset(), xfm.xOffset() + width, xfm.yOffset());
+    }
+    void destroy();
+
+protected:
+    static oaInst * track(oaInst * inst, oaBlock * blk, const oaScalarName & lib,
+            const oaScalarName & cell, const oaScalarName & view, const std::string & name,
+            const oaTransform & xfm) {
+        oaString str;
+        inst->blk = blk;
+        lib.get(str);
+        inst->lib = static_cast<const char *>(str);
+        cell.get(str);
+        inst->cell = static_cast<const char *>(str);
+        view.get(str);
+        inst->view = static_cast<const char *>(str);
+        inst->name = name;
+        inst->xfm = xfm;
+        stub::tracked<oaInst>().push_back(inst);
+        return inst;
+    }
+
+    oaBlock * blk;
+    std::string lib, cell, view, name;
+    oaTransform xfm;
+};
+
+class oaScalarInst: public oaInst {
+public:
+    static oaScalarInst * create(oaBlock * blk, const oaScalarName & lib,
+            const oaScalarName & cell, const oaScalarName & view, const oaScalarName & name,
+            const oaTransform & xfm, const oaParamArray * = NULL) {
+        stub::record(stub::call_scalar_inst);
+        if (!stub::track_names()) {
+            return stub::object<oaScalarInst>();
+        }
+        oaString str;
+        name.get(str);
+        oaScalarInst * inst = new oaScalarInst();
+        track(inst, blk, lib, cell, view, static_cast<const char *>(str), xfm);
+        return inst;
+    }
+    static oaScalarInst * create(oaBlock *, oaDesign *, const oaScalarName &,
+            const oaTransform &, const oaParamArray * = NULL) {
+        stub::record(stub::call_scalar_inst);
+        return stub::object<oaScalarInst>();
+    }
+};
+
+class oaVectorInst: public oaInst {
+public:
+    static oaVectorInst * find(const oaBlock * blk, const oaScalarName & base, oaUInt4 start,
+            oaUInt4 stop) {
+        return static_cast<oaVectorInst *>(oaInst::find(blk,
+                oaScalarName(oaNativeNS(), oaString(get_name(base, start, stop).c_str()))));
+    }
+    static oaVectorInst * create(oaBlock * blk, const oaScalarName & lib,
+            const oaScalarName & cell, const oaScalarName & view, const oaScalarName & base,
+            oaUInt4 start, oaUInt4 stop, const oaTransform & xfm,
+            const oaParamArray * = NULL) {
+        stub::record(stub::call_vector_inst);
+        if (!stub::track_names()) {
+            return stub::object<oaVectorInst>();
+        }
+        oaVectorInst * inst = new oaVectorInst();
+        track(inst, blk, lib, cell, view, get_name(base, start, stop), xfm);
+        return inst;
+    }
+
+private:
+    static std::string get_name(const oaScalarName & base, oaUInt4 start, oaUInt4 stop) {
+        oaString str;
+        base.get(str);
+        return static_cast<const char *>(str) + ("<" + std::to_string(start) + ":"
+                + std::to_string(stop) + ">");
+    }
+};
+
+class oaArrayInst: public oaInst {
+public:
+    static oaArrayInst * create(oaBlock *, const oaScalarName &, const oaScalarName &,
+            const oaScalarName &, const oaScalarName &, const oaTransform &, oaOffset, oaOffset,
+            oaUInt4, oaUInt4, const oaParamArray * = NULL) {
+        stub::record(stub::call_array_inst);
+        return stub::object<oaArrayInst>();
+    }
+    static oaArrayInst * create(oaBlock *, oaDesign *, const oaScalarName &,
+            const oaTransform &, oaOffset, oaOffset, oaUInt4, oaUInt4,
+            const oaParamArray * = NULL) {
+        stub::record(stub::call_array_inst);
+        return stub::object<oaArrayInst>();
+    }
+    oaUInt4 getNumRows() const {
+        return 1;
+    }
+    oaUInt4 getNumCols() const {
+        return 1;
+    }
+    oaOffset getDX() const {
+        return 0;
+    }
+    oaOffset getDY() const {
+        return 0;
+    }
+};
+
+class oaNet: public oaObject {
+public:
+    oaNet() :
+            blk(NULL) {
+    }
+    static oaNet * find(const oaBlock * blk, const oaName & name) {
+        oaString str;
+        name.get(str);
+        for (oaNet * net : stub::tracked<oaNet>()) {
+            if (net->blk == blk && net->name == static_cast<const char *>(str)) {
+                return net;
+            }
+        }
+        return NULL;
+    }
+    static oaNet * create(oaBlock * blk, const oaName & name) {
+        stub::record(stub::call_net);
+        if (!stub::track_names()) {
+            return stub::object<oaNet>();
+        }
+        oaNet * net = new oaNet();
+        net->blk = blk;
+        net->setName(name);
+        stub::tracked<oaNet>().push_back(net);
+        return net;
+    }
+    void getName(const oaNameSpace &, oaString & out) const {
+        out = name.c_str();
+    }
+    void setName(const oaName & val) {
+        oaString str;
+        val.get(str);
+        name = static_cast<const char *>(str);
+    }
+    oaCollection<oaTerm> getTerms() const;
+    oaCollection<oaInstTerm> getInstTerms() const;
+    oaCollection<oaShape> getShapes() const {
+        return oaCollection<oaShape>();
+    }
+    oaBlock * getBlock() const {
+        return blk;
+    }
+    void destroy() {
+        if (blk != NULL) {
+            stub::untrack(this);
+        }
+    }
+
+private:
+    oaBlock * blk;
+    std::string name;
+};
+
+class oaTerm: public oaObject {
+public:
+    oaTerm() :
+            net(NULL) {
+    }
+    static oaTerm * find(const oaBlock * blk, const oaName & name) {
+        oaString str;
+        name.get(str);
+        for (oaTerm * term : stub::tracked<oaTerm>()) {
+            if (term->net->getBlock() == blk && term->name == static_cast<const char *>(str)) {
+                return term;
+            }
+        }
+        return NULL;
+    }
+    static oaTerm * create(oaNet * net, const oaName & name) {
+        stub::record(stub::call_term);
+        if (!stub::track_names()) {
+            return stub::object<oaTerm>();
+        }
+        oaTerm * term = new oaTerm();
+        term->net = net;
+        term->setName(name);
+        stub::tracked<oaTerm>().push_back(term);
+        return term;
+    }
+    void getName(const oaNameSpace &, oaString & out) const {
+        out = name.c_str();
+    }
+    void setName(const oaName & val) {
+        oaString str;
+        val.get(str);
+        name = static_cast<const char *>(str);
+    }
+    oaNet * getNet() const {
+        return (net == NULL) ? stub::object<oaNet>() : net;
+    }
+    void moveToNet(oaNet * val) {
+        net = val;
+    }
+
+private:
+    oaNet * net;
+    std::string name;
+};
+
+class oaInstTerm: public oaObject {
+public:
+    oaInstTerm() :
+            net(NULL), inst(NULL) {
+    }
+    static oaInstTerm * create(oaNet * net, oaInst * inst, const oaName & name) {
+        stub::record(stub::call_inst_term);
+        if (!stub::track_names()) {
+            return stub::object<oaInstTerm>();
+        }
+        oaString str;
+        name.get(str);
+        oaInstTerm * inst_term = new oaInstTerm();
+        inst_term->net = net;
+        inst_term->inst = inst;
+        inst_term->term = static_cast<const char *>(str);
+        stub::tracked<oaInstTerm>().push_back(inst_term);
+        return inst_term;
+    }
+    oaNet * getNet() const {
+        return (net == NULL) ? stub::object<oaNet>() : net;
+    }
+    oaInst * getInst() const {
+        return inst;
+    }
+    void getTermName(oaName & out) const {
+        out = oaName(oaNativeNS(), oaString(term.c_str()));
+    }
+    void addToNet(oaNet * val) {
+        net = val;
+    }
+
+private:
+    oaNet * net;
+    oaInst * inst;
+    std::string term;
+};
+
+inline oaInst * oaInst::find(const oaBlock * blk, const oaScalarName & name) {
+    oaString str;
+    name.get(str);
+    for (oaInst * inst : stub::tracked<oaInst>()) {
+        if (inst->blk == blk && inst->name == static_cast<const char *>(str)) {
+            return inst;
+        }
+    }
+    return NULL;
+}
+
+inline oaCollection<oaInstTerm> oaInst::getInstTerms() const {
+    std::vector<oaInstTerm *> ans;
+    for (oaInstTerm * inst_term : stub::tracked<oaInstTerm>()) {
+        if (inst_term->getInst() == this) {
+            ans.push_back(inst_term);
+        }
+    }
+    return oaCollection<oaInstTerm>(ans);
+}
+
+inline void oaInst::destroy() {
+    if (blk != NULL) {
+        for (oaInstTerm * inst_term : getInstTerms().items) {
+            stub::untrack(inst_term);
+        }
+        stub::untrack(this);
+    }
+}
+
+inline oaCollection<oaTerm> oaNet::getTerms() const {
+    std::vector<oaTerm *> ans;
+    for (oaTerm * term : stub::tracked<oaTerm>()) {
+        if (term->getNet() == this) {
+            ans.push_back(term);
+        }
+    }
+    return oaCollection<oaTerm>(ans);
+}
+
+inline oaCollection<oaInstTerm> oaNet::getInstTerms() const {
+    std::vector<oaInstTerm *> ans;
+    for (oaInstTerm * inst_term : stub::tracked<oaInstTerm>()) {
+        if (inst_term->getNet() == this) {
+            ans.push_back(inst_term);
+        }
+    }
+    return oaCollection<oaInstTerm>(ans);
+}
+
+class oaPin: public oaObject {
+public:
+    static oaPin * create(oaTerm *, const oaString &, oaByte) {
+        stub::record(stub::call_pin);
+        return stub::object<oaPin>();
+    }
+    void getName(oaString &) const {
+    }
+    oaTerm * getTerm() const {
+        return stub::object<oaTerm>();
+    }
+};
+
+class oaBoundary: public oaFig {
+public:
+    void getPoints(oaPointArray &) const {
+    }
+};
+
+class oaPRBoundary: public oaBoundary {
+public:
+    static oaPRBoundary * create(oaBlock *, const oaPointArray &) {
+        stub::record(stub::call_boundary);
+        return stub::object<oaPRBoundary>();
+    }
+};
+
+class oaSnapBoundary: public oaBoundary {
+public:
+    static oaSnapBoundary * create(oaBlock *, const oaPointArray &) {
+        stub::record(stub::call_boundary);
+        return stub::object<oaSnapBoundary>();
+    }
+};
+
+class oaAreaBoundary: public oaBoundary {
+public:
+    static oaAreaBoundary * create(oaBlock *, const oaPointArray &) {
+        stub::record(stub::call_boundary);
+        return stub::object<oaAreaBoundary>();
+    }
+};
+
+class oaBlockage: public oaFig {
+public:
+    void getPoints(oaPointArray &) const {
+    }
+    oaBlockageType getBlockageType() const {
+        return oaBlockageType();
+    }
+};
+
+class oaAreaBlockage: public oaBlockage {
+public:
+    static oaAreaBlockage * create(oaBlock *, const oaPointArray &) {
+        stub::record(stub::call_blockage);
+        return stub::object<oaAreaBlockage>();
+    }
+};
+
+class oaLayerBlockage: public oaBlockage {
+public:
+    static oaLayerBlockage * create(oaBlock *, const oaBlockageType &, oaLayerNum,
+            const oaPointArray &) {
+        stub::record(stub::call_blockage);
+        return stub::object<oaLayerBlockage>();
+    }
+    oaLayerNum getLayerNum() const {
+        return 0;
+    }
+};
+
+class oaBlock: public oaObject {
+public:
+    static oaBlock * create(oaDesign * dsn);
+    oaCollection<oaShape> getShapes() const {
+        return oaCollection<oaShape>();
+    }
+    oaCollection<oaInst> getInsts() const {
+        return oaCollection<oaInst>(find_all(stub::tracked<oaInst>()));
+    }
+    oaCollection<oaVia> getVias() const {
+        return oaCollection<oaVia>();
+    }
+    oaCollection<oaNet> getNets() const {
+        return oaCollection<oaNet>(find_all(stub::tracked<oaNet>()));
+    }
+    oaCollection<oaTerm> getTerms() const {
+        std::vector<oaTerm *> ans;
+        for (oaTerm * term : stub::tracked<oaTerm>()) {
+            if (term->getNet()->getBlock() == this) {
+                ans.push_back(term);
+            }
+        }
+        return oaCollection<oaTerm>(ans);
+    }
+    oaCollection<oaBlockage> getBlockages() const {
+        return oaCollection<oaBlockage>();
+    }
+    oaCollection<oaBoundary> getBoundaries() const {
+        return oaCollection<oaBoundary>();
+    }
+
+private:
+    template<class T>
+    std::vector<T *> find_all(const std::vector<T *> & objs) const {
+        std::vector<T *> ans;
+        for (T * obj : objs) {
+            if (obj->getBlock() == this) {
+                ans.push_back(obj);
+            }
+        }
+        return ans;
+    }
+};
+
+// designs never exist before they are opened for writing.  With names
+// tracked, a design opened again, or a copy of it, is the same design.
+class oaDesign: public oaObject {
+public:
+    static oaDesign * open(const oaScalarName & lib, const oaScalarName & cell,
+            const oaScalarName & view, const oaViewType *, char) {
+        stub::enter();
+        stub::record(stub::call_design_open);
+        return get(lib, cell, view);
+    }
+    static oaDesign * open(const oaScalarName & lib, const oaScalarName & cell,
+            const oaScalarName & view, char) {
+        stub::enter();
+        stub::record(stub::call_design_open);
+        return get(lib, cell, view);
+    }
+    static oaDesign * find(const oaScalarName &, const oaScalarName &, const oaScalarName &) {
+        return NULL;
+    }
+    static oaBoolean exists(const oaScalarName &, const oaScalarName &, const oaScalarName &) {
+        return false;
+    }
+    void save() {
+        stub::record(stub::call_design_save);
+    }
+    void saveAs(const oaScalarName & lib, const oaScalarName & cell, const oaScalarName & view,
+            oaBoolean = false) {
+        stub::record(stub::call_design_save);
+        if (stub::track_names()) {
+            designs()[get_key(lib, cell, view)] = this;
+        }
+    }
+    void close() {
+        stub::leave();
+    }
+    oaBlock * getTopBlock() const {
+        return const_cast<oaBlock *>(&block);
+    }
+    oaCollection<oaProp> getProps() const {
+        return oaCollection<oaProp>();
+    }
+
+    // the tracked designs by name, and all of them.
+    static std::map<std::string, oaDesign *> & designs() {
+        static std::map<std::string, oaDesign *> val;
+        return val;
+    }
+    static std::vector<oaDesign *> & all_designs() {
+        static std::vector<oaDesign *> val;
+        return val;
+    }
+
+private:
+    static std::string get_key(const oaScalarName & lib, const oaScalarName & cell,
+            const oaScalarName & view) {
+        oaString lib_str, cell_str, view_str;
+        lib.get(lib_str);
+        cell.get(cell_str);
+        view.get(view_str);
+        return std::string(lib_str) + "/" + std::string(cell_str) + "/" + std::string(view_str);
+    }
+
+    static oaDesign * get(const oaScalarName & lib, const oaScalarName & cell,
+            const oaScalarName & view) {
+        if (!stub::track_names()) {
+            return stub::object<oaDesign>();
+        }
+        oaDesign *& dsn = designs()[get_key(lib, cell, view)];
+        if (dsn == NULL) {
+            dsn = new oaDesign();
+            all_designs().push_back(dsn);
+        }
+        return dsn;
+    }
+
+    oaBlock block;
+};
+
+inline oaBlock * oaBlock::create(oaDesign * dsn) {
+    return dsn->getTopBlock();
+}
+
+class oaProp: public oaObject {
+public:
+    static oaProp * find(const oaObject *, const oaString &) {
+        return NULL;
+    }
+    void getName(oaString &) const {
+    }
+    void getValue(oaString &) const {
+    }
+};
+
+class oaStringProp: public oaProp {
+public:
+    static oaStringProp * create(oaObject *, const oaString &, const oaString &) {
+        stub::record(stub::call_prop);
+        return stub::object<oaStringProp>();
+    }
+    void setValue(const oaString &) {
+    }
+};
+
+namespace stub {
+
+// remove all tracked designs and objects.
+inline void clear_names() {
+    while (!tracked<oaInstTerm>().empty()) {
+        untrack(tracked<oaInstTerm>().back());
+    }
+    while (!tracked<oaTerm>().empty()) {
+        untrack(tracked<oaTerm>().back());
+    }
+    while (!tracked<oaInst>().empty()) {
+        untrack(tracked<oaInst>().back());
+    }
+    while (!tracked<oaNet>().empty()) {
+        untrack(tracked<oaNet>().back());
+    }
+    for (oaDesign * dsn : oaDesign::all_designs()) {
+        delete dsn;
+    }
+    oaDesign::all_designs().clear();
+    oaDesign::designs().clear();
+}
+
+}
+
+}
+
+#endif
@@ -16,7 +16,7 @@ int test_layout(int argc, char * argv[]) {
 
 		// open library and draw layout
 		bagoa::OALayoutLibrary lib;
-		lib.open_library("./cds.lib", "AAAFOO");
+		lib.open_library("./cds.lib", "AAAFOO", "./AAAFOO", "cds_ff_mpt");
 		lib.add_purpose("pin", 251);
 		lib.create_layout("testoa", "layout", layout);
 		lib.close();
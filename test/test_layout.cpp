@@ -0,0 +1,587 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gds.hpp"
+#include "library.hpp"
+#include "oasis.hpp"
+#include "serialize.hpp"
+#include "spatial.hpp"
+
+// checks of layout storage, serialization, hashing, stream out and spatial
+// queries.  Needs no OA.  Exits with the number of failed checks.
+
+int num_failed = 0;
+
+void check(bool ok, const std::string & what) {
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        num_failed++;
+    }
+}
+
+// check that reading the image throws invalid_argument.
+void check_rejected(const std::vector<char> & buf, const std::string & what) {
+    bool rejected = false;
+    try {
+        bag::Layout layout;
+        bag::deserialize_layout(buf.data(), buf.size(), layout);
+    } catch (std::invalid_argument &) {
+        rejected = true;
+    }
+    check(rejected, "rejects " + what);
+}
+
+// a layout with something in every list and every parameter type.
+void fill_layout(bag::Layout & layout) {
+    bag::IntMap int_params;
+    bag::StrMap str_params;
+    bag::DoubleMap double_params;
+    int_params["nf"] = 4;
+    str_params["model"] = "nch";
+    double_params["l"] = 16e-9;
+    layout.add_inst("basic", "nmos", "layout", "X0", 1.0, 2.0, "MX", int_params, str_params,
+            double_params, 2, 3, 0.5, 0.25);
+
+    unsigned int m1 = layout.get_lpp_id("M1", "drawing");
+    unsigned int m2 = layout.get_lpp_id("M2", "drawing");
+    layout.add_rect(m1, 0, 0, 0.1, 0.2);
+    layout.add_rect(m2, 0.2, 0, 0.3, 0.1, 3, 2, 0.3, 0.4);
+    layout.add_path_seg(m1, 0, 0, 1, 0, 0.05, "truncate", "extend");
+    const double path_xy[] = { 0, 0, 0, 1, 1, 1 };
+    layout.add_path(m2, 3, path_xy, 0.1, "round", "truncate", "extend");
+    layout.add_via("M1_M2", 0.5, 0.5, "R0", 2, 1, 0.1, 0.1, 0.01, 0.02, 0.01, 0.02, 0.0, 0.01, 0.0,
+            0.01, 0.05, 0.05, 2, 1, 0.4, 0);
+    layout.add_pin("VDD", "VDD1", "VDD:", m1, 0, 0, 0.1, 0.4);
+    const double poly_xy[] = { 0, 0, 1, 0, 0, 1 };
+    layout.add_polygon(m1, 3, poly_xy);
+    const double box_xy[] = { 0, 0, 2, 0, 2, 2, 0, 2 };
+    layout.add_blockage("routing", "M1", 4, box_xy);
+    layout.add_boundary("PR", 4, box_xy);
+}
+
+bag::LayoutSectionEntry & get_entry(std::vector<char> & buf, unsigned int sec) {
+    return reinterpret_cast<bag::LayoutSectionEntry *>(buf.data()
+            + sizeof(bag::LayoutImageHeader))[sec];
+}
+
+// coordinates that do not fit in 32 bits are rejected on every quantize
+// path, and leave a gridded layout unchanged.
+void test_out_of_range() {
+    bag::Grid grid(1000, 1);
+    double vals[9] = { 0, 0.001, 0.0015, -0.0015, 0, 0, 0, 0, 0 };
+    int32_t out[9];
+    check(bag::quantize(vals, out, 9, grid) == 2 && out[2] == 2 && out[3] == -2,
+            "in-range values rounded half away from zero");
+    for (unsigned int idx = 0; idx < 9; idx++) {
+        double saved = vals[idx];
+        for (unsigned int k = 0; k < 2; k++) {
+            vals[idx] = (k == 0) ? 3e6 : NAN;
+            bool rejected = false;
+            try {
+                bag::quantize(vals, out, 9, grid);
+            } catch (std::invalid_argument &) {
+                rejected = true;
+            }
+            std::ostringstream what;
+            what << "value " << vals[idx] << " at " << idx << " rejected";
+            check(rejected, what.str());
+        }
+        vals[idx] = saved;
+    }
+    vals[0] = 2147483.647;
+    vals[1] = -2147483.647;
+    check(bag::quantize(vals, out, 2, grid) == 0 && out[0] == INT32_MAX && out[1] == -INT32_MAX,
+            "largest values kept");
+
+    bag::Layout layout(1000, 1);
+    unsigned int m1 = layout.get_lpp_id("M1", "drawing");
+    layout.add_rect(m1, 0, 0, 0.1, 0.1);
+    const double xy[] = { 0, 0, 1e7, 0, 0, 1 };
+    unsigned int num_rejected = 0;
+    try {
+        layout.add_rect(m1, 0, 0, 0.1, 0.1, 2, 1, 1e7, 0);
+    } catch (std::invalid_argument &) {
+        num_rejected++;
+    }
+    try {
+        layout.add_polygon(m1, 3, xy);
+    } catch (std::invalid_argument &) {
+        num_rejected++;
+    }
+    try {
+        layout.add_via("M1_M2", 0, 0, "R0", 1, 1, 0, 0, 0, 0, 0, 0, 1e7, 0, 0, 0, -1, -1);
+    } catch (std::invalid_argument &) {
+        num_rejected++;
+    }
+    check(num_rejected == 3, "layout rejects out of range coordinates");
+    check(layout.rect_list.size() == 1 && layout.rect_list.bbox.size() == 4
+            && layout.rect_list.arr_sp.size() == 2, "rejected rectangle not stored");
+    check(layout.polygon_list.empty() && layout.point_arena.size() == 0,
+            "rejected polygon not stored");
+    check(layout.via_list.size() == 0 && layout.via_list.loc.size() == 0
+            && layout.via_list.enc1.size() == 0, "rejected via not stored");
+}
+
+// every section survives a round trip, with and without a grid.
+void test_round_trip() {
+    for (unsigned int gridded = 0; gridded < 2; gridded++) {
+        bag::Layout layout;
+        if (gridded) {
+            layout.set_grid(1000, 5);
+        }
+        fill_layout(layout);
+
+        std::vector<char> buf;
+        bag::serialize_layout(layout, buf);
+        bag::LayoutImage image(buf.data(), buf.size());
+        for (unsigned int sec = 0; sec < bag::num_layout_sections; sec++) {
+            std::ostringstream what;
+            what << "section " << sec << " is not empty";
+            check(image.count(sec) > 0, what.str());
+        }
+
+        bag::Layout copy;
+        bag::deserialize_layout(buf.data(), buf.size(), copy);
+        std::vector<char> buf2;
+        bag::serialize_layout(copy, buf2);
+        check(buf == buf2, "image of the copy is the same");
+        check(copy.get_grid() == layout.get_grid(), "grid kept");
+        check(bag::same_layout(layout, copy, bag::Grid(1000, 5)), "copy has the same content");
+    }
+}
+
+// images that are truncated or point outside themselves are rejected.
+void test_corrupt_images() {
+    bag::Layout layout;
+    fill_layout(layout);
+    std::vector<char> good;
+    bag::serialize_layout(layout, good);
+
+    check_rejected(std::vector<char>(good.begin(), good.begin() + 16), "a truncated header");
+    check_rejected(std::vector<char>(good.begin(), good.begin() + good.size() / 2),
+            "a truncated image");
+
+    std::vector<char> buf(good);
+    buf[0] = 'X';
+    check_rejected(buf, "a bad magic");
+
+    buf = good;
+    reinterpret_cast<bag::LayoutImageHeader *>(buf.data())->version++;
+    check_rejected(buf, "another version");
+
+    buf = good;
+    get_entry(buf, bag::sec_rect_bbox).count = 1000000;
+    check_rejected(buf, "a section past the end");
+
+    buf = good;
+    get_entry(buf, bag::sec_rect_bbox).offset += 4;
+    check_rejected(buf, "a misaligned section");
+
+    buf = good;
+    uint32_t * lpp = reinterpret_cast<uint32_t *>(buf.data()
+            + get_entry(buf, bag::sec_rect_lpp).offset);
+    lpp[0] = 1000;
+    check_rejected(buf, "a layer/purpose id out of range");
+
+    buf = good;
+    uint64_t * poly = reinterpret_cast<uint64_t *>(buf.data()
+            + get_entry(buf, bag::sec_poly_pts).offset);
+    poly[1] = 1000;
+    check_rejected(buf, "a point range out of range");
+}
+
+// pickling hands the image to Python as bytes, which may not be aligned.
+void test_pickle_buffer() {
+    bag::Layout layout;
+    layout.set_grid(1000, 1);
+    fill_layout(layout);
+    std::vector<char> buf;
+    bag::serialize_layout(layout, buf);
+
+    std::vector<char> shifted(buf.size() + 1);
+    std::memcpy(shifted.data() + 1, buf.data(), buf.size());
+    bag::Layout copy;
+    bag::deserialize_layout(shifted.data() + 1, buf.size(), copy);
+    check(bag::same_layout(layout, copy, bag::Grid(1000, 1)), "unaligned image read");
+
+    // a reused layout drops its previous content.
+    bag::deserialize_layout(buf.data(), buf.size(), copy);
+    check(copy.rect_list.size() == layout.rect_list.size(), "image replaces old content");
+}
+
+// the hash ignores shape order and layer ids, and sees a one unit change.
+void test_hash() {
+    bag::Grid grid(1000, 1);
+    bag::Layout first, second, changed;
+    unsigned int m1 = first.get_lpp_id("M1", "drawing");
+    unsigned int m2 = first.get_lpp_id("M2", "drawing");
+    first.add_rect(m1, 0, 0, 0.1, 0.1);
+    first.add_rect(m2, 0, 0, 0.2, 0.2, 2, 2, 0.5, 0.5);
+    first.add_pin("A", "A", "A", m1, 0, 0, 0.1, 0.1);
+    first.add_pin("B", "B", "B", m2, 0, 0, 0.2, 0.2);
+
+    // layers interned in the other order, and shapes added in reverse.
+    m2 = second.get_lpp_id("M2", "drawing");
+    m1 = second.get_lpp_id("M1", "drawing");
+    second.add_pin("B", "B", "B", m2, 0, 0, 0.2, 0.2);
+    second.add_pin("A", "A", "A", m1, 0, 0, 0.1, 0.1);
+    second.add_rect(m2, 0, 0, 0.2, 0.2, 2, 2, 0.5, 0.5);
+    second.add_rect(m1, 0, 0, 0.1000001, 0.1);
+
+    m1 = changed.get_lpp_id("M1", "drawing");
+    m2 = changed.get_lpp_id("M2", "drawing");
+    changed.add_rect(m1, 0, 0, 0.101, 0.1);
+    changed.add_rect(m2, 0, 0, 0.2, 0.2, 2, 2, 0.5, 0.5);
+    changed.add_pin("A", "A", "A", m1, 0, 0, 0.1, 0.1);
+    changed.add_pin("B", "B", "B", m2, 0, 0, 0.2, 0.2);
+
+    check(bag::hash_layout(first, grid) == bag::hash_layout(second, grid),
+            "hash does not depend on order");
+    check(bag::same_layout(first, second, grid), "same content in another order");
+    check(bag::hash_layout(first, grid) != bag::hash_layout(changed, grid),
+            "hash sees a one unit change");
+    check(!bag::same_layout(first, changed, grid), "one unit change is a difference");
+
+    bag::LayoutLibrary lib("lib", "layout", 1000, 1);
+    lib.add_cell("first", first);
+    check(lib.add_cell("second", second) == "first", "duplicate cell aliased");
+    check(lib.add_cell("changed", changed) == "changed", "changed cell stored");
+    check(lib.size() == 2 && lib.get_num_duplicates() == 1, "library cell counts");
+}
+
+std::string read_file(const std::string & fname) {
+    std::ifstream in(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// a GDSII stream as one line per record.  Timestamps are not printed.
+std::string dump_gds(const std::string & data) {
+    const char * names[] = { "HEADER", "BGNLIB", "LIBNAME", "UNITS", "ENDLIB", "BGNSTR",
+            "STRNAME", "ENDSTR", "BOUNDARY", "PATH", "SREF", "AREF", "TEXT", "LAYER",
+            "DATATYPE", "WIDTH", "XY", "ENDEL", "SNAME", "COLROW", "", "", "TEXTTYPE",
+            "PRESENTATION", "", "STRING", "STRANS", "", "ANGLE" };
+    const unsigned char * ptr = reinterpret_cast<const unsigned char *>(data.data());
+    std::ostringstream os;
+    std::size_t pos = 0;
+    while (pos + 4 <= data.size()) {
+        std::size_t len = (ptr[pos] << 8) | ptr[pos + 1];
+        unsigned int rec = ptr[pos + 2];
+        unsigned int type = ptr[pos + 3];
+        if (len < 4 || pos + len > data.size()) {
+            return os.str() + "BAD RECORD\n";
+        }
+        os << ((rec < sizeof(names) / sizeof(names[0])) ? names[rec] : "?");
+        const unsigned char * val = ptr + pos + 4;
+        std::size_t num_bytes = len - 4;
+        if (rec == 0x01 || rec == 0x05) {
+            os << " *";
+        } else if (type == 1 || type == 2) {
+            for (std::size_t idx = 0; idx + 2 <= num_bytes; idx += 2) {
+                os << " " << (int16_t) ((val[idx] << 8) | val[idx + 1]);
+            }
+        } else if (type == 3) {
+            for (std::size_t idx = 0; idx + 4 <= num_bytes; idx += 4) {
+                os << " " << (int32_t) (((uint32_t) val[idx] << 24) | (val[idx + 1] << 16)
+                        | (val[idx + 2] << 8) | val[idx + 3]);
+            }
+        } else if (type == 5) {
+            for (std::size_t idx = 0; idx + 8 <= num_bytes; idx += 8) {
+                uint64_t mantissa = 0;
+                for (unsigned int j = 1; j < 8; j++) {
+                    mantissa = (mantissa << 8) | val[idx + j];
+                }
+                double x = std::ldexp((double) mantissa, 4 * ((val[idx] & 0x7F) - 64) - 56);
+                os << " " << ((val[idx] & 0x80) ? -x : x);
+            }
+        } else if (type == 6) {
+            os << " " << std::string(reinterpret_cast<const char *>(val), num_bytes).c_str();
+        }
+        os << "\n";
+        pos += len;
+    }
+    return os.str();
+}
+
+// a cell with a rectangle, an arrayed rectangle and a pin.
+void fill_known_cell(bag::Layout & layout) {
+    unsigned int m1 = layout.get_lpp_id("M1", "drawing");
+    layout.add_rect(m1, 0, 0, 0.1, 0.2);
+    layout.add_rect(m1, 0.2, 0, 0.3, 0.1, 3, 2, 0.3, 0.4);
+    layout.add_pin("VDD", "VDD", "VDD", layout.get_lpp_id("M1", "pin"), 0, 0, 0.1, 0.4);
+}
+
+void test_gds() {
+    const char * fname = "test_layout.gds";
+    bag::Layout layout;
+    fill_known_cell(layout);
+    bag::GdsWriter writer;
+    writer.open(fname, "testlib");
+    writer.add_layer("M1", 1);
+    writer.add_purpose("drawing", 0);
+    writer.add_purpose("pin", 2);
+    writer.create_layout("top", "layout", layout);
+    writer.close();
+    std::string dump = dump_gds(read_file(fname));
+    std::remove(fname);
+
+    check(dump == "HEADER 600\nBGNLIB *\nLIBNAME testlib\nUNITS 0.001 1e-09\n"
+            "BGNSTR *\nSTRNAME top\n"
+            "BOUNDARY\nLAYER 1\nDATATYPE 0\nXY 0 0 100 0 100 200 0 200 0 0\nENDEL\n"
+            "AREF\nSNAME top$rect_1_0_100x100\nCOLROW 3 2\nXY 200 0 1100 0 200 800\nENDEL\n"
+            "TEXT\nLAYER 1\nTEXTTYPE 2\nPRESENTATION 5\nSTRANS 0\nANGLE 90\nXY 50 200\n"
+            "STRING VDD\nENDEL\n"
+            "BOUNDARY\nLAYER 1\nDATATYPE 2\nXY 0 0 100 0 100 400 0 400 0 0\nENDEL\n"
+            "ENDSTR\n"
+            "BGNSTR *\nSTRNAME top$rect_1_0_100x100\n"
+            "BOUNDARY\nLAYER 1\nDATATYPE 0\nXY 0 0 100 0 100 100 0 100 0 0\nENDEL\n"
+            "ENDSTR\nENDLIB\n", "GDS records of the known cell");
+}
+
+// arrayed vias and their cut arrays are references, not flat boxes.
+void test_gds_vias() {
+    const char * fname = "test_layout_via.gds";
+    bag::Layout layout;
+    layout.add_via("M1_M2", 1.0, 1.0, "R90", 1, 2, 0.02, 0.02, 0.01, 0.01, 0.01, 0.01, 0.01,
+            0.01, 0.01, 0.01, 0.02, 0.02, 3, 2, 0.5, 0.4);
+    layout.add_via("M1_M2", 3.0, 3.0, "R90", 1, 2, 0.02, 0.02, 0.01, 0.01, 0.01, 0.01, 0.01,
+            0.01, 0.01, 0.01, 0.02, 0.02);
+    bag::GdsWriter writer;
+    writer.open(fname, "testlib");
+    writer.add_layer("M1", 1);
+    writer.add_layer("V1", 2);
+    writer.add_layer("M2", 3);
+    writer.add_purpose("drawing", 0);
+    writer.add_via_def("M1_M2", "M1", "V1", "M2", "drawing", 0.02, 0.02);
+    writer.create_layout("top", "layout", layout);
+    writer.close();
+    std::string dump = dump_gds(read_file(fname));
+    std::remove(fname);
+
+    std::string cells = dump.substr(dump.find("STRNAME top\n"));
+    check(cells == "STRNAME top\n"
+            "AREF\nSNAME top$via_M1_M2_1\nSTRANS 0\nANGLE 90\nCOLROW 3 2\n"
+            "XY 1000 1000 2500 1000 1000 1800\nENDEL\n"
+            "SREF\nSNAME top$via_M1_M2_1\nSTRANS 0\nANGLE 90\nXY 3000 3000\nENDEL\n"
+            "ENDSTR\n"
+            "BGNSTR *\nSTRNAME top$via_M1_M2_1\n"
+            "BOUNDARY\nLAYER 1\nDATATYPE 0\nXY -40 -20 40 -20 40 20 -40 20 -40 -20\nENDEL\n"
+            "BOUNDARY\nLAYER 3\nDATATYPE 0\nXY -40 -20 40 -20 40 20 -40 20 -40 -20\nENDEL\n"
+            "AREF\nSNAME top$rect_2_0_20x20\nCOLROW 2 1\nXY -30 -10 50 -10 -30 30\nENDEL\n"
+            "ENDSTR\n"
+            "BGNSTR *\nSTRNAME top$rect_2_0_20x20\n"
+            "BOUNDARY\nLAYER 2\nDATATYPE 0\nXY 0 0 20 0 20 20 0 20 0 0\nENDEL\n"
+            "ENDSTR\nENDLIB\n", "GDS records of arrayed vias");
+
+    // polygons past the XY record limit are refused, not dropped.
+    bag::Layout big;
+    std::vector<double> xy;
+    for (unsigned int idx = 0; idx < 9000; idx++) {
+        xy.push_back(idx * 0.001);
+        xy.push_back((idx % 2) * 0.001);
+    }
+    big.add_polygon(big.get_lpp_id("M1", "drawing"), 9000, xy.data());
+    writer.open(fname, "testlib");
+    bool rejected = false;
+    try {
+        writer.create_layout("big", "layout", big);
+    } catch (std::invalid_argument &) {
+        rejected = true;
+    }
+    writer.close();
+    std::remove(fname);
+    check(rejected, "GDS polygon over the point limit rejected");
+}
+
+uint64_t get_uint(const unsigned char * ptr, std::size_t & pos) {
+    uint64_t val = 0;
+    for (unsigned int shift = 0;; shift += 7) {
+        unsigned char byte = ptr[pos++];
+        val |= ((uint64_t) (byte & 0x7F)) << shift;
+        if ((byte & 0x80) == 0) {
+            return val;
+        }
+    }
+}
+
+int64_t get_sint(const unsigned char * ptr, std::size_t & pos) {
+    uint64_t val = get_uint(ptr, pos);
+    return (val & 1) ? -(int64_t) (val >> 1) : (int64_t) (val >> 1);
+}
+
+// an uncompressed OASIS file of rectangles as one line per record, with
+// modal values filled in.
+std::string dump_oasis(const std::string & data) {
+    const std::string magic("%SEMI-OASIS\r\n");
+    if (data.compare(0, magic.size(), magic) != 0) {
+        return "BAD MAGIC\n";
+    }
+    const unsigned char * ptr = reinterpret_cast<const unsigned char *>(data.data());
+    std::size_t pos = magic.size();
+    std::ostringstream os;
+    uint64_t layer = 0, datatype = 0, width = 0, height = 0;
+    int64_t x = 0, y = 0;
+    while (pos < data.size()) {
+        uint64_t rec = get_uint(ptr, pos);
+        if (rec == 1) {
+            std::size_t len = get_uint(ptr, pos);
+            os << "START " << data.substr(pos, len);
+            pos += len;
+            get_uint(ptr, pos);
+            os << " " << get_uint(ptr, pos);
+            for (unsigned int idx = 0; idx < 13; idx++) {
+                get_uint(ptr, pos);
+            }
+        } else if (rec == 14) {
+            std::size_t len = get_uint(ptr, pos);
+            os << "CELL " << data.substr(pos, len);
+            pos += len;
+            x = y = 0;
+        } else if (rec == 20) {
+            unsigned char info = ptr[pos++];
+            layer = (info & 0x01) ? get_uint(ptr, pos) : layer;
+            datatype = (info & 0x02) ? get_uint(ptr, pos) : datatype;
+            width = (info & 0x40) ? get_uint(ptr, pos) : width;
+            height = (info & 0x80) ? width : ((info & 0x20) ? get_uint(ptr, pos) : height);
+            x = (info & 0x10) ? get_sint(ptr, pos) : x;
+            y = (info & 0x08) ? get_sint(ptr, pos) : y;
+            os << "RECTANGLE " << layer << "/" << datatype << " " << width << "x" << height
+                    << " at " << x << " " << y;
+            if (info & 0x04) {
+                uint64_t rep = get_uint(ptr, pos);
+                os << " rep " << rep;
+                unsigned int num_vals = (rep == 1) ? 4 : ((rep == 2 || rep == 3) ? 2 : 0);
+                for (unsigned int idx = 0; idx < num_vals; idx++) {
+                    os << " " << get_uint(ptr, pos);
+                }
+            }
+        } else if (rec == 2) {
+            os << "END\n";
+            break;
+        } else {
+            os << "RECORD " << rec << "\n";
+            break;
+        }
+        os << "\n";
+    }
+    return os.str();
+}
+
+void test_oasis() {
+    const char * fname = "test_layout.oas";
+    bag::Layout layout;
+    unsigned int m1 = layout.get_lpp_id("M1", "drawing");
+    layout.add_rect(m1, 0, 0, 0.1, 0.2);
+    layout.add_rect(m1, 0.2, 0, 0.3, 0.1, 3, 2, 0.3, 0.4);
+    // corners given in the other order
+    layout.add_rect(m1, 0.3, 0.6, 0.2, 0.5);
+    bag::OasisWriter writer;
+    writer.open(fname, 1000, 1, false);
+    writer.add_layer("M1", 1);
+    writer.add_purpose("drawing", 0);
+    writer.create_layout("top", "layout", layout);
+    writer.close();
+    std::string data = read_file(fname);
+    std::remove(fname);
+
+    check(dump_oasis(data) == "START 1.0 1000\nCELL top\n"
+            "RECTANGLE 1/0 100x200 at 0 0\n"
+            "RECTANGLE 1/0 100x100 at 200 0 rep 1 1 0 300 400\n"
+            "RECTANGLE 1/0 100x100 at 200 500\n"
+            "END\n", "OASIS records of the known cell");
+    check(data.size() >= 256, "OASIS END record padded");
+}
+
+// arrays are matched element by element, not by their bounding box.
+void test_spatial() {
+    bag::Layout layout;
+    unsigned int m1 = layout.get_lpp_id("M1", "drawing");
+    // elements at x [0, 0.1], [0.3, 0.4], [0.6, 0.7] and y [0, 0.1], [0.4, 0.5]
+    layout.add_rect(m1, 0, 0, 0.1, 0.1, 3, 2, 0.3, 0.4);
+    // in the gap between the first two columns
+    layout.add_rect(m1, 0.15, 0, 0.25, 0.5);
+    // over the top right element
+    layout.add_rect(m1, 0.65, 0.45, 0.8, 0.6);
+
+    bag::SpatialIndex index;
+    index.build(layout);
+
+    bag::ShapeRefList hits;
+    const double gap[] = { 0.11, 0.2, 0.14, 0.3 };
+    index.query_box(bag::group_lpp, m1, gap, hits);
+    check(hits.empty(), "box between array elements meets nothing");
+
+    hits.clear();
+    const double inside[] = { 0.62, 0.42, 0.64, 0.44 };
+    index.query_box(bag::group_lpp, m1, inside, hits);
+    check(hits.size() == 1 && hits[0].kind == bag::kind_rect && hits[0].index == 0,
+            "box inside the last array element meets the array");
+
+    hits.clear();
+    const double touch[] = { 0.4, 0.5, 0.45, 0.55 };
+    index.query_box(bag::group_lpp, m1, touch, hits);
+    check(hits.size() == 1 && hits[0].index == 0, "touching an array element counts");
+
+    bag::ShapeRef ref;
+    double dist;
+    check(index.nearest(bag::group_lpp, m1, 0.5, 0.45, ref, dist), "nearest shape found");
+    check(ref.index == 0 && std::fabs(dist - 0.1) < 1e-9, "nearest is an array element");
+
+    bag::ShapePairList pairs;
+    index.overlap_pairs(bag::group_lpp, m1, pairs);
+    check(pairs.size() == 1, "one overlapping pair");
+    if (pairs.size() == 1) {
+        std::size_t lo = std::min(pairs[0].first.index, pairs[0].second.index);
+        std::size_t hi = std::max(pairs[0].first.index, pairs[0].second.index);
+        check(lo == 0 && hi == 2, "array overlaps the rectangle on its last element");
+    }
+}
+
+// layers without shapes still get a tree when the index is built.
+void test_spatial_empty() {
+    bag::Layout layout;
+    unsigned int m1 = layout.get_lpp_id("M1", "drawing");
+    unsigned int m2 = layout.get_lpp_id("M2", "drawing");
+    layout.add_rect(m2, 0, 0, 0.1, 0.1);
+
+    bag::SpatialIndex index;
+    index.build(layout);
+    bag::ShapeRefList hits;
+    const double box[] = { 0, 0, 1, 1 };
+    index.query_box(bag::group_lpp, m1, box, hits);
+    check(hits.empty(), "empty layer meets nothing");
+    bag::ShapeRef ref;
+    double dist;
+    check(!index.nearest(bag::group_lpp, m1, 0, 0, ref, dist), "empty layer has no nearest");
+    bag::ShapePairList pairs;
+    index.overlap_pairs(bag::group_lpp, m1, pairs);
+    check(pairs.empty(), "empty layer has no pairs");
+}
+
+int main() {
+    try {
+        test_out_of_range();
+        test_round_trip();
+        test_corrupt_images();
+        test_pickle_buffer();
+        test_hash();
+        test_gds();
+        test_gds_vias();
+        test_oasis();
+        test_spatial();
+        test_spatial_empty();
+    } catch (std::exception & ex) {
+        std::cerr << "FAILED: " << ex.what() << std::endl;
+        num_failed++;
+    }
+    if (num_failed == 0) {
+        std::cout << "all checks passed" << std::endl;
+    }
+    return num_failed;
+}
@@ -0,0 +1,254 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+#include "bagoa.hpp"
+
+// checks of the OA writers against the recording OA stub in test/oastub, so
+// no OA install is needed.  Exits with the number of failed checks.
+
+int num_failed = 0;
+
+void check(bool ok, const std::string & what) {
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        num_failed++;
+    }
+}
+
+void fill_layout(bag::Layout & layout, std::size_t num_rects) {
+    unsigned int lpp = layout.get_lpp_id("M1", "drawing");
+    for (std::size_t idx = 0; idx < num_rects; idx++) {
+        double x = (idx % 100) * 0.2;
+        double y = (idx / 100) * 0.2;
+        layout.add_rect(lpp, x, y, x + 0.1, y + 0.1);
+    }
+}
+
+void open_library(bagoa::OALayoutLibrary & lib, const std::string & name) {
+    lib.open_library("./cds.lib", name, "./" + name, "stub_tech");
+    lib.set_skip_unchanged(false);
+    lib.add_layer("M1", 1);
+    lib.add_purpose("drawing", 0);
+}
+
+// two libraries written from two threads, one through the write queue, must
+// never use OA at the same time.
+void test_two_libraries() {
+    oa::stub::reset();
+    const unsigned int num_cells = 20;
+    bagoa::OALayoutLibrary lib_a, lib_b;
+    open_library(lib_a, "stub_lib_a");
+    open_library(lib_b, "stub_lib_b");
+
+    std::thread other([&lib_b]() {
+        for (unsigned int idx = 0; idx < num_cells; idx++) {
+            bag::Layout layout;
+            fill_layout(layout, 2000);
+            lib_b.create_layout("cell_b" + std::to_string(idx), "layout", layout);
+        }
+    });
+    std::vector<bagoa::WriteTicket> tickets;
+    for (unsigned int idx = 0; idx < num_cells; idx++) {
+        bag::Layout layout;
+        fill_layout(layout, 2000);
+        tickets.push_back(lib_a.create_layout_async("cell_a" + std::to_string(idx), "layout",
+                std::move(layout)));
+    }
+    other.join();
+    lib_a.close();
+    lib_b.close();
+
+    for (unsigned int idx = 0; idx < num_cells; idx++) {
+        check(tickets[idx].is_done(), "queued write finished by close()");
+    }
+    check(oa::stub::counts()[oa::stub::call_design_save] == 2 * num_cells,
+            "every layout of both libraries saved");
+    check(oa::stub::counts()[oa::stub::call_rect] == 2 * num_cells * 2000,
+            "every rectangle of both libraries written");
+    check(oa::stub::num_overlaps() == 0, "OA used from one thread at a time");
+}
+
+// the content hash is only computed and stored when unchanged layouts are skipped.
+void test_skip_unchanged() {
+    oa::stub::reset();
+    bagoa::OALayoutLibrary lib;
+    open_library(lib, "stub_lib");
+    bag::Layout layout;
+    fill_layout(layout, 10);
+    bagoa::PreparedLayout prep;
+    lib.prepare_layout(layout, prep);
+    check(prep.hash.empty(), "no hash without skipping");
+    lib.create_layout("cell", "layout", layout);
+    check(oa::stub::counts()[oa::stub::call_prop] == 0, "no hash property without skipping");
+
+    lib.set_skip_unchanged(true);
+    lib.prepare_layout(layout, prep);
+    check(prep.hash.size() == 16, "hash computed when skipping");
+    lib.create_layout("cell", "layout", layout);
+    check(oa::stub::counts()[oa::stub::call_prop] == 1, "hash property stored when skipping");
+    lib.close();
+}
+
+// vias and pins snapped by prepare_layout(), with enclosures and offsets
+// snapped once from the enclosure boxes and off-grid results counted.
+void test_prepare_vias() {
+    bagoa::OALayoutLibrary lib;
+    open_library(lib, "stub_lib");
+    bag::Layout layout;
+    layout.add_via("M1_M2", 1.0, 2.0, "R0", 2, 3, 0.1, 0.2, 0.01, 0.02, 0.03, 0.04, 0.011, 0,
+            0, 0, -1, -1, 2, 1, 0.5, 0);
+    // off-grid edges with an on-grid center are not rounded twice
+    layout.add_via("M1_M2", 0, 0, "R0", 1, 1, 0, 0, 0.0002, 0, 0.0006, 0, 0, 0, 0, 0, -1, -1);
+    layout.add_pin("VDD", "VDD", "VDD:", "M1", "drawing", 0.0005, 0, 0.1, 0.1);
+    bagoa::PreparedLayout prep;
+    lib.prepare_layout(layout, prep);
+    lib.close();
+
+    const int32_t expected[] = { 1000, 2000, 200, 100, 20, 30, 10, 10, 6, 0, -6, 0, -1000,
+            -1000, 500, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1000, -1000, 0, 0 };
+    check(prep.via_par == std::vector<int32_t>(expected, expected + 32), "via parameters");
+    const int32_t pin_expected[] = { 1, 0, 100, 100 };
+    check(prep.pin_box == std::vector<int32_t>(pin_expected, pin_expected + 4), "pin box");
+    check(prep.num_off_grid == 5, "off-grid via enclosures and pin counted");
+}
+
+// the terms, nets and instances of a block, one per line in sorted order.
+// Each instance is listed with its cell, x offset and connections.
+std::string describe(oa::oaBlock * blk_ptr) {
+    const oa::oaNativeNS ns;
+    std::vector<std::string> lines;
+    oa::oaString name;
+    oa::oaIter<oa::oaTerm> term_iter(blk_ptr->getTerms());
+    while (oa::oaTerm * term = term_iter.getNext()) {
+        term->getName(ns, name);
+        lines.push_back("term " + std::string(name));
+    }
+    oa::oaIter<oa::oaNet> net_iter(blk_ptr->getNets());
+    while (oa::oaNet * net = net_iter.getNext()) {
+        net->getName(ns, name);
+        lines.push_back("net " + std::string(name));
+    }
+    oa::oaIter<oa::oaInst> inst_iter(blk_ptr->getInsts());
+    while (oa::oaInst * inst = inst_iter.getNext()) {
+        oa::oaString cell;
+        oa::oaTransform xfm;
+        inst->getName(ns, name);
+        inst->getCellName(ns, cell);
+        inst->getTransform(xfm);
+        std::ostringstream line;
+        line << "inst " << name << " " << cell << " " << xfm.xOffset();
+        std::vector<std::string> conns;
+        oa::oaIter<oa::oaInstTerm> conn_iter(inst->getInstTerms());
+        while (oa::oaInstTerm * inst_term = conn_iter.getNext()) {
+            oa::oaName term_name;
+            oa::oaString term_str;
+            inst_term->getTermName(term_name);
+            term_name.get(ns, term_str);
+            inst_term->getNet()->getName(ns, name);
+            conns.push_back(" " + std::string(term_str) + "=" + std::string(name));
+        }
+        std::sort(conns.begin(), conns.end());
+        for (std::size_t idx = 0; idx < conns.size(); idx++) {
+            line << conns[idx];
+        }
+        lines.push_back(line.str());
+    }
+    std::sort(lines.begin(), lines.end());
+    std::string ans;
+    for (std::size_t idx = 0; idx < lines.size(); idx++) {
+        ans += lines[idx] + "\n";
+    }
+    return ans;
+}
+
+// a pin renamed to a net that already exists, another renamed plainly, and a
+// vector instance replaced by two masters, checked on the names the stub tracks.
+void test_schematic_edits() {
+    oa::stub::reset();
+    oa::stub::track_names() = true;
+    oa::stub::cell_widths()["nand"] = 400;
+    oa::stub::cell_widths()["inv"] = 300;
+    const oa::oaNativeNS ns;
+    const oa::oaCdbaNS ns_cdba;
+
+    // the template: pins IN and OUT, net VDD, and XINV<3:0> from IN to OUT.
+    oa::oaScalarName tmpl_lib(ns, "tmpl");
+    oa::oaScalarName tmpl_cell(ns, "chain");
+    oa::oaDesign * sch_ptr = oa::oaDesign::open(tmpl_lib, tmpl_cell,
+            oa::oaScalarName(ns, "schematic"), 'w');
+    oa::oaBlock * sch_blk = sch_ptr->getTopBlock();
+    oa::oaNet * net_in = oa::oaNet::create(sch_blk, oa::oaName(ns_cdba, "IN"));
+    oa::oaNet * net_out = oa::oaNet::create(sch_blk, oa::oaName(ns_cdba, "OUT"));
+    oa::oaNet::create(sch_blk, oa::oaName(ns_cdba, "VDD"));
+    oa::oaTerm::create(net_in, oa::oaName(ns_cdba, "IN"));
+    oa::oaTerm::create(net_out, oa::oaName(ns_cdba, "OUT"));
+    oa::oaInst * inst_ptr = oa::oaVectorInst::create(sch_blk, tmpl_lib,
+            oa::oaScalarName(ns, "inv"), oa::oaScalarName(ns, "symbol"),
+            oa::oaScalarName(ns, "XINV"), 3, 0, oa::oaTransform(1000, 0));
+    oa::oaInstTerm::create(net_in, inst_ptr, oa::oaName(ns_cdba, "A"));
+    oa::oaInstTerm::create(net_out, inst_ptr, oa::oaName(ns_cdba, "Y"));
+    sch_ptr->close();
+    oa::oaDesign * sym_ptr = oa::oaDesign::open(tmpl_lib, tmpl_cell,
+            oa::oaScalarName(ns, "symbol"), 'w');
+    oa::oaBlock * sym_blk = sym_ptr->getTopBlock();
+    oa::oaTerm::create(oa::oaNet::create(sym_blk, oa::oaName(ns_cdba, "IN")),
+            oa::oaName(ns_cdba, "IN"));
+    oa::oaTerm::create(oa::oaNet::create(sym_blk, oa::oaName(ns_cdba, "OUT")),
+            oa::oaName(ns_cdba, "OUT"));
+    sym_ptr->close();
+
+    bag::SchCell cell;
+    cell.lib_name = "tmpl";
+    cell.cell_name = "chain";
+    cell.new_cell_name = "chain_new";
+    cell.pin_map["IN"] = "VDD";
+    cell.pin_map["OUT"] = "Z";
+    std::vector<bag::SchInst> & inst_list = cell.inst_map["XINV<3:0>"];
+    inst_list.resize(2);
+    inst_list[0].inst_name = "XINV<3:0>";
+    inst_list[0].lib_name = "basic";
+    inst_list[0].cell_name = "nand";
+    inst_list[0].term_map["B"] = "EN";
+    inst_list[1].inst_name = "XBUF";
+    inst_list[1].lib_name = "basic";
+    inst_list[1].cell_name = "inv";
+    inst_list[1].params["nf"] = "2";
+
+    bagoa::OASchematicWriter writer;
+    writer.open_library("./cds.lib", "stub_lib");
+    writer.create_schematics(std::vector<bag::SchCell>(1, cell), "schematic", "symbol");
+    writer.close();
+
+    // the copies share the blocks of the template in the stub.
+    check(describe(sch_blk) == "inst XBUF inv 1400 A=VDD Y=Z\n"
+            "inst XINV<3:0> nand 1000 A=VDD B=EN Y=Z\n"
+            "net EN\nnet VDD\nnet Z\nterm VDD\nterm Z\n",
+            "schematic pins renamed and instance replaced");
+    check(describe(sym_blk) == "net VDD\nnet Z\nterm VDD\nterm Z\n", "symbol pins renamed");
+    check(oa::stub::counts()[oa::stub::call_vector_inst] == 2, "vector instances created");
+    check(oa::stub::num_overlaps() == 0, "OA used from one thread at a time");
+
+    oa::stub::clear_names();
+    oa::stub::cell_widths().clear();
+    oa::stub::track_names() = false;
+}
+
+int main() {
+    try {
+        test_two_libraries();
+        test_skip_unchanged();
+        test_prepare_vias();
+        test_schematic_edits();
+    } catch (std::exception & ex) {
+        std::cerr << "FAILED: " << ex.what() << std::endl;
+        num_failed++;
+    }
+    if (num_failed == 0) {
+        std::cout << "all checks passed" << std::endl;
+    }
+    return num_failed;
+}